@@ -1,9 +1,11 @@
 #include "audiocapture.h"
-#include "../ui/configwidget.h"
+#include "../config/audioconfiguration.h"
+#ifdef QWHISPER_HAVE_QTMULTIMEDIA
 #include <QAudioSource>
 #include <QAudioDevice>
 #include <QMediaDevices>
 #include <QAudioFormat>
+#endif
 #include <QIODevice>
 #include <QTimer>
 #include <QDebug>
@@ -89,9 +91,11 @@ void AudioCapture::stopCapture()
         m_captureTimer->stop();
     }
     
+#ifdef QWHISPER_HAVE_QTMULTIMEDIA
     if (m_audioInput) {
         m_audioInput->stop();
     }
+#endif
 
     if (m_pacatProcess) {
         m_pacatProcess->kill();
@@ -111,13 +115,16 @@ void AudioCapture::pauseCapture()
     
     m_isPaused = !m_isPaused;
     
-    if (m_isPaused) {
-        if (m_audioInput) m_audioInput->suspend();
-        emit statusChanged("Audio capture paused");
-    } else {
-        if (m_audioInput) m_audioInput->resume();
-        emit statusChanged("Audio capture resumed");
+#ifdef QWHISPER_HAVE_QTMULTIMEDIA
+    if (m_audioInput) {
+        if (m_isPaused) {
+            m_audioInput->suspend();
+        } else {
+            m_audioInput->resume();
+        }
     }
+#endif
+    emit statusChanged(m_isPaused ? "Audio capture paused" : "Audio capture resumed");
 }
 
 void AudioCapture::updateConfiguration(const AudioConfiguration &config)
@@ -129,10 +136,11 @@ void AudioCapture::updateConfiguration(const AudioConfiguration &config)
 
 void AudioCapture::processAudioData()
 {
-    if (!m_audioDevice || !m_isCapturing || m_isPaused) return;
+    if (!m_audioDevice || !m_isCapturing) return;
     
+    // pacat keeps recording while paused; what it captured meanwhile is dropped
     QByteArray data = m_audioDevice->readAll();
-    if (!data.isEmpty()) {
+    if (!data.isEmpty() && !m_isPaused) {
         emit audioDataReady(data);
         
         float level = calculateLevel(data);
@@ -142,89 +150,101 @@ void AudioCapture::processAudioData()
 
 void AudioCapture::setupAudioInput()
 {
+    // Check if we're trying to capture system audio
+    bool isSystemAudio = m_audioSource.toLower().contains("speaker") || 
+                        m_audioSource.toLower().contains("system");
+    
+    if (isSystemAudio) {
+        startPacat(m_deviceId + ".monitor");
+        return;
+    }
+    
+#ifdef QWHISPER_HAVE_QTMULTIMEDIA
     QAudioFormat format;
     format.setSampleRate(m_sampleRate);
     format.setChannelCount(m_channels);
     format.setSampleFormat(QAudioFormat::Int16);
     
-    // Get audio device
+    // For microphone input, use regular input devices
     QAudioDevice device;
-    
-    // Check if we're trying to capture system audio
-    bool isSystemAudio = m_audioSource.toLower().contains("speaker") || 
-                        m_audioSource.toLower().contains("system");
-    
-    if (isSystemAudio) {
-        if (m_pacatProcess) {
-            m_pacatProcess->kill();
-            m_pacatProcess->waitForFinished();
-            delete m_pacatProcess;
-            m_pacatProcess = nullptr;
+    if (!m_deviceId.isEmpty()) {
+        const auto devices = QMediaDevices::audioInputs();
+        for (const auto &d : devices) {
+            if (d.id() == m_deviceId.toUtf8()) {
+                device = d;
+                break;
+            }
         }
+    }
+    
+    if (device.isNull()) {
+        device = QMediaDevices::defaultAudioInput();
+    }
 
-        m_pacatProcess = new QProcess(this);
-        QStringList args;
-        args << "--record"
-             << "-d" << (m_deviceId + ".monitor")
-             << "--format=s16le"
-             << "--rate=16000"
-             << "--channels=1";
-        
-        m_pacatProcess->start("pacat", args);
+    if (device.isNull()) {
+        qDebug() << "No audio device available";
+        emit statusChanged("No audio device available");
+        return;
+    }
 
-        if (!m_pacatProcess->waitForStarted()) {
-            qDebug() << "Failed to start pacat process:" << m_pacatProcess->errorString();
-            emit statusChanged("Failed to start audio capture with pacat");
-            return;
-        }
+    if (!device.isFormatSupported(format)) {
+        format = device.preferredFormat();
+        qDebug() << "Using preferred format - Sample rate:" << format.sampleRate() 
+                 << "Channels:" << format.channelCount();
+    }
+
+    // Clean up any existing audio source
+    if (m_audioInput) {
+        m_audioInput->stop();
+        m_audioInput.reset();
+    }
+
+    m_audioInput = std::make_unique<QAudioSource>(device, format);
+    m_audioInput->setBufferSize(8192); // Set a reasonable buffer size
+    m_audioDevice = m_audioInput->start(); // This returns the QIODevice to read from
 
-        m_audioDevice = m_pacatProcess;
-        qDebug() << "Successfully started audio capture with pacat for device:" << m_deviceId;
+    if (!m_audioDevice) {
+        qDebug() << "Failed to start audio source with device:" << device.description();
+        emit statusChanged("Failed to start audio capture");
     } else {
-        // For microphone input, use regular input devices
-        if (!m_deviceId.isEmpty()) {
-            const auto devices = QMediaDevices::audioInputs();
-            for (const auto &d : devices) {
-                if (d.id() == m_deviceId.toUtf8()) {
-                    device = d;
-                    break;
-                }
-            }
-        }
-        
-        if (device.isNull()) {
-            device = QMediaDevices::defaultAudioInput();
-        }
-    
-        if (device.isNull()) {
-            qDebug() << "No audio device available";
-            emit statusChanged("No audio device available");
-            return;
-        }
-    
-        if (!device.isFormatSupported(format)) {
-            format = device.preferredFormat();
-            qDebug() << "Using preferred format - Sample rate:" << format.sampleRate() 
-                     << "Channels:" << format.channelCount();
-        }
-    
-        // Clean up any existing audio source
-        if (m_audioInput) {
-            m_audioInput->stop();
-            m_audioInput.reset();
-        }
-    
-        m_audioInput = std::make_unique<QAudioSource>(device, format);
-        m_audioInput->setBufferSize(8192); // Set a reasonable buffer size
-        m_audioDevice = m_audioInput->start(); // This returns the QIODevice to read from
+        qDebug() << "Successfully started audio capture with:" << device.description();
+    }
+#else
+    // The headless build has no Qt Multimedia: the microphone is read through
+    // pacat too, and device ids are PulseAudio source names
+    startPacat(m_deviceId);
+#endif
+}
+
+void AudioCapture::startPacat(const QString &source)
+{
+    if (m_pacatProcess) {
+        m_pacatProcess->kill();
+        m_pacatProcess->waitForFinished();
+        delete m_pacatProcess;
+        m_pacatProcess = nullptr;
+    }
+
+    m_pacatProcess = new QProcess(this);
+    QStringList args;
+    args << "--record";
+    if (!source.isEmpty()) {
+        args << "-d" << source;   // Otherwise PulseAudio's default source
+    }
+    args << "--format=s16le"
+         << "--rate=16000"
+         << "--channels=1";
     
-        if (!m_audioDevice) {
-            qDebug() << "Failed to start audio source with device:" << device.description();
-            emit statusChanged("Failed to start audio capture");
-        } else {
-            qDebug() << "Successfully started audio capture with:" << device.description();
-        }
+    m_pacatProcess->start("pacat", args);
+
+    if (!m_pacatProcess->waitForStarted()) {
+        qDebug() << "Failed to start pacat process:" << m_pacatProcess->errorString();
+        emit statusChanged("Failed to start audio capture with pacat");
+        return;
     }
+
+    m_audioDevice = m_pacatProcess;
+    qDebug() << "Successfully started audio capture with pacat for device:" << source;
 }
 
 float AudioCapture::calculateLevel(const QByteArray &data)
@@ -42,10 +42,13 @@ private slots:
 
 private:
     void setupAudioInput();
+    void startPacat(const QString &source);
     float calculateLevel(const QByteArray &data);
     
+#ifdef QWHISPER_HAVE_QTMULTIMEDIA
     std::unique_ptr<QAudioSource> m_audioInput;
-    QProcess *m_pacatProcess = nullptr;
+#endif
+    QProcess *m_pacatProcess = nullptr;   // System audio, and the microphone without Qt Multimedia
     QIODevice *m_audioDevice;
     QTimer *m_captureTimer = nullptr;
     bool m_isCapturing;
@@ -0,0 +1,503 @@
+#include "batchqueue.h"
+#include "../whisper/offlinetranscriber.h"
+#include "../whisper/whispermodels.h"
+#include "../whisper/devicemanager.h"
+#include "../config/configmanager.h"
+#include <QThread>
+#include <QTimer>
+#include <QFileSystemWatcher>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QTime>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QMetaObject>
+#include <QDebug>
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr int kSettleMs = 2000;          // A file's size must hold this long before it is queued
+constexpr int kMaxFinishedJobs = 1000;   // Finished entries kept in the journal
+
+QString stateName(BatchJob::State state)
+{
+    switch (state) {
+    case BatchJob::Queued: return "queued";
+    case BatchJob::Running: return "running";
+    case BatchJob::Done: return "done";
+    case BatchJob::Failed: return "failed";
+    }
+    return "queued";
+}
+
+BatchJob::State stateFromName(const QString &name)
+{
+    if (name == "done") {
+        return BatchJob::Done;
+    } else if (name == "failed") {
+        return BatchJob::Failed;
+    }
+    // Jobs that were running when we stopped start over
+    return BatchJob::Queued;
+}
+}
+
+BatchQueue::BatchQueue(QObject *parent)
+    : QObject(parent)
+    , m_configured(false)
+    , m_maxJobs(0)
+    , m_shuttingDown(false)
+    , m_watcher(new QFileSystemWatcher(this))
+    , m_settleTimer(new QTimer(this))
+{
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(kSettleMs);
+    connect(m_settleTimer, &QTimer::timeout, this, &BatchQueue::scanWatchFolder);
+
+    // inotify tells us something changed; wait for the writer to finish
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged,
+            m_settleTimer, QOverload<>::of(&QTimer::start));
+}
+
+BatchQueue::~BatchQueue()
+{
+    shutdown();
+}
+
+QString BatchQueue::defaultJournalPath()
+{
+    return QFileInfo(ConfigManager::instance().getConfigFilePath()).dir().filePath("batch-journal.json");
+}
+
+QString BatchQueue::outputPathFor(const QString &audioPath)
+{
+    const QFileInfo info(audioPath);
+    return QDir(info.absolutePath()).filePath(info.completeBaseName() + ".txt");
+}
+
+bool BatchQueue::isAudioFile(const QString &path)
+{
+    static const QStringList suffixes{"wav", "flac", "mp3", "ogg", "opus", "m4a", "aac"};
+    return suffixes.contains(QFileInfo(path).suffix().toLower());
+}
+
+void BatchQueue::loadJournal(const QString &path)
+{
+    m_journalPath = path;
+    m_jobs.clear();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonArray entries = QJsonDocument::fromJson(file.readAll()).object().value("jobs").toArray();
+    for (const QJsonValue &value : entries) {
+        const QJsonObject entry = value.toObject();
+        BatchJob job;
+        job.path = entry.value("path").toString();
+        job.priority = entry.value("priority").toInt(WatchPriority);
+        job.state = stateFromName(entry.value("state").toString());
+        job.queuedAt = static_cast<qint64>(entry.value("queuedAt").toDouble());
+        job.outputPath = entry.value("output").toString();
+        job.error = entry.value("error").toString();
+        if (!job.path.isEmpty()) {
+            m_jobs.append(job);
+        }
+    }
+
+    const int pending = std::count_if(m_jobs.begin(), m_jobs.end(),
+                                      [](const BatchJob &job) { return job.state == BatchJob::Queued; });
+    qDebug() << "Batch journal:" << m_jobs.size() << "jobs," << pending << "to resume";
+}
+
+void BatchQueue::saveJournal() const
+{
+    if (m_journalPath.isEmpty()) {
+        return;
+    }
+
+    QJsonArray entries;
+    for (const BatchJob &job : m_jobs) {
+        QJsonObject entry;
+        entry["path"] = job.path;
+        entry["priority"] = job.priority;
+        entry["state"] = stateName(job.state);
+        entry["queuedAt"] = static_cast<double>(job.queuedAt);
+        if (!job.outputPath.isEmpty()) {
+            entry["output"] = job.outputPath;
+        }
+        if (!job.error.isEmpty()) {
+            entry["error"] = job.error;
+        }
+        entries.append(entry);
+    }
+
+    // Write-and-rename, so a crash leaves the previous journal intact
+    QDir().mkpath(QFileInfo(m_journalPath).absolutePath());
+    QSaveFile file(m_journalPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "Cannot write batch journal" << m_journalPath << ":" << file.errorString();
+        return;
+    }
+    QJsonObject root;
+    root["jobs"] = entries;
+    file.write(QJsonDocument(root).toJson());
+    file.commit();
+}
+
+void BatchQueue::updateConfiguration(const AudioConfiguration &config)
+{
+    m_config = config;
+    m_configured = true;
+    m_maxJobs = config.batchJobs;
+
+    // Idle workers pick it up now, busy ones before their next file
+    for (const auto &worker : m_workers) {
+        const AudioConfiguration copy = config;
+        OfflineTranscriber *transcriber = worker->transcriber;
+        QMetaObject::invokeMethod(transcriber, [transcriber, copy]() {
+            transcriber->updateConfiguration(copy);
+        }, Qt::QueuedConnection);
+    }
+
+    setWatchFolder(config.batchWatchFolder);
+    dispatch();
+}
+
+void BatchQueue::setWatchFolder(const QString &folder)
+{
+    if (folder == m_watchFolder) {
+        return;
+    }
+    if (!m_watchFolder.isEmpty()) {
+        m_watcher->removePath(m_watchFolder);
+    }
+    m_watchFolder = folder;
+    m_pendingSizes.clear();
+
+    if (folder.isEmpty()) {
+        return;
+    }
+    if (!QFileInfo(folder).isDir() || !m_watcher->addPath(folder)) {
+        emit statusChanged(QString("Cannot watch folder %1").arg(folder));
+        return;
+    }
+    qDebug() << "Watching for recordings in" << folder;
+
+    // Pick up whatever arrived while we weren't running
+    scanWatchFolder();
+}
+
+void BatchQueue::scanWatchFolder()
+{
+    if (m_watchFolder.isEmpty()) {
+        return;
+    }
+
+    QHash<QString, qint64> stillPending;
+    const QFileInfoList files = QDir(m_watchFolder).entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+    for (const QFileInfo &info : files) {
+        const QString path = info.absoluteFilePath();
+        if (!isAudioFile(path) || findJob(path) >= 0 || QFile::exists(outputPathFor(path))) {
+            continue;
+        }
+
+        // Still being copied in while the size keeps changing between scans
+        const qint64 size = info.size();
+        if (size > 0 && m_pendingSizes.value(path, -1) == size) {
+            enqueue(path, WatchPriority);
+        } else {
+            stillPending.insert(path, size);
+        }
+    }
+
+    m_pendingSizes = stillPending;
+    if (!m_pendingSizes.isEmpty()) {
+        m_settleTimer->start();
+    }
+}
+
+bool BatchQueue::enqueue(const QString &path, int priority)
+{
+    const QString absolutePath = QFileInfo(path).absoluteFilePath();
+    if (!QFileInfo(absolutePath).isFile()) {
+        emit jobFailed(absolutePath, "File not found");
+        return false;
+    }
+
+    const int index = findJob(absolutePath);
+    if (index >= 0 && m_jobs[index].state == BatchJob::Running) {
+        return true;
+    }
+    if (index >= 0 && m_jobs[index].state == BatchJob::Queued) {
+        m_jobs[index].priority = std::max(m_jobs[index].priority, priority);
+    } else {
+        // New, or finished before and explicitly asked for again
+        BatchJob job;
+        job.path = absolutePath;
+        job.priority = priority;
+        job.queuedAt = QDateTime::currentMSecsSinceEpoch();
+        if (index >= 0) {
+            m_jobs.removeAt(index);
+        }
+        m_jobs.append(job);
+    }
+
+    qDebug() << "Queued" << absolutePath << "with priority" << priority;
+    saveJournal();
+    dispatch();
+    return true;
+}
+
+int BatchQueue::findJob(const QString &path) const
+{
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i].path == path) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int BatchQueue::nextJob() const
+{
+    int best = -1;
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        const BatchJob &job = m_jobs[i];
+        if (job.state != BatchJob::Queued) {
+            continue;
+        }
+        if (best < 0 || job.priority > m_jobs[best].priority ||
+            (job.priority == m_jobs[best].priority && job.queuedAt < m_jobs[best].queuedAt)) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+int BatchQueue::jobCapacity() const
+{
+    if (m_maxJobs > 0) {
+        return m_maxJobs;
+    }
+    // One GPU runs one file at a time well; on the CPU a job wants about four cores
+    if (m_config.computeDeviceType == 1) {
+        return 1;
+    }
+    return std::max(1, QThread::idealThreadCount() / 4);
+}
+
+BatchQueue::Worker *BatchQueue::idleWorker(bool allowNew)
+{
+    for (const auto &worker : m_workers) {
+        if (worker->jobPath.isEmpty()) {
+            return worker.get();
+        }
+    }
+    if (!allowNew) {
+        return nullptr;
+    }
+
+    // Workers share the model's weights, so another one only costs its decoder
+    // state (the KV caches and compute buffers, roughly a quarter of the model).
+    // Add one when that fits in what is free now, which already accounts for
+    // the workers running
+    if (!m_workers.empty()) {
+        const size_t needed = WhisperModels::getModelMemoryRequirement(m_config.model) / 4;
+        const size_t available = DeviceManager::instance().availableMemory(
+            static_cast<DeviceManager::DeviceType>(m_config.computeDeviceType), m_config.computeDeviceId);
+        if (available < needed + needed / 5) {
+            qDebug() << "Not starting another batch job:" << available / (1024 * 1024) << "MB free,"
+                     << needed / (1024 * 1024) << "MB needed";
+            return nullptr;
+        }
+    }
+
+    auto worker = std::make_unique<Worker>();
+    worker->thread = new QThread(this);
+    worker->transcriber = new OfflineTranscriber();
+    worker->transcriber->moveToThread(worker->thread);
+    connect(worker->thread, &QThread::finished, worker->transcriber, &QObject::deleteLater);
+
+    Worker *w = worker.get();
+    connect(w->transcriber, &OfflineTranscriber::fileFinished, this,
+            [this, w](const QString &, const QList<TranscriptionSegment> &segments, double audioSeconds, double) {
+                finishJob(w, segments, audioSeconds);
+            });
+    connect(w->transcriber, &OfflineTranscriber::fileFailed, this,
+            [this, w](const QString &, const QString &error) { failJob(w, error); });
+
+#ifdef Q_OS_LINUX
+    // QThread priorities are ignored under SCHED_OTHER; the nice value is per thread
+    // on Linux and is inherited by the decode and ggml threads started from this one
+    connect(worker->thread, &QThread::started, []() {
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+    });
+#endif
+
+    // Batch work yields to live transcription
+    worker->thread->start(QThread::LowPriority);
+    m_workers.push_back(std::move(worker));
+    return w;
+}
+
+void BatchQueue::dispatch()
+{
+    if (!m_configured || m_shuttingDown) {
+        return;
+    }
+
+    const int capacity = jobCapacity();
+    const int threadBudget = std::max(1, QThread::idealThreadCount() / capacity);
+    bool started = false;
+
+    for (int index = nextJob(); index >= 0; index = nextJob()) {
+        const int running = std::count_if(m_workers.begin(), m_workers.end(),
+                                          [](const auto &worker) { return !worker->jobPath.isEmpty(); });
+        if (running >= capacity) {
+            break;
+        }
+        Worker *worker = idleWorker(static_cast<int>(m_workers.size()) < capacity);
+        if (!worker) {
+            break;
+        }
+
+        BatchJob &job = m_jobs[index];
+        job.state = BatchJob::Running;
+        job.error.clear();
+        worker->jobPath = job.path;
+        started = true;
+
+        const AudioConfiguration config = m_config;
+        const QString path = job.path;
+        OfflineTranscriber *transcriber = worker->transcriber;
+        QMetaObject::invokeMethod(transcriber, [transcriber, config, threadBudget, path]() {
+            transcriber->updateConfiguration(config);
+            transcriber->setThreadBudget(threadBudget);
+            transcriber->transcribeFile(path);
+        }, Qt::QueuedConnection);
+
+        qDebug() << "Batch job started:" << path << "(" << running + 1 << "of" << capacity << "slots)";
+        emit jobStarted(path);
+    }
+
+    if (started) {
+        saveJournal();
+    }
+}
+
+void BatchQueue::finishJob(Worker *worker, const QList<TranscriptionSegment> &segments, double audioSeconds)
+{
+    const int index = findJob(worker->jobPath);
+    worker->jobPath.clear();
+    if (index < 0 || m_shuttingDown) {
+        return;
+    }
+
+    BatchJob &job = m_jobs[index];
+    job.outputPath = outputPathFor(job.path);
+    QString error;
+    if (writeTranscript(job, segments, audioSeconds, &error)) {
+        job.state = BatchJob::Done;
+        emit statusChanged(QString("Transcribed %1").arg(QFileInfo(job.path).fileName()));
+        emit jobFinished(job.path, job.outputPath);
+    } else {
+        job.state = BatchJob::Failed;
+        job.error = error;
+        emit jobFailed(job.path, error);
+    }
+
+    // Keep the journal from growing forever; the oldest finished entries go first
+    int finished = std::count_if(m_jobs.begin(), m_jobs.end(),
+                                 [](const BatchJob &j) { return j.state == BatchJob::Done || j.state == BatchJob::Failed; });
+    for (int i = 0; i < m_jobs.size() && finished > kMaxFinishedJobs; ) {
+        if (m_jobs[i].state == BatchJob::Done || m_jobs[i].state == BatchJob::Failed) {
+            m_jobs.removeAt(i);
+            finished--;
+        } else {
+            ++i;
+        }
+    }
+
+    saveJournal();
+    dispatch();
+}
+
+void BatchQueue::failJob(Worker *worker, const QString &error)
+{
+    const int index = findJob(worker->jobPath);
+    worker->jobPath.clear();
+    if (index < 0 || m_shuttingDown) {
+        return;
+    }
+
+    // A bad file doesn't hold up the rest of the queue
+    BatchJob &job = m_jobs[index];
+    job.state = BatchJob::Failed;
+    job.error = error;
+    qDebug() << "Batch job failed:" << job.path << "-" << error;
+    emit jobFailed(job.path, error);
+
+    saveJournal();
+    dispatch();
+}
+
+bool BatchQueue::writeTranscript(const BatchJob &job, const QList<TranscriptionSegment> &segments,
+                                 double audioSeconds, QString *error) const
+{
+    // Readers of the folder never see a half-written transcript
+    QSaveFile file(job.outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        *error = QString("Cannot write %1: %2").arg(job.outputPath, file.errorString());
+        return false;
+    }
+
+    // Timestamps are the position in the recording
+    const qint64 start = OfflineTranscriber::recordingStart(job.path, audioSeconds);
+    QTextStream out(&file);
+    for (const TranscriptionSegment &segment : segments) {
+        if (m_config.includeTimestamps) {
+            out << "[" << QTime(0, 0).addMSecs(static_cast<int>(segment.startTime - start)).toString("hh:mm:ss") << "] ";
+        }
+        out << segment.text << "\n";
+    }
+    out.flush();
+
+    if (!file.commit()) {
+        *error = QString("Cannot write %1: %2").arg(job.outputPath, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+void BatchQueue::shutdown()
+{
+    if (m_shuttingDown) {
+        return;
+    }
+    m_shuttingDown = true;
+    m_settleTimer->stop();
+
+    // Interrupted jobs stay "running" in memory and are saved as such, so the
+    // next start queues them again
+    for (const auto &worker : m_workers) {
+        worker->transcriber->requestAbort();
+    }
+    for (const auto &worker : m_workers) {
+        worker->thread->quit();
+        worker->thread->wait();
+    }
+    saveJournal();
+}
@@ -0,0 +1,105 @@
+#ifndef BATCHQUEUE_H
+#define BATCHQUEUE_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <memory>
+#include <vector>
+#include "../config/audioconfiguration.h"
+#include "../whisper/transcriptionsegment.h"
+
+class QThread;
+class QTimer;
+class QFileSystemWatcher;
+class OfflineTranscriber;
+
+// One file to transcribe
+struct BatchJob {
+    enum State { Queued, Running, Done, Failed };
+
+    QString path;
+    int priority = 0;        // Higher runs first; equal priorities run oldest first
+    State state = Queued;
+    qint64 queuedAt = 0;     // Wall-clock ms since epoch
+    QString outputPath;      // Transcript written next to the source
+    QString error;
+};
+
+// Transcribes files in the background: files dropped into a watch folder (and
+// ones queued explicitly) are decoded by up to N OfflineTranscribers at once,
+// and each transcript is written atomically next to its recording. Every state
+// change goes to a journal, so jobs that were queued or running when the
+// application stopped are picked up again on the next start.
+class BatchQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int WatchPriority = 0;
+    static constexpr int InteractivePriority = 10;
+
+    explicit BatchQueue(QObject *parent = nullptr);
+    ~BatchQueue();
+
+    // Load the journal and resume what it left unfinished
+    void loadJournal(const QString &path);
+    static QString defaultJournalPath();
+
+    static QString outputPathFor(const QString &audioPath);
+    static bool isAudioFile(const QString &path);
+
+    const QList<BatchJob> &jobs() const { return m_jobs; }
+
+    // Stop the running decodes (they are journaled as queued again)
+    void shutdown();
+
+public slots:
+    void updateConfiguration(const AudioConfiguration &config);
+    bool enqueue(const QString &path, int priority = InteractivePriority);
+
+signals:
+    void jobStarted(const QString &path);
+    void jobFinished(const QString &path, const QString &outputPath);
+    void jobFailed(const QString &path, const QString &error);
+    void statusChanged(const QString &status);
+
+private slots:
+    void scanWatchFolder();
+    void dispatch();
+
+private:
+    struct Worker {
+        QThread *thread = nullptr;
+        OfflineTranscriber *transcriber = nullptr;
+        QString jobPath;          // Empty when idle
+    };
+
+    void setWatchFolder(const QString &folder);
+    Worker *idleWorker(bool allowNew);
+    int jobCapacity() const;
+    int findJob(const QString &path) const;
+    int nextJob() const;
+    void finishJob(Worker *worker, const QList<TranscriptionSegment> &segments, double audioSeconds);
+    void failJob(Worker *worker, const QString &error);
+    bool writeTranscript(const BatchJob &job, const QList<TranscriptionSegment> &segments,
+                         double audioSeconds, QString *error) const;
+    void saveJournal() const;
+
+    AudioConfiguration m_config;
+    bool m_configured;
+    int m_maxJobs;                // 0 = from the core count
+    QList<BatchJob> m_jobs;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    QString m_journalPath;
+    bool m_shuttingDown;
+
+    // Watch folder; new files are queued once their size stops changing
+    QString m_watchFolder;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_settleTimer;
+    QHash<QString, qint64> m_pendingSizes;
+};
+
+#endif // BATCHQUEUE_H
@@ -0,0 +1,315 @@
+#include "headlesssession.h"
+#include "../audio/audiocapture.h"
+#include "../audio/audioprocessor.h"
+#include "../whisper/whisperprocessor.h"
+#include "../whisper/refinementprocessor.h"
+#include "../whisper/offlinetranscriber.h"
+#include "../whisper/whispermodels.h"
+#include "../output/outputmanager.h"
+#include "../control/controlserver.h"
+#include "../batch/batchqueue.h"
+#include "../server/streamingserver.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <cstdio>
+
+namespace {
+QTextStream &out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+QTextStream &err()
+{
+    static QTextStream stream(stderr);
+    return stream;
+}
+}
+
+HeadlessSession::HeadlessSession(const AudioConfiguration &config, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_jsonOutput(false)
+    , m_isCapturing(false)
+    , m_pushToTalkDown(false)
+    , m_filesPending(0)
+    , m_filesFailed(0)
+    , m_streamingServer(nullptr)
+{
+    m_audioCapture = std::make_unique<AudioCapture>();
+    m_audioProcessor = std::make_unique<AudioProcessor>();
+    m_whisperProcessor = std::make_unique<WhisperProcessor>();
+    m_refinementProcessor = std::make_unique<RefinementProcessor>();
+    m_offlineTranscriber = std::make_unique<OfflineTranscriber>();
+    m_outputManager = std::make_unique<OutputManager>();
+    m_controlServer = new ControlServer(this);
+    m_batchQueue = new BatchQueue(this);
+
+    m_audioThread = new QThread(this);
+    m_whisperThread = new QThread(this);
+    m_refinementThread = new QThread(this);
+    m_offlineThread = new QThread(this);
+
+    m_audioCapture->moveToThread(m_audioThread);
+    m_whisperProcessor->moveToThread(m_whisperThread);
+    m_refinementProcessor->moveToThread(m_refinementThread);
+    m_offlineTranscriber->moveToThread(m_offlineThread);
+
+    // Live pipeline, as in the main window
+    connect(m_audioCapture.get(), &AudioCapture::audioDataReady,
+            m_audioProcessor.get(), &AudioProcessor::processAudioData);
+    connect(m_audioProcessor.get(), &AudioProcessor::processedAudio,
+            m_whisperProcessor.get(), &WhisperProcessor::processAudio);
+    connect(m_whisperProcessor.get(), &WhisperProcessor::transcriptionReady,
+            this, &HeadlessSession::onTranscriptionReceived);
+    connect(m_whisperProcessor.get(), &WhisperProcessor::utteranceDecoded,
+            m_refinementProcessor.get(), &RefinementProcessor::refineUtterance);
+    connect(m_refinementProcessor.get(), &RefinementProcessor::utteranceRefined,
+            this, &HeadlessSession::onTranscriptionRefined);
+    connect(m_whisperProcessor.get(), &WhisperProcessor::commandRecognized, this,
+            [this](const QString &, const QString &action) { m_outputManager->runCommand(action); });
+    connect(m_whisperProcessor.get(), &WhisperProcessor::modelNotFound,
+            this, &HeadlessSession::onModelNotFound);
+
+    // Files given on the command line
+    connect(m_offlineTranscriber.get(), &OfflineTranscriber::fileFinished, this,
+            [this](const QString &path, const QList<TranscriptionSegment> &segments, double audioSeconds, double elapsedSeconds) {
+                for (const TranscriptionSegment &segment : segments) {
+                    printSegment(segment, "segment", path);
+                }
+                onStatusChanged(QString("Transcribed %1 at %2x real time")
+                                    .arg(QFileInfo(path).fileName())
+                                    .arg(elapsedSeconds > 0.0 ? audioSeconds / elapsedSeconds : 0.0, 0, 'f', 1));
+                if (--m_filesPending == 0) {
+                    emit finished(m_filesFailed > 0 ? 1 : 0);
+                }
+            });
+    connect(m_offlineTranscriber.get(), &OfflineTranscriber::fileFailed, this,
+            [this](const QString &path, const QString &error) {
+                onStatusChanged(QString("Could not transcribe %1: %2").arg(path, error));
+                m_filesFailed++;
+                if (--m_filesPending == 0) {
+                    emit finished(1);
+                }
+            });
+
+    // Control socket: the same commands the GUI accepts ("qwhisper --ptt toggle", ...)
+    connect(m_controlServer, &ControlServer::startRequested, this, &HeadlessSession::startCapture);
+    connect(m_controlServer, &ControlServer::stopRequested, this, &HeadlessSession::stopCapture);
+    connect(m_controlServer, &ControlServer::pushToTalkPressed, this, [this]() { setPushToTalk(true); });
+    connect(m_controlServer, &ControlServer::pushToTalkReleased, this, [this]() { setPushToTalk(false); });
+    connect(m_controlServer, &ControlServer::pushToTalkToggled, this, [this]() { setPushToTalk(!m_pushToTalkDown); });
+    connect(m_controlServer, &ControlServer::transcribeRequested, this,
+            [this](const QString &path) { m_batchQueue->enqueue(path, BatchQueue::InteractivePriority); });
+    connect(m_batchQueue, &BatchQueue::jobFinished, this,
+            [this](const QString &path, const QString &outputPath) {
+                onStatusChanged(QString("Transcribed %1 to %2").arg(path, outputPath));
+            });
+    connect(m_batchQueue, &BatchQueue::jobFailed, this,
+            [this](const QString &path, const QString &error) {
+                onStatusChanged(QString("Batch transcription of %1 failed: %2").arg(path, error));
+            });
+
+    connect(m_audioCapture.get(), &AudioCapture::statusChanged, this, &HeadlessSession::onStatusChanged);
+    connect(m_whisperProcessor.get(), &WhisperProcessor::statusChanged, this, &HeadlessSession::onStatusChanged);
+    connect(m_refinementProcessor.get(), &RefinementProcessor::statusChanged, this, &HeadlessSession::onStatusChanged);
+    connect(m_offlineTranscriber.get(), &OfflineTranscriber::statusChanged, this, &HeadlessSession::onStatusChanged);
+    connect(m_batchQueue, &BatchQueue::statusChanged, this, &HeadlessSession::onStatusChanged);
+
+    m_audioProcessor->setSampleRate(16000);
+    m_audioProcessor->setGainBoost(m_config.gainBoostDb);
+    m_audioProcessor->setAutoGainEnabled(m_config.autoGainEnabled);
+    m_audioProcessor->setAutoGainTarget(m_config.autoGainTarget);
+    m_audioProcessor->setFilterEnabled(m_config.useBandpass);
+    m_audioProcessor->setFilterFrequencies(m_config.lowCutFreq, m_config.highCutFreq);
+    m_outputManager->updateConfiguration(m_config);
+
+    m_audioThread->start();
+    m_whisperThread->start();
+    m_refinementThread->start(QThread::LowPriority);
+    m_offlineThread->start();
+}
+
+HeadlessSession::~HeadlessSession()
+{
+    m_whisperProcessor->requestAbort();
+    m_refinementProcessor->requestAbort();
+    m_offlineTranscriber->requestAbort();
+    m_batchQueue->shutdown();
+    if (m_streamingServer) {
+        m_streamingServer->shutdown();
+    }
+
+    for (QThread *thread : {m_audioThread, m_whisperThread, m_refinementThread, m_offlineThread}) {
+        thread->quit();
+        thread->wait();
+    }
+}
+
+void HeadlessSession::startDaemon(bool capture)
+{
+    // The model loads on the whisper thread before any audio reaches it
+    const AudioConfiguration config = m_config;
+    QMetaObject::invokeMethod(m_whisperProcessor.get(), [this, config]() {
+        m_whisperProcessor->updateConfiguration(config);
+    }, Qt::QueuedConnection);
+    QMetaObject::invokeMethod(m_refinementProcessor.get(), [this, config]() {
+        m_refinementProcessor->updateConfiguration(config);
+    }, Qt::QueuedConnection);
+
+    if (!m_controlServer->listen()) {
+        onStatusChanged("Control socket unavailable; another instance may be running");
+    }
+    m_batchQueue->loadJournal(BatchQueue::defaultJournalPath());
+    m_batchQueue->updateConfiguration(m_config);  // Resumes the journal's jobs
+
+    if (capture) {
+        startCapture();
+    }
+}
+
+bool HeadlessSession::startServer(quint16 port)
+{
+    if (!m_streamingServer) {
+        m_streamingServer = new StreamingServer(this);
+        connect(m_streamingServer, &StreamingServer::statusChanged, this, &HeadlessSession::onStatusChanged);
+        m_streamingServer->updateConfiguration(m_config);
+    }
+    return m_streamingServer->listen(port);
+}
+
+void HeadlessSession::transcribeFiles(const QStringList &paths)
+{
+    if (paths.isEmpty()) {
+        emit finished(0);
+        return;
+    }
+
+    m_filesPending = paths.size();
+    const AudioConfiguration config = m_config;
+    QMetaObject::invokeMethod(m_offlineTranscriber.get(), [this, config]() {
+        m_offlineTranscriber->updateConfiguration(config);
+    }, Qt::QueuedConnection);
+    for (const QString &path : paths) {
+        QMetaObject::invokeMethod(m_offlineTranscriber.get(), [this, path]() {
+            m_offlineTranscriber->transcribeFile(path);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void HeadlessSession::stop()
+{
+    stopCapture();
+
+    // Deliver the segments decoded from the flushed audio before exiting
+    QCoreApplication::processEvents();
+}
+
+void HeadlessSession::startCapture()
+{
+    if (m_isCapturing) {
+        return;
+    }
+    m_isCapturing = true;
+
+    const AudioConfiguration config = m_config;
+    QMetaObject::invokeMethod(m_audioCapture.get(), [this, config]() {
+        m_audioCapture->updateConfiguration(config);
+        m_audioCapture->startCapture();
+    }, Qt::QueuedConnection);
+}
+
+void HeadlessSession::stopCapture()
+{
+    if (!m_isCapturing) {
+        return;
+    }
+    m_isCapturing = false;
+    m_pushToTalkDown = false;
+
+    // Blocking, so the audio captured so far is decoded rather than dropped
+    QMetaObject::invokeMethod(m_audioCapture.get(), &AudioCapture::stopCapture, Qt::BlockingQueuedConnection);
+    QMetaObject::invokeMethod(m_whisperProcessor.get(), &WhisperProcessor::finishRecording, Qt::BlockingQueuedConnection);
+}
+
+void HeadlessSession::setPushToTalk(bool pressed)
+{
+    if (!m_config.pushToTalk) {
+        onStatusChanged("Push-to-talk is off (set pushToTalk in the configuration)");
+        return;
+    }
+    if (pressed == m_pushToTalkDown) {
+        return;
+    }
+    if (pressed) {
+        startCapture();
+    }
+    m_pushToTalkDown = pressed;
+    QMetaObject::invokeMethod(m_whisperProcessor.get(),
+                              pressed ? &WhisperProcessor::pushToTalkPressed
+                                      : &WhisperProcessor::pushToTalkReleased,
+                              Qt::QueuedConnection);
+}
+
+void HeadlessSession::onTranscriptionReceived(const TranscriptionSegment &segment)
+{
+    printSegment(segment, "segment");
+    m_outputManager->handleTranscription(formatOutputText(segment), segment);
+}
+
+void HeadlessSession::onTranscriptionRefined(const TranscriptionSegment &segment)
+{
+    // Text already printed can't be taken back; JSON consumers get the replacement
+    if (m_jsonOutput) {
+        printSegment(segment, "refined");
+    }
+    m_outputManager->replaceTranscription(formatOutputText(segment), segment);
+}
+
+void HeadlessSession::onStatusChanged(const QString &status)
+{
+    err() << status << Qt::endl;
+}
+
+void HeadlessSession::onModelNotFound(const QString &modelName)
+{
+    const ModelInfo info = WhisperModels::modelInfo(modelName);
+    err() << QString("Model '%1' is not installed. Download %2 to %3")
+                 .arg(modelName, info.url, WhisperModels::modelPath(modelName))
+          << Qt::endl;
+    emit finished(1);
+}
+
+void HeadlessSession::printSegment(const TranscriptionSegment &segment, const QString &type, const QString &source)
+{
+    if (!m_jsonOutput) {
+        out() << formatOutputText(segment) << Qt::endl;
+        return;
+    }
+
+    QJsonObject event;
+    event["type"] = type;
+    event["text"] = segment.text;
+    event["start"] = static_cast<double>(segment.startTime);
+    event["end"] = static_cast<double>(segment.endTime);
+    event["utterance"] = static_cast<double>(segment.utteranceId);
+    if (!source.isEmpty()) {
+        event["file"] = source;
+    }
+    out() << QJsonDocument(event).toJson(QJsonDocument::Compact) << Qt::endl;
+}
+
+QString HeadlessSession::formatOutputText(const TranscriptionSegment &segment) const
+{
+    if (m_config.includeTimestamps) {
+        return QString("[%1] %2")
+            .arg(QDateTime::fromMSecsSinceEpoch(segment.startTime).toString("hh:mm:ss"))
+            .arg(segment.text);
+    }
+    return segment.text;
+}
@@ -0,0 +1,86 @@
+#ifndef HEADLESSSESSION_H
+#define HEADLESSSESSION_H
+
+#include <QObject>
+#include <QThread>
+#include <QStringList>
+#include <memory>
+#include "../config/audioconfiguration.h"
+#include "../whisper/transcriptionsegment.h"
+
+class AudioCapture;
+class AudioProcessor;
+class WhisperProcessor;
+class RefinementProcessor;
+class OfflineTranscriber;
+class OutputManager;
+class ControlServer;
+class BatchQueue;
+class StreamingServer;
+
+// The capture/decode/output pipeline of the main window without any widgets,
+// for qwhisper-cli. Transcripts go to stdout (plain text or one JSON object per
+// line) and to the configured file output; status messages go to stderr.
+class HeadlessSession : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HeadlessSession(const AudioConfiguration &config, QObject *parent = nullptr);
+    ~HeadlessSession();
+
+    void setJsonOutput(bool json) { m_jsonOutput = json; }
+
+    // Listen on the control socket and run the batch queue (watch folder); with
+    // capture, also transcribe the input device live. Runs until stop().
+    void startDaemon(bool capture);
+
+    // Serve the streaming endpoints on the loopback interface
+    bool startServer(quint16 port);
+
+    // Transcribe recordings one after another, then emit finished()
+    void transcribeFiles(const QStringList &paths);
+
+    // Flush the audio still being captured and decoded
+    void stop();
+
+signals:
+    void finished(int exitCode);
+
+private slots:
+    void onTranscriptionReceived(const TranscriptionSegment &segment);
+    void onTranscriptionRefined(const TranscriptionSegment &segment);
+    void onStatusChanged(const QString &status);
+    void onModelNotFound(const QString &modelName);
+
+private:
+    void startCapture();
+    void stopCapture();
+    void setPushToTalk(bool pressed);
+    void printSegment(const TranscriptionSegment &segment, const QString &type, const QString &source = QString());
+    QString formatOutputText(const TranscriptionSegment &segment) const;
+
+    AudioConfiguration m_config;
+    bool m_jsonOutput;
+    bool m_isCapturing;
+    bool m_pushToTalkDown;
+    int m_filesPending;
+    int m_filesFailed;
+
+    std::unique_ptr<AudioCapture> m_audioCapture;
+    std::unique_ptr<AudioProcessor> m_audioProcessor;
+    std::unique_ptr<WhisperProcessor> m_whisperProcessor;
+    std::unique_ptr<RefinementProcessor> m_refinementProcessor;
+    std::unique_ptr<OfflineTranscriber> m_offlineTranscriber;
+    std::unique_ptr<OutputManager> m_outputManager;
+    ControlServer *m_controlServer;
+    BatchQueue *m_batchQueue;
+    StreamingServer *m_streamingServer;
+
+    QThread *m_audioThread;
+    QThread *m_whisperThread;
+    QThread *m_refinementThread;
+    QThread *m_offlineThread;
+};
+
+#endif // HEADLESSSESSION_H
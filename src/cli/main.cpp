@@ -0,0 +1,168 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSocketNotifier>
+#include <QFileInfo>
+#include <QDebug>
+#include "headlesssession.h"
+#include "../server/streamingserver.h"
+#include "../server/streamingclient.h"
+#include "../config/configmanager.h"
+#include "../ipc/workerprocess.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+int signalSockets[2];
+
+void handleSignal(int signal)
+{
+    // Only async-signal-safe work here; the event loop picks it up. If it can't
+    // be told, quitting at once beats ignoring the signal
+    char byte = 1;
+    if (::write(signalSockets[0], &byte, sizeof(byte)) != 1) {
+        _exit(128 + signal);
+    }
+}
+}
+
+int main(int argc, char *argv[])
+{
+    // Started by ourselves to decode in a separate process
+    if (WorkerProcess::isRequested(argc, argv)) {
+        return WorkerProcess::run(argc, argv);
+    }
+
+    QCoreApplication app(argc, argv);
+
+    // Same names as the GUI, so both use one config file, model directory and cache
+    QCoreApplication::setOrganizationName("qwhisper");
+    QCoreApplication::setApplicationName("qwhisper");
+    QCoreApplication::setApplicationVersion("1.0.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Speech recognition without a display. With files, transcribes them to stdout and exits; "
+        "otherwise transcribes the audio input live until interrupted.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("files", "Recordings to transcribe.", "[files...]");
+    QCommandLineOption configOption("config", "Read settings from this config.json instead of the user's.", "file");
+    QCommandLineOption modelOption("model", "Model to use (e.g. base.en, small, turbo).", "name");
+    QCommandLineOption languageOption("language", "Spoken language code, or \"auto\".", "code");
+    QCommandLineOption deviceOption("device", "Audio input device.", "name");
+    QCommandLineOption gpuOption("gpu", "Decode on this CUDA device.", "index");
+    QCommandLineOption outputOption("output", "Also append the transcript to this file.", "file");
+    QCommandLineOption timestampsOption("timestamps", "Prefix each line with the time it was spoken.");
+    QCommandLineOption jsonOption("json", "Print one JSON object per segment instead of plain text.");
+    QCommandLineOption watchOption("watch", "Transcribe recordings that appear in this folder.", "folder");
+    QCommandLineOption noCaptureOption("no-capture",
+        "Don't open the audio input; only serve the control socket, the watch folder and the streaming server.");
+    QCommandLineOption serveOption("serve",
+        QString("Run the streaming server on this loopback port (usually %1).").arg(StreamingServer::DefaultPort), "port");
+    QCommandLineOption streamToOption("stream-to",
+        "Test client: stream the files to the streaming server on this port and print its events.", "port");
+    QCommandLineOption speedOption("speed",
+        "With --stream-to, send audio at this multiple of real time (0 = as fast as accepted).", "factor", "1");
+    parser.addOptions({configOption, modelOption, languageOption, deviceOption, gpuOption, outputOption,
+                       timestampsOption, jsonOption, watchOption, noCaptureOption, serveOption, streamToOption,
+                       speedOption});
+    parser.process(app);
+
+    // The test client needs no model or settings
+    if (parser.isSet(streamToOption)) {
+        const QStringList files = parser.positionalArguments();
+        if (files.isEmpty()) {
+            qWarning() << "--stream-to needs a recording to send";
+            return 2;
+        }
+        const quint16 port = static_cast<quint16>(parser.value(streamToOption).toUInt());
+        const double speed = parser.value(speedOption).toDouble();
+        int exitCode = 0;
+        for (const QString &file : files) {
+            StreamingClient client;
+            QObject::connect(&client, &StreamingClient::event, [](const QByteArray &json) {
+                fprintf(stdout, "%s\n", json.constData());
+                fflush(stdout);
+            });
+            // Queued: a recording that fails to load finishes before exec() runs
+            QObject::connect(&client, &StreamingClient::finished, &app, &QCoreApplication::exit,
+                             Qt::QueuedConnection);
+            client.stream(file, port, speed);
+            exitCode = std::max(exitCode, app.exec());
+        }
+        return exitCode;
+    }
+
+    if (parser.isSet(configOption)) {
+        ConfigManager::setConfigFilePathOverride(parser.value(configOption));
+    }
+
+    // Saved settings, with the command line on top. Nothing is written back.
+    AudioConfiguration config = AudioConfiguration::fromJson(ConfigManager::instance().loadAudioConfiguration());
+    config.outputToWindow = false;     // No window to type into
+    config.outputToClipboard = false;
+    config.outputToFile = false;
+    if (parser.isSet(modelOption)) {
+        config.model = parser.value(modelOption);
+    }
+    if (parser.isSet(languageOption)) {
+        config.language = parser.value(languageOption);
+    }
+    if (parser.isSet(deviceOption)) {
+        config.device = parser.value(deviceOption);
+    }
+    if (parser.isSet(gpuOption)) {
+        config.computeDeviceType = 1;
+        config.computeDeviceId = parser.value(gpuOption).toInt();
+    }
+    if (parser.isSet(outputOption)) {
+        config.outputToFile = true;
+        config.outputFilePath = QFileInfo(parser.value(outputOption)).absoluteFilePath();
+    }
+    if (parser.isSet(timestampsOption)) {
+        config.includeTimestamps = true;
+    }
+    if (parser.isSet(watchOption)) {
+        config.batchWatchFolder = QFileInfo(parser.value(watchOption)).absoluteFilePath();
+    }
+    if (parser.isSet(serveOption)) {
+        config.streamServerPort = parser.value(serveOption).toInt();
+    }
+
+    HeadlessSession session(config);
+    session.setJsonOutput(parser.isSet(jsonOption));
+    QObject::connect(&session, &HeadlessSession::finished, &app, &QCoreApplication::exit);
+
+    // SIGINT/SIGTERM end a live session cleanly
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalSockets) == 0) {
+        QSocketNotifier *notifier = new QSocketNotifier(signalSockets[1], QSocketNotifier::Read, &app);
+        QObject::connect(notifier, &QSocketNotifier::activated, &app, [&session]() {
+            char byte;
+            if (::read(signalSockets[1], &byte, sizeof(byte)) != 1) {
+                return;   // Woken without a signal to handle
+            }
+            session.stop();
+            QCoreApplication::exit(0);
+        });
+        std::signal(SIGINT, handleSignal);
+        std::signal(SIGTERM, handleSignal);
+    } else {
+        qWarning() << "Cannot install signal handlers";
+    }
+
+    const QStringList files = parser.positionalArguments();
+    if (!files.isEmpty()) {
+        session.transcribeFiles(files);
+    } else {
+        if (config.streamServerPort > 0 && !session.startServer(static_cast<quint16>(config.streamServerPort))) {
+            return 1;
+        }
+        session.startDaemon(!parser.isSet(noCaptureOption));
+    }
+
+    return app.exec();
+}
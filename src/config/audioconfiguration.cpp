@@ -0,0 +1,204 @@
+#include "audioconfiguration.h"
+#include "../whisper/decodingprofile.h"
+#include <QJsonArray>
+#include <QJsonValue>
+
+AudioConfiguration AudioConfiguration::defaults()
+{
+    AudioConfiguration config;
+    config.model = "base";
+    config.refineModel = QString();
+    config.refineLogprobThreshold = -0.5;
+    config.audioSource = "microphone";
+    config.pickupThreshold = 120;
+    config.minSpeechDuration = 0.0;
+    config.maxSpeechDuration = 10.0;
+    config.compactSilence = 1.0;
+    config.pushToTalk = false;
+    config.pushToTalkPreRoll = 0.5;
+    config.wakeWordEnabled = false;
+    config.wakePhrase = "hey computer";
+    config.wakeModel = "tiny.en";
+    config.wakeWindow = 10.0;
+    config.useBandpass = true;
+    config.lowCutFreq = 80.0;
+    config.highCutFreq = 6000.0;
+    config.includeTimestamps = false;
+    config.maxDecodeLag = 0.0;     // Default: never drop segments
+    config.runawayGuardEnabled = true;
+    config.wordTimestamps = false;
+    config.translateAlongside = false;
+    config.adaptiveQuality = false;
+    config.reduceAudioContext = false;
+    config.commandMode = false;
+    config.commandNoSpeechThreshold = 0.6;
+    config.offlineParallelDecodes = 0;
+    config.transcriptCacheMB = 256;
+    config.remoteTimeout = 10.0;
+    config.inferenceProcess = false;
+    config.promptTokens = 64;
+    config.promptResetSilence = 10.0;
+    DecodingProfile::preset("balanced").applyTo(config);
+    config.language = "en";
+    config.languageThreshold = 0.6;
+    config.computeDeviceType = 0;  // Default to CPU
+    config.computeDeviceId = -1;
+    config.gainBoostDb = 0.0;      // Default: no gain boost
+    config.autoGainEnabled = false; // Default: manual gain control
+    config.autoGainTarget = 0.1;   // Default: 10% target level
+    config.outputToWindow = true;
+    config.outputToFile = false;
+    config.outputToClipboard = false;
+    config.batchJobs = 0;
+    config.streamServerPort = 0;
+    config.streamServerDecoders = 0;
+    return config;
+}
+
+AudioConfiguration AudioConfiguration::fromJson(const QJsonObject &json)
+{
+    AudioConfiguration config = defaults();
+    config.model = json.value("model").toString("base");
+    config.refineModel = json.value("refineModel").toString();
+    config.refineLogprobThreshold = json.value("refineLogprobThreshold").toDouble(-0.5);
+    config.audioSource = json.value("audioSource").toString("microphone");
+    config.device = json.value("device").toString("");
+    config.computeDeviceType = json.value("computeDeviceType").toInt(0);
+    config.computeDeviceId = json.value("computeDeviceId").toInt(-1);
+    config.pickupThreshold = json.value("pickupThreshold").toInt(120);
+    config.minSpeechDuration = json.value("minSpeechDuration").toDouble(0.0);
+    config.maxSpeechDuration = json.value("maxSpeechDuration").toDouble(10.0);
+    config.compactSilence = json.value("compactSilence").toDouble(1.0);
+    config.pushToTalk = json.value("pushToTalk").toBool(false);
+    config.pushToTalkPreRoll = json.value("pushToTalkPreRoll").toDouble(0.5);
+    config.wakeWordEnabled = json.value("wakeWordEnabled").toBool(false);
+    config.wakePhrase = json.value("wakePhrase").toString("hey computer");
+    config.wakeModel = json.value("wakeModel").toString("tiny.en");
+    config.wakeWindow = json.value("wakeWindow").toDouble(10.0);
+    config.maxDecodeLag = json.value("maxDecodeLag").toDouble(0.0);
+    config.runawayGuardEnabled = json.value("runawayGuardEnabled").toBool(true);
+    config.wordTimestamps = json.value("wordTimestamps").toBool(false);
+    config.translateAlongside = json.value("translateAlongside").toBool(false);
+    config.adaptiveQuality = json.value("adaptiveQuality").toBool(false);
+    config.reduceAudioContext = json.value("reduceAudioContext").toBool(false);
+    config.commandMode = json.value("commandMode").toBool(false);
+    config.commandFile = json.value("commandFile").toString();
+    config.commandNoSpeechThreshold = json.value("commandNoSpeechThreshold").toDouble(0.6);
+    for (const QJsonValue &tier : json.value("qualityTiers").toArray()) {
+        config.qualityTiers.append(tier.toString());
+    }
+    config.offlineParallelDecodes = json.value("offlineParallelDecodes").toInt(0);
+    config.transcriptCacheMB = json.value("transcriptCacheMB").toInt(256);
+    for (const QJsonValue &endpoint : json.value("remoteEndpoints").toArray()) {
+        config.remoteEndpoints.append(endpoint.toString());
+    }
+    config.remoteTimeout = json.value("remoteTimeout").toDouble(10.0);
+    config.inferenceProcess = json.value("inferenceProcess").toBool(false);
+    config.promptTokens = json.value("promptTokens").toInt(64);
+    config.promptResetSilence = json.value("promptResetSilence").toDouble(10.0);
+    
+    config.language = json.value("language").toString("en");
+    config.languageThreshold = json.value("languageThreshold").toDouble(0.6);
+    
+    // Missing decoding fields fall back to the saved (or balanced) preset's values
+    DecodingProfile profile = DecodingProfile::preset(json.value("decodingProfile").toString("balanced"));
+    config.decodingProfile = json.value("decodingProfile").toString(profile.name);
+    config.beamSearch = json.value("beamSearch").toBool(profile.beamSearch);
+    config.beamSize = json.value("beamSize").toInt(profile.beamSize);
+    config.bestOf = json.value("bestOf").toInt(profile.bestOf);
+    config.temperatureFallback = json.value("temperatureFallback").toBool(profile.temperatureFallback);
+    config.entropyThreshold = json.value("entropyThreshold").toDouble(profile.entropyThreshold);
+    config.logprobThreshold = json.value("logprobThreshold").toDouble(profile.logprobThreshold);
+    config.maxTokensPerSegment = json.value("maxTokensPerSegment").toInt(profile.maxTokensPerSegment);
+    config.useBandpass = json.value("useBandpass").toBool(true);
+    config.lowCutFreq = json.value("lowCutFreq").toDouble(80.0);
+    config.highCutFreq = json.value("highCutFreq").toDouble(6000.0);
+    config.gainBoostDb = json.value("gainBoostDb").toDouble(0.0);
+    config.autoGainEnabled = json.value("autoGainEnabled").toBool(false);
+    config.autoGainTarget = json.value("autoGainTarget").toDouble(0.1);
+    // Handle legacy settings
+    if (json.contains("useTimestamps")) {
+        config.includeTimestamps = json.value("useTimestamps").toBool(false);
+    } else if (json.contains("showTimestampsInUI") || json.contains("includeTimestampsInOutput")) {
+        // If either of the old split settings exist, use them
+        bool showInUI = json.value("showTimestampsInUI").toBool(false);
+        bool includeInOutput = json.value("includeTimestampsInOutput").toBool(false);
+        config.includeTimestamps = showInUI || includeInOutput;  // Enable if either was enabled
+    } else {
+        config.includeTimestamps = json.value("includeTimestamps").toBool(false);
+    }
+    config.outputToWindow = json.value("outputToWindow").toBool(true);
+    config.outputToFile = json.value("outputToFile").toBool(false);
+    config.outputToClipboard = json.value("outputToClipboard").toBool(false);
+    config.outputFilePath = json.value("outputFilePath").toString("");
+    config.batchWatchFolder = json.value("batchWatchFolder").toString();
+    config.batchJobs = json.value("batchJobs").toInt(0);
+    config.streamServerPort = json.value("streamServerPort").toInt(0);
+    config.streamServerDecoders = json.value("streamServerDecoders").toInt(0);
+    return config;
+}
+
+QJsonObject AudioConfiguration::toJson() const
+{
+    QJsonObject json;
+    json["model"] = model;
+    json["refineModel"] = refineModel;
+    json["refineLogprobThreshold"] = refineLogprobThreshold;
+    json["audioSource"] = audioSource;
+    json["device"] = device;
+    json["computeDeviceType"] = computeDeviceType;
+    json["computeDeviceId"] = computeDeviceId;
+    json["pickupThreshold"] = pickupThreshold;
+    json["minSpeechDuration"] = minSpeechDuration;
+    json["maxSpeechDuration"] = maxSpeechDuration;
+    json["compactSilence"] = compactSilence;
+    json["pushToTalk"] = pushToTalk;
+    json["pushToTalkPreRoll"] = pushToTalkPreRoll;
+    json["wakeWordEnabled"] = wakeWordEnabled;
+    json["wakePhrase"] = wakePhrase;
+    json["wakeModel"] = wakeModel;
+    json["wakeWindow"] = wakeWindow;
+    json["maxDecodeLag"] = maxDecodeLag;
+    json["runawayGuardEnabled"] = runawayGuardEnabled;
+    json["wordTimestamps"] = wordTimestamps;
+    json["translateAlongside"] = translateAlongside;
+    json["adaptiveQuality"] = adaptiveQuality;
+    json["reduceAudioContext"] = reduceAudioContext;
+    json["commandMode"] = commandMode;
+    json["commandFile"] = commandFile;
+    json["commandNoSpeechThreshold"] = commandNoSpeechThreshold;
+    json["qualityTiers"] = QJsonArray::fromStringList(qualityTiers);
+    json["offlineParallelDecodes"] = offlineParallelDecodes;
+    json["transcriptCacheMB"] = transcriptCacheMB;
+    json["remoteEndpoints"] = QJsonArray::fromStringList(remoteEndpoints);
+    json["remoteTimeout"] = remoteTimeout;
+    json["inferenceProcess"] = inferenceProcess;
+    json["promptTokens"] = promptTokens;
+    json["promptResetSilence"] = promptResetSilence;
+    json["language"] = language;
+    json["languageThreshold"] = languageThreshold;
+    json["decodingProfile"] = decodingProfile;
+    json["beamSearch"] = beamSearch;
+    json["beamSize"] = beamSize;
+    json["bestOf"] = bestOf;
+    json["temperatureFallback"] = temperatureFallback;
+    json["entropyThreshold"] = entropyThreshold;
+    json["logprobThreshold"] = logprobThreshold;
+    json["maxTokensPerSegment"] = maxTokensPerSegment;
+    json["useBandpass"] = useBandpass;
+    json["lowCutFreq"] = lowCutFreq;
+    json["highCutFreq"] = highCutFreq;
+    json["gainBoostDb"] = gainBoostDb;
+    json["autoGainEnabled"] = autoGainEnabled;
+    json["autoGainTarget"] = autoGainTarget;
+    json["includeTimestamps"] = includeTimestamps;
+    json["outputToWindow"] = outputToWindow;
+    json["outputToFile"] = outputToFile;
+    json["outputToClipboard"] = outputToClipboard;
+    json["outputFilePath"] = outputFilePath;
+    json["batchWatchFolder"] = batchWatchFolder;
+    json["batchJobs"] = batchJobs;
+    json["streamServerPort"] = streamServerPort;
+    json["streamServerDecoders"] = streamServerDecoders;
+    return json;
+}
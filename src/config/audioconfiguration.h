@@ -0,0 +1,93 @@
+#ifndef AUDIOCONFIGURATION_H
+#define AUDIOCONFIGURATION_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+// Everything the capture, decoding and output pipeline is configured with. The
+// settings panel edits it and the headless CLI reads it straight from config.json.
+struct AudioConfiguration {
+    QString model;
+    QString refineModel;     // Larger model that re-decodes finished chunks in the background (empty = off)
+    double refineLogprobThreshold; // Only refine chunks whose avg token log-prob falls below this (0 = all)
+    QString device;
+    QString audioSource;
+    int pickupThreshold;
+    double minSpeechDuration;
+    double maxSpeechDuration;
+    bool useBandpass;
+    double lowCutFreq;
+    double highCutFreq;
+    bool includeTimestamps;  // Include timestamps in UI and all outputs
+    double compactSilence;   // Pauses inside an utterance longer than this (sec) are shortened (0 = off)
+    bool pushToTalk;         // Utterances are marked by a key / control command instead of the VAD
+    double pushToTalkPreRoll; // Audio (sec) from before the key press included in the utterance
+    bool wakeWordEnabled;    // Only transcribe after the wake phrase has been heard
+    QString wakePhrase;
+    QString wakeModel;       // Small model that listens for the phrase (falls back to the main model)
+    double wakeWindow;       // Seconds of transcription after the phrase / the last speech
+    
+    // Decoding options
+    double maxDecodeLag;     // Drop segments further behind real time than this (sec, 0 = never)
+    bool runawayGuardEnabled; // Abort decodes that loop or produce implausibly long output
+    int promptTokens;         // Previous-text tokens carried into the next decode (0 = off)
+    double promptResetSilence; // Silence (sec) after which the carried-over text (and detected language) is dropped
+    QString language;         // Spoken language code, or "auto" to detect it once per session
+    double languageThreshold; // Detection probability required before a language is cached
+    bool wordTimestamps;      // Per-word start/end/probability from whisper's token timestamps
+    bool translateAlongside;  // Also decode an English translation from the same encoder pass
+    bool adaptiveQuality;     // Step between qualityTiers as CPU load changes
+    QStringList qualityTiers; // "model:profile" entries, cheapest first (empty = model at each preset)
+    bool reduceAudioContext;  // Encode only as much of the 30 s window as the chunk needs
+    bool commandMode;         // Decode speech only as one of the phrases in commandFile and run its action
+    QString commandFile;      // "phrase = action" list (empty = commands.txt next to the config file)
+    double commandNoSpeechThreshold; // Commands whose no-speech probability is above this are not run
+    int offlineParallelDecodes; // Chunks of a file transcribed at once (0 = from the core count)
+    int transcriptCacheMB;    // Disk space for cached offline chunk transcripts (0 = no cache)
+    QStringList remoteEndpoints; // whisper.cpp server URLs live chunks are sent to (empty = decode locally)
+    double remoteTimeout;     // Seconds a server may take beyond the chunk's length before the local model takes over
+    bool inferenceProcess;    // Decode live audio in a separate worker process that is restarted if it crashes
+    
+    // Decoding strategy (see DecodingProfile; filled in from the selected preset)
+    QString decodingProfile;  // "fastest", "balanced", "accurate" or "custom"
+    bool beamSearch;
+    int beamSize;
+    int bestOf;
+    bool temperatureFallback;
+    double entropyThreshold;
+    double logprobThreshold;
+    int maxTokensPerSegment;  // 0 = unlimited
+    
+    // Compute device options
+    int computeDeviceType;  // 0 = CPU, 1 = CUDA
+    int computeDeviceId;    // -1 for CPU, 0+ for GPU index
+    
+    // Audio gain options
+    double gainBoostDb;     // Manual gain boost in dB
+    bool autoGainEnabled;   // Enable automatic gain control
+    double autoGainTarget;  // Target level for AGC (0.0 to 1.0)
+    
+    // Output options
+    bool outputToWindow;
+    bool outputToFile;
+    bool outputToClipboard;
+    QString outputFilePath;
+    
+    // Batch transcription
+    QString batchWatchFolder; // Recordings appearing here are transcribed next to themselves (empty = off)
+    int batchJobs;            // Files transcribed at once (0 = from the core count and free memory)
+    
+    // Streaming server for other local programs
+    int streamServerPort;     // Loopback port (0 = off)
+    int streamServerDecoders; // Decodes run at once for its clients (0 = from the core count)
+
+    // Built-in defaults for every field
+    static AudioConfiguration defaults();
+    
+    // The "audio_configuration" object of config.json; missing keys keep their defaults
+    static AudioConfiguration fromJson(const QJsonObject &json);
+    QJsonObject toJson() const;
+};
+
+#endif // AUDIOCONFIGURATION_H
@@ -8,13 +8,18 @@
 #include <QDebug>
 #include <QFileInfo>
 
+namespace {
+QString configFilePathOverride;
+}
+
 ConfigManager::ConfigManager(QObject *parent)
     : QObject(parent)
 {
     // Determine config file path following XDG Base Directory specification
     QString configDir = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
     QString appConfigDir = QDir(configDir).filePath("qwhisper");
-    m_configFilePath = QDir(appConfigDir).filePath(CONFIG_FILE_NAME);
+    m_configFilePath = configFilePathOverride.isEmpty()
+        ? QDir(appConfigDir).filePath(CONFIG_FILE_NAME) : configFilePathOverride;
     
     // Ensure config directory exists
     ensureConfigDirectoryExists();
@@ -38,6 +43,11 @@ ConfigManager& ConfigManager::instance()
     return instance;
 }
 
+void ConfigManager::setConfigFilePathOverride(const QString& path)
+{
+    configFilePathOverride = QFileInfo(path).absoluteFilePath();
+}
+
 void ConfigManager::ensureConfigDirectoryExists()
 {
     QFileInfo fileInfo(m_configFilePath);
@@ -14,6 +14,10 @@ class ConfigManager : public QObject
 public:
     static ConfigManager& instance();
     
+    // Read and write this file instead of the user's config.json; only takes
+    // effect when called before the first instance()
+    static void setConfigFilePathOverride(const QString& path);
+    
     // Prevent copying
     ConfigManager(const ConfigManager&) = delete;
     ConfigManager& operator=(const ConfigManager&) = delete;
@@ -0,0 +1,102 @@
+#include "controlserver.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDebug>
+
+ControlServer::ControlServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QLocalServer(this))
+{
+    // Only the user running the application may send commands
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &ControlServer::onNewConnection);
+}
+
+ControlServer::~ControlServer()
+{
+    m_server->close();
+}
+
+QString ControlServer::serverName()
+{
+    return QString("qwhisper-control-%1").arg(qEnvironmentVariable("USER", "default"));
+}
+
+bool ControlServer::listen()
+{
+    if (m_server->listen(serverName())) {
+        qDebug() << "Control socket listening at" << m_server->fullServerName();
+        return true;
+    }
+
+    // A socket left behind by a crashed instance blocks the name; replace it
+    // unless another instance is actually answering on it
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(serverName());
+        if (!probe.waitForConnected(200)) {
+            QLocalServer::removeServer(serverName());
+            if (m_server->listen(serverName())) {
+                qDebug() << "Control socket listening at" << m_server->fullServerName();
+                return true;
+            }
+        }
+    }
+
+    qDebug() << "Control socket unavailable:" << m_server->errorString();
+    return false;
+}
+
+bool ControlServer::sendCommand(const QString &command)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(1000)) {
+        return false;
+    }
+    socket.write(command.toUtf8() + '\n');
+    bool written = socket.waitForBytesWritten(1000);
+    socket.disconnectFromServer();
+    return written;
+}
+
+void ControlServer::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, &ControlServer::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void ControlServer::onReadyRead()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+
+    while (socket->canReadLine()) {
+        handleCommand(QString::fromUtf8(socket->readLine()).trimmed());
+    }
+}
+
+void ControlServer::handleCommand(const QString &command)
+{
+    qDebug() << "Control command:" << command;
+
+    if (command == "ptt-press") {
+        emit pushToTalkPressed();
+    } else if (command == "ptt-release") {
+        emit pushToTalkReleased();
+    } else if (command == "ptt-toggle") {
+        emit pushToTalkToggled();
+    } else if (command == "start") {
+        emit startRequested();
+    } else if (command == "stop") {
+        emit stopRequested();
+    } else if (command.startsWith("transcribe ")) {
+        emit transcribeRequested(command.mid(11).trimmed());
+    } else {
+        qDebug() << "Unknown control command:" << command;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QString>
+
+class QLocalServer;
+class QLocalSocket;
+
+// Local control socket so other processes can drive a running instance, e.g. a
+// desktop-wide hotkey bound to "qwhisper --ptt toggle". Commands are single
+// lines: ptt-press, ptt-release, ptt-toggle, start, stop, transcribe <file>.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ControlServer(QObject *parent = nullptr);
+    ~ControlServer();
+
+    bool listen();
+
+    // Send one command to a running instance. Returns false when none is listening.
+    static bool sendCommand(const QString &command);
+
+signals:
+    void pushToTalkPressed();
+    void pushToTalkReleased();
+    void pushToTalkToggled();
+    void startRequested();
+    void stopRequested();
+    void transcribeRequested(const QString &path);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    static QString serverName();
+    void handleCommand(const QString &command);
+
+    QLocalServer *m_server;
+};
+
+#endif // CONTROLSERVER_H
@@ -0,0 +1,141 @@
+#include "audioring.h"
+#include <QByteArray>
+#include <QDebug>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+AudioRing::AudioRing()
+    : m_header(nullptr)
+    , m_samples(nullptr)
+    , m_mappedBytes(0)
+    , m_fd(-1)
+{
+}
+
+AudioRing::~AudioRing()
+{
+    release();
+}
+
+bool AudioRing::create(size_t capacitySamples)
+{
+    release();
+
+    // The name only exists until the fd is open; the worker inherits the fd
+    static std::atomic<int> counter(0);
+    const QByteArray name = "/qwhisper-audio-" + QByteArray::number(getpid()) + '-'
+                          + QByteArray::number(counter.fetch_add(1));
+    m_fd = shm_open(name.constData(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (m_fd < 0) {
+        qDebug() << "Cannot create shared audio ring:" << strerror(errno);
+        return false;
+    }
+    shm_unlink(name.constData());
+
+    const size_t bytes = sizeof(Header) + capacitySamples * sizeof(qint16);
+    if (ftruncate(m_fd, static_cast<off_t>(bytes)) != 0) {
+        qDebug() << "Cannot size shared audio ring:" << strerror(errno);
+        release();
+        return false;
+    }
+    if (!attach(m_fd)) {
+        return false;
+    }
+    m_header->writePos.store(0);
+    m_header->readPos.store(0);
+    m_header->dropped.store(0);
+    m_header->capacity = capacitySamples;
+    return true;
+}
+
+bool AudioRing::attach(int fd)
+{
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) <= sizeof(Header)) {
+        qDebug() << "Shared audio ring has no usable mapping";
+        return false;
+    }
+    void *mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        qDebug() << "Cannot map shared audio ring:" << strerror(errno);
+        return false;
+    }
+    m_fd = fd;
+    m_mappedBytes = static_cast<size_t>(info.st_size);
+    m_header = static_cast<Header*>(mapping);
+    m_samples = reinterpret_cast<qint16*>(static_cast<char*>(mapping) + sizeof(Header));
+    return true;
+}
+
+void AudioRing::release()
+{
+    if (m_header) {
+        munmap(m_header, m_mappedBytes);
+        m_header = nullptr;
+        m_samples = nullptr;
+        m_mappedBytes = 0;
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+size_t AudioRing::write(const qint16 *samples, size_t count)
+{
+    const quint64 capacity = m_header->capacity;
+    const quint64 writePos = m_header->writePos.load(std::memory_order_relaxed);
+    const quint64 readPos = m_header->readPos.load(std::memory_order_acquire);
+    const size_t room = static_cast<size_t>(capacity - (writePos - readPos));
+    const size_t written = std::min(count, room);
+    if (written < count) {
+        m_header->dropped.fetch_add(count - written, std::memory_order_relaxed);
+    }
+
+    const size_t start = static_cast<size_t>(writePos % capacity);
+    const size_t first = std::min(written, static_cast<size_t>(capacity) - start);
+    memcpy(m_samples + start, samples, first * sizeof(qint16));
+    memcpy(m_samples, samples + first, (written - first) * sizeof(qint16));
+
+    // Publishes the samples to the consumer
+    m_header->writePos.store(writePos + written, std::memory_order_release);
+    return written;
+}
+
+void AudioRing::reset()
+{
+    m_header->readPos.store(0);
+    m_header->writePos.store(0);
+}
+
+size_t AudioRing::available() const
+{
+    return static_cast<size_t>(m_header->writePos.load(std::memory_order_acquire)
+                               - m_header->readPos.load(std::memory_order_acquire));
+}
+
+quint64 AudioRing::droppedSamples() const
+{
+    return m_header->dropped.load(std::memory_order_relaxed);
+}
+
+const qint16 *AudioRing::peek(size_t *count) const
+{
+    const quint64 capacity = m_header->capacity;
+    const quint64 readPos = m_header->readPos.load(std::memory_order_relaxed);
+    const quint64 writePos = m_header->writePos.load(std::memory_order_acquire);
+    const size_t start = static_cast<size_t>(readPos % capacity);
+    *count = std::min(static_cast<size_t>(writePos - readPos), static_cast<size_t>(capacity) - start);
+    return m_samples + start;
+}
+
+void AudioRing::consume(size_t count)
+{
+    // Hands the space back to the producer
+    m_header->readPos.fetch_add(count, std::memory_order_release);
+}
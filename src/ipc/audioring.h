@@ -0,0 +1,63 @@
+#ifndef AUDIORING_H
+#define AUDIORING_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Single-producer, single-consumer ring of 16 kHz 16-bit samples in POSIX
+// shared memory, used to hand captured audio to the inference worker process.
+// The consumer reads samples where they lie in the mapping; positions only
+// grow, so full and empty are told apart without a spare slot. The ring does no
+// signaling itself; the owner pairs it with an eventfd.
+class AudioRing
+{
+public:
+    AudioRing();
+    ~AudioRing();
+    AudioRing(const AudioRing &) = delete;
+    AudioRing &operator=(const AudioRing &) = delete;
+
+    // Producer side: a new, already unlinked shared memory object. fd() is
+    // what the other process maps.
+    bool create(size_t capacitySamples);
+    // Consumer side: map a ring created by another process
+    bool attach(int fd);
+    void release();
+
+    bool isValid() const { return m_header != nullptr; }
+    int fd() const { return m_fd; }
+
+    // Producer. Writes as much as fits; returns the samples written. A stalled
+    // consumer loses the newest audio rather than corrupting what it is reading.
+    size_t write(const qint16 *samples, size_t count);
+    // Only while no consumer is attached (e.g. when a stopped worker is started again)
+    void reset();
+    // Samples written but not consumed yet
+    size_t available() const;
+    quint64 droppedSamples() const;
+
+    // Consumer. The longest contiguous run of unread samples (up to the end of
+    // the buffer); it stays valid until consume() hands it back.
+    const qint16 *peek(size_t *count) const;
+    void consume(size_t count);
+
+private:
+    struct Header {
+        std::atomic<quint64> writePos;
+        std::atomic<quint64> readPos;
+        std::atomic<quint64> dropped;
+        quint64 capacity;
+    };
+
+    static_assert(std::atomic<quint64>::is_always_lock_free,
+                  "the ring's positions are shared between processes");
+
+    Header *m_header;
+    qint16 *m_samples;
+    size_t m_mappedBytes;
+    int m_fd;
+};
+
+#endif // AUDIORING_H
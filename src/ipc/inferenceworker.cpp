@@ -0,0 +1,367 @@
+#include "inferenceworker.h"
+#include "workerprotocol.h"
+#include "../config/audioconfiguration.h"
+#include "../config/configmanager.h"
+#include <QCoreApplication>
+#include <QLocalSocket>
+#include <QTimer>
+#include <QDebug>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+constexpr size_t kRingSamples = 60 * 16000;   // A minute of backlog before audio is dropped
+constexpr int kMinRestartMs = 500;
+constexpr int kMaxRestartMs = 30000;
+constexpr qint64 kStableUptimeMs = 60000;     // Running this long resets the backoff
+constexpr int kStopTimeoutMs = 3000;
+constexpr qint64 kFlushTimeoutMs = 30000;
+
+void ringEventFd(int fd)
+{
+    const quint64 one = 1;
+    if (::write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        qDebug() << "Cannot signal the inference worker:" << strerror(errno);
+    }
+}
+
+void drainEventFd(int fd)
+{
+    quint64 count;
+    while (::read(fd, &count, sizeof(count)) > 0) {
+    }
+}
+}
+
+InferenceWorker::InferenceWorker(QObject *parent)
+    : QObject(parent)
+    , m_audioEvent(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    , m_abortEvent(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+    , m_process(nullptr)
+    , m_socket(nullptr)
+    , m_restartTimer(new QTimer(this))
+    , m_enabled(false)
+    , m_flushed(true)
+    , m_restarting(false)
+    , m_dropping(false)
+    , m_reportedDrops(0)
+    , m_configPath(ConfigManager::instance().getConfigFilePath())
+    , m_restartDelay(kMinRestartMs)
+{
+    m_restartTimer->setSingleShot(true);
+    connect(m_restartTimer, &QTimer::timeout, this, &InferenceWorker::launch);
+}
+
+InferenceWorker::~InferenceWorker()
+{
+    stop();
+    for (int fd : {m_audioEvent, m_abortEvent}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+bool InferenceWorker::isRunning() const
+{
+    return m_process != nullptr;
+}
+
+qint64 InferenceWorker::processId() const
+{
+    return m_process ? m_process->processId() : 0;
+}
+
+bool InferenceWorker::start(const AudioConfiguration &config)
+{
+    // The ring is created once; restarted workers map the same one
+    if (!m_ring.isValid() && !m_ring.create(kRingSamples)) {
+        emit statusChanged("Cannot run inference in a worker process: no shared memory");
+        return false;
+    }
+    if (m_audioEvent < 0 || m_abortEvent < 0) {
+        emit statusChanged("Cannot run inference in a worker process: no eventfd");
+        return false;
+    }
+
+    m_config = config.toJson();
+    m_model.clear();
+    if (!m_enabled) {
+        // Audio left from before a stop belongs to another session
+        m_enabled = true;
+        m_restartDelay = kMinRestartMs;
+        m_ring.reset();
+        m_reportedDrops = m_ring.droppedSamples();
+        m_dropping = false;
+        m_restarting = false;
+    }
+    if (m_socket) {
+        send({{"cmd", "config"}, {"config", m_config}});
+    } else if (!m_restartTimer->isActive()) {
+        launch();
+    }
+    return true;
+}
+
+void InferenceWorker::launch()
+{
+    if (!m_enabled || m_process) {
+        return;
+    }
+
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0) {
+        scheduleRestart(QString("could not start (%1)").arg(strerror(errno)));
+        return;
+    }
+
+    // Unread audio is kept for the new worker, which reads the ring on start;
+    // aborts meant for the previous one are stale
+    drainEventFd(m_audioEvent);
+    drainEventFd(m_abortEvent);
+
+    const int ringFd = m_ring.fd();
+    const int audioEvent = m_audioEvent;
+    const int abortEvent = m_abortEvent;
+    const int childSocket = sockets[1];
+
+    m_process = new QProcess(this);
+    m_process->setProcessChannelMode(QProcess::ForwardedChannels);
+    m_process->setChildProcessModifier([ringFd, audioEvent, abortEvent, childSocket]() {
+        // Runs between fork and exec: only async-signal-safe calls
+        const int inherited[] = {ringFd, audioEvent, abortEvent, childSocket};
+        for (int fd : inherited) {
+            fcntl(fd, F_SETFD, 0);
+        }
+        prctl(PR_SET_PDEATHSIG, SIGTERM);   // Never outlive the app
+        setpgid(0, 0);                      // Ctrl+C in the terminal is the app's to handle
+    });
+    connect(m_process, &QProcess::finished, this, &InferenceWorker::onProcessFinished);
+    m_process->start(QCoreApplication::applicationFilePath(),
+                     {"--inference-worker", QString::number(ringFd), QString::number(audioEvent),
+                      QString::number(abortEvent), QString::number(childSocket), m_configPath});
+    const bool started = m_process->waitForStarted();
+    ::close(childSocket);
+
+    if (!started) {
+        const QString error = m_process->errorString();
+        delete m_process;
+        m_process = nullptr;
+        ::close(sockets[0]);
+        scheduleRestart(QString("could not start (%1)").arg(error));
+        return;
+    }
+
+    m_socket = new QLocalSocket(this);
+    m_socket->setSocketDescriptor(sockets[0]);
+    connect(m_socket, &QLocalSocket::readyRead, this, &InferenceWorker::onReadyRead);
+    m_uptime.start();
+    qDebug() << "Inference worker started, pid" << m_process->processId();
+    if (m_restarting) {
+        m_restarting = false;
+        emit statusChanged(QString("Inference worker restarted, catching up on %1 s of audio")
+                           .arg(m_ring.available() / 16000.0, 0, 'f', 1));
+        reportDroppedAudio();
+    }
+
+    send({{"cmd", "config"}, {"config", m_config}});
+    if (!m_model.isEmpty()) {
+        send({{"cmd", "loadModel"}, {"model", m_model}});
+    }
+}
+
+void InferenceWorker::stop()
+{
+    m_enabled = false;
+    m_restartTimer->stop();
+    if (!m_process) {
+        return;
+    }
+
+    // The worker quits when its socket closes; kill it if it's stuck in a decode
+    QProcess *process = m_process;
+    m_process = nullptr;
+    disconnect(process, nullptr, this, nullptr);
+    requestAbort();
+    closeConnection();
+    if (!process->waitForFinished(kStopTimeoutMs)) {
+        qDebug() << "Inference worker did not exit, killing it";
+        process->kill();
+        process->waitForFinished();
+    }
+    delete process;
+    emit statusChanged("Inference worker stopped");
+}
+
+void InferenceWorker::closeConnection()
+{
+    if (m_socket) {
+        m_socket->disconnect(this);
+        m_socket->abort();
+        m_socket->deleteLater();
+        m_socket = nullptr;
+    }
+}
+
+void InferenceWorker::onProcessFinished(int exitCode, QProcess::ExitStatus status)
+{
+    m_process->deleteLater();
+    m_process = nullptr;
+    closeConnection();
+    m_flushed = true;
+    if (!m_enabled) {
+        return;
+    }
+    scheduleRestart(status == QProcess::CrashExit ? QString("crashed")
+                                                   : QString("exited with code %1").arg(exitCode));
+}
+
+void InferenceWorker::scheduleRestart(const QString &reason)
+{
+    if (m_uptime.isValid() && m_uptime.elapsed() > kStableUptimeMs) {
+        m_restartDelay = kMinRestartMs;
+    }
+    m_uptime.invalidate();
+
+    m_restarting = true;
+    qDebug() << "Inference worker" << reason << "- restarting in" << m_restartDelay << "ms";
+    emit statusChanged(QString("Inference worker %1, restarting").arg(reason));
+    m_restartTimer->start(m_restartDelay);
+    m_restartDelay = std::min(m_restartDelay * 2, kMaxRestartMs);
+}
+
+void InferenceWorker::send(const QJsonObject &message)
+{
+    if (m_socket) {
+        m_socket->write(WorkerProtocol::encode(message));
+        m_socket->flush();
+    }
+}
+
+void InferenceWorker::sendCommand(const QString &command)
+{
+    send({{"cmd", command}});
+}
+
+void InferenceWorker::loadModel(const QString &modelName)
+{
+    m_model = modelName;
+    send({{"cmd", "loadModel"}, {"model", modelName}});
+}
+
+void InferenceWorker::writeAudio(const QByteArray &audioData)
+{
+    if (!m_enabled) {
+        return;
+    }
+
+    // The only copy of the audio on its way to the worker, which decodes it in
+    // place; between a crash and the restart it waits in the ring
+    const size_t count = audioData.size() / sizeof(qint16);
+    const size_t written = m_ring.write(reinterpret_cast<const qint16*>(audioData.constData()), count);
+    if (written < count && !m_dropping) {
+        m_dropping = true;
+        emit statusChanged("Inference worker is a minute behind, dropping audio");
+    } else if (written == count && m_dropping) {
+        m_dropping = false;
+        reportDroppedAudio();
+    }
+    if (written > 0 && m_socket) {
+        ringEventFd(m_audioEvent);
+    }
+}
+
+void InferenceWorker::reportDroppedAudio()
+{
+    const quint64 dropped = m_ring.droppedSamples();
+    if (dropped > m_reportedDrops) {
+        const double seconds = (dropped - m_reportedDrops) / 16000.0;
+        qDebug() << "Inference worker: dropped" << (dropped - m_reportedDrops) << "samples";
+        emit statusChanged(QString("Inference worker fell behind: %1 s of audio was dropped").arg(seconds, 0, 'f', 1));
+        m_reportedDrops = dropped;
+    }
+}
+
+void InferenceWorker::finishRecording()
+{
+    if (!m_socket) {
+        return;
+    }
+
+    m_flushed = false;
+    sendCommand("finish");
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_flushed && m_socket && timer.elapsed() < kFlushTimeoutMs) {
+        if (!m_socket->waitForReadyRead(100) && m_socket->state() != QLocalSocket::ConnectedState) {
+            break;
+        }
+        onReadyRead();
+    }
+    if (!m_flushed) {
+        qDebug() << "Inference worker did not finish the last chunk in time";
+        m_flushed = true;
+    }
+}
+
+void InferenceWorker::resetAudioClock()
+{
+    sendCommand("resetClock");
+}
+
+void InferenceWorker::pushToTalkPressed()
+{
+    sendCommand("pttPressed");
+}
+
+void InferenceWorker::pushToTalkReleased()
+{
+    sendCommand("pttReleased");
+}
+
+void InferenceWorker::requestAbort()
+{
+    if (m_abortEvent >= 0) {
+        ringEventFd(m_abortEvent);
+    }
+}
+
+void InferenceWorker::onReadyRead()
+{
+    if (!m_socket) {
+        return;
+    }
+    for (const QJsonObject &message : WorkerProtocol::readMessages(m_socket)) {
+        handleMessage(message);
+    }
+}
+
+void InferenceWorker::handleMessage(const QJsonObject &message)
+{
+    const QString event = message.value("event").toString();
+    if (event == "segment") {
+        emit transcriptionReady(WorkerProtocol::segmentFromJson(message.value("segment").toObject()));
+    } else if (event == "status") {
+        emit statusChanged(message.value("status").toString());
+    } else if (event == "modelNotFound") {
+        emit modelNotFound(message.value("model").toString());
+    } else if (event == "utterance") {
+        emit utteranceDecoded(message.value("id").toString().toULongLong(),
+                              static_cast<qint64>(message.value("audioStart").toDouble()),
+                              message.value("language").toString(),
+                              WorkerProtocol::samplesFromBase64(message.value("samples").toString().toLatin1()));
+    } else if (event == "command") {
+        emit commandRecognized(message.value("phrase").toString(), message.value("action").toString());
+    } else if (event == "flushed") {
+        m_flushed = true;
+    } else {
+        qDebug() << "Unknown inference worker event:" << event;
+    }
+}
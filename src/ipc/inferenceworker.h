@@ -0,0 +1,94 @@
+#ifndef INFERENCEWORKER_H
+#define INFERENCEWORKER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QProcess>
+#include <QString>
+#include "audioring.h"
+#include "../whisper/transcriptionsegment.h"
+
+class QLocalSocket;
+class QTimer;
+struct AudioConfiguration;
+
+// Runs live decoding in a child process (this executable started with
+// --inference-worker), so a crash in whisper.cpp or a GPU driver takes down
+// only the worker. Audio goes through a shared memory ring with an eventfd
+// doorbell; commands and results are JSON lines on a socket pair. A worker
+// that dies is restarted with backoff and gets the configuration replayed;
+// audio it hadn't read yet, and audio captured while it was down, waits in
+// the ring for the new worker (as much as the ring holds).
+//
+// Lives on the whisper thread; everything but requestAbort() must be called there.
+class InferenceWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InferenceWorker(QObject *parent = nullptr);
+    ~InferenceWorker();
+
+    bool isEnabled() const { return m_enabled; }
+    bool isRunning() const;
+    qint64 processId() const;            // 0 while no worker runs
+
+    // Starts the worker if needed and sends it the configuration. False if
+    // this system can't run one (no shared memory or eventfd).
+    bool start(const AudioConfiguration &config);
+    void stop();
+
+    void loadModel(const QString &modelName);
+    void writeAudio(const QByteArray &audioData);
+    // Waits (bounded) until the worker has decoded what is left, as the
+    // in-process finishRecording() does
+    void finishRecording();
+    void resetAudioClock();
+    void pushToTalkPressed();
+    void pushToTalkReleased();
+    // Thread-safe
+    void requestAbort();
+
+signals:
+    // Same meaning as WhisperProcessor's signals
+    void transcriptionReady(const TranscriptionSegment &segment);
+    void statusChanged(const QString &status);
+    void modelNotFound(const QString &modelName);
+    void utteranceDecoded(quint64 utteranceId, qint64 audioStart, const QString &language,
+                          const QList<float> &samples);
+    void commandRecognized(const QString &phrase, const QString &action);
+
+private slots:
+    void onReadyRead();
+    void onProcessFinished(int exitCode, QProcess::ExitStatus status);
+    void launch();
+
+private:
+    void send(const QJsonObject &message);
+    void sendCommand(const QString &command);
+    void handleMessage(const QJsonObject &message);
+    void scheduleRestart(const QString &reason);
+    void closeConnection();
+    void reportDroppedAudio();
+
+    AudioRing m_ring;
+    int m_audioEvent;                    // Rung after each write to the ring
+    int m_abortEvent;                    // Rung by requestAbort()
+    QProcess *m_process;
+    QLocalSocket *m_socket;
+    QTimer *m_restartTimer;
+    bool m_enabled;
+    bool m_flushed;                      // The worker answered the last finish command
+    bool m_restarting;                   // The next launch replaces a worker that died
+    bool m_dropping;                     // The ring is full and new audio is being lost
+    quint64 m_reportedDrops;             // Ring drops already reported
+    QJsonObject m_config;                // Replayed to a restarted worker
+    QString m_model;                     // Loaded explicitly after the configuration (empty = config.model)
+    QString m_configPath;
+    int m_restartDelay;                  // ms, doubles with each crash in a row
+    QElapsedTimer m_uptime;
+};
+
+#endif // INFERENCEWORKER_H
@@ -0,0 +1,178 @@
+#include "workerprocess.h"
+#include "audioring.h"
+#include "workerprotocol.h"
+#include "../whisper/whisperprocessor.h"
+#include "../config/audioconfiguration.h"
+#include "../config/configmanager.h"
+#include <QCoreApplication>
+#include <QLocalSocket>
+#include <QSocketNotifier>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace {
+constexpr size_t kFeedSamples = 1600;   // 100 ms per processAudio() call, about what capture delivers
+
+void drainEventFd(int fd)
+{
+    quint64 count;
+    while (::read(fd, &count, sizeof(count)) > 0) {
+    }
+}
+
+// Hands ring audio to the processor; lives on the decode thread
+class RingReader : public QObject
+{
+public:
+    RingReader(AudioRing *ring, int eventFd, WhisperProcessor *processor)
+        : m_ring(ring), m_eventFd(eventFd), m_processor(processor), m_notifier(nullptr)
+    {
+    }
+
+    // Called on the decode thread, which the notifier must belong to
+    void start()
+    {
+        m_notifier = new QSocketNotifier(m_eventFd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, [this]() {
+            drainEventFd(m_eventFd);
+            drain();
+        });
+        drain();
+    }
+
+    void drain()
+    {
+        // The processor converts the samples before returning, so they are
+        // read where they lie in shared memory and only then given back
+        size_t count = 0;
+        const qint16 *samples = m_ring->peek(&count);
+        while (count > 0) {
+            const size_t feed = std::min(count, kFeedSamples);
+            m_processor->processAudio(QByteArray::fromRawData(reinterpret_cast<const char*>(samples),
+                                                              static_cast<qsizetype>(feed * sizeof(qint16))));
+            m_ring->consume(feed);
+            samples = m_ring->peek(&count);
+        }
+    }
+
+private:
+    AudioRing *m_ring;
+    int m_eventFd;
+    WhisperProcessor *m_processor;
+    QSocketNotifier *m_notifier;
+};
+}
+
+bool WorkerProcess::isRequested(int argc, char *argv[])
+{
+    return argc > 1 && strcmp(argv[1], "--inference-worker") == 0;
+}
+
+int WorkerProcess::run(int argc, char *argv[])
+{
+    if (argc < 7) {
+        fprintf(stderr, "--inference-worker is started by qwhisper itself\n");
+        return 2;
+    }
+    const int ringFd = atoi(argv[2]);
+    const int audioEvent = atoi(argv[3]);
+    const int abortEvent = atoi(argv[4]);
+    const int socketFd = atoi(argv[5]);
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("qwhisper");
+    QCoreApplication::setApplicationName("qwhisper");
+    QCoreApplication::setApplicationVersion("1.0.0");
+    ConfigManager::setConfigFilePathOverride(QString::fromLocal8Bit(argv[6]));
+
+    AudioRing ring;
+    QLocalSocket control;
+    if (!ring.attach(ringFd) || !control.setSocketDescriptor(socketFd)) {
+        fprintf(stderr, "Inference worker: cannot attach to the app\n");
+        return 1;
+    }
+
+    QThread decodeThread;
+    auto *processor = new WhisperProcessor;
+    auto *reader = new RingReader(&ring, audioEvent, processor);
+    processor->moveToThread(&decodeThread);
+    reader->moveToThread(&decodeThread);
+
+    // Results go back from the main thread, in the order they were emitted
+    auto send = [&control](const QJsonObject &message) {
+        control.write(WorkerProtocol::encode(message));
+        control.flush();
+    };
+    QObject::connect(processor, &WhisperProcessor::transcriptionReady, &control,
+                     [send](const TranscriptionSegment &segment) {
+        send({{"event", "segment"}, {"segment", WorkerProtocol::segmentToJson(segment)}});
+    });
+    QObject::connect(processor, &WhisperProcessor::statusChanged, &control, [send](const QString &status) {
+        send({{"event", "status"}, {"status", status}});
+    });
+    QObject::connect(processor, &WhisperProcessor::modelNotFound, &control, [send](const QString &modelName) {
+        send({{"event", "modelNotFound"}, {"model", modelName}});
+    });
+    QObject::connect(processor, &WhisperProcessor::utteranceDecoded, &control,
+                     [send](quint64 utteranceId, qint64 audioStart, const QString &language, const QList<float> &samples) {
+        send({{"event", "utterance"}, {"id", QString::number(utteranceId)},
+              {"audioStart", static_cast<double>(audioStart)}, {"language", language},
+              {"samples", QString::fromLatin1(WorkerProtocol::samplesToBase64(samples))}});
+    });
+    QObject::connect(processor, &WhisperProcessor::commandRecognized, &control,
+                     [send](const QString &phrase, const QString &action) {
+        send({{"event", "command"}, {"phrase", phrase}, {"action", action}});
+    });
+
+    // Commands run on the decode thread after the audio written before them
+    QObject::connect(&control, &QLocalSocket::readyRead, &control, [&control, send, reader, processor]() {
+        for (const QJsonObject &message : WorkerProtocol::readMessages(&control)) {
+            QMetaObject::invokeMethod(reader, [&control, send, reader, processor, message]() {
+                reader->drain();
+                const QString command = message.value("cmd").toString();
+                if (command == "config") {
+                    AudioConfiguration config = AudioConfiguration::fromJson(message.value("config").toObject());
+                    config.inferenceProcess = false;   // This is the worker
+                    processor->updateConfiguration(config);
+                } else if (command == "loadModel") {
+                    processor->loadModel(message.value("model").toString());
+                } else if (command == "finish") {
+                    processor->finishRecording();
+                    QMetaObject::invokeMethod(&control, [send]() { send({{"event", "flushed"}}); });
+                } else if (command == "resetClock") {
+                    processor->resetAudioClock();
+                } else if (command == "pttPressed") {
+                    processor->pushToTalkPressed();
+                } else if (command == "pttReleased") {
+                    processor->pushToTalkReleased();
+                } else {
+                    qDebug() << "Inference worker: unknown command" << command;
+                }
+            }, Qt::QueuedConnection);
+        }
+    });
+    QObject::connect(&control, &QLocalSocket::disconnected, &app, &QCoreApplication::quit);
+
+    // Aborts skip the command queue, which is blocked behind the decode they cancel
+    QSocketNotifier abortNotifier(abortEvent, QSocketNotifier::Read);
+    QObject::connect(&abortNotifier, &QSocketNotifier::activated, &abortNotifier, [abortEvent, processor]() {
+        drainEventFd(abortEvent);
+        processor->requestAbort();
+    });
+
+    decodeThread.start();
+    QMetaObject::invokeMethod(reader, [reader]() { reader->start(); }, Qt::QueuedConnection);
+    const int result = app.exec();
+
+    processor->requestAbort();
+    decodeThread.quit();
+    decodeThread.wait();
+    delete reader;
+    delete processor;
+    return result;
+}
@@ -0,0 +1,15 @@
+#ifndef WORKERPROCESS_H
+#define WORKERPROCESS_H
+
+// The inference worker process that InferenceWorker starts: a WhisperProcessor
+// fed straight from the shared audio ring, reporting back over the control
+// socket. It exits when the app closes the socket (or dies).
+class WorkerProcess
+{
+public:
+    // Checked by main() before any application object exists
+    static bool isRequested(int argc, char *argv[]);
+    static int run(int argc, char *argv[]);
+};
+
+#endif // WORKERPROCESS_H
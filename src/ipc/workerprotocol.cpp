@@ -0,0 +1,95 @@
+#include "workerprotocol.h"
+#include <QIODevice>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+#include <cstring>
+
+QByteArray WorkerProtocol::encode(const QJsonObject &message)
+{
+    return QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QList<QJsonObject> WorkerProtocol::readMessages(QIODevice *device)
+{
+    QList<QJsonObject> messages;
+    while (device->canReadLine()) {
+        const QByteArray line = device->readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        QJsonParseError error;
+        const QJsonDocument document = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError || !document.isObject()) {
+            qDebug() << "Ignoring malformed worker message:" << error.errorString();
+            continue;
+        }
+        messages.append(document.object());
+    }
+    return messages;
+}
+
+QJsonObject WorkerProtocol::segmentToJson(const TranscriptionSegment &segment)
+{
+    QJsonObject json;
+    json["text"] = segment.text;
+    json["timestamp"] = static_cast<double>(segment.timestamp);
+    json["t0"] = static_cast<double>(segment.startTime);
+    json["t1"] = static_cast<double>(segment.endTime);
+    json["utterance"] = QString::number(segment.utteranceId);
+    json["avgLogprob"] = segment.avgLogprob;
+    json["noSpeech"] = segment.noSpeechProb;
+    if (!segment.translation.isEmpty()) {
+        json["translation"] = segment.translation;
+    }
+    if (!segment.words.isEmpty()) {
+        QJsonArray words;
+        for (const TranscriptionWord &word : segment.words) {
+            QJsonObject wordJson;
+            wordJson["text"] = word.text;
+            wordJson["t0"] = static_cast<double>(word.startTime);
+            wordJson["t1"] = static_cast<double>(word.endTime);
+            wordJson["p"] = word.probability;
+            words.append(wordJson);
+        }
+        json["words"] = words;
+    }
+    return json;
+}
+
+TranscriptionSegment WorkerProtocol::segmentFromJson(const QJsonObject &json)
+{
+    TranscriptionSegment segment;
+    segment.text = json.value("text").toString();
+    segment.timestamp = static_cast<qint64>(json.value("timestamp").toDouble());
+    segment.startTime = static_cast<qint64>(json.value("t0").toDouble());
+    segment.endTime = static_cast<qint64>(json.value("t1").toDouble());
+    segment.utteranceId = json.value("utterance").toString().toULongLong();
+    segment.avgLogprob = static_cast<float>(json.value("avgLogprob").toDouble());
+    segment.noSpeechProb = static_cast<float>(json.value("noSpeech").toDouble());
+    segment.translation = json.value("translation").toString();
+    for (const QJsonValue &value : json.value("words").toArray()) {
+        const QJsonObject wordJson = value.toObject();
+        TranscriptionWord word;
+        word.text = wordJson.value("text").toString();
+        word.startTime = static_cast<qint64>(wordJson.value("t0").toDouble());
+        word.endTime = static_cast<qint64>(wordJson.value("t1").toDouble());
+        word.probability = static_cast<float>(wordJson.value("p").toDouble());
+        segment.words.append(word);
+    }
+    return segment;
+}
+
+QByteArray WorkerProtocol::samplesToBase64(const QList<float> &samples)
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(samples.constData()),
+                                   samples.size() * sizeof(float)).toBase64();
+}
+
+QList<float> WorkerProtocol::samplesFromBase64(const QByteArray &data)
+{
+    const QByteArray raw = QByteArray::fromBase64(data);
+    QList<float> samples(raw.size() / sizeof(float));
+    memcpy(samples.data(), raw.constData(), samples.size() * sizeof(float));
+    return samples;
+}
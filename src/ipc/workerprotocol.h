@@ -0,0 +1,29 @@
+#ifndef WORKERPROTOCOL_H
+#define WORKERPROTOCOL_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include "../whisper/transcriptionsegment.h"
+
+class QIODevice;
+
+// Control messages between the app and its inference worker process: one
+// compact JSON object per line. Commands to the worker carry "cmd", messages
+// from it carry "event". Audio does not go through here (see AudioRing).
+class WorkerProtocol
+{
+public:
+    static QByteArray encode(const QJsonObject &message);
+    // Complete lines available on the device; a partial line stays buffered
+    static QList<QJsonObject> readMessages(QIODevice *device);
+
+    static QJsonObject segmentToJson(const TranscriptionSegment &segment);
+    static TranscriptionSegment segmentFromJson(const QJsonObject &json);
+
+    // Raw floats, base64; an utterance is too large for a JSON number array
+    static QByteArray samplesToBase64(const QList<float> &samples);
+    static QList<float> samplesFromBase64(const QByteArray &data);
+};
+
+#endif // WORKERPROTOCOL_H
@@ -2,10 +2,19 @@
 #include <QStyleFactory>
 #include <QSettings>
 #include <QDebug>
+#include <QCommandLineParser>
+#include <QFileInfo>
 #include "mainwindow.h"
+#include "control/controlserver.h"
+#include "ipc/workerprocess.h"
 
 int main(int argc, char *argv[])
 {
+    // Started by ourselves to decode in a separate process; no GUI there
+    if (WorkerProcess::isRequested(argc, argv)) {
+        return WorkerProcess::run(argc, argv);
+    }
+    
     QApplication app(argc, argv);
     
     // Set application metadata
@@ -13,6 +22,43 @@ int main(int argc, char *argv[])
     QCoreApplication::setApplicationName("qwhisper");
     QCoreApplication::setApplicationVersion("1.0.0");
     
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Real-time speech recognition");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption pttOption("ptt",
+        "Send a push-to-talk command (press, release or toggle) to the running instance and exit. "
+        "Bind this to a desktop hotkey.", "action");
+    parser.addOption(pttOption);
+    QCommandLineOption transcribeOption("transcribe",
+        "Queue a recording for background transcription in the running instance and exit. "
+        "The transcript is written next to it. May be given more than once.", "file");
+    parser.addOption(transcribeOption);
+    parser.process(app);
+    
+    if (parser.isSet(pttOption)) {
+        const QString action = parser.value(pttOption);
+        if (action != "press" && action != "release" && action != "toggle") {
+            qWarning() << "Unknown push-to-talk action:" << action;
+            return 2;
+        }
+        if (!ControlServer::sendCommand("ptt-" + action)) {
+            qWarning() << "QWhisper is not running";
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (parser.isSet(transcribeOption)) {
+        for (const QString &file : parser.values(transcribeOption)) {
+            if (!ControlServer::sendCommand("transcribe " + QFileInfo(file).absoluteFilePath())) {
+                qWarning() << "QWhisper is not running";
+                return 1;
+            }
+        }
+        return 0;
+    }
+    
     // Set application style
     app.setStyle(QStyleFactory::create("Fusion"));
     
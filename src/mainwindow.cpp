@@ -6,8 +6,13 @@
 #include "audio/audiocapture.h"
 #include "audio/audioprocessor.h"
 #include "whisper/whisperprocessor.h"
+#include "whisper/refinementprocessor.h"
 #include "whisper/modeldownloader.h"
+#include "whisper/offlinetranscriber.h"
 #include "output/outputmanager.h"
+#include "control/controlserver.h"
+#include "batch/batchqueue.h"
+#include "server/streamingserver.h"
 
 #include <QAction>
 #include <QMenu>
@@ -22,11 +27,19 @@
 #include <QCloseEvent>
 #include <QTimer>
 #include <QDateTime>
+#include <QSignalBlocker>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QClipboard>
+#include <QKeyEvent>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_isRecording(false)
     , m_isPaused(false)
+    , m_pushToTalkMode(false)
+    , m_pushToTalkKeyHeld(false)
 {
     setupUi();
     createActions();
@@ -38,22 +51,55 @@ MainWindow::MainWindow(QWidget *parent)
     m_audioCapture = std::make_unique<AudioCapture>();
     m_audioProcessor = std::make_unique<AudioProcessor>();
     m_whisperProcessor = std::make_unique<WhisperProcessor>();
+    m_refinementProcessor = std::make_unique<RefinementProcessor>();
+    m_offlineTranscriber = std::make_unique<OfflineTranscriber>();
     m_outputManager = std::make_unique<OutputManager>();
     m_modelDownloader = std::make_unique<ModelDownloader>();
+    m_controlServer = new ControlServer(this);
+    m_batchQueue = new BatchQueue(this);
+    m_batchQueue->loadJournal(BatchQueue::defaultJournalPath());
+    m_streamingServer = nullptr;
     
     // Setup threads
     m_audioThread = new QThread(this);
     m_whisperThread = new QThread(this);
+    m_refinementThread = new QThread(this);
+    m_offlineThread = new QThread(this);
     
     m_audioCapture->moveToThread(m_audioThread);
     m_whisperProcessor->moveToThread(m_whisperThread);
+    m_refinementProcessor->moveToThread(m_refinementThread);
+    m_offlineTranscriber->moveToThread(m_offlineThread);
     
     connectSignals();
     loadSettings();
+    m_controlServer->listen();
+    m_batchQueue->updateConfiguration(m_configWidget->getConfiguration());  // Resumes the journal's jobs
+    
+    // Local programs can stream audio to the resident model (config file only)
+    const int streamPort = m_configWidget->getConfiguration().streamServerPort;
+    if (streamPort > 0) {
+        m_streamingServer = new StreamingServer(this);
+        m_streamingServer->updateConfiguration(m_configWidget->getConfiguration());
+        m_streamingServer->listen(static_cast<quint16>(streamPort));
+        connect(m_configWidget, &ConfigWidget::configurationChanged,
+                m_streamingServer, &StreamingServer::updateConfiguration);
+        connect(m_streamingServer, &StreamingServer::statusChanged,
+                this, &MainWindow::onStatusChanged);
+    }
     
     // Start threads
     m_audioThread->start();
     m_whisperThread->start();
+    m_refinementThread->start(QThread::LowPriority);  // Background re-decodes must not starve live decoding
+    m_offlineThread->start();
+    
+    // F8 is held down for push-to-talk, which a shortcut can't express
+    qApp->installEventFilter(this);
+    m_pushToTalkMode = m_configWidget->getConfiguration().pushToTalk;
+    if (m_pushToTalkMode) {
+        onStartRecording();
+    }
     
     setWindowTitle("QWhisper - Real-time Speech Recognition");
     resize(1200, 800);
@@ -63,6 +109,15 @@ MainWindow::~MainWindow()
 {
     saveSettings();
     
+    // Cancel any in-flight decode so the whisper thread can exit promptly
+    m_whisperProcessor->requestAbort();
+    m_refinementProcessor->requestAbort();
+    m_offlineTranscriber->requestAbort();
+    m_batchQueue->shutdown();
+    if (m_streamingServer) {
+        m_streamingServer->shutdown();
+    }
+    
     // Stop threads
     if (m_audioThread->isRunning()) {
         m_audioThread->quit();
@@ -73,6 +128,16 @@ MainWindow::~MainWindow()
         m_whisperThread->quit();
         m_whisperThread->wait();
     }
+    
+    if (m_refinementThread->isRunning()) {
+        m_refinementThread->quit();
+        m_refinementThread->wait();
+    }
+    
+    if (m_offlineThread->isRunning()) {
+        m_offlineThread->quit();
+        m_offlineThread->wait();
+    }
 }
 
 void MainWindow::setupUi()
@@ -128,6 +193,18 @@ void MainWindow::createActions()
     m_pauseAction->setEnabled(false);
     connect(m_pauseAction, &QAction::triggered, this, &MainWindow::onPauseRecording);
     
+    // Checked while an utterance is being spoken: held with F8 (see eventFilter),
+    // clicked on and off in the toolbar
+    m_pushToTalkAction = new QAction(tr("Push to &Talk"), this);
+    m_pushToTalkAction->setStatusTip(tr("Hold F8 (or click on and off) to speak a push-to-talk utterance"));
+    m_pushToTalkAction->setCheckable(true);
+    connect(m_pushToTalkAction, &QAction::toggled, this, &MainWindow::onPushToTalk);
+    
+    m_transcribeFileAction = new QAction(tr("Transcribe &File..."), this);
+    m_transcribeFileAction->setShortcut(QKeySequence("Ctrl+Shift+O"));
+    m_transcribeFileAction->setStatusTip(tr("Transcribe an existing recording"));
+    connect(m_transcribeFileAction, &QAction::triggered, this, &MainWindow::onTranscribeFile);
+    
     m_saveTranscriptAction = new QAction(QIcon(":/icons/save.png"), tr("&Save Transcript"), this);
     m_saveTranscriptAction->setShortcut(QKeySequence::Save);
     m_saveTranscriptAction->setStatusTip(tr("Save transcript to file"));
@@ -162,6 +239,9 @@ void MainWindow::createMenus()
     m_fileMenu->addAction(m_startAction);
     m_fileMenu->addAction(m_stopAction);
     m_fileMenu->addAction(m_pauseAction);
+    m_fileMenu->addAction(m_pushToTalkAction);
+    m_fileMenu->addSeparator();
+    m_fileMenu->addAction(m_transcribeFileAction);
     m_fileMenu->addSeparator();
     m_fileMenu->addAction(m_saveTranscriptAction);
     m_fileMenu->addAction(m_clearTranscriptAction);
@@ -187,6 +267,7 @@ void MainWindow::createToolBars()
     m_mainToolBar->addAction(m_startAction);
     m_mainToolBar->addAction(m_stopAction);
     m_mainToolBar->addAction(m_pauseAction);
+    m_mainToolBar->addAction(m_pushToTalkAction);
     m_mainToolBar->addSeparator();
     m_mainToolBar->addAction(m_saveTranscriptAction);
     m_mainToolBar->addAction(m_clearTranscriptAction);
@@ -216,10 +297,22 @@ void MainWindow::connectSignals()
                 m_transcriptWidget->setShowTimestamps(config.includeTimestamps);
             });
     
-    // Connect config widget to whisper processor
+    // Connect config widget to whisper processor. The abort runs directly on this
+    // thread so the queued model load doesn't wait behind a long decode.
+    connect(m_configWidget, &ConfigWidget::modelChanged,
+            [this](const QString &) { m_whisperProcessor->requestAbort(); });
     connect(m_configWidget, &ConfigWidget::modelChanged,
             m_whisperProcessor.get(), &WhisperProcessor::loadModel);
     
+    // The refinement model follows the configuration on its own thread (loading a
+    // large model there keeps the UI responsive)
+    connect(m_configWidget, &ConfigWidget::configurationChanged,
+            [this](const AudioConfiguration &config) {
+                QMetaObject::invokeMethod(m_refinementProcessor.get(), [this, config]() {
+                    m_refinementProcessor->updateConfiguration(config);
+                }, Qt::QueuedConnection);
+            });
+    
     // Connect audio capture to audio processor (with filtering and gain)
     connect(m_audioCapture.get(), &AudioCapture::audioDataReady,
             m_audioProcessor.get(), &AudioProcessor::processAudioData);
@@ -250,6 +343,14 @@ void MainWindow::connectSignals()
     connect(m_whisperProcessor.get(), &WhisperProcessor::transcriptionReady,
             this, &MainWindow::onTranscriptionReceived);
     
+    // Finished chunks are re-decoded in the background and replace the live text
+    connect(m_whisperProcessor.get(), &WhisperProcessor::utteranceDecoded,
+            m_refinementProcessor.get(), &RefinementProcessor::refineUtterance);
+    connect(m_refinementProcessor.get(), &RefinementProcessor::utteranceRefined,
+            this, &MainWindow::onTranscriptionRefined);
+    connect(m_refinementProcessor.get(), &RefinementProcessor::statusChanged,
+            this, &MainWindow::onStatusChanged);
+    
     // Connect main window recording controls
     connect(this, &MainWindow::startRecording,
             m_audioCapture.get(), &AudioCapture::startCapture);
@@ -259,6 +360,71 @@ void MainWindow::connectSignals()
             m_whisperProcessor.get(), &WhisperProcessor::finishRecording);
     connect(this, &MainWindow::pauseRecording,
             m_audioCapture.get(), &AudioCapture::pauseCapture);
+    connect(this, &MainWindow::pauseRecording,
+            m_whisperProcessor.get(), &WhisperProcessor::resetAudioClock);
+    
+    // Recordings transcribed from disk go to the transcript once they are complete
+    connect(m_offlineTranscriber.get(), &OfflineTranscriber::segmentTranscribed,
+            m_transcriptWidget, &TranscriptWidget::appendTranscription);
+    connect(m_offlineTranscriber.get(), &OfflineTranscriber::progress, this,
+            [this](const QString &path, int chunksDone, int chunksTotal) {
+                statusBar()->showMessage(tr("Transcribing %1: %2/%3 chunks")
+                                             .arg(QFileInfo(path).fileName()).arg(chunksDone).arg(chunksTotal));
+            });
+    connect(m_offlineTranscriber.get(), &OfflineTranscriber::statusChanged,
+            this, &MainWindow::onStatusChanged);
+    connect(m_offlineTranscriber.get(), &OfflineTranscriber::fileFinished, this,
+            [this](const QString &path, const QList<TranscriptionSegment> &, double audioSeconds, double elapsedSeconds) {
+                // Keep the throughput on screen rather than flashing it like other status messages
+                statusBar()->showMessage(tr("Transcribed %1 at %2x real time")
+                                             .arg(QFileInfo(path).fileName())
+                                             .arg(elapsedSeconds > 0.0 ? audioSeconds / elapsedSeconds : 0.0, 0, 'f', 1));
+            });
+    connect(m_offlineTranscriber.get(), &OfflineTranscriber::fileFailed,
+            this, &MainWindow::onOfflineFileFailed);
+    
+    // Background batch jobs (watch folder, "qwhisper --transcribe") report in the status bar
+    connect(m_configWidget, &ConfigWidget::configurationChanged,
+            m_batchQueue, &BatchQueue::updateConfiguration);
+    connect(m_controlServer, &ControlServer::transcribeRequested, this,
+            [this](const QString &path) { m_batchQueue->enqueue(path, BatchQueue::InteractivePriority); });
+    connect(m_batchQueue, &BatchQueue::statusChanged,
+            this, &MainWindow::onStatusChanged);
+    connect(m_batchQueue, &BatchQueue::jobFailed, this,
+            [this](const QString &path, const QString &error) {
+                statusBar()->showMessage(tr("Batch transcription of %1 failed: %2")
+                                             .arg(QFileInfo(path).fileName(), error));
+            });
+    
+    connect(m_outputManager.get(), &OutputManager::clipboardTextReady, this,
+            [](const QString &text) { QGuiApplication::clipboard()->setText(text); });
+    
+    // Recognized voice commands act on the active window
+    connect(m_whisperProcessor.get(), &WhisperProcessor::commandRecognized, this,
+            [this](const QString &, const QString &action) { m_outputManager->runCommand(action); });
+    
+    // Push-to-talk keeps the device open while the mode is on, so the first press
+    // already has its pre-roll
+    connect(m_configWidget, &ConfigWidget::configurationChanged,
+            [this](const AudioConfiguration &config) {
+                const bool turnedOn = config.pushToTalk && !m_pushToTalkMode;
+                m_pushToTalkMode = config.pushToTalk;
+                if (turnedOn && !m_isRecording && m_audioThread->isRunning()) {
+                    onStartRecording();
+                }
+            });
+    
+    // Commands from other processes (e.g. a desktop hotkey running "qwhisper --ptt toggle")
+    connect(m_controlServer, &ControlServer::pushToTalkPressed,
+            [this]() { m_pushToTalkAction->setChecked(true); });
+    connect(m_controlServer, &ControlServer::pushToTalkReleased,
+            [this]() { m_pushToTalkAction->setChecked(false); });
+    connect(m_controlServer, &ControlServer::pushToTalkToggled,
+            m_pushToTalkAction, &QAction::toggle);
+    connect(m_controlServer, &ControlServer::startRequested,
+            this, &MainWindow::onStartRecording);
+    connect(m_controlServer, &ControlServer::stopRequested,
+            this, &MainWindow::onStopRecording);
     
     // Connect status updates
     connect(m_audioCapture.get(), &AudioCapture::statusChanged,
@@ -318,11 +484,91 @@ void MainWindow::onStopRecording()
         // Re-enable configuration changes after recording
         m_configWidget->setRecordingState(false);
         
+        // The decode in flight finishes and the remaining audio is flushed after it;
+        // aborting is left to shutdown and model changes, so the last sentence isn't lost.
+        // An open push-to-talk span is decoded by finishRecording()
+        QSignalBlocker blocker(m_pushToTalkAction);
+        m_pushToTalkAction->setChecked(false);
+        
         emit stopRecording();
         statusBar()->showMessage(tr("Stopped"));
     }
 }
 
+void MainWindow::onPushToTalk(bool pressed)
+{
+    if (!m_configWidget->getConfiguration().pushToTalk) {
+        QSignalBlocker blocker(m_pushToTalkAction);
+        m_pushToTalkAction->setChecked(false);
+        statusBar()->showMessage(tr("Push-to-talk is off (enable it under Voice Activity Detection)"));
+        return;
+    }
+    
+    // Capture stays open while push-to-talk is on; only a press after Stop pays
+    // for opening the device again
+    if (pressed && !m_isRecording) {
+        onStartRecording();
+    }
+    if (!m_isRecording) {
+        return;
+    }
+    
+    // Queued, so the boundary falls between the audio already captured (pre-roll)
+    // and what follows
+    QMetaObject::invokeMethod(m_whisperProcessor.get(),
+                              pressed ? &WhisperProcessor::pushToTalkPressed
+                                      : &WhisperProcessor::pushToTalkReleased,
+                              Qt::QueuedConnection);
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    // Push-to-talk: pressing F8 starts the utterance and releasing it ends it
+    // (auto-repeat aside), whichever widget has the focus
+    if ((event->type() == QEvent::KeyPress || event->type() == QEvent::KeyRelease) && isActiveWindow()) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        if (keyEvent->key() == Qt::Key_F8 && keyEvent->modifiers() == Qt::NoModifier) {
+            if (!keyEvent->isAutoRepeat()) {
+                m_pushToTalkKeyHeld = event->type() == QEvent::KeyPress;
+                m_pushToTalkAction->setChecked(m_pushToTalkKeyHeld);
+            }
+            return true;
+        }
+    } else if (event->type() == QEvent::ApplicationDeactivate && m_pushToTalkKeyHeld) {
+        // The release would go to another application
+        m_pushToTalkKeyHeld = false;
+        m_pushToTalkAction->setChecked(false);
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::onTranscribeFile()
+{
+    const QStringList paths = QFileDialog::getOpenFileNames(
+        this, tr("Transcribe Recordings"), QString(),
+        tr("Audio Files (*.wav *.flac *.mp3 *.ogg *.opus *.m4a *.aac);;All Files (*)"));
+    if (paths.isEmpty()) {
+        return;
+    }
+    
+    // Queued behind any file already in progress, in the order picked
+    const AudioConfiguration config = m_configWidget->getConfiguration();
+    QMetaObject::invokeMethod(m_offlineTranscriber.get(), [this, config]() {
+        m_offlineTranscriber->updateConfiguration(config);
+    }, Qt::QueuedConnection);
+    for (const QString &path : paths) {
+        QMetaObject::invokeMethod(m_offlineTranscriber.get(), [this, path]() {
+            m_offlineTranscriber->transcribeFile(path);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void MainWindow::onOfflineFileFailed(const QString &path, const QString &error)
+{
+    QMessageBox::warning(this, tr("Transcription Failed"),
+                         tr("Could not transcribe %1:\n%2").arg(QFileInfo(path).fileName(), error));
+}
+
 void MainWindow::onPauseRecording()
 {
     if (m_isRecording) {
@@ -333,24 +579,34 @@ void MainWindow::onPauseRecording()
     }
 }
 
-void MainWindow::onTranscriptionReceived(const QString &text, qint64 timestamp)
+void MainWindow::onTranscriptionReceived(const TranscriptionSegment &segment)
 {
-    // Add to transcript widget
-    m_transcriptWidget->appendTranscription(text, timestamp);
-    
-    // Get current configuration to check if timestamps should be included in output
-    auto config = m_configWidget->getConfiguration();
+    // Segments arrive one at a time while whisper is still decoding; stamp each
+    // with the time its audio started rather than when decoding finished
+    m_transcriptWidget->appendTranscription(segment);
     
     // Send to output manager for additional outputs (file, clipboard, etc.)
+    m_outputManager->handleTranscription(formatOutputText(segment), segment);
+}
+
+void MainWindow::onTranscriptionRefined(const TranscriptionSegment &segment)
+{
+    // Swap in the refinement model's text; clipboard and typed output were
+    // already delivered live, so only the stored transcripts change
+    m_transcriptWidget->replaceTranscription(segment);
+    m_outputManager->replaceTranscription(formatOutputText(segment), segment);
+}
+
+QString MainWindow::formatOutputText(const TranscriptionSegment &segment) const
+{
     // Include timestamps in output if configured
+    auto config = m_configWidget->getConfiguration();
     if (config.includeTimestamps) {
-        QString timestampedText = QString("[%1] %2")
-            .arg(QDateTime::fromMSecsSinceEpoch(timestamp).toString("hh:mm:ss"))
-            .arg(text);
-        m_outputManager->handleTranscription(timestampedText, timestamp);
-    } else {
-        m_outputManager->handleTranscription(text, timestamp);
+        return QString("[%1] %2")
+            .arg(QDateTime::fromMSecsSinceEpoch(segment.startTime).toString("hh:mm:ss"))
+            .arg(segment.text);
     }
+    return segment.text;
 }
 
 void MainWindow::onAudioLevelChanged(float level)
@@ -4,6 +4,7 @@
 #include <QMainWindow>
 #include <QThread>
 #include <memory>
+#include "whisper/transcriptionsegment.h"
 
 QT_BEGIN_NAMESPACE
 class QAction;
@@ -19,8 +20,13 @@ class AudioMonitor;
 class AudioCapture;
 class AudioProcessor;
 class WhisperProcessor;
+class RefinementProcessor;
 class OutputManager;
 class ModelDownloader;
+class ControlServer;
+class OfflineTranscriber;
+class BatchQueue;
+class StreamingServer;
 
 class MainWindow : public QMainWindow
 {
@@ -30,6 +36,9 @@ public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 signals:
     void startRecording();
     void stopRecording();
@@ -39,7 +48,11 @@ private slots:
     void onStartRecording();
     void onStopRecording();
     void onPauseRecording();
-    void onTranscriptionReceived(const QString &text, qint64 timestamp);
+    void onPushToTalk(bool pressed);
+    void onTranscribeFile();
+    void onOfflineFileFailed(const QString &path, const QString &error);
+    void onTranscriptionReceived(const TranscriptionSegment &segment);
+    void onTranscriptionRefined(const TranscriptionSegment &segment);
     void onAudioLevelChanged(float level);
     void onStatusChanged(const QString &status);
     void onAbout();
@@ -57,6 +70,7 @@ private:
     void createToolBars();
     void createStatusBar();
     void connectSignals();
+    QString formatOutputText(const TranscriptionSegment &segment) const;
     
     // UI Components
     ConfigWidget *m_configWidget;
@@ -68,17 +82,26 @@ private:
     std::unique_ptr<AudioCapture> m_audioCapture;
     std::unique_ptr<AudioProcessor> m_audioProcessor;
     std::unique_ptr<WhisperProcessor> m_whisperProcessor;
+    std::unique_ptr<RefinementProcessor> m_refinementProcessor;
+    std::unique_ptr<OfflineTranscriber> m_offlineTranscriber;
     std::unique_ptr<OutputManager> m_outputManager;
     std::unique_ptr<ModelDownloader> m_modelDownloader;
+    ControlServer *m_controlServer;
+    BatchQueue *m_batchQueue;
+    StreamingServer *m_streamingServer;   // Null unless streamServerPort is set
     
     // Threads
     QThread *m_audioThread;
     QThread *m_whisperThread;
+    QThread *m_refinementThread;
+    QThread *m_offlineThread;
     
     // Actions
     QAction *m_startAction;
     QAction *m_stopAction;
     QAction *m_pauseAction;
+    QAction *m_pushToTalkAction;
+    QAction *m_transcribeFileAction;
     QAction *m_exitAction;
     QAction *m_aboutAction;
     QAction *m_settingsAction;
@@ -97,6 +120,8 @@ private:
     // State
     bool m_isRecording;
     bool m_isPaused;
+    bool m_pushToTalkMode;       // Push-to-talk as last configured
+    bool m_pushToTalkKeyHeld;    // F8 is down in this window
 };
 
 #endif // MAINWINDOW_H
@@ -1,5 +1,13 @@
 #include "fileoutput.h"
 #include <QDateTime>
+#include <QFileInfo>
+#include <QDir>
+#include <QDebug>
+
+namespace {
+// Refinement runs at most a queue of chunks behind the live text, each a few lines
+constexpr int kRewritableEntries = 128;
+}
 
 FileOutput::FileOutput(QObject *parent)
     : QObject(parent)
@@ -12,6 +20,9 @@ FileOutput::~FileOutput()
     if (m_file && m_file->isOpen()) {
         m_file->close();
     }
+    if (m_wordsFile && m_wordsFile->isOpen()) {
+        m_wordsFile->close();
+    }
 }
 
 void FileOutput::setOutputFile(const QString &filePath)
@@ -22,6 +33,10 @@ void FileOutput::setOutputFile(const QString &filePath)
     if (m_file && m_file->isOpen()) {
         m_file->close();
     }
+    m_wordsStream.reset();
+    m_wordsFile.reset();
+    m_lines.clear();
+    m_wordEntries.clear();
     
     // Open new file
     m_file = std::make_unique<QFile>(m_filePath);
@@ -40,11 +55,138 @@ bool FileOutput::isEnabled() const
     return m_enabled;
 }
 
-void FileOutput::writeTranscription(const QString &text, qint64 timestamp)
+QString FileOutput::formatLine(const QString &text, const TranscriptionSegment &segment) const
+{
+    QString timestampStr = QDateTime::fromMSecsSinceEpoch(segment.startTime).toString("hh:mm:ss");
+    QString line = QString("[%1] %2").arg(timestampStr, text);
+    if (!segment.translation.isEmpty()) {
+        line += QString("\n    [en] %1").arg(segment.translation);
+    }
+    return line;
+}
+
+void FileOutput::writeTranscription(const QString &text, const TranscriptionSegment &segment)
 {
     if (!m_enabled || !m_stream) return;
     
-    QString timestampStr = QDateTime::fromMSecsSinceEpoch(timestamp).toString("hh:mm:ss");
-    *m_stream << "[" << timestampStr << "] " << text << Qt::endl;
-    m_stream->flush();
+    appendEntry(m_file.get(), m_stream.get(), m_lines, segment.utteranceId, formatLine(text, segment) + '\n');
+    
+    if (!segment.words.isEmpty()) {
+        writeWords(segment.utteranceId, segment.words);
+    }
+}
+
+void FileOutput::replaceTranscription(const QString &text, const TranscriptionSegment &segment)
+{
+    if (!m_enabled || !m_stream || segment.utteranceId == 0) return;
+    
+    // Same merge as the transcript view: the first line of the utterance takes the
+    // refined text and its other lines are dropped. An utterance that has left
+    // the tail keeps its live text.
+    const int first = firstEntry(m_lines, segment.utteranceId);
+    if (first < 0) return;
+    
+    // A refined segment has no translation of its own; keep the live one
+    QString line = formatLine(text, segment);
+    const QString &previous = m_lines[first].text;
+    int translationStart = previous.indexOf("\n    [en] ");
+    if (segment.translation.isEmpty() && translationStart >= 0) {
+        line += previous.mid(translationStart).chopped(1);
+    }
+    if (!replaceEntries(m_file.get(), m_stream.get(), m_lines, first, line + '\n')) {
+        return;
+    }
+    
+    if (!segment.words.isEmpty()) {
+        replaceWords(segment.utteranceId, segment.words);
+    }
+}
+
+int FileOutput::firstEntry(const QList<TailEntry> &tail, quint64 utteranceId)
+{
+    for (int i = 0; i < tail.size(); ++i) {
+        if (tail[i].utteranceId == utteranceId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FileOutput::appendEntry(QFile *file, QTextStream *stream, QList<TailEntry> &tail,
+                             quint64 utteranceId, const QString &text)
+{
+    // The file is opened in append mode, so its size is where the text lands
+    stream->flush();
+    tail.append({utteranceId, text, file->size()});
+    *stream << text;
+    stream->flush();
+    if (tail.size() > kRewritableEntries) {
+        tail.removeFirst();
+    }
+}
+
+bool FileOutput::replaceEntries(QFile *file, QTextStream *stream, QList<TailEntry> &tail,
+                                int first, const QString &text)
+{
+    const quint64 utteranceId = tail[first].utteranceId;
+    for (int i = tail.size() - 1; i > first; --i) {
+        if (tail[i].utteranceId == utteranceId) {
+            tail.removeAt(i);
+        }
+    }
+    tail[first].text = text;
+    
+    // Truncate to the replaced entry and write the rest of the tail again
+    stream->flush();
+    if (!file->resize(tail[first].offset)) {
+        qWarning() << "Could not rewrite" << file->fileName() << ":" << file->errorString();
+        return false;
+    }
+    for (int i = first; i < tail.size(); ++i) {
+        tail[i].offset = file->size();
+        *stream << tail[i].text;
+        stream->flush();
+    }
+    return true;
+}
+
+QString FileOutput::formatWords(const QList<TranscriptionWord> &words)
+{
+    QString text;
+    for (const auto &word : words) {
+        text += QDateTime::fromMSecsSinceEpoch(word.startTime).toString("hh:mm:ss.zzz") + '\t'
+              + QDateTime::fromMSecsSinceEpoch(word.endTime).toString("hh:mm:ss.zzz") + '\t'
+              + QString::number(word.probability, 'f', 3) + '\t'
+              + word.text + '\n';
+    }
+    return text;
+}
+
+void FileOutput::writeWords(quint64 utteranceId, const QList<TranscriptionWord> &words)
+{
+    if (!m_wordsStream) {
+        QFileInfo info(m_filePath);
+        QString wordsPath = info.dir().filePath(info.completeBaseName() + ".words.tsv");
+        
+        m_wordsFile = std::make_unique<QFile>(wordsPath);
+        if (!m_wordsFile->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            m_wordsFile.reset();
+            return;
+        }
+        m_wordsStream = std::make_unique<QTextStream>(m_wordsFile.get());
+        if (m_wordsFile->size() == 0) {
+            *m_wordsStream << "start\tend\tprobability\tword" << Qt::endl;
+        }
+    }
+    
+    appendEntry(m_wordsFile.get(), m_wordsStream.get(), m_wordEntries, utteranceId, formatWords(words));
+}
+
+void FileOutput::replaceWords(quint64 utteranceId, const QList<TranscriptionWord> &words)
+{
+    // The refined words take the place of the live ones, in the same order as the lines
+    const int first = m_wordsStream ? firstEntry(m_wordEntries, utteranceId) : -1;
+    if (first >= 0) {
+        replaceEntries(m_wordsFile.get(), m_wordsStream.get(), m_wordEntries, first, formatWords(words));
+    }
 }
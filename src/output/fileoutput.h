@@ -6,6 +6,7 @@
 #include <QFile>
 #include <QTextStream>
 #include <memory>
+#include "../whisper/transcriptionsegment.h"
 
 class FileOutput : public QObject
 {
@@ -18,13 +19,41 @@ public:
     void setOutputFile(const QString &filePath);
     void setEnabled(bool enabled);
     bool isEnabled() const;
-    void writeTranscription(const QString &text, qint64 timestamp);
+    void writeTranscription(const QString &text, const TranscriptionSegment &segment);
+    void replaceTranscription(const QString &text, const TranscriptionSegment &segment);
 
 private:
+    // Recent entries of an output file. Refined text rewrites the file from the
+    // entry it replaces on, so only this tail is kept; older entries are final.
+    struct TailEntry {
+        quint64 utteranceId;
+        QString text;          // As written, trailing newline included
+        qint64 offset;         // Where it starts in the file
+    };
+    
+    void writeWords(quint64 utteranceId, const QList<TranscriptionWord> &words);
+    void replaceWords(quint64 utteranceId, const QList<TranscriptionWord> &words);
+    QString formatLine(const QString &text, const TranscriptionSegment &segment) const;
+    static QString formatWords(const QList<TranscriptionWord> &words);
+    static void appendEntry(QFile *file, QTextStream *stream, QList<TailEntry> &tail,
+                            quint64 utteranceId, const QString &text);
+    // Give entry `first` the new text, drop the utterance's later entries, and
+    // write the file out again from there
+    static bool replaceEntries(QFile *file, QTextStream *stream, QList<TailEntry> &tail,
+                               int first, const QString &text);
+    static int firstEntry(const QList<TailEntry> &tail, quint64 utteranceId);
+    
+
     QString m_filePath;
     std::unique_ptr<QFile> m_file;
     std::unique_ptr<QTextStream> m_stream;
     bool m_enabled;
+    QList<TailEntry> m_lines;
+    
+    // Word timings go to a sidecar <name>.words.tsv, opened on first use
+    std::unique_ptr<QFile> m_wordsFile;
+    std::unique_ptr<QTextStream> m_wordsStream;
+    QList<TailEntry> m_wordEntries;
 };
 
 #endif // FILEOUTPUT_H
@@ -1,13 +1,12 @@
 #include "outputmanager.h"
 #include "fileoutput.h"
 #include "windowtyper.h"
-#include "../ui/configwidget.h"
-#include <QClipboard>
-#include <QApplication>
+#include "../config/audioconfiguration.h"
 
 OutputManager::OutputManager(QObject *parent)
     : QObject(parent)
     , m_outputToClipboard(false)
+    , m_outputToWindow(false)
 {
     m_fileOutput = std::make_unique<FileOutput>(this);
     m_windowTyper = std::make_unique<WindowTyper>(this);
@@ -28,25 +27,44 @@ void OutputManager::updateConfiguration(const AudioConfiguration &config)
         m_fileOutput->setEnabled(false);
     }
     
-    // Enable/disable window typing
-    m_windowTyper->setEnabled(config.outputToWindow);
+    // Enable/disable window typing; command mode acts on the active window too
+    m_outputToWindow = config.outputToWindow;
+    m_windowTyper->setEnabled(config.outputToWindow || config.commandMode);
 }
 
-void OutputManager::handleTranscription(const QString &text, qint64 timestamp)
+void OutputManager::handleTranscription(const QString &text, const TranscriptionSegment &segment)
 {
     // Output to file if enabled
     if (m_fileOutput->isEnabled()) {
-        m_fileOutput->writeTranscription(text, timestamp);
+        m_fileOutput->writeTranscription(text, segment);
     }
     
-    // Copy to clipboard if enabled
+    // Copy to clipboard if enabled (the GUI owns the clipboard; headless runs have none)
     if (m_outputToClipboard) {
-        QClipboard *clipboard = QApplication::clipboard();
-        clipboard->setText(text);
+        emit clipboardTextReady(text);
     }
     
     // Type to window if enabled
-    if (m_windowTyper->isEnabled()) {
+    if (m_outputToWindow && m_windowTyper->isEnabled()) {
+        m_windowTyper->typeText(text);
+    }
+}
+
+void OutputManager::replaceTranscription(const QString &text, const TranscriptionSegment &segment)
+{
+    // Clipboard and typed text can't be taken back, so only the file is rewritten
+    if (m_fileOutput->isEnabled()) {
+        m_fileOutput->replaceTranscription(text, segment);
+    }
+}
+
+void OutputManager::runCommand(const QString &action)
+{
+    if (action.startsWith("key ")) {
+        m_windowTyper->sendKeys(action.mid(4).trimmed());
+    } else if (action.startsWith("type ")) {
+        QString text = action.mid(5);
+        text.replace("\\n", "\n");
         m_windowTyper->typeText(text);
     }
 }
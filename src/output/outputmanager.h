@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QString>
 #include <memory>
+#include "../whisper/transcriptionsegment.h"
 
 struct AudioConfiguration;
 class FileOutput;
@@ -18,12 +19,22 @@ public:
     ~OutputManager();
     
     void updateConfiguration(const AudioConfiguration &config);
-    void handleTranscription(const QString &text, qint64 timestamp);
+    // text is the segment's text as it should be delivered (e.g. with a timestamp prefix)
+    void handleTranscription(const QString &text, const TranscriptionSegment &segment);
+    // Refined text for an utterance; only stored outputs (the file) are updated
+    void replaceTranscription(const QString &text, const TranscriptionSegment &segment);
+    // Carry out a voice command action ("key <combos>" or "type <text>")
+    void runCommand(const QString &action);
+
+signals:
+    // Text to put on the clipboard when clipboard output is on
+    void clipboardTextReady(const QString &text);
 
 private:
     std::unique_ptr<FileOutput> m_fileOutput;
     std::unique_ptr<WindowTyper> m_windowTyper;
     bool m_outputToClipboard;
+    bool m_outputToWindow;
 };
 
 #endif // OUTPUTMANAGER_H
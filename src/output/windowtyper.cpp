@@ -5,10 +5,17 @@
 #include <QCoreApplication>
 
 #ifdef Q_OS_LINUX
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#endif
+
+// Only the GUI is built against Xlib; without it the X11 backend types
+// through xdotool
+#ifdef QWHISPER_HAVE_X11
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
 #include <X11/extensions/XTest.h>
-#include <unistd.h>
 #endif
 
 WindowTyper::WindowTyper(QObject *parent)
@@ -27,7 +34,7 @@ WindowTyper::WindowTyper(QObject *parent)
 
 WindowTyper::~WindowTyper()
 {
-#ifdef Q_OS_LINUX
+#ifdef QWHISPER_HAVE_X11
     if (m_display) {
         XCloseDisplay(static_cast<Display*>(m_display));
     }
@@ -62,6 +69,7 @@ void WindowTyper::detectBackend()
                 m_backend = Backend_X11;  // Treat it as X11 backend
                 qDebug() << "WindowTyper: Using xdotool via XWayland on Wayland session";
                 
+#ifdef QWHISPER_HAVE_X11
                 // Try to open X11 display for direct X11 access
                 Display* display = XOpenDisplay(nullptr);
                 if (display) {
@@ -73,6 +81,7 @@ void WindowTyper::detectBackend()
                         m_display = nullptr;
                     }
                 }
+#endif
             } else {
                 // xdotool doesn't work, try native Wayland tools
                 
@@ -127,6 +136,7 @@ void WindowTyper::detectBackend()
         }
     } else {
         // Pure X11 session
+#ifdef QWHISPER_HAVE_X11
         // Try to open X11 display
         Display* display = XOpenDisplay(nullptr);
         if (display) {
@@ -147,6 +157,19 @@ void WindowTyper::detectBackend()
             qWarning() << "WindowTyper: Could not open X11 display";
             m_backend = Backend_None;
         }
+#else
+        QProcess checkXdotool;
+        checkXdotool.start("which", QStringList() << "xdotool");
+        checkXdotool.waitForFinished(1000);
+        
+        if (checkXdotool.exitCode() == 0) {
+            m_backend = Backend_X11;
+            qDebug() << "WindowTyper: Using xdotool backend";
+        } else {
+            qWarning() << "WindowTyper: X11 session but xdotool not found";
+            m_backend = Backend_None;
+        }
+#endif
     }
 #else
     qWarning() << "WindowTyper: Not supported on this platform";
@@ -176,6 +199,98 @@ void WindowTyper::typeText(const QString &text)
     processNextLine();
 }
 
+void WindowTyper::sendKeys(const QString &combos)
+{
+    if (!m_enabled || m_backend == Backend_None) {
+        if (m_backend == Backend_None) {
+            emit typingError("Window typing not available on this system");
+        }
+        return;
+    }
+    
+    for (const QString &combo : combos.split(' ', Qt::SkipEmptyParts)) {
+        const QStringList keys = combo.split('+', Qt::SkipEmptyParts);
+        if (keys.isEmpty()) {
+            continue;
+        }
+        
+        bool ok = false;
+        if (m_backend == Backend_X11 && m_display) {
+            ok = sendKeyComboX11(keys);
+        } else if (m_backend == Backend_Wayland_WType) {
+            // wtype -M ctrl -M shift -k t -m shift -m ctrl
+            QStringList args;
+            const QStringList modifiers = keys.mid(0, keys.size() - 1);
+            for (const QString &modifier : modifiers) {
+                args << "-M" << (modifier.toLower() == "super" ? QString("logo") : modifier.toLower());
+            }
+            args << "-k" << keys.last();
+            for (auto it = modifiers.rbegin(); it != modifiers.rend(); ++it) {
+                args << "-m" << (it->toLower() == "super" ? QString("logo") : it->toLower());
+            }
+            ok = QProcess::execute("wtype", args) == 0;
+        } else if (m_backend == Backend_Wayland_YDotool) {
+            // ydotool only takes raw key codes
+            emit typingError("Key combinations need xdotool or wtype");
+            return;
+        } else {
+            // xdotool understands the same "ctrl+shift+t" notation
+            ok = QProcess::execute("xdotool", QStringList() << "key" << combo) == 0;
+        }
+        
+        if (!ok) {
+            qWarning() << "Failed to send key combination" << combo;
+            emit typingError(QString("Failed to send %1").arg(combo));
+            return;
+        }
+    }
+}
+
+bool WindowTyper::sendKeyComboX11(const QStringList &keys)
+{
+#ifdef QWHISPER_HAVE_X11
+    Display* display = static_cast<Display*>(m_display);
+    
+    // Modifiers by their common names, everything else by keysym name ("s", "Tab", "F5")
+    QList<KeyCode> keycodes;
+    for (const QString &key : keys) {
+        const QString lower = key.toLower();
+        KeySym keysym = NoSymbol;
+        if (lower == "ctrl" || lower == "control") {
+            keysym = XK_Control_L;
+        } else if (lower == "shift") {
+            keysym = XK_Shift_L;
+        } else if (lower == "alt") {
+            keysym = XK_Alt_L;
+        } else if (lower == "super" || lower == "meta" || lower == "win") {
+            keysym = XK_Super_L;
+        } else {
+            keysym = XStringToKeysym(key.toLatin1().constData());
+        }
+        
+        KeyCode keycode = keysym != NoSymbol ? XKeysymToKeycode(display, keysym) : 0;
+        if (keycode == 0) {
+            qWarning() << "Unknown key" << key;
+            return false;
+        }
+        keycodes.append(keycode);
+    }
+    
+    // Press in order, release in reverse
+    for (KeyCode keycode : keycodes) {
+        XTestFakeKeyEvent(display, keycode, True, 0);
+    }
+    for (auto it = keycodes.rbegin(); it != keycodes.rend(); ++it) {
+        XTestFakeKeyEvent(display, *it, False, 0);
+    }
+    XFlush(display);
+    return true;
+#else
+    Q_UNUSED(keys)
+    return false;
+#endif
+}
+
 void WindowTyper::processNextLine()
 {
     if (m_pendingLines.isEmpty()) {
@@ -223,6 +338,7 @@ void WindowTyper::simulateReturn()
 #ifdef Q_OS_LINUX
     if (m_backend == Backend_X11) {
         if (m_display) {
+#ifdef QWHISPER_HAVE_X11
             Display* display = static_cast<Display*>(m_display);
             
             // Simulate Return key press using XTest
@@ -230,6 +346,7 @@ void WindowTyper::simulateReturn()
             XTestFakeKeyEvent(display, keycode, True, 0);  // Key press
             XTestFakeKeyEvent(display, keycode, False, 0); // Key release
             XFlush(display);
+#endif
         } else {
             // Use xdotool command as fallback (XWayland case)
             QProcess::execute("xdotool", QStringList() << "key" << "Return");
@@ -258,6 +375,7 @@ bool WindowTyper::typeTextX11(const QString &text)
         return process.exitCode() == 0;
     }
     
+#ifdef QWHISPER_HAVE_X11
     Display* display = static_cast<Display*>(m_display);
     
     // Type each character using XTest
@@ -308,6 +426,7 @@ bool WindowTyper::typeTextX11(const QString &text)
             QProcess::execute("xdotool", QStringList() << "type" << QString(ch));
         }
     }
+#endif
     
     return true;
 #else
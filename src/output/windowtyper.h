@@ -16,6 +16,8 @@ public:
     ~WindowTyper();
     
     void typeText(const QString &text);
+    // Press key combinations such as "ctrl+s" or "ctrl+shift+Tab Return" (X keysym names)
+    void sendKeys(const QString &combos);
     void setEnabled(bool enabled);
     bool isEnabled() const { return m_enabled; }
     
@@ -53,6 +55,7 @@ private:
     bool typeTextX11(const QString &text);
     bool typeTextWayland(const QString &text);
     bool typeTextFallback(const QString &text);
+    bool sendKeyComboX11(const QStringList &keys);
     void simulateKeyPress(const QString &text);
     void simulateReturn();
     
@@ -0,0 +1,431 @@
+#include "decodescheduler.h"
+#include "../whisper/whisperprocessor.h"
+#include "../whisper/sharedmodel.h"
+#include "../config/audioconfiguration.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <iterator>
+
+extern "C" {
+#include "include/whisper.h"
+}
+
+namespace {
+constexpr int kSampleRate = 16000;
+constexpr size_t kMinDecodeSamples = kSampleRate * 105 / 100;  // whisper skips input under 1 s
+constexpr qint64 kInterimLifetimeMs = 1000;   // The next interim replaces it after this
+constexpr double kLiveOverhead = 1.5;         // Interims re-decode part of every utterance
+constexpr double kTargetLoad = 0.8;           // Headroom kept for bursts of speech
+constexpr double kRtfSmoothing = 0.2;
+constexpr double kUnmeasuredRtf = kTargetLoad / kLiveOverhead;  // One live stream per worker
+constexpr int kLiveRunBeforeBatch = 4;        // Live jobs started in a row while batch work waits
+}
+
+DecodeScheduler::DecodeScheduler(QObject *parent)
+    : QObject(parent)
+    , m_stopping(false)
+    , m_running(0)
+    , m_loading(false)
+    , m_liveRun(0)
+    , m_loadedDeviceType(0)
+    , m_computeDeviceType(0)
+    , m_computeDeviceId(-1)
+    , m_configuredWorkers(0)
+    , m_profile(DecodingProfile::preset("balanced"))
+    , m_realTimeFactor(0.0)
+    , m_abort(false)
+{
+}
+
+DecodeScheduler::~DecodeScheduler()
+{
+    shutdown();
+    releaseModel();
+}
+
+void DecodeScheduler::updateConfiguration(const AudioConfiguration &config)
+{
+    // A new model is loaded by the first worker that finds the pool idle
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_modelName = config.model;
+    m_language = config.language;
+    m_computeDeviceType = config.computeDeviceType;
+    m_computeDeviceId = config.computeDeviceId;
+    m_configuredWorkers = config.streamServerDecoders;
+    m_profile = DecodingProfile::fromConfiguration(config);
+    if (m_loadedModel != m_modelName) {
+        m_realTimeFactor = 0.0;
+    }
+    m_wake.notify_all();
+}
+
+int DecodeScheduler::workerCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return workerCountLocked();
+}
+
+int DecodeScheduler::workerCountLocked() const
+{
+    // Same split as offline transcription: on a GPU two states keep it busy
+    if (!m_workers.empty()) {
+        return static_cast<int>(m_workers.size());
+    }
+    const int cores = std::max(1, QThread::idealThreadCount());
+    return m_configuredWorkers > 0 ? m_configuredWorkers
+         : m_computeDeviceType == 1 ? 2
+         : std::clamp(cores / 4, 1, 4);
+}
+
+double DecodeScheduler::liveDemand(int liveSessions) const
+{
+    // Each live stream brings one second of audio per second. Until a decode
+    // has been timed, each is assumed to need a worker of its own.
+    const double rtf = m_realTimeFactor > 0.0 ? m_realTimeFactor : kUnmeasuredRtf;
+    return rtf * kLiveOverhead * liveSessions / workerCountLocked();
+}
+
+bool DecodeScheduler::admit(Priority priority) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int live = 0;
+    for (const SessionQueue &queue : m_sessions) {
+        if (queue.priority == Live) {
+            live++;
+        }
+    }
+    // Batch work only needs the workers not to be saturated by live streams
+    return priority == Live ? liveDemand(live + 1) <= kTargetLoad : liveDemand(live) < 1.0;
+}
+
+double DecodeScheduler::predictedLoad() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    int live = 0;
+    for (const SessionQueue &queue : m_sessions) {
+        if (queue.priority == Live) {
+            live++;
+        }
+    }
+    return liveDemand(live);
+}
+
+double DecodeScheduler::realTimeFactor() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_realTimeFactor;
+}
+
+void DecodeScheduler::openSession(quint64 sessionId, Priority priority)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sessions[sessionId].priority = priority;
+}
+
+void DecodeScheduler::closeSession(quint64 sessionId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_sessions.remove(sessionId);
+}
+
+void DecodeScheduler::submit(quint64 sessionId, std::vector<float> samples, qint64 audioStart, bool final)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_sessions.find(sessionId);
+    if (it == m_sessions.end() || m_stopping) {
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 audioMs = static_cast<qint64>(samples.size()) * 1000 / kSampleRate;
+    Job job{sessionId, std::move(samples), audioStart, final, now + kInterimLifetimeMs};
+    if (final) {
+        it->virtualClock = std::max(now, it->virtualClock) + audioMs;
+        job.deadline = it->virtualClock;
+    }
+    it->jobs.push_back(std::move(job));
+
+    if (m_workers.empty()) {
+        startWorkers();
+    }
+    m_wake.notify_one();
+}
+
+void DecodeScheduler::startWorkers()
+{
+    const int workers = workerCountLocked();
+    const int threads = std::max(1, QThread::idealThreadCount() / workers);
+    qDebug() << "Streaming decode pool:" << workers << "workers x" << threads << "threads";
+    for (int i = 0; i < workers; ++i) {
+        m_workers.emplace_back([this, threads]() { workerLoop(threads); });
+    }
+}
+
+void DecodeScheduler::shutdown()
+{
+    // The list is taken under the lock so workerCount() never sees it half cleared
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_sessions.clear();
+        workers.swap(m_workers);
+    }
+    m_abort.store(true);
+    m_wake.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void DecodeScheduler::setDecodeFunction(DecodeFunction function)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_decodeFunction = std::move(function);
+}
+
+bool DecodeScheduler::loadModel()
+{
+    // Runs with the pool idle and m_loading set, so no decode uses the model
+    std::unique_lock<std::mutex> lock(m_mutex);
+    const QString modelName = m_modelName;
+    const int deviceType = m_computeDeviceType;
+    const int deviceId = m_computeDeviceId;
+    lock.unlock();
+    releaseModel();
+
+    const QString modelPath = WhisperProcessor::getModelPath(modelName);
+    if (modelPath.isEmpty() || !QFile::exists(modelPath)) {
+        return false;
+    }
+
+    // The same weights as the live processor when it uses this model
+    std::shared_ptr<whisper_context> context = SharedModel::acquire(modelPath, deviceType, deviceId);
+    if (!context) {
+        return false;
+    }
+
+    lock.lock();
+    m_context = context;
+    m_loadedModel = modelName;
+    m_loadedDeviceType = deviceType;
+    lock.unlock();
+    emit statusChanged(QString("Streaming server model loaded: %1").arg(modelName));
+    return true;
+}
+
+void DecodeScheduler::releaseModel()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::vector<whisper_state*> states;
+    states.swap(m_freeStates);
+    std::shared_ptr<whisper_context> context;
+    context.swap(m_context);
+    m_loadedModel.clear();
+    lock.unlock();
+
+    // States belong to the context they were created from
+    for (whisper_state *state : states) {
+        whisper_free_state(state);
+    }
+}
+
+bool DecodeScheduler::abortCallback(void *userData)
+{
+    return static_cast<const DecodeScheduler*>(userData)->m_abort.load();
+}
+
+void DecodeScheduler::workerLoop(int threads)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        // Pick the most urgent job of a session that has nothing running;
+        // interims nobody will see any more are answered without decoding
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        std::vector<Job> stale;
+        SessionQueue *bestLive = nullptr;
+        SessionQueue *bestBatch = nullptr;
+        for (SessionQueue &queue : m_sessions) {
+            if (queue.running) {
+                continue;
+            }
+            while (!queue.jobs.empty() && !queue.jobs.front().final && queue.jobs.front().deadline < now) {
+                stale.push_back(std::move(queue.jobs.front()));
+                queue.jobs.pop_front();
+            }
+            if (queue.jobs.empty()) {
+                continue;
+            }
+            SessionQueue *&classBest = queue.priority == Live ? bestLive : bestBatch;
+            if (!classBest || queue.jobs.front().deadline < classBest->jobs.front().deadline) {
+                classBest = &queue;
+            }
+        }
+        // Live first, but batch work gets every few jobs so uploads aren't
+        // starved while live streams keep the workers busy
+        SessionQueue *best = bestLive ? bestLive : bestBatch;
+        if (bestLive && bestBatch && m_liveRun >= kLiveRunBeforeBatch) {
+            best = bestBatch;
+        }
+
+        if (!stale.empty()) {
+            lock.unlock();
+            for (const Job &job : stale) {
+                emit decodeFailed(job.sessionId, false, "Skipped: past its deadline");
+            }
+            lock.lock();
+            continue;  // The session list may have changed meanwhile
+        }
+        if (!best || m_loading) {
+            m_wake.wait(lock);
+            continue;
+        }
+
+        // Swap models only once every running decode has given back its state
+        if (!m_decodeFunction
+            && (!m_context || m_loadedModel != m_modelName || m_loadedDeviceType != m_computeDeviceType)) {
+            if (m_running > 0) {
+                m_wake.wait(lock);
+                continue;
+            }
+            m_loading = true;
+            lock.unlock();
+            const bool loaded = loadModel();
+            lock.lock();
+            m_loading = false;
+            m_wake.notify_all();
+            if (!loaded) {
+                // Answer the queued jobs rather than retrying the load for each
+                std::vector<Job> failed;
+                for (SessionQueue &queue : m_sessions) {
+                    if (!queue.running) {
+                        std::move(queue.jobs.begin(), queue.jobs.end(), std::back_inserter(failed));
+                        queue.jobs.clear();
+                    }
+                }
+                const QString error = QString("Cannot load model %1").arg(m_modelName);
+                lock.unlock();
+                for (const Job &job : failed) {
+                    emit decodeFailed(job.sessionId, job.final, error);
+                }
+                lock.lock();
+            }
+            continue;
+        }
+
+        m_liveRun = (best == bestLive && bestBatch) ? m_liveRun + 1 : 0;
+        Job job = std::move(best->jobs.front());
+        best->jobs.pop_front();
+        best->running = true;
+        m_running++;
+        whisper_state *state = nullptr;
+        if (!m_freeStates.empty()) {
+            state = m_freeStates.back();
+            m_freeStates.pop_back();
+        }
+        // Interim text is replaced moments later, so it gets the cheapest settings
+        const DecodingProfile profile = job.final ? m_profile : DecodingProfile::preset("fastest");
+        const QString language = m_language;
+        const DecodeFunction decodeFunction = m_decodeFunction;
+        lock.unlock();
+
+        if (!state && !decodeFunction) {
+            state = whisper_init_state(m_context.get());
+        }
+        QElapsedTimer timer;
+        timer.start();
+        // Results are reported before the session is released, so its next
+        // one can't overtake them
+        bool ok = false;
+        if (decodeFunction) {
+            QList<TranscriptionSegment> segments = decodeFunction(job.samples, job.final);
+            for (TranscriptionSegment &segment : segments) {
+                segment.startTime += job.audioStart;
+                segment.endTime += job.audioStart;
+            }
+            emit decoded(job.sessionId, job.final, segments);
+            ok = true;
+        } else if (state) {
+            ok = runJob(job, state, threads, profile, language);
+        } else {
+            emit decodeFailed(job.sessionId, job.final, "Cannot allocate a decoder state");
+        }
+        const double seconds = timer.nsecsElapsed() / 1e9;
+
+        lock.lock();
+        if (state) {
+            m_freeStates.push_back(state);
+        }
+        if (ok && job.final) {
+            const double audioSeconds = std::max(job.samples.size(), kMinDecodeSamples) / double(kSampleRate);
+            const double rtf = seconds / audioSeconds;
+            m_realTimeFactor = m_realTimeFactor > 0.0
+                ? m_realTimeFactor + kRtfSmoothing * (rtf - m_realTimeFactor) : rtf;
+        }
+        m_running--;
+        auto it = m_sessions.find(job.sessionId);
+        if (it != m_sessions.end()) {
+            it->running = false;
+        }
+        m_wake.notify_all();
+    }
+}
+
+bool DecodeScheduler::runJob(const Job &job, whisper_state *state, int threads,
+                             const DecodingProfile &profile, const QString &language)
+{
+    whisper_full_params wparams = whisper_full_default_params(
+        static_cast<whisper_sampling_strategy>(profile.whisperStrategy()));
+    profile.applyTo(wparams);
+    wparams.print_progress = false;
+    wparams.print_special = false;
+    wparams.print_realtime = false;
+    wparams.print_timestamps = false;
+    wparams.single_segment = false;
+    // States are shared between sessions, so no session's text is carried over
+    wparams.no_context = true;
+    wparams.n_threads = threads;
+    wparams.suppress_blank = true;
+    const QByteArray languageCode = whisper_is_multilingual(m_context.get()) ? language.toLatin1() : QByteArray("en");
+    wparams.language = languageCode.constData();
+    wparams.abort_callback = &DecodeScheduler::abortCallback;
+    wparams.abort_callback_user_data = this;
+
+    // Pad short utterances with silence so whisper doesn't skip them
+    std::vector<float> padded;
+    const float *data = job.samples.data();
+    size_t count = job.samples.size();
+    if (count < kMinDecodeSamples) {
+        padded = job.samples;
+        padded.resize(kMinDecodeSamples, 0.0f);
+        data = padded.data();
+        count = padded.size();
+    }
+
+    if (whisper_full_with_state(m_context.get(), state, wparams, data, static_cast<int>(count)) != 0) {
+        emit decodeFailed(job.sessionId, job.final, m_abort.load() ? QString("Canceled") : QString("Decode failed"));
+        return false;
+    }
+
+    QList<TranscriptionSegment> segments;
+    const qint64 audioEnd = job.audioStart + static_cast<qint64>(job.samples.size()) * 1000 / kSampleRate;
+    for (int i = 0; i < whisper_full_n_segments_from_state(state); ++i) {
+        const QString text = QString::fromUtf8(whisper_full_get_segment_text_from_state(state, i)).trimmed();
+        if (text.isEmpty() || text == "[BLANK_AUDIO]") {
+            continue;
+        }
+        TranscriptionSegment segment;
+        segment.text = text;
+        segment.timestamp = QDateTime::currentMSecsSinceEpoch();
+        segment.startTime = job.audioStart + whisper_full_get_segment_t0_from_state(state, i) * 10;
+        segment.endTime = std::min(audioEnd, job.audioStart + whisper_full_get_segment_t1_from_state(state, i) * 10);
+        segment.noSpeechProb = whisper_full_get_segment_no_speech_prob_from_state(state, i);
+        segments.append(segment);
+    }
+    emit decoded(job.sessionId, job.final, segments);
+    return true;
+}
@@ -0,0 +1,133 @@
+#ifndef DECODESCHEDULER_H
+#define DECODESCHEDULER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../whisper/transcriptionsegment.h"
+#include "../whisper/decodingprofile.h"
+
+struct AudioConfiguration;
+struct whisper_context;
+struct whisper_state;
+
+// Shares one resident copy of the model between the streaming server's
+// sessions (the same copy the live processor uses, see SharedModel). A few worker threads each borrow a whisper state (KV cache, mel
+// buffer) from a pool, so memory doesn't grow with the number of clients.
+//
+// Ordering: live sessions go before batch ones, except that while batch work
+// waits every fifth job started is a batch job. Within a class the job
+// with the earliest deadline runs first. A final's deadline comes from its
+// session's virtual clock, which advances by the job's audio length, so a
+// client that sends faster than real time only pushes back its own work (fair
+// queuing). Interims are due within a second and are dropped once stale. A
+// session has at most one job running, so its results arrive in order.
+//
+// Admission: the measured real-time factor predicts how many live streams the
+// workers can keep up with; sessions past that are turned away. Until the
+// first decode is timed, each worker is given one live stream.
+class DecodeScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority { Live, Batch };
+
+    explicit DecodeScheduler(QObject *parent = nullptr);
+    ~DecodeScheduler();
+
+    void updateConfiguration(const AudioConfiguration &config);
+
+    // Whether one more session of this class fits in the decoding capacity
+    bool admit(Priority priority) const;
+    void openSession(quint64 sessionId, Priority priority);
+    // Drops the session's queued jobs; one already running finishes unseen
+    void closeSession(quint64 sessionId);
+
+    // Queue samples (16 kHz mono) that start audioStart ms into the session's
+    // stream. Interim decodes use the fastest preset; finals the configured one.
+    void submit(quint64 sessionId, std::vector<float> samples, qint64 audioStart, bool final);
+
+    // Cancel running decodes and stop the workers
+    void shutdown();
+
+    // Replaces whisper, for tests: called on a worker thread with a job's
+    // samples, returns its segments with times in ms from the first sample
+    using DecodeFunction = std::function<QList<TranscriptionSegment>(const std::vector<float> &samples, bool final)>;
+    void setDecodeFunction(DecodeFunction function);
+
+    // Predicted share of the workers the live sessions need (1.0 = all of them)
+    double predictedLoad() const;
+    double realTimeFactor() const;
+    int workerCount() const;
+
+signals:
+    // Segment times are ms from the start of the session's stream
+    void decoded(quint64 sessionId, bool final, const QList<TranscriptionSegment> &segments);
+    void decodeFailed(quint64 sessionId, bool final, const QString &error);
+    void statusChanged(const QString &status);
+
+private:
+    struct Job {
+        quint64 sessionId;
+        std::vector<float> samples;
+        qint64 audioStart;
+        bool final;
+        qint64 deadline;           // Wall clock, ms since epoch
+    };
+
+    struct SessionQueue {
+        Priority priority = Live;
+        std::deque<Job> jobs;
+        qint64 virtualClock = 0;   // Deadline given to the session's last final
+        bool running = false;
+    };
+
+    void startWorkers();
+    int workerCountLocked() const;
+    void workerLoop(int threads);
+    bool loadModel();
+    void releaseModel();
+    double liveDemand(int liveSessions) const;
+    bool runJob(const Job &job, whisper_state *state, int threads,
+                const DecodingProfile &profile, const QString &language);
+    static bool abortCallback(void *userData);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::vector<std::thread> m_workers;
+    bool m_stopping;
+
+    QHash<quint64, SessionQueue> m_sessions;
+    int m_running;                 // Jobs being decoded
+    bool m_loading;                // A worker is (re)loading the model
+    int m_liveRun;                 // Live jobs started in a row while batch jobs waited
+
+    // Model and state pool; replaced only while no job is running
+    std::shared_ptr<whisper_context> m_context;
+    QString m_loadedModel;
+    int m_loadedDeviceType;
+    std::vector<whisper_state*> m_freeStates;
+
+    QString m_modelName;
+    QString m_language;
+    int m_computeDeviceType;
+    int m_computeDeviceId;
+    int m_configuredWorkers;       // 0 = from the core count
+    DecodingProfile m_profile;
+    DecodeFunction m_decodeFunction;
+
+    double m_realTimeFactor;       // Decode time per second of audio, averaged; 0 until measured
+    std::atomic<bool> m_abort;
+};
+
+#endif // DECODESCHEDULER_H
@@ -0,0 +1,197 @@
+#include "streamingclient.h"
+#include "../whisper/offlinetranscriber.h"
+#include <QTcpSocket>
+#include <QTimer>
+#include <QHostAddress>
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+constexpr int kSampleRate = 16000;
+constexpr int kFrameMs = 100;
+constexpr qint64 kMaxUnsent = 64 * 1024;    // Wait for the socket to drain past this
+}
+
+StreamingClient::StreamingClient(QObject *parent)
+    : QObject(parent)
+    , m_socket(new QTcpSocket(this))
+    , m_timer(new QTimer(this))
+    , m_position(0)
+    , m_speed(1.0)
+    , m_upgraded(false)
+    , m_finished(false)
+{
+    connect(m_socket, &QTcpSocket::connected, this, &StreamingClient::onConnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &StreamingClient::onReadyRead);
+    connect(m_socket, &QTcpSocket::errorOccurred, this, [this]() { fail(m_socket->errorString()); });
+    connect(m_socket, &QTcpSocket::disconnected, this, [this]() { fail("Server closed the connection"); });
+
+    // The server stops reading when its backlog is full; the writes then pile up
+    // here and the next frame waits for them to drain
+    connect(m_socket, &QTcpSocket::bytesWritten, this, [this]() {
+        if (m_upgraded && !m_timer->isActive() && m_position < m_samples.size()
+            && m_socket->bytesToWrite() < kMaxUnsent) {
+            m_timer->start();
+        }
+    });
+    connect(m_timer, &QTimer::timeout, this, &StreamingClient::sendNextFrame);
+}
+
+void StreamingClient::stream(const QString &path, quint16 port, double speed)
+{
+    QString error;
+    if (!OfflineTranscriber::loadAudio(path, m_samples, &error)) {
+        fail(error);
+        return;
+    }
+    m_speed = speed;
+    m_timer->setInterval(speed > 0.0 ? static_cast<int>(kFrameMs / speed) : 0);
+    m_socket->connectToHost(QHostAddress::LocalHost, port);
+}
+
+void StreamingClient::onConnected()
+{
+    QByteArray nonce(16, 0);
+    for (char &byte : nonce) {
+        byte = static_cast<char>(QRandomGenerator::global()->bounded(256));
+    }
+    m_key = nonce.toBase64();
+    m_socket->write("GET /stream HTTP/1.1\r\n"
+                    "Host: 127.0.0.1\r\n"
+                    "Upgrade: websocket\r\n"
+                    "Connection: Upgrade\r\n"
+                    "Sec-WebSocket-Version: 13\r\n"
+                    "Sec-WebSocket-Key: " + m_key + "\r\n\r\n");
+}
+
+void StreamingClient::onReadyRead()
+{
+    m_input += m_socket->readAll();
+
+    if (!m_upgraded) {
+        const int headerEnd = m_input.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            return;
+        }
+        const QByteArray header = m_input.left(headerEnd);
+        m_input.remove(0, headerEnd + 4);
+        const QByteArray expected = QCryptographicHash::hash(m_key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11",
+                                                             QCryptographicHash::Sha1).toBase64();
+        if (!header.startsWith("HTTP/1.1 101") || !header.contains(expected)) {
+            fail(QString("Handshake rejected: %1").arg(QString::fromLatin1(header.left(header.indexOf('\r')))));
+            return;
+        }
+        m_upgraded = true;
+        m_timer->start();
+    }
+
+    // Server frames are unmasked and, for our events, never fragmented
+    while (m_input.size() >= 2) {
+        const quint8 opcode = static_cast<quint8>(m_input[0]) & 0x0F;
+        qint64 length = static_cast<quint8>(m_input[1]) & 0x7F;
+        int offset = 2;
+        if (length == 126) {
+            if (m_input.size() < 4) {
+                return;
+            }
+            length = qFromBigEndian<quint16>(m_input.constData() + 2);
+            offset = 4;
+        } else if (length == 127) {
+            if (m_input.size() < 10) {
+                return;
+            }
+            length = static_cast<qint64>(qFromBigEndian<quint64>(m_input.constData() + 2));
+            offset = 10;
+        }
+        if (m_input.size() < offset + length) {
+            return;
+        }
+        const QByteArray payload = m_input.mid(offset, length);
+        m_input.remove(0, offset + length);
+
+        if (opcode == 0x1) {
+            emit event(payload);
+            if (QJsonDocument::fromJson(payload).object().value("type").toString() == "done") {
+                m_finished = true;
+                m_timer->stop();
+                m_socket->disconnect(this);
+                m_socket->disconnectFromHost();
+                emit finished(0);
+                return;
+            }
+        } else if (opcode == 0x8) {
+            fail("Server closed the stream");
+            return;
+        } else if (opcode == 0x9) {
+            sendFrame(0xA, payload);
+        }
+    }
+}
+
+void StreamingClient::sendNextFrame()
+{
+    if (m_position >= m_samples.size()) {
+        m_timer->stop();
+        sendFrame(0x1, "{\"type\":\"end\"}");
+        return;
+    }
+    if (m_socket->bytesToWrite() >= kMaxUnsent) {
+        m_timer->stop();  // Resumed from bytesWritten
+        return;
+    }
+
+    const size_t count = std::min<size_t>(kSampleRate * kFrameMs / 1000, m_samples.size() - m_position);
+    QByteArray pcm(static_cast<qsizetype>(count * 2), 0);
+    for (size_t i = 0; i < count; ++i) {
+        const float sample = std::clamp(m_samples[m_position + i], -1.0f, 1.0f);
+        qToLittleEndian<qint16>(static_cast<qint16>(sample * 32767.0f), pcm.data() + i * 2);
+    }
+    m_position += count;
+    sendFrame(0x2, pcm);
+}
+
+void StreamingClient::sendFrame(quint8 opcode, const QByteArray &payload)
+{
+    // Client frames must be masked
+    QByteArray frame;
+    frame.append(static_cast<char>(0x80 | opcode));
+    if (payload.size() < 126) {
+        frame.append(static_cast<char>(0x80 | payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        frame.append(static_cast<char>(0x80 | 126));
+        QByteArray length(2, 0);
+        qToBigEndian<quint16>(static_cast<quint16>(payload.size()), length.data());
+        frame += length;
+    } else {
+        frame.append(static_cast<char>(0x80 | 127));
+        QByteArray length(8, 0);
+        qToBigEndian<quint64>(static_cast<quint64>(payload.size()), length.data());
+        frame += length;
+    }
+
+    const quint32 maskValue = QRandomGenerator::global()->generate();
+    QByteArray mask(4, 0);
+    qToBigEndian<quint32>(maskValue, mask.data());
+    frame += mask;
+    QByteArray masked = payload;
+    for (qsizetype i = 0; i < masked.size(); ++i) {
+        masked[i] = masked[i] ^ mask[i % 4];
+    }
+    m_socket->write(frame + masked);
+}
+
+void StreamingClient::fail(const QString &error)
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    m_timer->stop();
+    qWarning() << "Streaming client:" << error;
+    emit finished(1);
+}
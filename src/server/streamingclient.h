@@ -0,0 +1,50 @@
+#ifndef STREAMINGCLIENT_H
+#define STREAMINGCLIENT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <vector>
+
+class QTcpSocket;
+class QTimer;
+
+// Minimal WebSocket client for the streaming server: plays a recording to it
+// at a chosen speed, prints every event it gets back, and finishes when the
+// server says "done". Used by "qwhisper-cli --stream-to" to exercise a running
+// server (and its backpressure) from the command line.
+class StreamingClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StreamingClient(QObject *parent = nullptr);
+
+    // speed 1.0 sends audio in real time; 0 sends it as fast as the server takes it
+    void stream(const QString &path, quint16 port, double speed = 1.0);
+
+signals:
+    void event(const QByteArray &json);
+    void finished(int exitCode);
+
+private slots:
+    void onConnected();
+    void onReadyRead();
+    void sendNextFrame();
+
+private:
+    void sendFrame(quint8 opcode, const QByteArray &payload);
+    void fail(const QString &error);
+
+    QTcpSocket *m_socket;
+    QTimer *m_timer;
+    std::vector<float> m_samples;
+    size_t m_position;
+    double m_speed;
+    QByteArray m_key;
+    QByteArray m_input;
+    bool m_upgraded;
+    bool m_finished;
+};
+
+#endif // STREAMINGCLIENT_H
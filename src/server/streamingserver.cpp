@@ -0,0 +1,643 @@
+#include "streamingserver.h"
+#include "decodescheduler.h"
+#include "../config/audioconfiguration.h"
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QTimer>
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr int kSampleRate = 16000;
+constexpr int kFrameSamples = kSampleRate / 50;          // 20 ms VAD frames
+constexpr int kEndPauseSamples = kSampleRate * 6 / 10;   // Pause that ends an utterance
+constexpr int kPreRollSamples = kSampleRate * 3 / 10;    // Kept from before speech starts
+constexpr int kInterimStepSamples = kSampleRate;         // New audio between interim decodes
+constexpr qint64 kMaxBacklogMs = 30000;
+constexpr qint64 kMaxRequestHeader = 16 * 1024;
+constexpr int kRequestTimeoutMs = 10000;                 // To send the request headers
+constexpr qint64 kMaxFrameSize = 1024 * 1024;
+constexpr qint64 kReadBufferSize = 64 * 1024;            // Socket buffer while the backlog is full
+constexpr qint64 kMaxPendingOutput = 256 * 1024;         // Unsent reply bytes before interims are dropped
+constexpr int kMaxSessions = 8;
+const char *kWebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+QString joinedText(const QList<TranscriptionSegment> &segments)
+{
+    QStringList parts;
+    for (const TranscriptionSegment &segment : segments) {
+        parts.append(segment.text);
+    }
+    return parts.join(' ');
+}
+}
+
+StreamingServer::StreamingServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QTcpServer(this))
+    , m_scheduler(new DecodeScheduler(this))
+    , m_nextSessionId(1)
+    , m_threshold(0.012f)
+    , m_maxUtteranceSamples(kSampleRate * 10)
+{
+    connect(m_server, &QTcpServer::newConnection, this, &StreamingServer::onNewConnection);
+
+    // Emitted from the scheduler's worker threads
+    connect(m_scheduler, &DecodeScheduler::decoded, this, &StreamingServer::onDecoded, Qt::QueuedConnection);
+    connect(m_scheduler, &DecodeScheduler::decodeFailed, this, &StreamingServer::onDecodeFailed, Qt::QueuedConnection);
+    connect(m_scheduler, &DecodeScheduler::statusChanged, this, &StreamingServer::statusChanged, Qt::QueuedConnection);
+}
+
+StreamingServer::~StreamingServer()
+{
+    shutdown();
+}
+
+bool StreamingServer::listen(quint16 port)
+{
+    if (!m_server->listen(QHostAddress::LocalHost, port)) {
+        qDebug() << "Streaming server cannot listen on port" << port << ":" << m_server->errorString();
+        return false;
+    }
+    qDebug() << "Streaming server listening on 127.0.0.1:" << m_server->serverPort();
+    emit statusChanged(QString("Streaming server listening on port %1").arg(m_server->serverPort()));
+    return true;
+}
+
+quint16 StreamingServer::port() const
+{
+    return m_server->serverPort();
+}
+
+void StreamingServer::shutdown()
+{
+    m_server->close();
+    for (Session *session : std::as_const(m_sessions)) {
+        session->socket->disconnect(this);
+        session->socket->abort();
+        session->socket->deleteLater();
+        delete session;
+    }
+    m_sessions.clear();
+    m_scheduler->shutdown();
+}
+
+void StreamingServer::updateConfiguration(const AudioConfiguration &config)
+{
+    m_modelName = config.model;
+    m_threshold = config.pickupThreshold / 10000.0f;  // Same scale as WhisperProcessor's VAD
+    const int maxMs = std::clamp(static_cast<int>(config.maxSpeechDuration * 1000), 2000, 28000);
+    m_maxUtteranceSamples = maxMs * (kSampleRate / 1000);
+    m_scheduler->updateConfiguration(config);
+}
+
+void StreamingServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        if (m_sessions.size() >= kMaxSessions) {
+            socket->write("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            socket->disconnectFromHost();
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            continue;
+        }
+
+        Session *session = new Session;
+        session->id = m_nextSessionId++;
+        session->socket = socket;
+        m_sessions.insert(session->id, session);
+
+        const quint64 id = session->id;
+        connect(socket, &QTcpSocket::readyRead, this, [this, id]() {
+            if (Session *session = m_sessions.value(id)) {
+                readInput(session);
+            }
+        });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, id]() {
+            if (Session *session = m_sessions.value(id)) {
+                maybeClose(session);
+            }
+        });
+        // Queued: disconnectFromHost() can emit this while the session is in use
+        connect(socket, &QTcpSocket::disconnected, this, [this, id]() { removeSession(id); },
+                Qt::QueuedConnection);
+
+        // A client that never finishes its request (or never reads the reply to
+        // it) would hold one of the few session slots for good
+        QTimer::singleShot(kRequestTimeoutMs, this, [this, id]() {
+            Session *session = m_sessions.value(id);
+            if (session && session->protocol == Session::Request) {
+                qDebug() << "Streaming server: closing session" << id << "stuck in its request";
+                session->socket->abort();
+                removeSession(id);
+            }
+        });
+    }
+}
+
+void StreamingServer::readInput(Session *session)
+{
+    // A paused session leaves its data in the socket; with the read buffer
+    // capped, the kernel's receive window closes and the client blocks
+    if (session->paused || session->closing) {
+        return;
+    }
+    session->input += session->socket->readAll();
+
+    if (session->protocol == Session::Request && !parseRequest(session)) {
+        return;
+    }
+    if (session->protocol == Session::WebSocket) {
+        readWebSocket(session);
+    } else if (session->protocol == Session::HttpStream) {
+        readHttpBody(session);
+    }
+}
+
+bool StreamingServer::parseRequest(Session *session)
+{
+    const int headerEnd = session->input.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        if (session->input.size() > kMaxRequestHeader) {
+            sendHttpResponse(session, 431, "Request Header Fields Too Large", QByteArray());
+        }
+        return false;
+    }
+
+    const QList<QByteArray> lines = session->input.left(headerEnd).split('\n');
+    session->input.remove(0, headerEnd + 4);
+    const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+    const QByteArray method = requestLine.value(0);
+    const QByteArray path = requestLine.value(1).split('?').value(0);
+    const QByteArray query = requestLine.value(1).split('?').value(1);
+
+    QHash<QByteArray, QByteArray> headers;
+    for (int i = 1; i < lines.size(); ++i) {
+        const int colon = lines[i].indexOf(':');
+        if (colon > 0) {
+            headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+        }
+    }
+
+    if (method == "GET" && path == "/health") {
+        QJsonObject status;
+        status["status"] = "ok";
+        status["model"] = m_modelName;
+        status["sessions"] = m_sessions.size();
+        status["decoders"] = m_scheduler->workerCount();
+        status["realTimeFactor"] = m_scheduler->realTimeFactor();
+        status["load"] = m_scheduler->predictedLoad();
+        sendHttpResponse(session, 200, "OK", QJsonDocument(status).toJson(QJsonDocument::Compact));
+        return false;
+    }
+
+    // Live streams are decoded ahead of uploads unless the client says otherwise
+    DecodeScheduler::Priority priority = path == "/stream" ? DecodeScheduler::Live : DecodeScheduler::Batch;
+    if (query.contains("priority=live")) {
+        priority = DecodeScheduler::Live;
+    } else if (query.contains("priority=batch")) {
+        priority = DecodeScheduler::Batch;
+    }
+    if ((path == "/stream" || path == "/transcribe") && !m_scheduler->admit(priority)) {
+        qDebug() << "Streaming server at capacity; predicted load" << m_scheduler->predictedLoad();
+        sendHttpResponse(session, 503, "Service Unavailable", "{\"error\":\"Decoding capacity is full\"}");
+        return false;
+    }
+
+    if (method == "GET" && path == "/stream") {
+        const QByteArray key = headers.value("sec-websocket-key");
+        if (!headers.value("upgrade").toLower().contains("websocket") || key.isEmpty()) {
+            sendHttpResponse(session, 400, "Bad Request", "{\"error\":\"WebSocket upgrade required\"}");
+            return false;
+        }
+        const QByteArray accept = QCryptographicHash::hash(key + kWebSocketGuid, QCryptographicHash::Sha1).toBase64();
+        session->socket->write("HTTP/1.1 101 Switching Protocols\r\n"
+                               "Upgrade: websocket\r\n"
+                               "Connection: Upgrade\r\n"
+                               "Sec-WebSocket-Accept: " + accept + "\r\n\r\n");
+        session->protocol = Session::WebSocket;
+    } else if (method == "POST" && path == "/transcribe") {
+        session->chunkedBody = headers.value("transfer-encoding").toLower().contains("chunked");
+        session->bodyRemaining = session->chunkedBody ? -1 : headers.value("content-length", "0").toLongLong();
+        session->socket->write("HTTP/1.1 200 OK\r\n"
+                               "Content-Type: application/x-ndjson\r\n"
+                               "Transfer-Encoding: chunked\r\n"
+                               "Cache-Control: no-cache\r\n\r\n");
+        session->protocol = Session::HttpStream;
+    } else {
+        sendHttpResponse(session, 404, "Not Found", "{\"error\":\"Unknown endpoint\"}");
+        return false;
+    }
+
+    m_scheduler->openSession(session->id, priority);
+
+    QJsonObject ready;
+    ready["type"] = "ready";
+    ready["priority"] = priority == DecodeScheduler::Live ? "live" : "batch";
+    ready["sampleRate"] = kSampleRate;
+    ready["format"] = "s16le";
+    ready["model"] = m_modelName;
+    sendEvent(session, ready);
+    return true;
+}
+
+void StreamingServer::readWebSocket(Session *session)
+{
+    QByteArray &input = session->input;
+    while (!session->paused && !session->closing && input.size() >= 2) {
+        const quint8 b0 = static_cast<quint8>(input[0]);
+        const quint8 b1 = static_cast<quint8>(input[1]);
+        const bool fin = b0 & 0x80;
+        quint8 opcode = b0 & 0x0F;
+        qint64 length = b1 & 0x7F;
+        int offset = 2;
+        if (length == 126) {
+            if (input.size() < 4) {
+                return;
+            }
+            length = qFromBigEndian<quint16>(input.constData() + 2);
+            offset = 4;
+        } else if (length == 127) {
+            if (input.size() < 10) {
+                return;
+            }
+            length = static_cast<qint64>(qFromBigEndian<quint64>(input.constData() + 2));
+            offset = 10;
+        }
+
+        // Clients must mask their frames (RFC 6455 5.1)
+        if (!(b1 & 0x80) || length < 0 || length > kMaxFrameSize) {
+            QByteArray reason(2, 0);
+            qToBigEndian<quint16>(length > kMaxFrameSize ? 1009 : 1002, reason.data());
+            sendWebSocketFrame(session->socket, 0x8, reason);
+            session->closing = true;
+            session->socket->disconnectFromHost();
+            return;
+        }
+        if (input.size() < offset + 4 + length) {
+            return;
+        }
+
+        const QByteArray mask = input.mid(offset, 4);
+        QByteArray payload = input.mid(offset + 4, length);
+        input.remove(0, offset + 4 + length);
+        for (qsizetype i = 0; i < payload.size(); ++i) {
+            payload[i] = payload[i] ^ mask[i % 4];
+        }
+
+        if (opcode == 0x0) {
+            opcode = session->messageOpcode;
+        } else if (!fin) {
+            session->messageOpcode = opcode;
+        }
+
+        switch (opcode) {
+        case 0x1:
+            session->textMessage += payload;
+            if (fin) {
+                handleTextMessage(session, session->textMessage);
+                session->textMessage.clear();
+            }
+            break;
+        case 0x2:
+            handleAudio(session, payload);
+            break;
+        case 0x8:
+            sendWebSocketFrame(session->socket, 0x8, payload.left(2));
+            session->closing = true;
+            session->socket->disconnectFromHost();
+            return;
+        case 0x9:
+            sendWebSocketFrame(session->socket, 0xA, payload);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void StreamingServer::readHttpBody(Session *session)
+{
+    QByteArray &input = session->input;
+    while (!session->paused && !session->closing && !session->bodyDone) {
+        if (!session->chunkedBody) {
+            const qint64 take = std::min<qint64>(session->bodyRemaining, input.size());
+            handleAudio(session, input.left(take));
+            input.remove(0, take);
+            session->bodyRemaining -= take;
+            if (session->bodyRemaining > 0) {
+                return;
+            }
+            session->bodyDone = true;
+            break;
+        }
+
+        if (session->bodyRemaining <= 0) {
+            // Chunk header: hex size, optional extensions, CRLF (preceded by the
+            // CRLF that ends the previous chunk)
+            if (input.startsWith("\r\n")) {
+                input.remove(0, 2);
+            }
+            const int lineEnd = input.indexOf("\r\n");
+            if (lineEnd < 0) {
+                return;
+            }
+            bool ok = false;
+            const qint64 size = input.left(lineEnd).split(';').value(0).trimmed().toLongLong(&ok, 16);
+            input.remove(0, lineEnd + 2);
+            if (!ok) {
+                QJsonObject error;
+                error["type"] = "error";
+                error["message"] = "Malformed chunked body";
+                sendEvent(session, error);
+                session->bodyDone = true;
+                break;
+            }
+            if (size == 0) {
+                session->bodyDone = true;
+                break;
+            }
+            session->bodyRemaining = size;
+        }
+
+        const qint64 take = std::min<qint64>(session->bodyRemaining, input.size());
+        if (take == 0) {
+            return;
+        }
+        handleAudio(session, input.left(take));
+        input.remove(0, take);
+        session->bodyRemaining -= take;
+    }
+
+    if (session->bodyDone && !session->ending) {
+        finishStream(session);
+    }
+}
+
+void StreamingServer::handleAudio(Session *session, const QByteArray &pcm)
+{
+    QByteArray data = session->pcmRemainder + pcm;
+    session->pcmRemainder.clear();
+    if (data.size() % 2) {
+        session->pcmRemainder = data.right(1);
+        data.chop(1);
+    }
+
+    const qint16 *samples = reinterpret_cast<const qint16*>(data.constData());
+    const qsizetype count = data.size() / 2;
+    session->utterance.reserve(session->utterance.size() + count);
+    for (qsizetype i = 0; i < count; ++i) {
+        session->utterance.push_back(qFromLittleEndian(samples[i]) / 32768.0f);
+    }
+
+    // Energy VAD over whole frames: an utterance ends at a pause after speech,
+    // or at the length limit; before any speech only the pre-roll is kept
+    while (session->analyzed + kFrameSamples <= session->utterance.size()) {
+        float sum = 0.0f;
+        for (size_t i = session->analyzed; i < session->analyzed + kFrameSamples; ++i) {
+            sum += std::fabs(session->utterance[i]);
+        }
+        session->analyzed += kFrameSamples;
+
+        if (sum / kFrameSamples >= m_threshold) {
+            session->heardSpeech = true;
+            session->silentSamples = 0;
+        } else {
+            session->silentSamples += kFrameSamples;
+        }
+
+        if (!session->heardSpeech) {
+            if (session->analyzed > static_cast<size_t>(kPreRollSamples)) {
+                const size_t drop = session->analyzed - kPreRollSamples;
+                session->utterance.erase(session->utterance.begin(), session->utterance.begin() + drop);
+                session->analyzed -= drop;
+                session->utteranceStart += drop;
+            }
+        } else if (session->silentSamples >= kEndPauseSamples
+                   || session->analyzed >= static_cast<size_t>(m_maxUtteranceSamples)) {
+            finishUtterance(session);
+        }
+    }
+
+    requestInterim(session);
+}
+
+void StreamingServer::handleTextMessage(Session *session, const QByteArray &message)
+{
+    const QString type = QJsonDocument::fromJson(message).object().value("type").toString();
+    if (type == "flush") {
+        finishUtterance(session);
+    } else if (type == "end") {
+        finishStream(session);
+    }
+}
+
+void StreamingServer::finishUtterance(Session *session)
+{
+    // Cut at the analyzed position; the rest starts the next utterance
+    const size_t cut = session->analyzed;
+    if (session->heardSpeech && cut > 0) {
+        std::vector<float> samples(session->utterance.begin(), session->utterance.begin() + cut);
+        const qint64 audioStart = session->utteranceStart * 1000 / kSampleRate;
+        session->pending.push_back({true, session->utteranceId, static_cast<qint64>(cut)});
+        session->backlogSamples += cut;
+
+        const quint64 id = session->id;
+        m_scheduler->submit(id, std::move(samples), audioStart, true);
+
+        session->utteranceId++;
+        if (session->backlogSamples * 1000 / kSampleRate > kMaxBacklogMs) {
+            session->paused = true;
+            session->socket->setReadBufferSize(kReadBufferSize);
+        }
+    }
+
+    session->utterance.erase(session->utterance.begin(), session->utterance.begin() + cut);
+    session->utteranceStart += cut;
+    session->analyzed = 0;
+    session->silentSamples = 0;
+    session->heardSpeech = false;
+    session->lastInterimSize = 0;
+}
+
+void StreamingServer::requestInterim(Session *session)
+{
+    // One decode in flight per session; a client that outruns the decoder gets
+    // fewer interims rather than a growing queue
+    if (!session->heardSpeech || !session->pending.empty() || session->ending
+        || session->analyzed < session->lastInterimSize + kInterimStepSamples) {
+        return;
+    }
+    session->lastInterimSize = session->analyzed;
+    session->pending.push_back({false, session->utteranceId, 0});
+
+    std::vector<float> samples(session->utterance.begin(), session->utterance.begin() + session->analyzed);
+    const qint64 audioStart = session->utteranceStart * 1000 / kSampleRate;
+    const quint64 id = session->id;
+    m_scheduler->submit(id, std::move(samples), audioStart, false);
+}
+
+void StreamingServer::finishStream(Session *session)
+{
+    // The client is done; decode the rest of the utterance, partial frame included
+    session->analyzed = session->utterance.size();
+    finishUtterance(session);
+    session->ending = true;
+    maybeClose(session);
+}
+
+void StreamingServer::onDecoded(quint64 sessionId, bool final, const QList<TranscriptionSegment> &segments)
+{
+    Session *session = m_sessions.value(sessionId);
+    if (!session || session->pending.empty()) {
+        return;
+    }
+    const PendingDecode decode = session->pending.front();
+    session->pending.pop_front();
+
+    QJsonObject event;
+    event["type"] = final ? "final" : "interim";
+    event["utterance"] = static_cast<double>(decode.utteranceId);
+    event["text"] = joinedText(segments);
+    if (!segments.isEmpty()) {
+        event["start"] = static_cast<double>(segments.first().startTime);
+        event["end"] = static_cast<double>(segments.last().endTime);
+    }
+    if (final) {
+        QJsonArray list;
+        for (const TranscriptionSegment &segment : segments) {
+            QJsonObject entry;
+            entry["text"] = segment.text;
+            entry["start"] = static_cast<double>(segment.startTime);
+            entry["end"] = static_cast<double>(segment.endTime);
+            list.append(entry);
+        }
+        event["segments"] = list;
+        session->backlogSamples -= decode.samples;
+    }
+    // A final for an empty utterance still tells the client it is settled
+    if (final || !segments.isEmpty()) {
+        sendEvent(session, event, !final);
+    }
+
+    if (session->paused && session->backlogSamples * 1000 / kSampleRate <= kMaxBacklogMs / 2) {
+        session->paused = false;
+        session->socket->setReadBufferSize(0);
+        readInput(session);
+    }
+    if (m_sessions.contains(sessionId)) {
+        requestInterim(session);
+        maybeClose(session);
+    }
+}
+
+void StreamingServer::onDecodeFailed(quint64 sessionId, bool final, const QString &error)
+{
+    Session *session = m_sessions.value(sessionId);
+    if (!session || session->pending.empty()) {
+        return;
+    }
+    const PendingDecode decode = session->pending.front();
+    session->pending.pop_front();
+    if (final) {
+        session->backlogSamples -= decode.samples;
+        QJsonObject event;
+        event["type"] = "error";
+        event["utterance"] = static_cast<double>(decode.utteranceId);
+        event["message"] = error;
+        sendEvent(session, event);
+    }
+    if (session->paused && session->backlogSamples * 1000 / kSampleRate <= kMaxBacklogMs / 2) {
+        session->paused = false;
+        session->socket->setReadBufferSize(0);
+        readInput(session);
+    }
+    if (m_sessions.contains(sessionId)) {
+        maybeClose(session);
+    }
+}
+
+void StreamingServer::maybeClose(Session *session)
+{
+    // Close once everything is decoded and the last event has left
+    if (!session->ending || session->closing || !session->pending.empty()) {
+        return;
+    }
+
+    QJsonObject done;
+    done["type"] = "done";
+    sendEvent(session, done);
+    if (session->protocol == Session::WebSocket) {
+        QByteArray reason(2, 0);
+        qToBigEndian<quint16>(1000, reason.data());
+        sendWebSocketFrame(session->socket, 0x8, reason);
+    } else {
+        session->socket->write("0\r\n\r\n");
+    }
+    session->closing = true;
+    session->socket->disconnectFromHost();
+}
+
+void StreamingServer::sendEvent(Session *session, const QJsonObject &event, bool droppable)
+{
+    if (droppable && session->socket->bytesToWrite() > kMaxPendingOutput) {
+        return;
+    }
+
+    const QByteArray json = QJsonDocument(event).toJson(QJsonDocument::Compact);
+    if (session->protocol == Session::WebSocket) {
+        sendWebSocketFrame(session->socket, 0x1, json);
+    } else {
+        const QByteArray line = json + '\n';
+        session->socket->write(QByteArray::number(line.size(), 16) + "\r\n" + line + "\r\n");
+    }
+}
+
+void StreamingServer::sendHttpResponse(Session *session, int status, const QByteArray &reason,
+                                       const QByteArray &body, const QByteArray &contentType)
+{
+    session->socket->write("HTTP/1.1 " + QByteArray::number(status) + ' ' + reason + "\r\n"
+                           "Content-Type: " + contentType + "\r\n"
+                           "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body);
+    session->closing = true;
+    session->socket->disconnectFromHost();
+}
+
+void StreamingServer::sendWebSocketFrame(QTcpSocket *socket, quint8 opcode, const QByteArray &payload)
+{
+    // Server frames are never masked
+    QByteArray header;
+    header.append(static_cast<char>(0x80 | opcode));
+    if (payload.size() < 126) {
+        header.append(static_cast<char>(payload.size()));
+    } else if (payload.size() <= 0xFFFF) {
+        header.append(static_cast<char>(126));
+        QByteArray length(2, 0);
+        qToBigEndian<quint16>(static_cast<quint16>(payload.size()), length.data());
+        header += length;
+    } else {
+        header.append(static_cast<char>(127));
+        QByteArray length(8, 0);
+        qToBigEndian<quint64>(static_cast<quint64>(payload.size()), length.data());
+        header += length;
+    }
+    socket->write(header + payload);
+}
+
+void StreamingServer::removeSession(quint64 sessionId)
+{
+    Session *session = m_sessions.take(sessionId);
+    if (!session) {
+        return;
+    }
+    session->socket->deleteLater();
+    delete session;
+    m_scheduler->closeSession(sessionId);
+}
@@ -0,0 +1,137 @@
+#ifndef STREAMINGSERVER_H
+#define STREAMINGSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "../whisper/transcriptionsegment.h"
+
+class QTcpServer;
+class QTcpSocket;
+class QJsonObject;
+class DecodeScheduler;
+struct AudioConfiguration;
+
+// Lets other local programs transcribe through the resident model. Clients
+// stream 16 kHz mono signed 16-bit little-endian PCM and get JSON events back:
+//
+//   WebSocket   GET /stream        binary frames carry audio; text frames carry
+//                                  {"type":"flush"} or {"type":"end"}
+//   HTTP        POST /transcribe   chunked (or sized) request body of audio; the
+//                                  response streams one event per line
+//   HTTP        GET /health        server and model status
+//
+// Sessions are scheduled as live (WebSocket) or batch (POST) work; the query
+// parameter ?priority=live|batch overrides that. A session that would overload
+// the decoders is refused with 503.
+//
+// Events: ready, interim (the utterance so far, re-decoded about once a second),
+// final (an utterance that ended in a pause), error, done. Times are ms from the
+// start of the connection's audio. Only listens on the loopback interface.
+//
+// Backpressure: while a client's finished utterances wait for more than
+// kMaxBacklogMs of decoding, its socket isn't read, so TCP pushes back on the
+// sender; interim events are dropped while the client isn't reading its replies.
+class StreamingServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr quint16 DefaultPort = 8765;
+
+    explicit StreamingServer(QObject *parent = nullptr);
+    ~StreamingServer();
+
+    bool listen(quint16 port = DefaultPort);
+    quint16 port() const;
+
+    // Cancel decoding and drop every client
+    void shutdown();
+
+    DecodeScheduler *scheduler() const { return m_scheduler; }
+
+public slots:
+    void updateConfiguration(const AudioConfiguration &config);
+
+signals:
+    void statusChanged(const QString &status);
+
+private slots:
+    void onNewConnection();
+    void onDecoded(quint64 sessionId, bool final, const QList<TranscriptionSegment> &segments);
+    void onDecodeFailed(quint64 sessionId, bool final, const QString &error);
+
+private:
+    struct PendingDecode {
+        bool final;
+        quint64 utteranceId;
+        qint64 samples;
+    };
+
+    struct Session {
+        enum Protocol { Request, WebSocket, HttpStream };
+
+        quint64 id = 0;
+        QTcpSocket *socket = nullptr;
+        Protocol protocol = Request;
+        QByteArray input;              // Received bytes not parsed yet
+        bool closing = false;
+
+        // WebSocket message assembly
+        quint8 messageOpcode = 0;
+        QByteArray textMessage;
+
+        // HTTP request body
+        bool chunkedBody = false;
+        qint64 bodyRemaining = -1;     // Bytes left in the current chunk / sized body
+        bool bodyDone = false;
+
+        // Audio
+        QByteArray pcmRemainder;       // Odd trailing byte of the last frame
+        std::vector<float> utterance;
+        qint64 utteranceStart = 0;     // Stream position (samples) of utterance[0]
+        size_t analyzed = 0;           // Samples of utterance already run through the VAD
+        int silentSamples = 0;
+        bool heardSpeech = false;
+        size_t lastInterimSize = 0;
+        quint64 utteranceId = 1;
+
+        // Decodes in flight, oldest first; results come back in this order
+        std::deque<PendingDecode> pending;
+        qint64 backlogSamples = 0;     // Audio of the finals in pending
+        bool paused = false;           // Not reading the socket (backpressure)
+        bool ending = false;           // Client sent everything; close once decoded
+    };
+
+    void readInput(Session *session);
+    bool parseRequest(Session *session);
+    void readWebSocket(Session *session);
+    void readHttpBody(Session *session);
+    void handleAudio(Session *session, const QByteArray &pcm);
+    void handleTextMessage(Session *session, const QByteArray &message);
+    void finishUtterance(Session *session);
+    void requestInterim(Session *session);
+    void finishStream(Session *session);
+    void maybeClose(Session *session);
+    void sendEvent(Session *session, const QJsonObject &event, bool droppable = false);
+    void sendHttpResponse(Session *session, int status, const QByteArray &reason,
+                          const QByteArray &body, const QByteArray &contentType = "application/json");
+    static void sendWebSocketFrame(QTcpSocket *socket, quint8 opcode, const QByteArray &payload);
+    void removeSession(quint64 sessionId);
+
+    QTcpServer *m_server;
+    DecodeScheduler *m_scheduler;
+    QHash<quint64, Session*> m_sessions;
+    quint64 m_nextSessionId;
+
+    QString m_modelName;
+    float m_threshold;              // VAD amplitude threshold, as in WhisperProcessor
+    int m_maxUtteranceSamples;
+};
+
+#endif // STREAMINGSERVER_H
@@ -2,6 +2,7 @@
 #include "../audio/audiocapture.h"
 #include "../whisper/devicemanager.h"
 #include "../whisper/whispermodels.h"
+#include "../whisper/decodingprofile.h"
 #include "../config/configmanager.h"
 #include "../output/windowtyper.h"
 #include <QComboBox>
@@ -12,6 +13,7 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QSlider>
+#include <QLineEdit>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGridLayout>
@@ -20,28 +22,16 @@
 #include <QAudioDevice>
 #include <QMediaDevices>
 #include <QMessageBox>
+#include <QJsonArray>
+
+extern "C" {
+#include "include/whisper.h"
+}
 
 ConfigWidget::ConfigWidget(QWidget *parent)
     : QWidget(parent)
 {
-    // Set default configuration
-    m_config.model = "base";
-    m_config.audioSource = "microphone";
-    m_config.pickupThreshold = 120;
-    m_config.minSpeechDuration = 0.0;
-    m_config.maxSpeechDuration = 10.0;
-    m_config.useBandpass = true;
-    m_config.lowCutFreq = 80.0;
-    m_config.highCutFreq = 6000.0;
-    m_config.includeTimestamps = false;
-    m_config.computeDeviceType = 0;  // Default to CPU
-    m_config.computeDeviceId = -1;
-    m_config.gainBoostDb = 0.0;      // Default: no gain boost
-    m_config.autoGainEnabled = false; // Default: manual gain control
-    m_config.autoGainTarget = 0.1;   // Default: 10% target level
-    m_config.outputToWindow = true;
-    m_config.outputToFile = false;
-    m_config.outputToClipboard = false;
+    m_config = AudioConfiguration::defaults();
     
     setupUi();
     connectSignals();
@@ -69,6 +59,20 @@ void ConfigWidget::setupUi()
     m_modelDescLabel->setWordWrap(true);
     m_modelDescLabel->setStyleSheet("QLabel { color: gray; }");
     
+    QLabel *refineLabel = new QLabel(tr("Refine With:"), this);
+    m_refineModelCombo = new QComboBox(this);
+    m_refineModelCombo->setToolTip(tr("Re-transcribe finished phrases in the background with a larger model "
+                                      "and replace the live text when it is done"));
+    
+    QLabel *refineThresholdLabel = new QLabel(tr("Refine Below:"), this);
+    m_refineThresholdSpin = new QDoubleSpinBox(this);
+    m_refineThresholdSpin->setRange(-3.0, 0.0);
+    m_refineThresholdSpin->setSingleStep(0.1);
+    m_refineThresholdSpin->setDecimals(2);
+    m_refineThresholdSpin->setValue(-0.5);
+    m_refineThresholdSpin->setToolTip(tr("Only phrases whose average token log-probability falls below this "
+                                         "(or that may not be speech at all) are re-transcribed; 0 refines every phrase"));
+    
     QLabel *computeLabel = new QLabel(tr("Compute:"), this);
     m_computeDeviceCombo = new QComboBox(this);
     m_computeDeviceLabel = new QLabel(tr("Select compute device"), this);
@@ -78,9 +82,13 @@ void ConfigWidget::setupUi()
     modelLayout->addWidget(modelLabel, 0, 0);
     modelLayout->addWidget(m_modelCombo, 0, 1);
     modelLayout->addWidget(m_modelDescLabel, 1, 0, 1, 2);
-    modelLayout->addWidget(computeLabel, 2, 0);
-    modelLayout->addWidget(m_computeDeviceCombo, 2, 1);
-    modelLayout->addWidget(m_computeDeviceLabel, 3, 0, 1, 2);
+    modelLayout->addWidget(refineLabel, 2, 0);
+    modelLayout->addWidget(m_refineModelCombo, 2, 1);
+    modelLayout->addWidget(refineThresholdLabel, 3, 0);
+    modelLayout->addWidget(m_refineThresholdSpin, 3, 1);
+    modelLayout->addWidget(computeLabel, 4, 0);
+    modelLayout->addWidget(m_computeDeviceCombo, 4, 1);
+    modelLayout->addWidget(m_computeDeviceLabel, 5, 0, 1, 2);
     
     // Audio Input Group
     m_audioGroup = new QGroupBox(tr("Audio Input"), this);
@@ -124,6 +132,43 @@ void ConfigWidget::setupUi()
     m_maxSpeechSpin->setSingleStep(1.0);
     m_maxSpeechSpin->setValue(10.0);
     
+    QLabel *compactLabel = new QLabel(tr("Shorten Pauses (sec):"), this);
+    m_compactSilenceSpin = new QDoubleSpinBox(this);
+    m_compactSilenceSpin->setRange(0.0, 10.0);
+    m_compactSilenceSpin->setSingleStep(0.5);
+    m_compactSilenceSpin->setValue(1.0);
+    m_compactSilenceSpin->setSpecialValueText(tr("Off"));
+    m_compactSilenceSpin->setToolTip(tr("Pauses inside an utterance longer than this are cut short before "
+                                        "transcription; timestamps still refer to the recording"));
+    
+    m_pushToTalkCheck = new QCheckBox(tr("Push-to-Talk (F8)"), this);
+    m_pushToTalkCheck->setChecked(false);
+    m_pushToTalkCheck->setToolTip(tr("Transcribe exactly what is said while F8 is held down "
+                                     "(or between \"qwhisper --ptt press\" and \"release\" bound to a desktop "
+                                     "hotkey) instead of detecting speech. The microphone stays open while "
+                                     "this is on"));
+    
+    QLabel *preRollLabel = new QLabel(tr("Pre-roll (sec):"), this);
+    m_preRollSpin = new QDoubleSpinBox(this);
+    m_preRollSpin->setRange(0.0, 2.0);
+    m_preRollSpin->setSingleStep(0.1);
+    m_preRollSpin->setValue(0.5);
+    m_preRollSpin->setToolTip(tr("Audio from just before the key press that is included, so the first "
+                                 "word isn't clipped"));
+    
+    m_wakeWordCheck = new QCheckBox(tr("Wake Word:"), this);
+    m_wakeWordCheck->setChecked(false);
+    m_wakeWordCheck->setToolTip(tr("Stay idle until the phrase is heard (spotted with the tiny model), "
+                                   "then transcribe until the speaker goes quiet"));
+    m_wakePhraseEdit = new QLineEdit(tr("hey computer"), this);
+    
+    QLabel *wakeWindowLabel = new QLabel(tr("Listen For (sec):"), this);
+    m_wakeWindowSpin = new QDoubleSpinBox(this);
+    m_wakeWindowSpin->setRange(2.0, 120.0);
+    m_wakeWindowSpin->setSingleStep(5.0);
+    m_wakeWindowSpin->setValue(10.0);
+    m_wakeWindowSpin->setToolTip(tr("How long transcription continues after the wake word or the last speech"));
+    
     vadLayout->addWidget(pickupLabel, 0, 0);
     vadLayout->addWidget(m_pickupSlider, 0, 1);
     vadLayout->addWidget(m_pickupLabel, 0, 2);
@@ -131,6 +176,113 @@ void ConfigWidget::setupUi()
     vadLayout->addWidget(m_minSpeechSpin, 1, 1, 1, 2);
     vadLayout->addWidget(maxSpeechLabel, 2, 0);
     vadLayout->addWidget(m_maxSpeechSpin, 2, 1, 1, 2);
+    vadLayout->addWidget(compactLabel, 3, 0);
+    vadLayout->addWidget(m_compactSilenceSpin, 3, 1, 1, 2);
+    vadLayout->addWidget(m_pushToTalkCheck, 4, 0, 1, 3);
+    vadLayout->addWidget(preRollLabel, 5, 0);
+    vadLayout->addWidget(m_preRollSpin, 5, 1, 1, 2);
+    vadLayout->addWidget(m_wakeWordCheck, 6, 0);
+    vadLayout->addWidget(m_wakePhraseEdit, 6, 1, 1, 2);
+    vadLayout->addWidget(wakeWindowLabel, 7, 0);
+    vadLayout->addWidget(m_wakeWindowSpin, 7, 1, 1, 2);
+    
+    // Decoding Group
+    m_decodingGroup = new QGroupBox(tr("Decoding"), this);
+    QGridLayout *decodingLayout = new QGridLayout(m_decodingGroup);
+    
+    QLabel *profileLabel = new QLabel(tr("Profile:"), this);
+    m_decodingProfileCombo = new QComboBox(this);
+    m_decodingProfileCombo->addItem(tr("Fastest"), "fastest");
+    m_decodingProfileCombo->addItem(tr("Balanced"), "balanced");
+    m_decodingProfileCombo->addItem(tr("Accurate"), "accurate");
+    m_decodingProfileCombo->setCurrentIndex(1);
+    m_decodingProfileCombo->setToolTip(tr("Fastest: single greedy pass, no retries\n"
+                                          "Balanced: greedy with temperature fallback\n"
+                                          "Accurate: beam search with temperature fallback"));
+    
+    QLabel *languageLabel = new QLabel(tr("Language:"), this);
+    m_languageCombo = new QComboBox(this);
+    m_languageCombo->addItem(tr("Auto-detect"), "auto");
+    for (int id = 0; id <= whisper_lang_max_id(); ++id) {
+        QString name = QString::fromLatin1(whisper_lang_str_full(id));
+        if (!name.isEmpty()) {
+            name[0] = name[0].toUpper();
+        }
+        m_languageCombo->addItem(name, QString::fromLatin1(whisper_lang_str(id)));
+    }
+    m_languageCombo->setCurrentIndex(m_languageCombo->findData("en"));
+    m_languageCombo->setToolTip(tr("Auto-detect runs language identification until it is confident, "
+                                   "then reuses the result for the session (multilingual models only)"));
+    
+    QLabel *maxLagLabel = new QLabel(tr("Max Lag (sec):"), this);
+    m_maxDecodeLagSpin = new QDoubleSpinBox(this);
+    m_maxDecodeLagSpin->setRange(0.0, 120.0);
+    m_maxDecodeLagSpin->setSingleStep(1.0);
+    m_maxDecodeLagSpin->setValue(0.0);
+    m_maxDecodeLagSpin->setSpecialValueText(tr("Off"));
+    m_maxDecodeLagSpin->setToolTip(tr("Drop a segment instead of transcribing it once it falls this far behind real time"));
+    
+    m_runawayGuardCheck = new QCheckBox(tr("Stop Repetition Loops"), this);
+    m_runawayGuardCheck->setChecked(true);
+    m_runawayGuardCheck->setToolTip(tr("Abort and retry decodes that repeat a phrase or produce far more text than the audio contains"));
+    
+    m_wordTimestampsCheck = new QCheckBox(tr("Word Timestamps"), this);
+    m_wordTimestampsCheck->setChecked(false);
+    m_wordTimestampsCheck->setToolTip(tr("Record start/end time and confidence of every word "
+                                         "(written next to the output file as .words.tsv)"));
+    
+    m_translateCheck = new QCheckBox(tr("Also Translate to English"), this);
+    m_translateCheck->setChecked(false);
+    m_translateCheck->setToolTip(tr("Show an English translation under non-English speech. Both are decoded "
+                                    "from one encoder pass using greedy search (multilingual models only)"));
+    
+    m_adaptiveQualityCheck = new QCheckBox(tr("Adapt Quality to System Load"), this);
+    m_adaptiveQualityCheck->setChecked(false);
+    m_adaptiveQualityCheck->setToolTip(tr("Switch to a cheaper profile or model when transcription falls behind "
+                                          "or the CPU is busy, and back when it is idle (tiers: qualityTiers "
+                                          "in the config file)"));
+    
+    m_reduceAudioContextCheck = new QCheckBox(tr("Shrink Encoder Window"), this);
+    m_reduceAudioContextCheck->setChecked(false);
+    m_reduceAudioContextCheck->setToolTip(tr("Encode only as much audio as each chunk holds instead of a full "
+                                             "30 s window. Much faster for short chunks, slightly less accurate"));
+    
+    m_commandModeCheck = new QCheckBox(tr("Command Mode"), this);
+    m_commandModeCheck->setChecked(false);
+    m_commandModeCheck->setToolTip(tr("Recognize only the phrases in commands.txt (next to the config file) "
+                                      "and send their key presses or snippets to the active window"));
+    
+    QLabel *promptTokensLabel = new QLabel(tr("Context Tokens:"), this);
+    m_promptTokensSpin = new QSpinBox(this);
+    m_promptTokensSpin->setRange(0, 224);
+    m_promptTokensSpin->setSingleStep(16);
+    m_promptTokensSpin->setValue(64);
+    m_promptTokensSpin->setSpecialValueText(tr("Off"));
+    m_promptTokensSpin->setToolTip(tr("Number of previously transcribed tokens passed to the next segment as context"));
+    
+    QLabel *promptResetLabel = new QLabel(tr("Context Reset (sec):"), this);
+    m_promptResetSpin = new QDoubleSpinBox(this);
+    m_promptResetSpin->setRange(1.0, 300.0);
+    m_promptResetSpin->setSingleStep(5.0);
+    m_promptResetSpin->setValue(10.0);
+    m_promptResetSpin->setToolTip(tr("Forget the carried-over context and detected language after this much silence"));
+    
+    decodingLayout->addWidget(profileLabel, 0, 0);
+    decodingLayout->addWidget(m_decodingProfileCombo, 0, 1);
+    decodingLayout->addWidget(languageLabel, 1, 0);
+    decodingLayout->addWidget(m_languageCombo, 1, 1);
+    decodingLayout->addWidget(maxLagLabel, 2, 0);
+    decodingLayout->addWidget(m_maxDecodeLagSpin, 2, 1);
+    decodingLayout->addWidget(promptTokensLabel, 3, 0);
+    decodingLayout->addWidget(m_promptTokensSpin, 3, 1);
+    decodingLayout->addWidget(promptResetLabel, 4, 0);
+    decodingLayout->addWidget(m_promptResetSpin, 4, 1);
+    decodingLayout->addWidget(m_runawayGuardCheck, 5, 0, 1, 2);
+    decodingLayout->addWidget(m_wordTimestampsCheck, 6, 0, 1, 2);
+    decodingLayout->addWidget(m_translateCheck, 7, 0, 1, 2);
+    decodingLayout->addWidget(m_adaptiveQualityCheck, 8, 0, 1, 2);
+    decodingLayout->addWidget(m_reduceAudioContextCheck, 9, 0, 1, 2);
+    decodingLayout->addWidget(m_commandModeCheck, 10, 0, 1, 2);
     
     // Audio Filtering Group
     m_filterGroup = new QGroupBox(tr("Audio Filtering"), this);
@@ -239,13 +391,27 @@ void ConfigWidget::setupUi()
     outputLayout->addWidget(m_outputTypeToWindowCheck);
     outputLayout->addWidget(m_outputFileCheck);
     outputLayout->addLayout(fileLayout);
+    QHBoxLayout *watchLayout = new QHBoxLayout();
+    m_watchFolderLabel = new QLabel(tr("No watch folder"), this);
+    m_watchFolderLabel->setStyleSheet("QLabel { color: gray; }");
+    m_watchFolderLabel->setToolTip(tr("Recordings copied into this folder are transcribed in the background; "
+                                      "the transcript is written next to each one as a .txt file"));
+    m_browseWatchFolderButton = new QPushButton(tr("Watch Folder..."), this);
+    m_clearWatchFolderButton = new QPushButton(tr("Clear"), this);
+    m_clearWatchFolderButton->setEnabled(false);
+    watchLayout->addWidget(m_watchFolderLabel);
+    watchLayout->addWidget(m_browseWatchFolderButton);
+    watchLayout->addWidget(m_clearWatchFolderButton);
+    
     outputLayout->addWidget(m_outputClipboardCheck);
     outputLayout->addWidget(m_timestampsCheck);
+    outputLayout->addLayout(watchLayout);
     
     // Add all groups to main layout
     mainLayout->addWidget(m_modelGroup);
     mainLayout->addWidget(m_audioGroup);
     mainLayout->addWidget(m_vadGroup);
+    mainLayout->addWidget(m_decodingGroup);
     mainLayout->addWidget(m_filterGroup);
     mainLayout->addWidget(m_gainGroup);
     mainLayout->addWidget(m_outputGroup);
@@ -256,6 +422,10 @@ void ConfigWidget::connectSignals()
 {
     connect(m_modelCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &ConfigWidget::onModelChanged);
+    connect(m_refineModelCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &ConfigWidget::onRefineModelChanged);
+    connect(m_refineThresholdSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &ConfigWidget::onRefineThresholdChanged);
     connect(m_computeDeviceCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &ConfigWidget::onComputeDeviceChanged);
     connect(m_deviceCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
@@ -268,6 +438,40 @@ void ConfigWidget::connectSignals()
             this, &ConfigWidget::onMinSpeechDurationChanged);
     connect(m_maxSpeechSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
             this, &ConfigWidget::onMaxSpeechDurationChanged);
+    connect(m_compactSilenceSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &ConfigWidget::onCompactSilenceChanged);
+    connect(m_pushToTalkCheck, &QCheckBox::toggled,
+            this, &ConfigWidget::onPushToTalkToggled);
+    connect(m_preRollSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &ConfigWidget::onPushToTalkPreRollChanged);
+    connect(m_wakeWordCheck, &QCheckBox::toggled,
+            this, &ConfigWidget::onWakeWordToggled);
+    connect(m_wakePhraseEdit, &QLineEdit::editingFinished,
+            this, &ConfigWidget::onWakePhraseChanged);
+    connect(m_wakeWindowSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &ConfigWidget::onWakeWindowChanged);
+    connect(m_decodingProfileCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &ConfigWidget::onDecodingProfileChanged);
+    connect(m_languageCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &ConfigWidget::onLanguageChanged);
+    connect(m_maxDecodeLagSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &ConfigWidget::onMaxDecodeLagChanged);
+    connect(m_runawayGuardCheck, &QCheckBox::toggled,
+            this, &ConfigWidget::onRunawayGuardToggled);
+    connect(m_wordTimestampsCheck, &QCheckBox::toggled,
+            this, &ConfigWidget::onWordTimestampsToggled);
+    connect(m_translateCheck, &QCheckBox::toggled,
+            this, &ConfigWidget::onTranslateToggled);
+    connect(m_adaptiveQualityCheck, &QCheckBox::toggled,
+            this, &ConfigWidget::onAdaptiveQualityToggled);
+    connect(m_reduceAudioContextCheck, &QCheckBox::toggled,
+            this, &ConfigWidget::onReduceAudioContextToggled);
+    connect(m_commandModeCheck, &QCheckBox::toggled,
+            this, &ConfigWidget::onCommandModeToggled);
+    connect(m_promptTokensSpin, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &ConfigWidget::onPromptTokensChanged);
+    connect(m_promptResetSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+            this, &ConfigWidget::onPromptResetSilenceChanged);
     connect(m_bandpassCheck, &QCheckBox::toggled,
             this, &ConfigWidget::onBandpassToggled);
     connect(m_lowCutSpin, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
@@ -286,6 +490,10 @@ void ConfigWidget::connectSignals()
             this, &ConfigWidget::onOutputOptionsChanged);
     connect(m_browseFileButton, &QPushButton::clicked,
             this, &ConfigWidget::onBrowseOutputFile);
+    connect(m_browseWatchFolderButton, &QPushButton::clicked,
+            this, &ConfigWidget::onBrowseWatchFolder);
+    connect(m_clearWatchFolderButton, &QPushButton::clicked,
+            this, &ConfigWidget::onClearWatchFolder);
     connect(m_refreshDevicesButton, &QPushButton::clicked,
             this, &ConfigWidget::refreshAudioDevices);
     
@@ -318,14 +526,18 @@ void ConfigWidget::connectSignals()
 void ConfigWidget::populateModels()
 {
     m_modelCombo->clear();
-    m_modelCombo->addItems({
-        "tiny.en", "tiny",
-        "base.en", "base",
-        "small.en", "small",
-        "medium.en", "medium",
-        "large-v1", "large-v2", "large-v3",
-        "turbo"
-    });
+    m_refineModelCombo->clear();
+    m_refineModelCombo->addItem(tr("Off"), QString());
+    
+    for (const ModelInfo &info : WhisperModels::catalog()) {
+        m_modelCombo->addItem(info.name);
+        m_modelCombo->setItemData(m_modelCombo->count() - 1, info.description, Qt::ToolTipRole);
+        
+        // Refinement only pays off with the larger models
+        if (info.speed == "medium" || info.speed == "slow") {
+            m_refineModelCombo->addItem(info.name, info.name);
+        }
+    }
     
     // Set default to base
     m_modelCombo->setCurrentText("base");
@@ -387,10 +599,38 @@ void ConfigWidget::setConfiguration(const AudioConfiguration &config)
     
     // Update UI elements
     m_modelCombo->setCurrentText(config.model);
+    int refineIndex = m_refineModelCombo->findData(config.refineModel);
+    m_refineModelCombo->setCurrentIndex(refineIndex >= 0 ? refineIndex : 0);
+    m_refineThresholdSpin->setValue(config.refineLogprobThreshold);
     m_audioSourceCombo->setCurrentText(config.audioSource);
     m_pickupSlider->setValue(config.pickupThreshold);
     m_minSpeechSpin->setValue(config.minSpeechDuration);
     m_maxSpeechSpin->setValue(config.maxSpeechDuration);
+    m_compactSilenceSpin->setValue(config.compactSilence);
+    m_pushToTalkCheck->setChecked(config.pushToTalk);
+    m_preRollSpin->setValue(config.pushToTalkPreRoll);
+    m_wakeWordCheck->setChecked(config.wakeWordEnabled);
+    m_wakePhraseEdit->setText(config.wakePhrase);
+    m_wakeWindowSpin->setValue(config.wakeWindow);
+    m_maxDecodeLagSpin->setValue(config.maxDecodeLag);
+    int languageIndex = m_languageCombo->findData(config.language);
+    m_languageCombo->setCurrentIndex(languageIndex >= 0 ? languageIndex : 0);
+    
+    // A hand-edited profile shows up as "Custom" so selecting it doesn't reset the values
+    int profileIndex = m_decodingProfileCombo->findData(config.decodingProfile);
+    if (profileIndex < 0) {
+        m_decodingProfileCombo->addItem(tr("Custom"), config.decodingProfile);
+        profileIndex = m_decodingProfileCombo->count() - 1;
+    }
+    m_decodingProfileCombo->setCurrentIndex(profileIndex);
+    m_runawayGuardCheck->setChecked(config.runawayGuardEnabled);
+    m_wordTimestampsCheck->setChecked(config.wordTimestamps);
+    m_translateCheck->setChecked(config.translateAlongside);
+    m_adaptiveQualityCheck->setChecked(config.adaptiveQuality);
+    m_reduceAudioContextCheck->setChecked(config.reduceAudioContext);
+    m_commandModeCheck->setChecked(config.commandMode);
+    m_promptTokensSpin->setValue(config.promptTokens);
+    m_promptResetSpin->setValue(config.promptResetSilence);
     m_bandpassCheck->setChecked(config.useBandpass);
     m_lowCutSpin->setValue(config.lowCutFreq);
     m_highCutSpin->setValue(config.highCutFreq);
@@ -408,33 +648,13 @@ void ConfigWidget::setConfiguration(const AudioConfiguration &config)
     if (!config.outputFilePath.isEmpty()) {
         m_outputFileLabel->setText(config.outputFilePath);
     }
+    m_watchFolderLabel->setText(config.batchWatchFolder.isEmpty() ? tr("No watch folder") : config.batchWatchFolder);
+    m_clearWatchFolderButton->setEnabled(!config.batchWatchFolder.isEmpty());
 }
 
 void ConfigWidget::saveSettings()
 {
-    // Save configuration to ConfigManager
-    QJsonObject audioConfig;
-    audioConfig["model"] = m_config.model;
-    audioConfig["audioSource"] = m_config.audioSource;
-    audioConfig["device"] = m_config.device;
-    audioConfig["computeDeviceType"] = m_config.computeDeviceType;
-    audioConfig["computeDeviceId"] = m_config.computeDeviceId;
-    audioConfig["pickupThreshold"] = m_config.pickupThreshold;
-    audioConfig["minSpeechDuration"] = m_config.minSpeechDuration;
-    audioConfig["maxSpeechDuration"] = m_config.maxSpeechDuration;
-    audioConfig["useBandpass"] = m_config.useBandpass;
-    audioConfig["lowCutFreq"] = m_config.lowCutFreq;
-    audioConfig["highCutFreq"] = m_config.highCutFreq;
-    audioConfig["gainBoostDb"] = m_config.gainBoostDb;
-    audioConfig["autoGainEnabled"] = m_config.autoGainEnabled;
-    audioConfig["autoGainTarget"] = m_config.autoGainTarget;
-    audioConfig["includeTimestamps"] = m_config.includeTimestamps;
-    audioConfig["outputToWindow"] = m_config.outputToWindow;
-    audioConfig["outputToFile"] = m_config.outputToFile;
-    audioConfig["outputToClipboard"] = m_config.outputToClipboard;
-    audioConfig["outputFilePath"] = m_config.outputFilePath;
-    
-    ConfigManager::instance().saveAudioConfiguration(audioConfig);
+    ConfigManager::instance().saveAudioConfiguration(m_config.toJson());
 }
 
 void ConfigWidget::loadSettings()
@@ -443,59 +663,32 @@ void ConfigWidget::loadSettings()
     QJsonObject audioConfig = ConfigManager::instance().loadAudioConfiguration();
     
     if (!audioConfig.isEmpty()) {
-        m_config.model = audioConfig.value("model").toString("base");
-        m_config.audioSource = audioConfig.value("audioSource").toString("microphone");
-        m_config.device = audioConfig.value("device").toString("");
-        m_config.computeDeviceType = audioConfig.value("computeDeviceType").toInt(0);
-        m_config.computeDeviceId = audioConfig.value("computeDeviceId").toInt(-1);
-        m_config.pickupThreshold = audioConfig.value("pickupThreshold").toInt(120);
-        m_config.minSpeechDuration = audioConfig.value("minSpeechDuration").toDouble(0.0);
-        m_config.maxSpeechDuration = audioConfig.value("maxSpeechDuration").toDouble(10.0);
-        m_config.useBandpass = audioConfig.value("useBandpass").toBool(true);
-        m_config.lowCutFreq = audioConfig.value("lowCutFreq").toDouble(80.0);
-        m_config.highCutFreq = audioConfig.value("highCutFreq").toDouble(6000.0);
-        m_config.gainBoostDb = audioConfig.value("gainBoostDb").toDouble(0.0);
-        m_config.autoGainEnabled = audioConfig.value("autoGainEnabled").toBool(false);
-        m_config.autoGainTarget = audioConfig.value("autoGainTarget").toDouble(0.1);
-        // Handle legacy settings
-        if (audioConfig.contains("useTimestamps")) {
-            m_config.includeTimestamps = audioConfig.value("useTimestamps").toBool(false);
-        } else if (audioConfig.contains("showTimestampsInUI") || audioConfig.contains("includeTimestampsInOutput")) {
-            // If either of the old split settings exist, use them
-            bool showInUI = audioConfig.value("showTimestampsInUI").toBool(false);
-            bool includeInOutput = audioConfig.value("includeTimestampsInOutput").toBool(false);
-            m_config.includeTimestamps = showInUI || includeInOutput;  // Enable if either was enabled
-        } else {
-            m_config.includeTimestamps = audioConfig.value("includeTimestamps").toBool(false);
-        }
-        m_config.outputToWindow = audioConfig.value("outputToWindow").toBool(true);
-        m_config.outputToFile = audioConfig.value("outputToFile").toBool(false);
-        m_config.outputToClipboard = audioConfig.value("outputToClipboard").toBool(false);
-        m_config.outputFilePath = audioConfig.value("outputFilePath").toString("");
+        m_config = AudioConfiguration::fromJson(audioConfig);
     }
     
     setConfiguration(m_config);
 }
 
+void ConfigWidget::onRefineModelChanged(int index)
+{
+    if (index >= 0) {
+        m_config.refineModel = m_refineModelCombo->itemData(index).toString();
+        emitConfigurationChanged();
+    }
+}
+
+void ConfigWidget::onRefineThresholdChanged(double value)
+{
+    m_config.refineLogprobThreshold = value;
+    emitConfigurationChanged();
+}
+
 void ConfigWidget::onModelChanged(int index)
 {
     m_config.model = m_modelCombo->currentText();
     
-    // Update description based on model
-    QString desc;
-    if (m_config.model.contains("tiny")) {
-        desc = tr("Tiny: Fastest, least accurate (~39 MB)");
-    } else if (m_config.model.contains("base")) {
-        desc = tr("Base: Fast, good accuracy (~74 MB)");
-    } else if (m_config.model.contains("small")) {
-        desc = tr("Small: Balanced speed/accuracy (~244 MB)");
-    } else if (m_config.model.contains("medium")) {
-        desc = tr("Medium: Slower, better accuracy (~769 MB)");
-    } else if (m_config.model.contains("large")) {
-        desc = tr("Large: Slowest, best accuracy (~1550 MB)");
-    } else if (m_config.model.contains("turbo")) {
-        desc = tr("Turbo: Fast, high quality (~809 MB)");
-    }
+    // Update description from the model manifest
+    QString desc = WhisperModels::modelDescription(m_config.model);
     
     m_modelDescLabel->setText(desc);
     
@@ -542,6 +735,120 @@ void ConfigWidget::onMaxSpeechDurationChanged(double value)
     emitConfigurationChanged();
 }
 
+void ConfigWidget::onCompactSilenceChanged(double value)
+{
+    m_config.compactSilence = value;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onPushToTalkToggled(bool checked)
+{
+    m_config.pushToTalk = checked;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onPushToTalkPreRollChanged(double value)
+{
+    m_config.pushToTalkPreRoll = value;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onWakeWordToggled(bool checked)
+{
+    m_config.wakeWordEnabled = checked;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onWakePhraseChanged()
+{
+    m_config.wakePhrase = m_wakePhraseEdit->text().trimmed();
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onWakeWindowChanged(double value)
+{
+    m_config.wakeWindow = value;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onDecodingProfileChanged(int index)
+{
+    QString name = m_decodingProfileCombo->itemData(index).toString();
+    if (name == m_config.decodingProfile) {
+        return;
+    }
+    
+    // Presets overwrite all decoding fields; a custom profile keeps its values
+    if (DecodingProfile::presetNames().contains(name)) {
+        DecodingProfile::preset(name).applyTo(m_config);
+    } else {
+        m_config.decodingProfile = name;
+    }
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onLanguageChanged(int index)
+{
+    if (index >= 0) {
+        m_config.language = m_languageCombo->itemData(index).toString();
+        emitConfigurationChanged();
+    }
+}
+
+void ConfigWidget::onMaxDecodeLagChanged(double value)
+{
+    m_config.maxDecodeLag = value;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onRunawayGuardToggled(bool checked)
+{
+    m_config.runawayGuardEnabled = checked;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onWordTimestampsToggled(bool checked)
+{
+    m_config.wordTimestamps = checked;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onTranslateToggled(bool checked)
+{
+    m_config.translateAlongside = checked;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onAdaptiveQualityToggled(bool checked)
+{
+    m_config.adaptiveQuality = checked;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onReduceAudioContextToggled(bool checked)
+{
+    m_config.reduceAudioContext = checked;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onCommandModeToggled(bool checked)
+{
+    m_config.commandMode = checked;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onPromptTokensChanged(int value)
+{
+    m_config.promptTokens = value;
+    emitConfigurationChanged();
+}
+
+void ConfigWidget::onPromptResetSilenceChanged(double value)
+{
+    m_config.promptResetSilence = value;
+    emitConfigurationChanged();
+}
+
 void ConfigWidget::onBandpassToggled(bool checked)
 {
     m_config.useBandpass = checked;
@@ -608,6 +915,28 @@ void ConfigWidget::onBrowseOutputFile()
     }
 }
 
+void ConfigWidget::onBrowseWatchFolder()
+{
+    QString folder = QFileDialog::getExistingDirectory(this,
+        tr("Select Watch Folder"),
+        m_config.batchWatchFolder);
+    
+    if (!folder.isEmpty()) {
+        m_config.batchWatchFolder = folder;
+        m_watchFolderLabel->setText(folder);
+        m_clearWatchFolderButton->setEnabled(true);
+        emitConfigurationChanged();
+    }
+}
+
+void ConfigWidget::onClearWatchFolder()
+{
+    m_config.batchWatchFolder.clear();
+    m_watchFolderLabel->setText(tr("No watch folder"));
+    m_clearWatchFolderButton->setEnabled(false);
+    emitConfigurationChanged();
+}
+
 void ConfigWidget::refreshAudioDevices()
 {
     populateAudioDevices();
@@ -720,6 +1049,12 @@ void ConfigWidget::setRecordingState(bool isRecording)
     
     // Optionally disable other settings that shouldn't change during recording
     m_modelCombo->setEnabled(!isRecording);
+    m_refineModelCombo->setEnabled(!isRecording);
+    m_pushToTalkCheck->setEnabled(!isRecording);
+    m_preRollSpin->setEnabled(!isRecording);
+    m_wakeWordCheck->setEnabled(!isRecording);
+    m_wakePhraseEdit->setEnabled(!isRecording);
+    m_commandModeCheck->setEnabled(!isRecording);
     m_computeDeviceCombo->setEnabled(!isRecording);
     m_audioSourceCombo->setEnabled(!isRecording);
     m_deviceCombo->setEnabled(!isRecording);
@@ -3,7 +3,9 @@
 
 #include <QWidget>
 #include <QVariantMap>
+#include <QStringList>
 #include "../whisper/devicemanager.h"
+#include "../config/audioconfiguration.h"
 
 QT_BEGIN_NAMESPACE
 class QComboBox;
@@ -14,36 +16,9 @@ class QGroupBox;
 class QPushButton;
 class QLabel;
 class QSlider;
+class QLineEdit;
 QT_END_NAMESPACE
 
-struct AudioConfiguration {
-    QString model;
-    QString device;
-    QString audioSource;
-    int pickupThreshold;
-    double minSpeechDuration;
-    double maxSpeechDuration;
-    bool useBandpass;
-    double lowCutFreq;
-    double highCutFreq;
-    bool includeTimestamps;  // Include timestamps in UI and all outputs
-    
-    // Compute device options
-    int computeDeviceType;  // 0 = CPU, 1 = CUDA
-    int computeDeviceId;    // -1 for CPU, 0+ for GPU index
-    
-    // Audio gain options
-    double gainBoostDb;     // Manual gain boost in dB
-    bool autoGainEnabled;   // Enable automatic gain control
-    double autoGainTarget;  // Target level for AGC (0.0 to 1.0)
-    
-    // Output options
-    bool outputToWindow;
-    bool outputToFile;
-    bool outputToClipboard;
-    QString outputFilePath;
-};
-
 class ConfigWidget : public QWidget
 {
     Q_OBJECT
@@ -69,12 +44,31 @@ signals:
 
 private slots:
     void onModelChanged(int index);
+    void onRefineModelChanged(int index);
+    void onRefineThresholdChanged(double value);
     void onDeviceChanged(int index);
     void onAudioSourceChanged(int index);
     void onComputeDeviceChanged(int index);
     void onPickupThresholdChanged(int value);
     void onMinSpeechDurationChanged(double value);
     void onMaxSpeechDurationChanged(double value);
+    void onCompactSilenceChanged(double value);
+    void onPushToTalkToggled(bool checked);
+    void onPushToTalkPreRollChanged(double value);
+    void onWakeWordToggled(bool checked);
+    void onWakePhraseChanged();
+    void onWakeWindowChanged(double value);
+    void onMaxDecodeLagChanged(double value);
+    void onDecodingProfileChanged(int index);
+    void onLanguageChanged(int index);
+    void onRunawayGuardToggled(bool checked);
+    void onWordTimestampsToggled(bool checked);
+    void onTranslateToggled(bool checked);
+    void onAdaptiveQualityToggled(bool checked);
+    void onReduceAudioContextToggled(bool checked);
+    void onCommandModeToggled(bool checked);
+    void onPromptTokensChanged(int value);
+    void onPromptResetSilenceChanged(double value);
     void onBandpassToggled(bool checked);
     void onLowCutChanged(double value);
     void onHighCutChanged(double value);
@@ -84,6 +78,8 @@ private slots:
     void onTimestampsToggled(bool checked);
     void onOutputOptionsChanged();
     void onBrowseOutputFile();
+    void onBrowseWatchFolder();
+    void onClearWatchFolder();
     void refreshAudioDevices();
     void refreshComputeDevices();
     void updateDeviceColors();
@@ -99,6 +95,8 @@ private:
     QGroupBox *m_modelGroup;
     QComboBox *m_modelCombo;
     QLabel *m_modelDescLabel;
+    QComboBox *m_refineModelCombo;
+    QDoubleSpinBox *m_refineThresholdSpin;
     QComboBox *m_computeDeviceCombo;
     QLabel *m_computeDeviceLabel;
     
@@ -114,6 +112,26 @@ private:
     QLabel *m_pickupLabel;
     QDoubleSpinBox *m_minSpeechSpin;
     QDoubleSpinBox *m_maxSpeechSpin;
+    QDoubleSpinBox *m_compactSilenceSpin;
+    QCheckBox *m_pushToTalkCheck;
+    QDoubleSpinBox *m_preRollSpin;
+    QCheckBox *m_wakeWordCheck;
+    QLineEdit *m_wakePhraseEdit;
+    QDoubleSpinBox *m_wakeWindowSpin;
+    
+    // Decoding
+    QGroupBox *m_decodingGroup;
+    QComboBox *m_decodingProfileCombo;
+    QComboBox *m_languageCombo;
+    QDoubleSpinBox *m_maxDecodeLagSpin;
+    QCheckBox *m_runawayGuardCheck;
+    QCheckBox *m_wordTimestampsCheck;
+    QCheckBox *m_translateCheck;
+    QCheckBox *m_adaptiveQualityCheck;
+    QCheckBox *m_reduceAudioContextCheck;
+    QCheckBox *m_commandModeCheck;
+    QSpinBox *m_promptTokensSpin;
+    QDoubleSpinBox *m_promptResetSpin;
     
     // Audio filtering
     QGroupBox *m_filterGroup;
@@ -138,6 +156,9 @@ private:
     QCheckBox *m_timestampsCheck;
     QPushButton *m_browseFileButton;
     QLabel *m_outputFileLabel;
+    QLabel *m_watchFolderLabel;
+    QPushButton *m_browseWatchFolderButton;
+    QPushButton *m_clearWatchFolderButton;
     
     // Current configuration
     AudioConfiguration m_config;
@@ -14,6 +14,7 @@
 #include <QTextStream>
 #include <QTextCursor>
 #include <QTextDocument>
+#include <QTextBlock>
 #include <QTextCharFormat>
 #include <QScrollBar>
 #include <QTimer>
@@ -22,6 +23,7 @@
 #include <QKeySequence>
 #include <QFile>
 #include <QRegularExpression>
+#include <QDebug>
 
 TranscriptWidget::TranscriptWidget(QWidget *parent)
     : QWidget(parent)
@@ -142,6 +144,9 @@ void TranscriptWidget::createActions()
     
     m_exportRTFAction = new QAction(tr("Export as &RTF..."), this);
     connect(m_exportRTFAction, &QAction::triggered, this, &TranscriptWidget::exportAsRTF);
+    
+    m_exportWordTimingsAction = new QAction(tr("Export &Word Timings..."), this);
+    connect(m_exportWordTimingsAction, &QAction::triggered, this, &TranscriptWidget::exportWordTimings);
 }
 
 void TranscriptWidget::createToolBar()
@@ -161,28 +166,25 @@ void TranscriptWidget::createToolBar()
     exportMenu->addAction(m_exportTextAction);
     exportMenu->addAction(m_exportMarkdownAction);
     exportMenu->addAction(m_exportRTFAction);
+    exportMenu->addSeparator();
+    exportMenu->addAction(m_exportWordTimingsAction);
     exportButton->setMenu(exportMenu);
     m_toolBar->addWidget(exportButton);
 }
 
-void TranscriptWidget::appendTranscription(const QString &text, qint64 timestamp)
+void TranscriptWidget::appendTranscription(const TranscriptionSegment &segment)
 {
-    if (text.isEmpty()) return;
+    if (segment.text.isEmpty()) return;
     
-    // Store the entry
+    // Store the entry; segments are stamped with the time their audio started
     TranscriptEntry entry;
-    entry.text = text;
-    entry.timestamp = QDateTime::fromMSecsSinceEpoch(timestamp);
+    entry.text = segment.text;
+    entry.timestamp = QDateTime::fromMSecsSinceEpoch(segment.startTime);
+    entry.words = segment.words;
+    entry.utteranceId = segment.utteranceId;
+    entry.translation = segment.translation;
     m_transcriptEntries.append(entry);
     
-    // Format and append to text edit
-    QString formattedText;
-    if (m_showTimestamps) {
-        formattedText = QString("[%1] %2").arg(formatTimestamp(timestamp), text);
-    } else {
-        formattedText = text;
-    }
-    
     // Append with formatting
     QTextCursor cursor = m_textEdit->textCursor();
     cursor.movePosition(QTextCursor::End);
@@ -191,29 +193,134 @@ void TranscriptWidget::appendTranscription(const QString &text, qint64 timestamp
         cursor.insertText("\n");
     }
     
+    insertEntry(cursor, entry);
+    
+    // Auto-scroll if enabled
+    if (m_autoScroll) {
+        QScrollBar *scrollBar = m_textEdit->verticalScrollBar();
+        scrollBar->setValue(scrollBar->maximum());
+    }
+    
+    emit transcriptChanged();
+}
+
+void TranscriptWidget::insertEntry(QTextCursor &cursor, const TranscriptEntry &entry)
+{
     if (m_showTimestamps) {
         QTextCharFormat timestampFormat;
         timestampFormat.setForeground(Qt::gray);
-        cursor.insertText(QString("[%1] ").arg(formatTimestamp(timestamp)), timestampFormat);
+        cursor.insertText(QString("[%1] ").arg(entry.timestamp.toString("hh:mm:ss")), timestampFormat);
     }
     
     QTextCharFormat textFormat;
     // Use the window text color from the palette for proper theme contrast
     textFormat.setForeground(palette().color(QPalette::WindowText));
-    cursor.insertText(text, textFormat);
+    cursor.insertText(entry.text, textFormat);
+    
+    // The translation goes on its own, dimmed line under the original
+    if (!entry.translation.isEmpty()) {
+        QTextCharFormat translationFormat;
+        translationFormat.setForeground(Qt::gray);
+        translationFormat.setFontItalic(true);
+        cursor.insertText("\n", textFormat);
+        cursor.insertText(QString("    [en] %1").arg(entry.translation), translationFormat);
+    }
+}
+
+void TranscriptWidget::setAutoScroll(bool enabled)
+{
+    m_autoScroll = enabled;
+}
+
+void TranscriptWidget::replaceTranscription(const TranscriptionSegment &segment)
+{
+    if (segment.utteranceId == 0 || segment.text.isEmpty()) return;
+    
+    // The first live entry of the utterance takes the refined text, the rest go away.
+    // Nothing matches if the transcript was cleared in the meantime.
+    QList<int> indices;
+    for (int i = 0; i < m_transcriptEntries.size(); ++i) {
+        if (m_transcriptEntries[i].utteranceId == segment.utteranceId) {
+            indices.append(i);
+        }
+    }
+    if (indices.isEmpty()) return;
     
-    // Auto-scroll if enabled
-    if (m_autoScroll) {
-        QScrollBar *scrollBar = m_textEdit->verticalScrollBar();
-        scrollBar->setValue(scrollBar->maximum());
+    // Only the utterance's own blocks change; the rest of the document stays
+    QTextDocument *document = m_textEdit->document();
+    if (firstBlock(m_transcriptEntries.size()) != document->blockCount()) {
+        // Edited by hand, so entries no longer map to blocks
+        qDebug() << "Transcript text was edited, redrawing it";
+        for (int i = indices.size() - 1; i > 0; --i) {
+            m_transcriptEntries.removeAt(indices[i]);
+        }
+        applyRefinement(m_transcriptEntries[indices.first()], segment);
+        rebuildDisplay();
+        emit transcriptChanged();
+        return;
     }
     
+    int scrollPosition = m_textEdit->verticalScrollBar()->value();
+    QTextCursor cursor(document);
+    cursor.beginEditBlock();
+    
+    // Later entries go with the line break in front of them
+    for (int i = indices.size() - 1; i > 0; --i) {
+        const int index = indices[i];
+        const QTextBlock first = document->findBlockByNumber(firstBlock(index));
+        const QTextBlock last = document->findBlockByNumber(firstBlock(index + 1) - 1);
+        cursor.setPosition(first.position() - 1);
+        cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+        cursor.removeSelectedText();
+        m_transcriptEntries.removeAt(index);
+    }
+    
+    TranscriptEntry &entry = m_transcriptEntries[indices.first()];
+    const QTextBlock first = document->findBlockByNumber(firstBlock(indices.first()));
+    const QTextBlock last = document->findBlockByNumber(firstBlock(indices.first() + 1) - 1);
+    cursor.setPosition(first.position());
+    cursor.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    applyRefinement(entry, segment);
+    const int start = cursor.position();
+    insertEntry(cursor, entry);
+    const int end = cursor.position();
+    
+    // Search matches in the new text
+    if (!m_searchText.isEmpty()) {
+        QTextCharFormat highlightFormat;
+        highlightFormat.setBackground(Qt::yellow);
+        QTextCursor match = document->find(m_searchText, start);
+        while (!match.isNull() && match.selectionEnd() <= end) {
+            match.mergeCharFormat(highlightFormat);
+            match = document->find(m_searchText, match);
+        }
+    }
+    cursor.endEditBlock();
+    
+    QScrollBar *scrollBar = m_textEdit->verticalScrollBar();
+    scrollBar->setValue(m_autoScroll ? scrollBar->maximum() : scrollPosition);
     emit transcriptChanged();
 }
 
-void TranscriptWidget::setAutoScroll(bool enabled)
+void TranscriptWidget::applyRefinement(TranscriptEntry &entry, const TranscriptionSegment &segment)
 {
-    m_autoScroll = enabled;
+    entry.text = segment.text;
+    entry.timestamp = QDateTime::fromMSecsSinceEpoch(segment.startTime);
+    entry.words = segment.words;
+    if (!segment.translation.isEmpty()) {
+        entry.translation = segment.translation;
+    }
+}
+
+int TranscriptWidget::firstBlock(int index) const
+{
+    // Each entry is one block, plus one for its translation
+    int block = 0;
+    for (int i = 0; i < index; ++i) {
+        block += m_transcriptEntries[i].translation.isEmpty() ? 1 : 2;
+    }
+    return block;
 }
 
 void TranscriptWidget::setShowTimestamps(bool show)
@@ -221,8 +328,13 @@ void TranscriptWidget::setShowTimestamps(bool show)
     if (m_showTimestamps == show) return; // No change needed
     
     m_showTimestamps = show;
-    
+    rebuildDisplay();
+}
+
+void TranscriptWidget::rebuildDisplay()
+{
     // Rebuild the display without modifying the stored entries
+    int scrollPosition = m_textEdit->verticalScrollBar()->value();
     m_textEdit->clear();
     
     QTextCursor cursor = m_textEdit->textCursor();
@@ -232,23 +344,14 @@ void TranscriptWidget::setShowTimestamps(bool show)
         if (cursor.position() > 0) {
             cursor.insertText("\n");
         }
-        
-        if (m_showTimestamps) {
-            QTextCharFormat timestampFormat;
-            timestampFormat.setForeground(Qt::gray);
-            cursor.insertText(QString("[%1] ").arg(entry.timestamp.toString("hh:mm:ss")), timestampFormat);
-        }
-        
-        QTextCharFormat textFormat;
-        textFormat.setForeground(palette().color(QPalette::WindowText));
-        cursor.insertText(entry.text, textFormat);
+        insertEntry(cursor, entry);
     }
     
-    // Restore auto-scroll position if enabled
-    if (m_autoScroll) {
-        QScrollBar *scrollBar = m_textEdit->verticalScrollBar();
-        scrollBar->setValue(scrollBar->maximum());
-    }
+    // Restore auto-scroll position if enabled, otherwise keep the reader's place
+    QScrollBar *scrollBar = m_textEdit->verticalScrollBar();
+    scrollBar->setValue(m_autoScroll ? scrollBar->maximum() : scrollPosition);
+    
+    highlightSearchResults();
 }
 
 void TranscriptWidget::saveTranscript()
@@ -354,6 +457,37 @@ void TranscriptWidget::exportAsRTF()
     emit statusMessage(tr("Exported to %1").arg(fileName));
 }
 
+void TranscriptWidget::exportWordTimings()
+{
+    QString content = getWordTimingsContent();
+    if (content.isEmpty()) {
+        QMessageBox::information(this, tr("Export Word Timings"),
+                                 tr("The transcript has no word timings. Enable \"Word Timestamps\" "
+                                    "in the decoding settings before recording."));
+        return;
+    }
+    
+    QString fileName = QFileDialog::getSaveFileName(this, 
+        tr("Export Word Timings"), 
+        QString(), 
+        tr("Tab-separated Files (*.tsv);;All Files (*)"));
+    
+    if (fileName.isEmpty()) return;
+    
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, tr("Export Error"), 
+                           tr("Could not export file: %1").arg(file.errorString()));
+        return;
+    }
+    
+    QTextStream stream(&file);
+    stream << "start\tend\tprobability\tword\n" << content;
+    file.close();
+    
+    emit statusMessage(tr("Exported to %1").arg(fileName));
+}
+
 void TranscriptWidget::clearTranscript()
 {
     int ret = QMessageBox::question(this, tr("Clear Transcript"),
@@ -505,6 +639,9 @@ QString TranscriptWidget::getPlainTextContent() const
         } else {
             content += entry.text + "\n";
         }
+        if (!entry.translation.isEmpty()) {
+            content += QString("    [en] %1\n").arg(entry.translation);
+        }
     }
     return content;
 }
@@ -527,6 +664,25 @@ QString TranscriptWidget::getMarkdownContent() const
         } else {
             content += entry.text + "\n\n";
         }
+        if (!entry.translation.isEmpty()) {
+            content += QString("> *%1*\n\n").arg(entry.translation);
+        }
+    }
+    return content;
+}
+
+QString TranscriptWidget::getWordTimingsContent() const
+{
+    // One word per line; times are absolute so they line up with the recording
+    QString content;
+    for (const auto &entry : m_transcriptEntries) {
+        for (const auto &word : entry.words) {
+            content += QString("%1\t%2\t%3\t%4\n")
+                      .arg(QDateTime::fromMSecsSinceEpoch(word.startTime).toString("hh:mm:ss.zzz"))
+                      .arg(QDateTime::fromMSecsSinceEpoch(word.endTime).toString("hh:mm:ss.zzz"))
+                      .arg(word.probability, 0, 'f', 3)
+                      .arg(word.text);
+        }
     }
     return content;
 }
@@ -545,6 +701,9 @@ QString TranscriptWidget::getRTFContent() const
         } else {
             rtf += entry.text + "\\par ";
         }
+        if (!entry.translation.isEmpty()) {
+            rtf += QString("{\\i %1}\\par ").arg(entry.translation);
+        }
     }
     
     rtf += "}";
@@ -4,9 +4,11 @@
 #include <QWidget>
 #include <QDateTime>
 #include <QMap>
+#include "../whisper/transcriptionsegment.h"
 
 QT_BEGIN_NAMESPACE
 class QTextEdit;
+class QTextCursor;
 class QToolBar;
 class QLineEdit;
 class QCheckBox;
@@ -23,7 +25,9 @@ public:
     explicit TranscriptWidget(QWidget *parent = nullptr);
     ~TranscriptWidget();
 
-    void appendTranscription(const QString &text, qint64 timestamp);
+    void appendTranscription(const TranscriptionSegment &segment);
+    // Replace every entry of the segment's utterance with its refined text
+    void replaceTranscription(const TranscriptionSegment &segment);
     void setAutoScroll(bool enabled);
     void setShowTimestamps(bool show);
     
@@ -33,6 +37,7 @@ public slots:
     void exportAsText();
     void exportAsMarkdown();
     void exportAsRTF();
+    void exportWordTimings();
     void clearTranscript();
     void findText();
     void findNext();
@@ -56,10 +61,12 @@ private:
     void createActions();
     void createToolBar();
     void highlightSearchResults();
+    void rebuildDisplay();
     QString formatTimestamp(qint64 timestamp) const;
     QString getPlainTextContent() const;
     QString getMarkdownContent() const;
     QString getRTFContent() const;
+    QString getWordTimingsContent() const;
     
     // UI Components
     QTextEdit *m_textEdit;
@@ -82,6 +89,7 @@ private:
     QAction *m_exportTextAction;
     QAction *m_exportMarkdownAction;
     QAction *m_exportRTFAction;
+    QAction *m_exportWordTimingsAction;
     
     // State
     bool m_autoScroll;
@@ -95,8 +103,15 @@ private:
     struct TranscriptEntry {
         QString text;
         QDateTime timestamp;
+        QList<TranscriptionWord> words;  // Only filled when word timestamps are enabled
+        quint64 utteranceId = 0;         // Links live entries to their refined replacement
+        QString translation;             // English translation, when decoded alongside
     };
     QList<TranscriptEntry> m_transcriptEntries;
+    
+    void insertEntry(QTextCursor &cursor, const TranscriptEntry &entry);
+    static void applyRefinement(TranscriptEntry &entry, const TranscriptionSegment &segment);
+    int firstBlock(int index) const;
 };
 
 #endif // TRANSCRIPTWIDGET_H
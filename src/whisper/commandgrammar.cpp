@@ -0,0 +1,181 @@
+#include "commandgrammar.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegularExpression>
+#include <QDebug>
+#include <algorithm>
+
+extern "C" {
+#include "include/whisper.h"
+}
+
+CommandGrammar::CommandGrammar()
+{
+}
+
+CommandGrammar::~CommandGrammar()
+{
+}
+
+bool CommandGrammar::load(const QString &path)
+{
+    m_path = path;
+    m_error.clear();
+    m_commands.clear();
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        m_error = QString("Cannot open %1: %2").arg(path, file.errorString());
+        buildRules();
+        return false;
+    }
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        lineNumber++;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        const int separator = line.indexOf('=');
+        VoiceCommand command;
+        command.phrase = separator > 0 ? normalize(line.left(separator)) : QString();
+        command.action = separator > 0 ? line.mid(separator + 1).trimmed() : QString();
+        if (command.phrase.isEmpty() ||
+            !(command.action.startsWith("key ") || command.action.startsWith("type "))) {
+            qDebug() << "Ignoring malformed command on line" << lineNumber << "of" << path << ":" << line;
+            continue;
+        }
+        m_commands.append(command);
+    }
+
+    if (m_commands.isEmpty()) {
+        m_error = QString("No commands in %1").arg(path);
+    }
+    buildRules();
+    return !m_commands.isEmpty();
+}
+
+bool CommandGrammar::writeTemplate(const QString &path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "# QWhisper voice commands: one per line, \"spoken phrase = action\".\n"
+        << "#   key <combo> [<combo>...]  press key combinations, e.g. key ctrl+shift+t\n"
+        << "#   type <text>               type a snippet (\\n starts a new line)\n"
+        << "\n"
+        << "save file = key ctrl+s\n"
+        << "undo that = key ctrl+z\n"
+        << "new tab = key ctrl+t\n"
+        << "close tab = key ctrl+w\n"
+        << "next tab = key ctrl+Tab\n"
+        << "new paragraph = key Return Return\n"
+        << "select all = key ctrl+a\n"
+        << "copy that = key ctrl+c\n"
+        << "paste that = key ctrl+v\n"
+        << "sign off = type Best regards,\\nYour Name\n";
+    return true;
+}
+
+QString CommandGrammar::prompt() const
+{
+    QStringList phrases;
+    for (const VoiceCommand &command : m_commands) {
+        phrases.append(command.phrase);
+    }
+    return phrases.join(", ");
+}
+
+int CommandGrammar::tokenBudget() const
+{
+    // BPE tokens hold a few characters each; leave room for the leading space,
+    // capitalization and the closing punctuation
+    int longest = 0;
+    for (const VoiceCommand &command : m_commands) {
+        longest = std::max(longest, static_cast<int>(command.phrase.size()));
+    }
+    return longest / 2 + 4;
+}
+
+const VoiceCommand *CommandGrammar::match(const QString &text) const
+{
+    const QString normalized = normalize(text);
+    for (const VoiceCommand &command : m_commands) {
+        if (command.phrase == normalized) {
+            return &command;
+        }
+    }
+    return nullptr;
+}
+
+QString CommandGrammar::normalize(const QString &text)
+{
+    QString normalized = text.toLower();
+    normalized.replace(QRegularExpression("[^\\w\\s']"), " ");
+    return normalized.simplified();
+}
+
+void CommandGrammar::buildRules()
+{
+    // root     ::= space phrases end
+    // space    ::= " " |
+    // phrases  ::= phrase1 | phrase2 | ...    (letters match either case)
+    // end      ::= "." | "!" |
+    m_rules.clear();
+    m_rulePointers.clear();
+    if (m_commands.isEmpty()) {
+        return;
+    }
+
+    auto element = [](whisper_gretype type, uint32_t value) {
+        whisper_grammar_element e;
+        e.type = type;
+        e.value = value;
+        return e;
+    };
+
+    m_rules.push_back({element(WHISPER_GRETYPE_RULE_REF, 1),
+                       element(WHISPER_GRETYPE_RULE_REF, 2),
+                       element(WHISPER_GRETYPE_RULE_REF, 3),
+                       element(WHISPER_GRETYPE_END, 0)});
+
+    m_rules.push_back({element(WHISPER_GRETYPE_CHAR, ' '),
+                       element(WHISPER_GRETYPE_ALT, 0),
+                       element(WHISPER_GRETYPE_END, 0)});
+
+    std::vector<whisper_grammar_element> phrases;
+    for (int i = 0; i < m_commands.size(); ++i) {
+        if (i > 0) {
+            phrases.push_back(element(WHISPER_GRETYPE_ALT, 0));
+        }
+        for (const uint c : m_commands[i].phrase.toUcs4()) {
+            const QString single = QString::fromUcs4(reinterpret_cast<const char32_t*>(&c), 1);
+            const uint upper = single.toUpper().toUcs4().value(0, c);
+            phrases.push_back(element(WHISPER_GRETYPE_CHAR, c));
+            if (upper != c) {
+                phrases.push_back(element(WHISPER_GRETYPE_CHAR_ALT, upper));
+            }
+        }
+    }
+    phrases.push_back(element(WHISPER_GRETYPE_END, 0));
+    m_rules.push_back(phrases);
+
+    m_rules.push_back({element(WHISPER_GRETYPE_CHAR, '.'),
+                       element(WHISPER_GRETYPE_CHAR_ALT, '!'),
+                       element(WHISPER_GRETYPE_ALT, 0),
+                       element(WHISPER_GRETYPE_END, 0)});
+
+    for (const auto &rule : m_rules) {
+        m_rulePointers.push_back(rule.data());
+    }
+}
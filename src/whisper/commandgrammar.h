@@ -0,0 +1,62 @@
+#ifndef COMMANDGRAMMAR_H
+#define COMMANDGRAMMAR_H
+
+#include <QString>
+#include <QList>
+#include <cstddef>
+#include <vector>
+
+struct whisper_grammar_element;
+
+// A spoken phrase and what it does: "key ctrl+s" presses a key combination
+// (several separated by spaces), "type <text>" types a snippet (\n = new line)
+struct VoiceCommand {
+    QString phrase;
+    QString action;
+};
+
+// The command list for command mode, compiled to a whisper.cpp grammar so the
+// decoder can only produce one of the phrases. The file has one command per
+// line, "phrase = action", with # comments:
+//
+//     save file = key ctrl+s
+//     sign off = type Best regards,\nSam
+class CommandGrammar
+{
+public:
+    CommandGrammar();
+    ~CommandGrammar();
+
+    bool load(const QString &path);
+    QString errorString() const { return m_error; }
+    QString path() const { return m_path; }
+
+    // Write an example command list to path
+    static bool writeTemplate(const QString &path);
+
+    const QList<VoiceCommand> &commands() const { return m_commands; }
+    bool isEmpty() const { return m_commands.isEmpty(); }
+
+    // Grammar rules for whisper_full_params (the start rule is 0)
+    const whisper_grammar_element **rules() { return m_rulePointers.data(); }
+    size_t ruleCount() const { return m_rulePointers.size(); }
+
+    // The phrases as a decoder prompt, and a token budget for the longest one
+    QString prompt() const;
+    int tokenBudget() const;
+
+    // The command whose phrase the decoded text is, if any
+    const VoiceCommand *match(const QString &text) const;
+
+private:
+    static QString normalize(const QString &text);
+    void buildRules();
+
+    QString m_path;
+    QString m_error;
+    QList<VoiceCommand> m_commands;
+    std::vector<std::vector<whisper_grammar_element>> m_rules;
+    std::vector<const whisper_grammar_element*> m_rulePointers;
+};
+
+#endif // COMMANDGRAMMAR_H
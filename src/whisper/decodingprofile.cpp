@@ -0,0 +1,96 @@
+#include "decodingprofile.h"
+#include "../config/audioconfiguration.h"
+
+extern "C" {
+#include "include/whisper.h"
+}
+
+QStringList DecodingProfile::presetNames()
+{
+    return QStringList{"fastest", "balanced", "accurate"};
+}
+
+DecodingProfile DecodingProfile::preset(const QString &name)
+{
+    DecodingProfile profile;
+    profile.name = name;
+    
+    if (name == "fastest") {
+        // Single greedy pass: no fallback retries, short segments
+        profile.beamSearch = false;
+        profile.beamSize = 1;
+        profile.bestOf = 1;
+        profile.temperatureFallback = false;
+        profile.entropyThreshold = 2.4;
+        profile.logprobThreshold = -1.0;
+        profile.maxTokensPerSegment = 64;
+    } else if (name == "accurate") {
+        // Reference whisper settings: beam search with full fallback
+        profile.beamSearch = true;
+        profile.beamSize = 5;
+        profile.bestOf = 5;
+        profile.temperatureFallback = true;
+        profile.entropyThreshold = 2.4;
+        profile.logprobThreshold = -1.0;
+        profile.maxTokensPerSegment = 0;
+    } else {
+        // Balanced: greedy with fallback, matching whisper.cpp defaults
+        profile.name = "balanced";
+        profile.beamSearch = false;
+        profile.beamSize = 1;
+        profile.bestOf = 5;
+        profile.temperatureFallback = true;
+        profile.entropyThreshold = 2.4;
+        profile.logprobThreshold = -1.0;
+        profile.maxTokensPerSegment = 0;
+    }
+    
+    return profile;
+}
+
+DecodingProfile DecodingProfile::fromConfiguration(const AudioConfiguration &config)
+{
+    DecodingProfile profile;
+    profile.name = config.decodingProfile;
+    profile.beamSearch = config.beamSearch;
+    profile.beamSize = config.beamSize;
+    profile.bestOf = config.bestOf;
+    profile.temperatureFallback = config.temperatureFallback;
+    profile.entropyThreshold = config.entropyThreshold;
+    profile.logprobThreshold = config.logprobThreshold;
+    profile.maxTokensPerSegment = config.maxTokensPerSegment;
+    return profile;
+}
+
+void DecodingProfile::applyTo(AudioConfiguration &config) const
+{
+    config.decodingProfile = name;
+    config.beamSearch = beamSearch;
+    config.beamSize = beamSize;
+    config.bestOf = bestOf;
+    config.temperatureFallback = temperatureFallback;
+    config.entropyThreshold = entropyThreshold;
+    config.logprobThreshold = logprobThreshold;
+    config.maxTokensPerSegment = maxTokensPerSegment;
+}
+
+int DecodingProfile::whisperStrategy() const
+{
+    return beamSearch ? WHISPER_SAMPLING_BEAM_SEARCH : WHISPER_SAMPLING_GREEDY;
+}
+
+void DecodingProfile::applyTo(whisper_full_params &params) const
+{
+    if (beamSearch) {
+        params.beam_search.beam_size = qMax(1, beamSize);
+    } else {
+        params.greedy.best_of = qMax(1, bestOf);
+    }
+    
+    // A zero increment disables whisper's temperature fallback loop
+    params.temperature = 0.0f;
+    params.temperature_inc = temperatureFallback ? 0.2f : 0.0f;
+    params.entropy_thold = static_cast<float>(entropyThreshold);
+    params.logprob_thold = static_cast<float>(logprobThreshold);
+    params.max_tokens = qMax(0, maxTokensPerSegment);
+}
@@ -0,0 +1,35 @@
+#ifndef DECODINGPROFILE_H
+#define DECODINGPROFILE_H
+
+#include <QString>
+#include <QStringList>
+
+struct AudioConfiguration;
+struct whisper_full_params;
+
+// Decoding strategy settings that trade latency against accuracy. The named
+// presets fill these in; the individual values are persisted with the rest of
+// the audio configuration so a deployment can fine-tune them.
+struct DecodingProfile {
+    QString name;               // "fastest", "balanced", "accurate" or "custom"
+    bool beamSearch;            // Beam search instead of greedy sampling
+    int beamSize;               // Beams when beamSearch is set
+    int bestOf;                 // Candidates sampled per temperature when greedy
+    bool temperatureFallback;   // Retry at higher temperatures when a decode fails the thresholds
+    double entropyThreshold;    // Fallback when the token entropy is above this
+    double logprobThreshold;    // Fallback when the average log-probability is below this
+    int maxTokensPerSegment;    // Hard cap on tokens per segment (0 = unlimited)
+    
+    static QStringList presetNames();
+    static DecodingProfile preset(const QString &name);
+    static DecodingProfile fromConfiguration(const AudioConfiguration &config);
+    
+    // Copy the profile into the configuration fields
+    void applyTo(AudioConfiguration &config) const;
+    
+    // Configure whisper_full parameters created with whisperStrategy()
+    int whisperStrategy() const;
+    void applyTo(whisper_full_params &params) const;
+};
+
+#endif // DECODINGPROFILE_H
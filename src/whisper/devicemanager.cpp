@@ -101,6 +101,34 @@ QString DeviceManager::formatDeviceNameWithMemory(const DeviceInfo& device)
     return name;
 }
 
+size_t DeviceManager::availableMemory(DeviceType type, int deviceId)
+{
+    if (type != CPU) {
+        return getDeviceInfo(type, deviceId).memoryFree;
+    }
+    
+    // MemAvailable counts reclaimable page cache, which MemFree leaves out
+    QFile meminfo("/proc/meminfo");
+    if (meminfo.open(QIODevice::ReadOnly)) {
+        QTextStream in(&meminfo);
+        QString line;
+        while (in.readLineInto(&line)) {
+            if (line.startsWith("MemAvailable:")) {
+                bool ok;
+                const size_t available = line.mid(13).trimmed().split(' ').value(0).toULongLong(&ok);
+                if (ok) {
+                    return available * 1024;
+                }
+            }
+        }
+    }
+    
+    size_t total = 0;
+    size_t free = 0;
+    getSystemMemoryInfo(total, free);
+    return free;
+}
+
 void DeviceManager::detectDevices()
 {
     m_devices.clear();
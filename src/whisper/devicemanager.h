@@ -41,6 +41,9 @@ public:
     // Get default device (first CUDA if available, otherwise CPU)
     DeviceInfo getDefaultDevice() const;
     
+    // Memory that can be allocated right now (re-read for the CPU, as detected for GPUs)
+    size_t availableMemory(DeviceType type, int deviceId);
+    
     // Format device name for display
     static QString formatDeviceName(const DeviceInfo& device);
     
@@ -0,0 +1,138 @@
+#include "melstream.h"
+#include <QMutexLocker>
+#include <algorithm>
+
+namespace {
+constexpr quint64 kHop = StreamingMel::kHopLength;
+constexpr quint64 kHalfWindow = StreamingMel::kWindowLength / 2;
+constexpr size_t kRetainedSamples = 60 * 16000;   // Longer than any utterance is decoded in one piece
+
+// First grid frame whose window starts at or after position
+quint64 firstFrameAfter(quint64 position)
+{
+    return (position + kHalfWindow + kHop - 1) / kHop;
+}
+}
+
+MelStream::MelStream(QObject *parent)
+    : QObject(parent)
+    , m_melCount(0)
+    , m_active(false)
+    , m_sampleBase(0)
+    , m_frameBase(firstFrameAfter(0))
+{
+}
+
+void MelStream::setFilters(int melCount, const std::vector<float> &filters)
+{
+    QMutexLocker locker(&m_mutex);
+    m_melCount = melCount;
+    m_mel.setFilters(melCount, filters);
+
+    // Frames of another model are no use; the next utterance starts over
+    m_active = false;
+    clear(0);
+}
+
+void MelStream::begin(quint64 start, std::vector<float> samples)
+{
+    QMutexLocker locker(&m_mutex);
+    clear(start);
+    if (m_melCount == 0) {
+        return;
+    }
+    m_active = true;
+    m_samples = std::move(samples);
+    computeFrames();
+}
+
+void MelStream::append(const std::vector<float> &samples)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_active) {
+        return;
+    }
+    m_samples.insert(m_samples.end(), samples.begin(), samples.end());
+    computeFrames();
+    if (m_samples.size() > 2 * kRetainedSamples) {
+        dropOldest();
+    }
+}
+
+void MelStream::end()
+{
+    QMutexLocker locker(&m_mutex);
+    m_active = false;
+    clear(0);
+}
+
+void MelStream::clear(quint64 start)
+{
+    m_samples.clear();
+    m_sampleBase = start;
+    m_frames.clear();
+    m_frameBase = firstFrameAfter(start);
+}
+
+void MelStream::computeFrames()
+{
+    // Every frame whose window has been received; about ten per 100 ms block
+    const quint64 position = m_sampleBase + m_samples.size();
+    for (;;) {
+        const quint64 frame = m_frameBase + m_frames.size() / m_melCount;
+        const quint64 windowEnd = frame * kHop + kHalfWindow;
+        if (windowEnd > position) {
+            break;
+        }
+        m_frames.resize(m_frames.size() + m_melCount);
+        m_mel.logMel(m_samples.data() + (windowEnd - StreamingMel::kWindowLength - m_sampleBase),
+                     m_frames.data() + m_frames.size() - m_melCount);
+    }
+}
+
+void MelStream::dropOldest()
+{
+    const size_t dropped = m_samples.size() - kRetainedSamples;
+    m_samples.erase(m_samples.begin(), m_samples.begin() + dropped);
+    m_sampleBase += dropped;
+
+    const quint64 firstFrame = firstFrameAfter(m_sampleBase);
+    if (firstFrame > m_frameBase) {
+        const size_t frames = std::min<size_t>(firstFrame - m_frameBase, m_frames.size() / m_melCount);
+        m_frames.erase(m_frames.begin(), m_frames.begin() + frames * m_melCount);
+        m_frameBase += frames;
+    }
+}
+
+size_t MelStream::copyFrames(quint64 start, const float *audio, size_t sampleCount, size_t firstFrame,
+                             std::vector<float> &frames) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_active || m_melCount == 0 || start % kHop != 0) {
+        return 0;
+    }
+
+    // Grid frames for the utterance's frames, limited to what both cover
+    const quint64 first = start / kHop + firstFrame;
+    if (first < m_frameBase || first * kHop < start + kHalfWindow) {
+        return 0;
+    }
+    const quint64 computedEnd = m_frameBase + m_frames.size() / m_melCount;
+    const quint64 audioEnd = sampleCount >= kHalfWindow ? (start + sampleCount - kHalfWindow) / kHop + 1 : 0;
+    const quint64 end = std::min(computedEnd, audioEnd);
+    if (end <= first) {
+        return 0;
+    }
+
+    // The frames are only the utterance's if the audio under them is
+    const quint64 from = first * kHop - kHalfWindow;
+    const quint64 to = (end - 1) * kHop + kHalfWindow;
+    if (from < m_sampleBase || !std::equal(audio + (from - start), audio + (to - start),
+                                           m_samples.data() + (from - m_sampleBase))) {
+        return 0;
+    }
+
+    const float *begin = m_frames.data() + (first - m_frameBase) * m_melCount;
+    frames.insert(frames.end(), begin, begin + (end - first) * m_melCount);
+    return static_cast<size_t>(end - first);
+}
@@ -0,0 +1,57 @@
+#ifndef MELSTREAM_H
+#define MELSTREAM_H
+
+#include <QObject>
+#include <QMutex>
+#include <vector>
+#include "streamingmel.h"
+
+// Computes the log-mel frames of the utterance being recorded on a thread of
+// its own, as the live processor hands it the audio, so most of the
+// spectrogram is ready by the time the utterance ends. It does nothing between
+// utterances. Frames sit on a fixed grid of the capture: frame k is centred on
+// capture position k * kHopLength, and utterances start on that grid.
+class MelStream : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MelStream(QObject *parent = nullptr);
+
+    // The loaded model's filterbank (see StreamingMel::setFilters); a melCount
+    // of 0 stops computing frames. Thread-safe.
+    void setFilters(int melCount, const std::vector<float> &filters);
+
+    // Called on the stream's thread, in the processor's order. begin() starts
+    // over with the utterance whose audio (so far) starts at capture position
+    // start, append() adds the audio that follows, end() drops it all.
+    void begin(quint64 start, std::vector<float> samples);
+    void append(const std::vector<float> &samples);
+    void end();
+
+    // Copies (appends to frames, frame-major, raw log10) the frames of the
+    // utterance whose audio starts at capture position start, beginning with
+    // its frame firstFrame and up to the last one lying wholly inside the
+    // sampleCount samples. Stops at the first frame not computed yet, and
+    // copies nothing unless the stream's audio matches the utterance's.
+    // Returns the number of frames copied. Thread-safe.
+    size_t copyFrames(quint64 start, const float *audio, size_t sampleCount, size_t firstFrame,
+                      std::vector<float> &frames) const;
+
+private:
+    void computeFrames();
+    void dropOldest();
+    void clear(quint64 start);
+
+    mutable QMutex m_mutex;
+    StreamingMel m_mel;              // Used for its per-frame computation
+    int m_melCount;                  // 0 = stopped
+    bool m_active;                   // Between begin() and end()
+
+    std::vector<float> m_samples;    // The utterance's audio (its most recent minute)...
+    quint64 m_sampleBase;            // ...starting at this capture position
+    std::vector<float> m_frames;     // Computed frames, frame-major...
+    quint64 m_frameBase;             // ...starting with this frame of the grid
+};
+
+#endif // MELSTREAM_H
@@ -7,12 +7,15 @@
 #include <QMessageBox>
 #include <QDebug>
 #include <QFileInfo>
+#include <QRegularExpression>
+#include <QUrl>
 
 ModelDownloader::ModelDownloader(QObject *parent)
     : QObject(parent)
     , m_currentReply(nullptr)
     , m_progressDialog(nullptr)
     , m_outputFile(nullptr)
+    , m_hash(QCryptographicHash::Sha256)
 {
     m_networkManager = std::make_unique<QNetworkAccessManager>(this);
 }
@@ -49,6 +52,7 @@ void ModelDownloader::downloadModel(const QString &modelName, QWidget *parentWid
         emit downloadFailed(modelName, "Invalid model name or URL not found");
         return;
     }
+    m_expectedSha256 = WhisperModels::modelInfo(modelName).sha256;
     
     // Create progress dialog
     m_progressDialog = new QProgressDialog(parentWidget);
@@ -71,62 +75,70 @@ void ModelDownloader::downloadModel(const QString &modelName, QWidget *parentWid
 
 void ModelDownloader::cancelDownload()
 {
+    // Aborting normally finishes the reply at once and its handler cleans up;
+    // whatever is left (a reply that had already finished) is done here
     if (m_currentReply) {
         m_currentReply->abort();
     }
+    if (m_outputFile) {
+        m_outputFile->close();
+        m_outputFile->remove();
+    }
     cleanup();
 }
 
 QString ModelDownloader::getModelUrl(const QString &modelName)
 {
-    // Hugging Face URLs for Whisper models
-    QString baseUrl = "https://huggingface.co/ggerganov/whisper.cpp/resolve/main/";
-    QString fileName = QString("ggml-%1.bin").arg(modelName);
-    
-    // Map model names to their file names on Hugging Face
-    QMap<QString, QString> modelMap;
-    modelMap["tiny.en"] = "ggml-tiny.en.bin";
-    modelMap["tiny"] = "ggml-tiny.bin";
-    modelMap["base.en"] = "ggml-base.en.bin";
-    modelMap["base"] = "ggml-base.bin";
-    modelMap["small.en"] = "ggml-small.en.bin";
-    modelMap["small"] = "ggml-small.bin";
-    modelMap["medium.en"] = "ggml-medium.en.bin";
-    modelMap["medium"] = "ggml-medium.bin";
-    modelMap["large-v1"] = "ggml-large-v1.bin";
-    modelMap["large-v2"] = "ggml-large-v2.bin";
-    modelMap["large-v3"] = "ggml-large-v3.bin";
-    modelMap["turbo"] = "ggml-large-v3-turbo.bin";
-    
-    if (modelMap.contains(modelName)) {
-        return baseUrl + modelMap[modelName];
-    }
-    
-    return QString();
+    // Download locations come from the model manifest
+    return WhisperModels::modelInfo(modelName).url;
 }
 
 qint64 ModelDownloader::getModelSize(const QString &modelName)
 {
-    // Return approximate model sizes in bytes
-    if (modelName.contains("tiny")) {
-        return 39 * 1024 * 1024;  // 39 MB
-    } else if (modelName.contains("base")) {
-        return 74 * 1024 * 1024;  // 74 MB
-    } else if (modelName.contains("small")) {
-        return 244 * 1024 * 1024;  // 244 MB
-    } else if (modelName.contains("medium")) {
-        return 769 * 1024 * 1024;  // 769 MB
-    } else if (modelName.contains("large")) {
-        return 1550 * 1024 * 1024;  // 1550 MB
-    } else if (modelName.contains("turbo")) {
-        return 809 * 1024 * 1024;  // 809 MB
-    }
-    return 100 * 1024 * 1024;  // Default 100 MB
+    // Approximate download size in bytes
+    return WhisperModels::modelInfo(modelName).size;
 }
 
 void ModelDownloader::startDownload(const QString &url, const QString &destinationPath)
 {
-    // Create the output file
+    // Without a digest in the manifest, check against the one Hugging Face
+    // publishes: the redirect from a /resolve/ URL of an LFS file carries its
+    // SHA-256 as X-Linked-Etag
+    if (!m_expectedSha256.isEmpty() || !QUrl(url).host().endsWith("huggingface.co")) {
+        startTransfer(url, destinationPath);
+        return;
+    }
+    
+    QNetworkRequest request(url);
+    request.setRawHeader("User-Agent", "QWhisper/1.0");
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::ManualRedirectPolicy);
+    m_currentReply = m_networkManager->head(request);
+    connect(m_currentReply, &QNetworkReply::finished, this, [this, url, destinationPath]() {
+        if (m_currentReply->error() == QNetworkReply::OperationCanceledError) {
+            cleanup();
+            return;
+        }
+        QNetworkReply *reply = m_currentReply;
+        m_currentReply = nullptr;
+        reply->deleteLater();
+        
+        static const QRegularExpression digestPattern("^[0-9a-f]{64}$");
+        const QString etag = QString::fromLatin1(reply->rawHeader("X-Linked-Etag")).remove('"').toLower();
+        if (digestPattern.match(etag).hasMatch()) {
+            m_expectedSha256 = etag;
+            qDebug() << "Checking" << m_currentModelName << "against the published SHA-256" << etag;
+        } else {
+            qDebug() << "No published SHA-256 for" << m_currentModelName << "- not verifying the download";
+        }
+        startTransfer(url, destinationPath);
+    });
+}
+
+void ModelDownloader::startTransfer(const QString &url, const QString &destinationPath)
+{
+    // Create the output file; the digest is computed as the data arrives so a
+    // multi-gigabyte model doesn't have to be read back afterwards
+    m_hash.reset();
     m_outputFile = new QFile(destinationPath);
     if (!m_outputFile->open(QIODevice::WriteOnly)) {
         QString error = QString("Failed to create file: %1").arg(destinationPath);
@@ -154,7 +166,9 @@ void ModelDownloader::startDownload(const QString &url, const QString &destinati
     connect(m_currentReply, &QNetworkReply::readyRead,
             this, [this]() {
                 if (m_outputFile && m_currentReply) {
-                    m_outputFile->write(m_currentReply->readAll());
+                    const QByteArray data = m_currentReply->readAll();
+                    m_hash.addData(data);
+                    m_outputFile->write(data);
                 }
             });
 }
@@ -183,8 +197,33 @@ void ModelDownloader::onDownloadFinished()
     if (!m_currentReply) {
         return;
     }
+    if (m_currentReply->error() == QNetworkReply::OperationCanceledError) {
+        // Canceled: whoever canceled reports it
+        if (m_outputFile) {
+            m_outputFile->close();
+            m_outputFile->remove();
+        }
+        cleanup();
+        return;
+    }
     
-    if (m_currentReply->error() == QNetworkReply::NoError) {
+    // A download that doesn't match the manifest's digest is as good as a failed one
+    QString checksumError;
+    if (m_currentReply->error() == QNetworkReply::NoError && !m_expectedSha256.isEmpty()) {
+        const QByteArray remaining = m_currentReply->readAll();
+        if (m_outputFile && !remaining.isEmpty()) {
+            m_hash.addData(remaining);
+            m_outputFile->write(remaining);
+        }
+        const QString actual = QString::fromLatin1(m_hash.result().toHex());
+        if (actual != m_expectedSha256) {
+            checksumError = QString("Checksum mismatch: expected SHA-256 %1, got %2")
+                                .arg(m_expectedSha256, actual);
+            qDebug() << m_currentModelName << checksumError;
+        }
+    }
+    
+    if (m_currentReply->error() == QNetworkReply::NoError && checksumError.isEmpty()) {
         // Download successful
         if (m_outputFile) {
             m_outputFile->flush();
@@ -207,7 +246,7 @@ void ModelDownloader::onDownloadFinished()
         }
     } else {
         // Download failed
-        QString error = m_currentReply->errorString();
+        QString error = checksumError.isEmpty() ? m_currentReply->errorString() : checksumError;
         emit downloadFailed(m_currentModelName, error);
         
         // Delete the incomplete file
@@ -236,16 +275,10 @@ void ModelDownloader::onDownloadError(QNetworkReply::NetworkError error)
 
 void ModelDownloader::onProgressDialogCanceled()
 {
+    // cancelDownload() clears the name and deletes the incomplete file
+    const QString modelName = m_currentModelName;
     cancelDownload();
-    
-    // Delete the incomplete file
-    if (m_outputFile && m_outputFile->isOpen()) {
-        QString path = m_outputFile->fileName();
-        m_outputFile->close();
-        QFile::remove(path);
-    }
-    
-    emit downloadFailed(m_currentModelName, "Download canceled by user");
+    emit downloadFailed(modelName, "Download canceled by user");
 }
 
 void ModelDownloader::cleanup()
@@ -272,4 +305,5 @@ void ModelDownloader::cleanup()
     
     m_currentModelName.clear();
     m_destinationPath.clear();
+    m_expectedSha256.clear();
 }
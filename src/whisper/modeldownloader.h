@@ -6,6 +6,7 @@
 #include <QNetworkReply>
 #include <QString>
 #include <QFile>
+#include <QCryptographicHash>
 #include <memory>
 
 class QProgressDialog;
@@ -38,6 +39,7 @@ private slots:
 
 private:
     void startDownload(const QString &url, const QString &destinationPath);
+    void startTransfer(const QString &url, const QString &destinationPath);
     void cleanup();
     
     std::unique_ptr<QNetworkAccessManager> m_networkManager;
@@ -46,6 +48,8 @@ private:
     QString m_destinationPath;
     QProgressDialog *m_progressDialog;
     QFile *m_outputFile;
+    QCryptographicHash m_hash;    // SHA-256 of the bytes written so far
+    QString m_expectedSha256;
 };
 
 #endif // MODELDOWNLOADER_H
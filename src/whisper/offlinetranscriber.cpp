@@ -0,0 +1,639 @@
+#include "offlinetranscriber.h"
+#include "whisperprocessor.h"
+#include "whispermodels.h"
+#include "sharedmodel.h"
+#include "transcriptcache.h"
+#include "../config/audioconfiguration.h"
+#ifdef QWHISPER_HAVE_QTMULTIMEDIA
+#include <QAudioDecoder>
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#else
+#include <QProcess>
+#endif
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QUrl>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+extern "C" {
+#include "include/whisper.h"
+}
+
+namespace {
+constexpr int kSampleRate = 16000;
+constexpr int kFrameSamples = kSampleRate / 50;   // 20 ms analysis frames
+constexpr int kMinChunkMs = 5000;                 // Don't cut shorter chunks than this to find a pause
+
+// Move chunk-relative segment and word times to where the chunk starts
+void shiftSegments(QList<TranscriptionSegment> &segments, qint64 offset)
+{
+    for (TranscriptionSegment &segment : segments) {
+        segment.startTime += offset;
+        segment.endTime += offset;
+        for (TranscriptionWord &word : segment.words) {
+            word.startTime += offset;
+            word.endTime += offset;
+        }
+    }
+}
+}
+
+OfflineTranscriber::OfflineTranscriber(QObject *parent)
+    : QObject(parent)
+    , m_loadedDeviceType(0)
+    , m_computeDeviceType(0)
+    , m_computeDeviceId(-1)
+    , m_wordTimestamps(false)
+    , m_parallelDecodes(0)
+    , m_threadBudget(0)
+    , m_profile(DecodingProfile::preset("balanced"))
+    , m_maxChunkMs(28000)
+    , m_abort(false)
+{
+}
+
+OfflineTranscriber::~OfflineTranscriber()
+{
+    releaseModel();
+}
+
+void OfflineTranscriber::requestAbort()
+{
+    m_abort.store(true);
+}
+
+void OfflineTranscriber::updateConfiguration(const AudioConfiguration &config)
+{
+    m_modelName = config.model;
+    m_language = config.language;
+    m_computeDeviceType = config.computeDeviceType;
+    m_computeDeviceId = config.computeDeviceId;
+    m_wordTimestamps = config.wordTimestamps;
+    m_parallelDecodes = config.offlineParallelDecodes;
+    m_profile = DecodingProfile::fromConfiguration(config);
+
+    // Stay inside the 30 s window, and inside what distilled models handle well
+    const int modelLimit = WhisperModels::modelInfo(config.model).maxChunkSeconds * 1000;
+    m_maxChunkMs = modelLimit > 0 ? std::min(modelLimit, 28000) : 28000;
+
+    const qint64 cacheBytes = static_cast<qint64>(config.transcriptCacheMB) * 1024 * 1024;
+    if (cacheBytes <= 0) {
+        m_cache.reset();
+    } else if (!m_cache || m_cache->maxBytes() != cacheBytes) {
+        m_cache = std::make_unique<TranscriptCache>(TranscriptCache::defaultDirectory(), cacheBytes);
+    }
+}
+
+void OfflineTranscriber::setThreadBudget(int threads)
+{
+    m_threadBudget = threads;
+}
+
+qint64 OfflineTranscriber::recordingStart(const QString &path, double audioSeconds)
+{
+    return QFileInfo(path).lastModified().toMSecsSinceEpoch() - static_cast<qint64>(audioSeconds * 1000);
+}
+
+bool OfflineTranscriber::loadModel()
+{
+    if (m_context && m_loadedModel == m_modelName && m_loadedDeviceType == m_computeDeviceType) {
+        return true;
+    }
+    releaseModel();
+
+    QString modelPath = WhisperProcessor::getModelPath(m_modelName);
+    if (modelPath.isEmpty() || !QFile::exists(modelPath)) {
+        return false;
+    }
+
+    // Batch workers, the live processor and the streaming server all decode
+    // on the same weights when they use the same model
+    m_context = SharedModel::acquire(modelPath, m_computeDeviceType, m_computeDeviceId);
+    if (!m_context) {
+        return false;
+    }
+    m_loadedModel = m_modelName;
+    m_loadedDeviceType = m_computeDeviceType;
+    return true;
+}
+
+void OfflineTranscriber::releaseModel()
+{
+    m_context.reset();
+    m_loadedModel.clear();
+}
+
+bool OfflineTranscriber::abortCallback(void *userData)
+{
+    return static_cast<const OfflineTranscriber*>(userData)->m_abort.load();
+}
+
+QByteArray OfflineTranscriber::cacheParams(const QByteArray &languageCode) const
+{
+    // Everything set on whisper_full_params below that changes the output
+    return QString("v1;lang=%1;words=%2;beam=%3/%4;bestOf=%5;fallback=%6;entropy=%7;logprob=%8;maxTokens=%9")
+        .arg(QString::fromLatin1(languageCode))
+        .arg(static_cast<int>(m_wordTimestamps))
+        .arg(static_cast<int>(m_profile.beamSearch))
+        .arg(m_profile.beamSize)
+        .arg(m_profile.bestOf)
+        .arg(static_cast<int>(m_profile.temperatureFallback))
+        .arg(m_profile.entropyThreshold)
+        .arg(m_profile.logprobThreshold)
+        .arg(m_profile.maxTokensPerSegment)
+        .toUtf8();
+}
+
+void OfflineTranscriber::transcribeFile(const QString &path)
+{
+    m_abort.store(false);
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString name = QFileInfo(path).fileName();
+    emit statusChanged(QString("Reading %1").arg(name));
+
+    std::vector<float> samples;
+    QString error;
+    if (!loadAudio(path, samples, &error)) {
+        emit fileFailed(path, error);
+        return;
+    }
+
+    if (!loadModel()) {
+        emit fileFailed(path, QString("Cannot load model %1").arg(m_modelName));
+        return;
+    }
+
+    const std::vector<Chunk> chunks = splitOnPauses(samples, m_maxChunkMs);
+    const double audioSeconds = static_cast<double>(samples.size()) / kSampleRate;
+
+    const qint64 fileStart = recordingStart(path, audioSeconds);
+
+    // Each worker owns a whisper state (KV cache, mel buffer, results) and pulls
+    // the next chunk when it is free. Threads are split between the workers so
+    // they don't oversubscribe the cores; on a GPU two states are enough to keep
+    // it busy while the other one is on the CPU side of a decode.
+    const int cores = m_threadBudget > 0 ? m_threadBudget : std::max(1, QThread::idealThreadCount());
+    int workers = m_parallelDecodes > 0 ? m_parallelDecodes
+                : m_computeDeviceType == 1 ? 2
+                : std::clamp(cores / 4, 1, 4);
+    workers = std::max(1, std::min(workers, static_cast<int>(chunks.size())));
+    const int threadsPerWorker = std::max(1, cores / workers);
+
+    qDebug() << "Offline transcription of" << path << "-" << audioSeconds << "s in" << chunks.size()
+             << "chunks," << workers << "workers x" << threadsPerWorker << "threads";
+    emit statusChanged(QString("Transcribing %1 (%2 chunks)").arg(name).arg(chunks.size()));
+
+    std::vector<QList<TranscriptionSegment>> results(chunks.size());
+    std::atomic<size_t> nextChunk(0);
+    std::atomic<int> chunksDone(0);
+    std::atomic<int> failures(0);
+    std::atomic<int> cacheHits(0);
+    const QByteArray languageCode = whisper_is_multilingual(m_context.get()) ? m_language.toLatin1() : QByteArray("en");
+    const QString modelIdentity = m_cache
+        ? TranscriptCache::modelIdentity(m_modelName, WhisperProcessor::getModelPath(m_modelName)) : QString();
+    const QByteArray cacheKeyParams = cacheParams(languageCode);
+
+    auto worker = [&]() {
+        whisper_state *state = whisper_init_state(m_context.get());
+        if (!state) {
+            failures++;
+            return;
+        }
+
+        whisper_full_params wparams = whisper_full_default_params(
+            static_cast<whisper_sampling_strategy>(m_profile.whisperStrategy()));
+        m_profile.applyTo(wparams);
+        wparams.print_progress = false;
+        wparams.print_special = false;
+        wparams.print_realtime = false;
+        wparams.print_timestamps = false;
+        wparams.single_segment = false;
+        // Chunks are decoded out of order, so there is no previous text to carry over
+        wparams.no_context = true;
+        wparams.n_threads = threadsPerWorker;
+        wparams.token_timestamps = m_wordTimestamps;
+        wparams.suppress_blank = true;
+        wparams.language = languageCode.constData();
+        wparams.abort_callback = &OfflineTranscriber::abortCallback;
+        wparams.abort_callback_user_data = this;
+
+        for (size_t index = nextChunk++; index < chunks.size() && !m_abort.load(); index = nextChunk++) {
+            const Chunk &chunk = chunks[index];
+            const qint64 chunkStart = fileStart + static_cast<qint64>(chunk.start) * 1000 / kSampleRate;
+            QList<TranscriptionSegment> &segments = results[index];
+
+            // Cached entries hold times relative to the chunk
+            QByteArray key;
+            if (m_cache) {
+                key = TranscriptCache::key(samples.data() + chunk.start, chunk.length, modelIdentity, cacheKeyParams);
+                if (m_cache->lookup(key, segments)) {
+                    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+                    for (TranscriptionSegment &segment : segments) {
+                        segment.timestamp = now;
+                    }
+                    shiftSegments(segments, chunkStart);
+                    cacheHits++;
+                    emit progress(path, ++chunksDone, static_cast<int>(chunks.size()));
+                    continue;
+                }
+            }
+
+            if (whisper_full_with_state(m_context.get(), state, wparams, samples.data() + chunk.start,
+                                        static_cast<int>(chunk.length)) != 0) {
+                if (!m_abort.load()) {
+                    qDebug() << "Offline decode failed for chunk" << index;
+                    failures++;
+                }
+                continue;
+            }
+
+            QList<TranscriptionSegment> relative;
+            for (int i = 0; i < whisper_full_n_segments_from_state(state); ++i) {
+                const QString text = QString::fromUtf8(whisper_full_get_segment_text_from_state(state, i)).trimmed();
+                if (text.isEmpty() || text == "[BLANK_AUDIO]") {
+                    continue;
+                }
+
+                TranscriptionSegment segment;
+                segment.text = text;
+                segment.timestamp = QDateTime::currentMSecsSinceEpoch();
+                segment.startTime = whisper_full_get_segment_t0_from_state(state, i) * 10;
+                segment.endTime = whisper_full_get_segment_t1_from_state(state, i) * 10;
+                segment.noSpeechProb = whisper_full_get_segment_no_speech_prob_from_state(state, i);
+                if (m_wordTimestamps) {
+                    segment.words = WhisperProcessor::collectWords(m_context.get(), state, i, 0);
+                }
+                relative.append(segment);
+            }
+            if (m_cache) {
+                m_cache->store(key, relative);
+            }
+
+            shiftSegments(relative, chunkStart);
+            segments = relative;
+
+            emit progress(path, ++chunksDone, static_cast<int>(chunks.size()));
+        }
+
+        whisper_free_state(state);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < workers; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    if (m_abort.load()) {
+        emit fileFailed(path, "Canceled");
+        return;
+    }
+    if (failures.load() > 0) {
+        emit fileFailed(path, QString("%1 of %2 chunks failed to decode").arg(failures.load()).arg(chunks.size()));
+        return;
+    }
+
+    // Stitch the chunks back together in audio order
+    QList<TranscriptionSegment> transcript;
+    for (const QList<TranscriptionSegment> &segments : results) {
+        transcript += segments;
+    }
+    for (const TranscriptionSegment &segment : transcript) {
+        emit segmentTranscribed(segment);
+    }
+
+    const double elapsedSeconds = timer.elapsed() / 1000.0;
+    const double speed = elapsedSeconds > 0.0 ? audioSeconds / elapsedSeconds : 0.0;
+    qDebug() << "Offline transcription of" << path << "done:" << audioSeconds << "s of audio in"
+             << elapsedSeconds << "s (" << speed << "x real time)," << cacheHits.load() << "of"
+             << chunks.size() << "chunks from the cache";
+    emit fileFinished(path, transcript, audioSeconds, elapsedSeconds);
+}
+
+std::vector<OfflineTranscriber::Chunk> OfflineTranscriber::splitOnPauses(const std::vector<float> &samples,
+                                                                        int maxChunkMs)
+{
+    std::vector<Chunk> chunks;
+    const size_t nFrames = (samples.size() + kFrameSamples - 1) / kFrameSamples;
+    if (nFrames == 0) {
+        return chunks;
+    }
+
+    // Mean absolute amplitude per frame
+    std::vector<float> levels(nFrames, 0.0f);
+    for (size_t f = 0; f < nFrames; ++f) {
+        const size_t begin = f * kFrameSamples;
+        const size_t end = std::min(samples.size(), begin + kFrameSamples);
+        float sum = 0.0f;
+        for (size_t i = begin; i < end; ++i) {
+            sum += std::fabs(samples[i]);
+        }
+        levels[f] = sum / (end - begin);
+    }
+
+    // Quiet means close to the recording's own noise floor (its 10th percentile)
+    std::vector<float> sorted(levels);
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 10, sorted.end());
+    const float threshold = std::max(0.003f, sorted[sorted.size() / 10] * 2.5f);
+
+    const size_t maxFrames = std::max<size_t>(1, static_cast<size_t>(maxChunkMs) / 20);
+    const size_t minFrames = std::min(maxFrames, static_cast<size_t>(kMinChunkMs / 20));
+
+    size_t start = 0;
+    while (start < nFrames) {
+        size_t end = std::min(start + maxFrames, nFrames);
+
+        if (end < nFrames) {
+            // Cut in the middle of the longest quiet run past the minimum length;
+            // with no pause at all, at the quietest frame
+            size_t bestRun = 0;
+            size_t bestCut = end;
+            size_t runStart = 0;
+            size_t runLength = 0;
+            size_t quietest = start + minFrames;
+            for (size_t f = start + minFrames; f < end; ++f) {
+                if (levels[f] < levels[quietest]) {
+                    quietest = f;
+                }
+                if (levels[f] < threshold) {
+                    if (runLength++ == 0) {
+                        runStart = f;
+                    }
+                    if (runLength >= bestRun) {
+                        bestRun = runLength;
+                        bestCut = runStart + runLength / 2;
+                    }
+                } else {
+                    runLength = 0;
+                }
+            }
+            end = bestRun > 0 ? bestCut : quietest;
+            end = std::max(end, start + 1);
+        }
+
+        const bool hasSound = std::any_of(levels.begin() + start, levels.begin() + end,
+                                          [threshold](float level) { return level >= threshold; });
+        if (hasSound) {
+            const size_t first = start * kFrameSamples;
+            const size_t last = std::min(samples.size(), end * kFrameSamples);
+            chunks.push_back({first, last - first});
+        }
+        start = end;
+    }
+    return chunks;
+}
+
+bool OfflineTranscriber::loadAudio(const QString &path, std::vector<float> &samples, QString *error)
+{
+    samples.clear();
+    if (!QFile::exists(path)) {
+        if (error) {
+            *error = QString("File not found: %1").arg(path);
+        }
+        return false;
+    }
+
+    // WAV needs no codec; anything else (or a WAV encoding the reader doesn't
+    // know) goes through the multimedia backend
+    if (path.endsWith(".wav", Qt::CaseInsensitive) && readWav(path, samples, error)) {
+        return true;
+    }
+    return decodeCompressed(path, samples, error);
+}
+
+bool OfflineTranscriber::readWav(const QString &path, std::vector<float> &samples, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+
+    // Map rather than read: hours of 48 kHz audio are hundreds of MB
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    if (!data || size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    int formatTag = 0;
+    int channels = 0;
+    int sampleRate = 0;
+    int bitsPerSample = 0;
+    const uchar *pcm = nullptr;
+    qint64 pcmBytes = 0;
+
+    qint64 offset = 12;
+    while (offset + 8 <= size) {
+        const uchar *chunk = data + offset;
+        const qint64 chunkSize = qFromLittleEndian<quint32>(chunk + 4);
+        const qint64 available = std::min(chunkSize, size - offset - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            formatTag = qFromLittleEndian<quint16>(chunk + 8);
+            channels = qFromLittleEndian<quint16>(chunk + 10);
+            sampleRate = static_cast<int>(qFromLittleEndian<quint32>(chunk + 12));
+            bitsPerSample = qFromLittleEndian<quint16>(chunk + 22);
+            // WAVE_FORMAT_EXTENSIBLE keeps the real format in its sub-format GUID
+            if (formatTag == 0xFFFE && available >= 26) {
+                formatTag = qFromLittleEndian<quint16>(chunk + 32);
+            }
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            pcm = chunk + 8;
+            pcmBytes = available;
+            break;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    const bool pcmInt = formatTag == 1 && (bitsPerSample == 8 || bitsPerSample == 16 ||
+                                           bitsPerSample == 24 || bitsPerSample == 32);
+    const bool pcmFloat = formatTag == 3 && bitsPerSample == 32;
+    if (!pcm || channels <= 0 || sampleRate <= 0 || !(pcmInt || pcmFloat)) {
+        return false;
+    }
+
+    const int bytesPerSample = bitsPerSample / 8;
+    const qint64 frames = pcmBytes / (bytesPerSample * channels);
+    samples.resize(static_cast<size_t>(frames));
+
+    // Mix down to mono while converting
+    for (qint64 frame = 0; frame < frames; ++frame) {
+        const uchar *p = pcm + frame * bytesPerSample * channels;
+        float sum = 0.0f;
+        for (int c = 0; c < channels; ++c, p += bytesPerSample) {
+            if (pcmFloat) {
+                const quint32 bits = qFromLittleEndian<quint32>(p);
+                float value;
+                std::memcpy(&value, &bits, sizeof(value));
+                sum += value;
+            } else if (bitsPerSample == 8) {
+                sum += (static_cast<int>(*p) - 128) / 128.0f;
+            } else if (bitsPerSample == 16) {
+                sum += qFromLittleEndian<qint16>(p) / 32768.0f;
+            } else if (bitsPerSample == 24) {
+                // Shift into the top of an int32 so the sign comes along
+                const qint32 value = static_cast<qint32>((static_cast<quint32>(p[0]) << 8) |
+                                                         (static_cast<quint32>(p[1]) << 16) |
+                                                         (static_cast<quint32>(p[2]) << 24)) >> 8;
+                sum += value / 8388608.0f;
+            } else {
+                sum += qFromLittleEndian<qint32>(p) / 2147483648.0f;
+            }
+        }
+        samples[static_cast<size_t>(frame)] = sum / channels;
+    }
+
+    resampleTo16k(samples, sampleRate);
+    return true;
+}
+
+#ifdef QWHISPER_HAVE_QTMULTIMEDIA
+bool OfflineTranscriber::decodeCompressed(const QString &path, std::vector<float> &samples, QString *error)
+{
+    // Ask for Whisper's format; backends that can't convert hand back their own
+    QAudioFormat format;
+    format.setSampleRate(kSampleRate);
+    format.setChannelCount(1);
+    format.setSampleFormat(QAudioFormat::Float);
+
+    QAudioDecoder decoder;
+    decoder.setAudioFormat(format);
+    decoder.setSource(QUrl::fromLocalFile(path));
+
+    QEventLoop loop;
+    QString decodeError;
+    int sourceRate = 0;
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&]() {
+        const QAudioBuffer buffer = decoder.read();
+        const QAudioFormat bufferFormat = buffer.format();
+        const int channels = bufferFormat.channelCount();
+        const int bytesPerSample = bufferFormat.bytesPerSample();
+        if (!buffer.isValid() || channels <= 0 || bytesPerSample <= 0) {
+            return;
+        }
+        sourceRate = bufferFormat.sampleRate();
+
+        const char *data = buffer.constData<char>();
+        for (qsizetype frame = 0; frame < buffer.frameCount(); ++frame) {
+            float sum = 0.0f;
+            for (int c = 0; c < channels; ++c) {
+                sum += bufferFormat.normalizedSampleValue(data + (frame * channels + c) * bytesPerSample);
+            }
+            samples.push_back(sum / channels);
+        }
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), &loop,
+                     [&](QAudioDecoder::Error) {
+                         decodeError = decoder.errorString();
+                         loop.quit();
+                     });
+
+    decoder.start();
+    loop.exec();
+
+    if (!decodeError.isEmpty() || samples.empty()) {
+        if (error) {
+            *error = decodeError.isEmpty() ? QString("No audio decoded from %1").arg(path) : decodeError;
+        }
+        samples.clear();
+        return false;
+    }
+
+    resampleTo16k(samples, sourceRate);
+    return true;
+}
+#else
+bool OfflineTranscriber::decodeCompressed(const QString &path, std::vector<float> &samples, QString *error)
+{
+    // Without Qt Multimedia, ffmpeg converts to Whisper's format (and resamples)
+    QProcess ffmpeg;
+    ffmpeg.start("ffmpeg", {"-nostdin", "-v", "error", "-i", path,
+                            "-f", "f32le", "-ac", "1", "-ar", QString::number(kSampleRate), "-"});
+    if (!ffmpeg.waitForStarted()) {
+        if (error) {
+            *error = QString("Cannot decode %1: ffmpeg is not installed").arg(path);
+        }
+        return false;
+    }
+    ffmpeg.waitForFinished(-1);
+
+    const QByteArray pcm = ffmpeg.readAllStandardOutput();
+    if (ffmpeg.exitStatus() != QProcess::NormalExit || ffmpeg.exitCode() != 0 || pcm.size() < 4) {
+        if (error) {
+            const QString message = QString::fromLocal8Bit(ffmpeg.readAllStandardError()).trimmed();
+            *error = message.isEmpty() ? QString("No audio decoded from %1").arg(path) : message;
+        }
+        return false;
+    }
+
+    samples.resize(pcm.size() / sizeof(float));
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = qFromLittleEndian<float>(pcm.constData() + i * sizeof(float));
+    }
+    return true;
+}
+#endif
+
+void OfflineTranscriber::resampleTo16k(std::vector<float> &samples, int sampleRate)
+{
+    if (sampleRate <= 0 || sampleRate == kSampleRate || samples.empty()) {
+        return;
+    }
+
+    // Windowed-sinc interpolation: every output sample is the input seen through
+    // a Blackman-windowed low-pass just under the lower of the two Nyquist
+    // frequencies, so nothing above 8 kHz folds back into the speech band. The
+    // kernel is tabulated kPhases times per input sample and interpolated.
+    constexpr int kZeroCrossings = 16;   // On each side of the kernel's centre
+    constexpr int kPhases = 256;
+    const double step = static_cast<double>(sampleRate) / kSampleRate;
+    const double cutoff = 0.95 * std::min(1.0, 1.0 / step);   // Of the input's Nyquist frequency
+    const double halfWidth = kZeroCrossings / cutoff;          // In input samples
+
+    std::vector<float> kernel(static_cast<size_t>(std::ceil(halfWidth * kPhases)) + 2, 0.0f);
+    for (size_t i = 0; i < kernel.size(); ++i) {
+        const double t = static_cast<double>(i) / kPhases;
+        if (t >= halfWidth) {
+            break;
+        }
+        const double x = M_PI * cutoff * t;
+        const double sinc = x == 0.0 ? 1.0 : std::sin(x) / x;
+        const double window = 0.42 + 0.5 * std::cos(M_PI * t / halfWidth) + 0.08 * std::cos(2.0 * M_PI * t / halfWidth);
+        kernel[i] = static_cast<float>(cutoff * sinc * window);
+    }
+
+    std::vector<float> output(static_cast<size_t>(samples.size() / step));
+    const long last = static_cast<long>(samples.size()) - 1;
+    for (size_t i = 0; i < output.size(); ++i) {
+        const double position = i * step;
+        const long first = std::max(0L, static_cast<long>(std::ceil(position - halfWidth)));
+        const long end = std::min(last, static_cast<long>(std::floor(position + halfWidth)));
+        double sum = 0.0;
+        for (long j = first; j <= end; ++j) {
+            const double phase = std::abs(position - j) * kPhases;
+            const size_t index = static_cast<size_t>(phase);
+            const float fraction = static_cast<float>(phase - index);
+            sum += samples[j] * (kernel[index] + (kernel[index + 1] - kernel[index]) * fraction);
+        }
+        output[i] = static_cast<float>(sum);
+    }
+    samples.swap(output);
+}
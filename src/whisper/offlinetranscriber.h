@@ -0,0 +1,95 @@
+#ifndef OFFLINETRANSCRIBER_H
+#define OFFLINETRANSCRIBER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "transcriptionsegment.h"
+#include "decodingprofile.h"
+
+struct AudioConfiguration;
+struct whisper_context;
+class TranscriptCache;
+
+// Transcribes recordings from disk instead of live capture. The file is decoded
+// to 16 kHz mono, cut into chunks at pauses, and the chunks are decoded in
+// parallel on a pool of whisper states sharing one copy of the model weights;
+// the results are put back in order. Chunks decoded before with the same model
+// and settings come from the transcript cache. Meant to live on its own thread.
+class OfflineTranscriber : public QObject
+{
+    Q_OBJECT
+
+public:
+    // A run of samples decoded in one whisper_full call
+    struct Chunk {
+        size_t start;
+        size_t length;
+    };
+
+    explicit OfflineTranscriber(QObject *parent = nullptr);
+    ~OfflineTranscriber();
+
+    // Cancel the file in progress. Thread-safe.
+    void requestAbort();
+
+    // Read a recording as 16 kHz mono samples. WAV is parsed directly; other
+    // formats (FLAC, MP3, ...) go through QAudioDecoder, which needs an event
+    // loop, or through ffmpeg in the headless build.
+    static bool loadAudio(const QString &path, std::vector<float> &samples, QString *error = nullptr);
+
+    // Cut audio into chunks of at most maxChunkMs, ending each in the longest
+    // pause available; chunks without any sound are left out
+    static std::vector<Chunk> splitOnPauses(const std::vector<float> &samples, int maxChunkMs);
+
+    // Wall-clock time segment times are based on: the recording is assumed to
+    // have started its length before the file was last written
+    static qint64 recordingStart(const QString &path, double audioSeconds);
+
+public slots:
+    void updateConfiguration(const AudioConfiguration &config);
+    // Cores this transcriber may use (0 = all); lets several run side by side
+    void setThreadBudget(int threads);
+    void transcribeFile(const QString &path);
+
+signals:
+    // Emitted in audio order once the whole file is done
+    void segmentTranscribed(const TranscriptionSegment &segment);
+    void fileFinished(const QString &path, const QList<TranscriptionSegment> &segments,
+                      double audioSeconds, double elapsedSeconds);
+    void fileFailed(const QString &path, const QString &error);
+    void progress(const QString &path, int chunksDone, int chunksTotal);
+    void statusChanged(const QString &status);
+
+private:
+    bool loadModel();
+    void releaseModel();
+    static bool readWav(const QString &path, std::vector<float> &samples, QString *error);
+    static bool decodeCompressed(const QString &path, std::vector<float> &samples, QString *error);
+    static void resampleTo16k(std::vector<float> &samples, int sampleRate);
+    static bool abortCallback(void *userData);
+    QByteArray cacheParams(const QByteArray &languageCode) const;
+
+    std::shared_ptr<whisper_context> m_context;   // Shared weights; each worker brings its own state
+    QString m_loadedModel;
+    int m_loadedDeviceType;
+
+    QString m_modelName;
+    QString m_language;
+    int m_computeDeviceType;      // 0 = CPU, 1 = CUDA
+    int m_computeDeviceId;
+    bool m_wordTimestamps;
+    int m_parallelDecodes;        // 0 = pick from the core count
+    int m_threadBudget;           // 0 = every core
+    DecodingProfile m_profile;
+    int m_maxChunkMs;
+    std::unique_ptr<TranscriptCache> m_cache;   // Null when disabled
+
+    std::atomic<bool> m_abort;
+};
+
+#endif // OFFLINETRANSCRIBER_H
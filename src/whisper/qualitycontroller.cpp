@@ -0,0 +1,161 @@
+#include "qualitycontroller.h"
+#include "decodingprofile.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+
+namespace {
+// Weight of the newest decode in the smoothed real-time factor
+constexpr double kSmoothing = 0.3;
+}
+
+QualityController::QualityController()
+    : m_current(0)
+    , m_enabled(false)
+    , m_realTimeFactor(-1.0)
+    , m_calmDecodes(0)
+    , m_lastChange(0)
+    , m_degradeRealTimeFactor(1.0)   // Decoding slower than speech: the backlog can only grow
+    , m_degradeBacklog(3000)
+    , m_degradePressure(40.0)
+    , m_degradeDwell(10000)
+    , m_upgradeRealTimeFactor(0.3)   // Leaves room for a tier roughly 3x as expensive
+    , m_upgradeBacklog(500)
+    , m_upgradePressure(10.0)
+    , m_upgradeDwell(60000)
+    , m_calmDecodesNeeded(5)
+{
+}
+
+QList<QualityTier> QualityController::parseTiers(const QStringList &specs, const QString &defaultModel)
+{
+    QList<QualityTier> tiers;
+    for (const QString &spec : specs) {
+        const QStringList parts = spec.trimmed().split(':');
+        if (parts.isEmpty() || parts[0].isEmpty()) {
+            continue;
+        }
+        QualityTier tier;
+        tier.model = parts[0];
+        tier.profile = parts.size() > 1 && DecodingProfile::presetNames().contains(parts[1])
+                       ? parts[1] : QString("balanced");
+        tiers.append(tier);
+    }
+
+    if (tiers.isEmpty() && !defaultModel.isEmpty()) {
+        for (const QString &profile : {QString("fastest"), QString("balanced"), QString("accurate")}) {
+            tiers.append({defaultModel, profile});
+        }
+    }
+    return tiers;
+}
+
+void QualityController::setTiers(const QList<QualityTier> &tiers)
+{
+    m_tiers = tiers;
+    m_current = 0;
+    m_realTimeFactor = -1.0;
+    m_calmDecodes = 0;
+}
+
+void QualityController::selectTier(const QString &model, const QString &profile)
+{
+    int match = -1;
+    for (int i = 0; i < m_tiers.size(); ++i) {
+        if (m_tiers[i].model == model && (m_tiers[i].profile == profile || match < 0)) {
+            match = i;
+            if (m_tiers[i].profile == profile) {
+                break;
+            }
+        }
+    }
+    m_current = qMax(0, match);
+    m_realTimeFactor = -1.0;
+    m_calmDecodes = 0;
+    m_lastChange = QDateTime::currentMSecsSinceEpoch();
+}
+
+void QualityController::settle()
+{
+    m_realTimeFactor = -1.0;
+    m_calmDecodes = 0;
+    m_lastChange = QDateTime::currentMSecsSinceEpoch();
+}
+
+bool QualityController::update(double audioSeconds, qint64 decodeMs, qint64 backlogMs)
+{
+    if (!isEnabled()) {
+        return false;
+    }
+
+    if (decodeMs >= 0 && audioSeconds > 0.0) {
+        double factor = decodeMs / (audioSeconds * 1000.0);
+        m_realTimeFactor = m_realTimeFactor < 0.0
+                           ? factor : m_realTimeFactor + kSmoothing * (factor - m_realTimeFactor);
+    }
+    const double pressure = readCpuPressure();
+    const qint64 sinceChange = QDateTime::currentMSecsSinceEpoch() - m_lastChange;
+
+    QStringList overload;
+    if (m_realTimeFactor > m_degradeRealTimeFactor) {
+        overload << QString("real-time factor %1").arg(m_realTimeFactor, 0, 'f', 2);
+    }
+    if (backlogMs > m_degradeBacklog) {
+        overload << QString("%1 s backlog").arg(backlogMs / 1000.0, 0, 'f', 1);
+    }
+    if (pressure > m_degradePressure) {
+        overload << QString("CPU pressure %1%").arg(pressure, 0, 'f', 0);
+    }
+
+    if (!overload.isEmpty()) {
+        m_calmDecodes = 0;
+        if (m_current > 0 && sinceChange >= m_degradeDwell) {
+            return moveTo(m_current - 1, overload.join(", "));
+        }
+        return false;
+    }
+
+    const bool headroom = m_realTimeFactor >= 0.0 && m_realTimeFactor < m_upgradeRealTimeFactor &&
+                          backlogMs < m_upgradeBacklog && pressure < m_upgradePressure;
+    m_calmDecodes = headroom ? m_calmDecodes + 1 : 0;
+
+    if (m_calmDecodes >= m_calmDecodesNeeded && m_current + 1 < m_tiers.size() &&
+        sinceChange >= m_upgradeDwell) {
+        QString reason = QString("real-time factor %1").arg(m_realTimeFactor, 0, 'f', 2);
+        if (pressure >= 0.0) {
+            reason += QString(", CPU pressure %1%").arg(pressure, 0, 'f', 0);
+        }
+        return moveTo(m_current + 1, reason);
+    }
+    return false;
+}
+
+bool QualityController::moveTo(int tier, const QString &reason)
+{
+    qDebug() << "Quality tier" << m_tiers[m_current].toString() << "->" << m_tiers[tier].toString()
+             << "(" << reason << ")";
+
+    m_current = tier;
+    m_reason = reason;
+    settle();
+    return true;
+}
+
+double QualityController::readCpuPressure()
+{
+    // First line: "some avg10=1.23 avg60=0.80 avg300=0.40 total=123456"
+    QFile file("/proc/pressure/cpu");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1.0;
+    }
+
+    const QList<QByteArray> fields = file.readLine().trimmed().split(' ');
+    for (const QByteArray &field : fields) {
+        if (field.startsWith("avg10=")) {
+            bool ok = false;
+            double value = field.mid(6).toDouble(&ok);
+            return ok ? value : -1.0;
+        }
+    }
+    return -1.0;
+}
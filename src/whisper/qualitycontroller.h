@@ -0,0 +1,78 @@
+#ifndef QUALITYCONTROLLER_H
+#define QUALITYCONTROLLER_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+// One step on the quality ladder: a model and the decoding preset to run it with
+struct QualityTier {
+    QString model;
+    QString profile;   // DecodingProfile preset name
+
+    QString toString() const { return model + ":" + profile; }
+};
+
+// Moves the live decoder between configured quality tiers depending on how well
+// it keeps up: the real-time factor of recent decodes, how long chunks wait
+// before being decoded, and Linux CPU pressure (PSI). Overload steps down a tier
+// after a short dwell; headroom has to persist for several decodes and a much
+// longer dwell before it steps back up, so the tier doesn't oscillate.
+class QualityController
+{
+public:
+    QualityController();
+
+    // Parse "model:profile" entries, cheapest first. An empty list yields the
+    // given model with the fastest, balanced and accurate presets.
+    static QList<QualityTier> parseTiers(const QStringList &specs, const QString &defaultModel);
+
+    void setTiers(const QList<QualityTier> &tiers);
+    int tierCount() const { return m_tiers.size(); }
+    int currentTier() const { return m_current; }
+    const QualityTier &tier() const { return m_tiers.at(m_current); }
+
+    // Start from the tier matching the model and profile (or the first with the model)
+    void selectTier(const QString &model, const QString &profile);
+
+    // Feed one chunk: its length, the wall time the decode took (< 0 when it was
+    // dropped without decoding) and how long it waited for the decoder. Returns
+    // true when the controller moved to another tier; reason() says why.
+    bool update(double audioSeconds, qint64 decodeMs, qint64 backlogMs);
+    QString reason() const { return m_reason; }
+
+    // Start the dwell period over, e.g. after a slow model load
+    void settle();
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled && m_tiers.size() > 1; }
+
+    // "some avg10" of /proc/pressure/cpu in percent, or -1 when PSI isn't available
+    static double readCpuPressure();
+
+private:
+    bool moveTo(int tier, const QString &reason);
+
+    QList<QualityTier> m_tiers;
+    int m_current;
+    bool m_enabled;
+
+    double m_realTimeFactor;     // Smoothed decode time / audio time (-1 = no sample yet)
+    int m_calmDecodes;           // Consecutive decodes with headroom to spare
+    qint64 m_lastChange;         // Wall-clock ms of the last transition
+    QString m_reason;
+
+    // Step down when any of these is exceeded...
+    double m_degradeRealTimeFactor;
+    qint64 m_degradeBacklog;     // ms
+    double m_degradePressure;    // %
+    qint64 m_degradeDwell;       // ms since the last transition
+    // ...and up only when all of these hold for m_calmDecodesNeeded decodes
+    double m_upgradeRealTimeFactor;
+    qint64 m_upgradeBacklog;
+    double m_upgradePressure;
+    qint64 m_upgradeDwell;
+    int m_calmDecodesNeeded;
+};
+
+#endif // QUALITYCONTROLLER_H
@@ -0,0 +1,239 @@
+#include "refinementprocessor.h"
+#include "whisperprocessor.h"
+#include "decodingprofile.h"
+#include "../config/audioconfiguration.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QMetaObject>
+#include <QStringList>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+extern "C" {
+#include "include/whisper.h"
+}
+
+RefinementProcessor::RefinementProcessor(QObject *parent)
+    : QObject(parent)
+    , m_context(nullptr)
+    , m_state(nullptr)
+    , m_computeDeviceType(0)
+    , m_computeDeviceId(-1)
+    , m_wordTimestamps(false)
+    , m_threads(2)
+    , m_maxQueued(16)
+    , m_scheduled(false)
+    , m_threadPriorityLowered(false)
+    , m_abortGeneration(0)
+    , m_decodeGeneration(0)
+{
+}
+
+RefinementProcessor::~RefinementProcessor()
+{
+    releaseModel();
+}
+
+void RefinementProcessor::requestAbort()
+{
+    m_abortGeneration.fetch_add(1);
+}
+
+void RefinementProcessor::updateConfiguration(const AudioConfiguration &config)
+{
+    m_wordTimestamps = config.wordTimestamps;
+    
+    // Refining with the live model would only repeat the same work
+    QString modelName = config.refineModel != config.model ? config.refineModel : QString();
+    bool deviceChanged = m_computeDeviceType != config.computeDeviceType ||
+                         m_computeDeviceId != config.computeDeviceId;
+    m_computeDeviceType = config.computeDeviceType;
+    m_computeDeviceId = config.computeDeviceId;
+    
+    if (modelName != m_modelName || (deviceChanged && m_context)) {
+        loadModel(modelName);
+    }
+}
+
+void RefinementProcessor::loadModel(const QString &modelName)
+{
+    releaseModel();
+    m_queue.clear();
+    m_modelName = modelName;
+    
+    if (modelName.isEmpty()) {
+        return;
+    }
+    
+    QString modelPath = WhisperProcessor::getModelPath(modelName);
+    if (modelPath.isEmpty() || !QFile::exists(modelPath)) {
+        emit statusChanged(QString("Refinement model not found: %1").arg(modelName));
+        return;
+    }
+    
+    whisper_context_params params = whisper_context_default_params();
+    params.use_gpu = m_computeDeviceType == 1;
+    params.gpu_device = m_computeDeviceType == 1 ? m_computeDeviceId : 0;
+    params.flash_attn = true;
+    
+    m_context = whisper_init_from_file_with_params_no_state(modelPath.toLocal8Bit().constData(), params);
+    if (m_context) {
+        m_state = whisper_init_state(m_context);
+    }
+    if (m_state) {
+        emit statusChanged(QString("Refinement model loaded: %1").arg(modelName));
+    } else {
+        releaseModel();
+        emit statusChanged(QString("Failed to load refinement model: %1").arg(modelName));
+    }
+}
+
+void RefinementProcessor::releaseModel()
+{
+    if (m_state) {
+        whisper_free_state(m_state);
+        m_state = nullptr;
+    }
+    if (m_context) {
+        whisper_free(m_context);
+        m_context = nullptr;
+    }
+}
+
+void RefinementProcessor::refineUtterance(quint64 utteranceId, qint64 audioStart, const QString &language,
+                                          const QList<float> &samples)
+{
+    if (!m_state || samples.isEmpty()) {
+        return;
+    }
+    
+    // Falling behind is fine, the live text is already on screen; just don't let
+    // the backlog (and its audio) grow without bound
+    while (m_queue.size() >= m_maxQueued) {
+        qDebug() << "Refinement queue full - keeping live text for utterance" << m_queue.front().utteranceId;
+        m_queue.pop_front();
+    }
+    
+    m_queue.push_back({utteranceId, audioStart, language, samples, m_abortGeneration.load()});
+    scheduleNext();
+}
+
+void RefinementProcessor::scheduleNext()
+{
+    // Process one chunk per event-loop pass so newly queued chunks (and
+    // configuration changes) are seen between decodes
+    if (!m_scheduled && !m_queue.empty()) {
+        m_scheduled = true;
+        QMetaObject::invokeMethod(this, [this]() { processNext(); }, Qt::QueuedConnection);
+    }
+}
+
+bool RefinementProcessor::abortCallback(void *userData)
+{
+    const RefinementProcessor *self = static_cast<const RefinementProcessor*>(userData);
+    return self->m_abortGeneration.load() != self->m_decodeGeneration;
+}
+
+void RefinementProcessor::processNext()
+{
+    m_scheduled = false;
+    
+    // Chunks queued before an abort go with it
+    const int generation = m_abortGeneration.load();
+    while (!m_queue.empty() && m_queue.front().generation != generation) {
+        qDebug() << "Refinement aborted - keeping live text for utterance" << m_queue.front().utteranceId;
+        m_queue.pop_front();
+    }
+    if (m_queue.empty() || !m_state) {
+        return;
+    }
+    
+#ifdef Q_OS_LINUX
+    // QThread priorities are ignored under SCHED_OTHER; the nice value is per thread
+    // on Linux and is inherited by the ggml workers whisper_full spawns from here
+    if (!m_threadPriorityLowered) {
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+        m_threadPriorityLowered = true;
+    }
+#endif
+    
+    PendingUtterance utterance = std::move(m_queue.front());
+    m_queue.pop_front();
+    m_decodeGeneration = generation;
+    
+    // No deadline here: use the accurate profile, since quality is the point
+    DecodingProfile profile = DecodingProfile::preset("accurate");
+    whisper_full_params wparams = whisper_full_default_params(
+        static_cast<whisper_sampling_strategy>(profile.whisperStrategy()));
+    profile.applyTo(wparams);
+    wparams.print_progress = false;
+    wparams.print_special = false;
+    wparams.print_realtime = false;
+    wparams.print_timestamps = false;
+    wparams.single_segment = false;
+    wparams.no_context = true;
+    wparams.n_threads = m_threads;
+    wparams.token_timestamps = m_wordTimestamps;
+    wparams.suppress_blank = true;
+    wparams.abort_callback = &RefinementProcessor::abortCallback;
+    wparams.abort_callback_user_data = this;
+    
+    // An English-only refinement model can't follow a detected language
+    QByteArray languageCode = whisper_is_multilingual(m_context) ? utterance.language.toLatin1() : QByteArray("en");
+    wparams.language = languageCode.constData();
+    
+    std::vector<float> samples(utterance.samples.begin(), utterance.samples.end());
+    int result = whisper_full_with_state(m_context, m_state, wparams, samples.data(), static_cast<int>(samples.size()));
+    
+    if (result != 0) {
+        if (m_abortGeneration.load() != m_decodeGeneration) {
+            qDebug() << "Refinement aborted for utterance" << utterance.utteranceId;
+        } else {
+            qDebug() << "Refinement failed with error code:" << result;
+        }
+        scheduleNext();
+        return;
+    }
+    
+    // Merge the segments into one entry that replaces every live segment of the chunk
+    TranscriptionSegment refined;
+    refined.utteranceId = utterance.utteranceId;
+    refined.refined = true;
+    refined.timestamp = QDateTime::currentMSecsSinceEpoch();
+    
+    const int nSegments = whisper_full_n_segments_from_state(m_state);
+    QStringList parts;
+    for (int i = 0; i < nSegments; ++i) {
+        QString text = QString::fromUtf8(whisper_full_get_segment_text_from_state(m_state, i)).trimmed();
+        if (text.isEmpty() || text == "[BLANK_AUDIO]") {
+            continue;
+        }
+        
+        const qint64 t0 = utterance.audioStart + whisper_full_get_segment_t0_from_state(m_state, i) * 10;
+        const qint64 t1 = utterance.audioStart + whisper_full_get_segment_t1_from_state(m_state, i) * 10;
+        if (parts.isEmpty()) {
+            refined.startTime = t0;
+        }
+        refined.endTime = t1;
+        parts << text;
+        
+        if (m_wordTimestamps) {
+            refined.words += WhisperProcessor::collectWords(m_context, m_state, i, utterance.audioStart);
+        }
+    }
+    
+    // An empty result keeps the live text rather than erasing it
+    if (!parts.isEmpty()) {
+        refined.text = parts.join(' ');
+        qDebug() << "Refined utterance" << refined.utteranceId << ":" << refined.text;
+        emit utteranceRefined(refined);
+    }
+    
+    scheduleNext();
+}
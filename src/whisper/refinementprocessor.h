@@ -0,0 +1,72 @@
+#ifndef REFINEMENTPROCESSOR_H
+#define REFINEMENTPROCESSOR_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <atomic>
+#include <deque>
+#include "transcriptionsegment.h"
+
+struct AudioConfiguration;
+struct whisper_context;
+struct whisper_state;
+
+// Re-decodes finished chunks with a second, larger model in the background.
+// The live WhisperProcessor keeps a small model that holds real time; chunks it
+// was unsure about are queued here and the accurate text replaces the live
+// segments once it is ready. Meant to live on its own low-priority thread.
+class RefinementProcessor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RefinementProcessor(QObject *parent = nullptr);
+    ~RefinementProcessor();
+    
+    // Drop queued chunks and cancel the decode in flight. Thread-safe.
+    void requestAbort();
+
+public slots:
+    void updateConfiguration(const AudioConfiguration &config);
+    void refineUtterance(quint64 utteranceId, qint64 audioStart, const QString &language,
+                         const QList<float> &samples);
+
+signals:
+    // The refined text for all live segments of one chunk
+    void utteranceRefined(const TranscriptionSegment &segment);
+    void statusChanged(const QString &status);
+
+private:
+    struct PendingUtterance {
+        quint64 utteranceId;
+        qint64 audioStart;
+        QString language;
+        QList<float> samples;
+        int generation;       // Abort generation when queued; stale ones are dropped
+    };
+    
+    void loadModel(const QString &modelName);
+    void releaseModel();
+    void scheduleNext();
+    void processNext();
+    static bool abortCallback(void *userData);
+    
+    whisper_context *m_context;
+    whisper_state *m_state;   // Own state so the segment/token getters can be shared with the live path
+    QString m_modelName;
+    int m_computeDeviceType;  // 0 = CPU, 1 = CUDA
+    int m_computeDeviceId;
+    bool m_wordTimestamps;
+    int m_threads;            // Kept low so the live decoder gets the CPU first
+    
+    std::deque<PendingUtterance> m_queue;
+    size_t m_maxQueued;       // Oldest chunks are dropped (their live text stays) beyond this
+    bool m_scheduled;
+    bool m_threadPriorityLowered;
+    
+    std::atomic<int> m_abortGeneration;
+    int m_decodeGeneration;
+};
+
+#endif // REFINEMENTPROCESSOR_H
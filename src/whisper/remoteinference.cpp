@@ -0,0 +1,326 @@
+#include "remoteinference.h"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QHttpMultiPart>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QtEndian>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr int kSampleRate = 16000;
+constexpr int kMaxAttempts = 2;             // The first endpoint and one other
+constexpr qint64 kBaseSkipMs = 2000;        // Doubles with each failure in a row
+constexpr qint64 kMaxSkipMs = 60000;
+constexpr double kRtfSmoothing = 0.3;
+
+QHttpPart formField(const QByteArray &name, const QByteArray &value)
+{
+    QHttpPart part;
+    part.setHeader(QNetworkRequest::ContentDispositionHeader, "form-data; name=\"" + name + "\"");
+    part.setBody(value);
+    return part;
+}
+}
+
+RemoteInference::RemoteInference(QObject *parent)
+    : QObject(parent)
+    , m_network(new QNetworkAccessManager(this))
+    , m_timeoutMs(10000)
+    , m_temperatureFallback(true)
+{
+}
+
+RemoteInference::~RemoteInference()
+{
+    cancelAll();
+}
+
+void RemoteInference::setEndpoints(const QStringList &urls)
+{
+    QList<QUrl> parsed;
+    for (const QString &entry : urls) {
+        QUrl url = QUrl::fromUserInput(entry.trimmed());
+        if (!url.isValid() || url.host().isEmpty()) {
+            qDebug() << "Ignoring remote inference endpoint" << entry;
+            continue;
+        }
+        if (url.path().isEmpty() || url.path() == "/") {
+            url.setPath("/inference");
+        }
+        parsed.append(url);
+    }
+
+    QList<QUrl> current;
+    for (const Endpoint &endpoint : m_endpoints) {
+        current.append(endpoint.url);
+    }
+    if (parsed == current) {
+        return;
+    }
+    qDebug() << "Remote inference endpoints:" << parsed;
+
+    // Endpoints that stay keep their statistics and requests in flight
+    std::vector<Endpoint> endpoints;
+    std::vector<int> newIndex(m_endpoints.size(), -1);
+    for (const QUrl &url : parsed) {
+        const int old = static_cast<int>(current.indexOf(url));
+        if (old >= 0) {
+            newIndex[old] = static_cast<int>(endpoints.size());
+            endpoints.push_back(m_endpoints[old]);
+        } else {
+            Endpoint endpoint;
+            endpoint.url = url;
+            endpoints.push_back(endpoint);
+        }
+    }
+
+    // Requests to removed endpoints are cancelled and reported as failed, so
+    // their chunks fall back to the local model instead of vanishing
+    for (const std::unique_ptr<Pending> &pending : m_pending) {
+        if (!pending->reply) {
+            continue;
+        }
+        const int index = newIndex[pending->endpoint];
+        if (index >= 0) {
+            pending->endpoint = index;
+            continue;
+        }
+        pending->reply->disconnect(this);
+        pending->reply->abort();
+        pending->reply->deleteLater();
+        pending->reply = nullptr;
+        pending->state = Pending::Failed;
+        pending->error = QString("%1 was removed from the configuration").arg(m_endpoints[pending->endpoint].url.host());
+    }
+    m_endpoints = std::move(endpoints);
+    deliverFinished();
+}
+
+bool RemoteInference::hasAvailableEndpoint() const
+{
+    return pickEndpoint(-1) >= 0;
+}
+
+int RemoteInference::pickEndpoint(int exclude) const
+{
+    // Least expected completion time: queue length times measured speed. Unmeasured
+    // endpoints count as fast so each gets tried.
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    int best = -1;
+    double bestCost = 0.0;
+    for (int i = 0; i < static_cast<int>(m_endpoints.size()); ++i) {
+        const Endpoint &endpoint = m_endpoints[i];
+        if (i == exclude || endpoint.skipUntil > now) {
+            continue;
+        }
+        const double cost = (endpoint.inFlight + 1) * std::max(endpoint.realTimeFactor, 0.05);
+        if (best < 0 || cost < bestCost) {
+            best = i;
+            bestCost = cost;
+        }
+    }
+    return best;
+}
+
+void RemoteInference::submit(Chunk chunk)
+{
+    auto pending = std::make_unique<Pending>();
+    pending->chunk = std::move(chunk);
+    Pending *raw = pending.get();
+    m_pending.push_back(std::move(pending));
+
+    const int endpoint = pickEndpoint(-1);
+    if (endpoint < 0) {
+        raw->state = Pending::Failed;
+        raw->error = "No remote endpoint available";
+        deliverFinished();
+        return;
+    }
+    send(raw, endpoint);
+}
+
+void RemoteInference::send(Pending *pending, int endpoint)
+{
+    const Chunk &chunk = pending->chunk;
+    auto *form = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+
+    QHttpPart file;
+    file.setHeader(QNetworkRequest::ContentDispositionHeader, "form-data; name=\"file\"; filename=\"chunk.wav\"");
+    file.setHeader(QNetworkRequest::ContentTypeHeader, "audio/wav");
+    file.setBody(encodeWav(chunk.samples));
+    form->append(file);
+    form->append(formField("response_format", "verbose_json"));
+    form->append(formField("temperature", "0.0"));
+    form->append(formField("temperature_inc", m_temperatureFallback ? "0.2" : "0.0"));
+    form->append(formField("language", chunk.language.toUtf8()));
+    if (!chunk.prompt.isEmpty()) {
+        form->append(formField("prompt", chunk.prompt.toUtf8()));
+    }
+
+    // Nothing comes back while the server decodes, so the transfer timeout
+    // bounds the whole request; longer chunks get longer
+    QNetworkRequest request(m_endpoints[endpoint].url);
+    const qint64 audioMs = static_cast<qint64>(chunk.samples.size()) * 1000 / kSampleRate;
+    request.setTransferTimeout(static_cast<int>(m_timeoutMs + audioMs));
+    request.setAttribute(QNetworkRequest::HttpPipeliningAllowedAttribute, true);
+
+    pending->endpoint = endpoint;
+    pending->attempts++;
+    pending->sentAt = QDateTime::currentMSecsSinceEpoch();
+    pending->reply = m_network->post(request, form);
+    form->setParent(pending->reply);
+    m_endpoints[endpoint].inFlight++;
+
+    connect(pending->reply, &QNetworkReply::finished, this, [this, pending]() { onReplyFinished(pending); });
+}
+
+void RemoteInference::onReplyFinished(Pending *pending)
+{
+    QNetworkReply *reply = pending->reply;
+    pending->reply = nullptr;
+    reply->deleteLater();
+
+    Endpoint &endpoint = m_endpoints[pending->endpoint];
+    endpoint.inFlight--;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+
+    QString error;
+    if (reply->error() != QNetworkReply::NoError) {
+        error = reply->error() == QNetworkReply::OperationCanceledError ? QString("timed out") : reply->errorString();
+    } else if (status != 200) {
+        error = QString("HTTP %1").arg(status);
+    } else if (!parseReply(reply->readAll(), pending->chunk, pending->segments)) {
+        error = "unreadable response";
+    }
+
+    if (error.isEmpty()) {
+        const double audioSeconds = pending->chunk.samples.size() / double(kSampleRate);
+        const double rtf = (now - pending->sentAt) / 1000.0 / std::max(audioSeconds, 1.0);
+        endpoint.realTimeFactor = endpoint.realTimeFactor > 0.0
+            ? endpoint.realTimeFactor + kRtfSmoothing * (rtf - endpoint.realTimeFactor) : rtf;
+        endpoint.failures = 0;
+        endpoint.skipUntil = 0;
+        pending->state = Pending::Done;
+    } else {
+        endpoint.failures++;
+        endpoint.skipUntil = now + std::min(kMaxSkipMs, kBaseSkipMs << std::min(endpoint.failures - 1, 5));
+        qDebug() << "Remote inference on" << endpoint.url.toString() << "failed:" << error
+                 << "- skipping it for" << (endpoint.skipUntil - now) << "ms";
+
+        const int retry = pending->attempts < kMaxAttempts ? pickEndpoint(pending->endpoint) : -1;
+        if (retry >= 0) {
+            send(pending, retry);
+            return;
+        }
+        pending->state = Pending::Failed;
+        pending->error = QString("%1: %2").arg(endpoint.url.host(), error);
+    }
+    deliverFinished();
+}
+
+bool RemoteInference::parseReply(const QByteArray &body, const Chunk &chunk,
+                                 QList<TranscriptionSegment> &segments) const
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(body, &parseError);
+    if (parseError.error != QJsonParseError::NoError || !document.isObject()) {
+        return false;
+    }
+    const QJsonObject object = document.object();
+    if (object.contains("error")) {
+        return false;
+    }
+
+    // verbose_json lists segments with times in seconds from the start of the
+    // upload; older servers only send the text
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const qint64 audioEnd = chunk.audioStart + static_cast<qint64>(chunk.samples.size()) * 1000 / kSampleRate;
+    const QJsonArray list = object.value("segments").toArray();
+    for (const QJsonValue &value : list) {
+        const QJsonObject entry = value.toObject();
+        TranscriptionSegment segment;
+        segment.text = entry.value("text").toString().trimmed();
+        if (segment.text.isEmpty() || segment.text == "[BLANK_AUDIO]") {
+            continue;
+        }
+        segment.timestamp = now;
+        segment.startTime = chunk.audioStart + static_cast<qint64>(entry.value("start").toDouble() * 1000);
+        segment.endTime = std::min(audioEnd, chunk.audioStart + static_cast<qint64>(entry.value("end").toDouble() * 1000));
+        segment.utteranceId = chunk.utteranceId;
+        segment.avgLogprob = static_cast<float>(entry.value("avg_logprob").toDouble(0.0));
+        segment.noSpeechProb = static_cast<float>(entry.value("no_speech_prob").toDouble(0.0));
+        segments.append(segment);
+    }
+    if (list.isEmpty()) {
+        const QString text = object.value("text").toString().trimmed();
+        if (!text.isEmpty() && text != "[BLANK_AUDIO]") {
+            TranscriptionSegment segment;
+            segment.text = text;
+            segment.timestamp = now;
+            segment.startTime = chunk.audioStart;
+            segment.endTime = audioEnd;
+            segment.utteranceId = chunk.utteranceId;
+            segments.append(segment);
+        }
+    }
+    return true;
+}
+
+void RemoteInference::deliverFinished()
+{
+    // A slow chunk holds back the ones submitted after it
+    while (!m_pending.empty() && m_pending.front()->state != Pending::Waiting) {
+        std::unique_ptr<Pending> pending = std::move(m_pending.front());
+        m_pending.pop_front();
+        if (pending->state == Pending::Done) {
+            emit chunkDecoded(pending->chunk, pending->segments);
+        } else {
+            emit chunkFailed(pending->chunk, pending->error);
+        }
+    }
+}
+
+void RemoteInference::cancelAll()
+{
+    for (const std::unique_ptr<Pending> &pending : m_pending) {
+        if (pending->reply) {
+            pending->reply->disconnect(this);
+            pending->reply->abort();
+            pending->reply->deleteLater();
+            m_endpoints[pending->endpoint].inFlight--;
+        }
+    }
+    m_pending.clear();
+}
+
+QByteArray RemoteInference::encodeWav(const std::vector<float> &samples)
+{
+    // 16-bit mono PCM, which every whisper.cpp server build reads without ffmpeg
+    const quint32 dataSize = static_cast<quint32>(samples.size() * 2);
+    QByteArray wav(44 + dataSize, 0);
+    char *out = wav.data();
+    memcpy(out, "RIFF", 4);
+    qToLittleEndian<quint32>(36 + dataSize, out + 4);
+    memcpy(out + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, out + 16);
+    qToLittleEndian<quint16>(1, out + 20);                 // PCM
+    qToLittleEndian<quint16>(1, out + 22);                 // Mono
+    qToLittleEndian<quint32>(kSampleRate, out + 24);
+    qToLittleEndian<quint32>(kSampleRate * 2, out + 28);   // Byte rate
+    qToLittleEndian<quint16>(2, out + 32);                 // Block align
+    qToLittleEndian<quint16>(16, out + 34);                // Bits per sample
+    memcpy(out + 36, "data", 4);
+    qToLittleEndian<quint32>(dataSize, out + 40);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const float sample = std::clamp(samples[i], -1.0f, 1.0f);
+        qToLittleEndian<qint16>(static_cast<qint16>(sample * 32767.0f), out + 44 + i * 2);
+    }
+    return wav;
+}
@@ -0,0 +1,96 @@
+#ifndef REMOTEINFERENCE_H
+#define REMOTEINFERENCE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QUrl>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "transcriptionsegment.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+// Decodes chunks on machines running the whisper.cpp "server" example (POST
+// /inference) instead of the local model. Each chunk goes to the endpoint that
+// should finish it first given its queue and measured speed; several chunks can
+// be in flight at once, and results come back in the order they were submitted.
+// A chunk that fails or times out is tried once more on another endpoint, then
+// handed back for local decoding. Failing endpoints are skipped for a while.
+class RemoteInference : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Chunk {
+        quint64 utteranceId = 0;
+        std::vector<float> samples;   // 16 kHz mono
+        qint64 audioStart = 0;        // Wall-clock ms of the first sample
+        qint64 audioEnd = 0;          // Audio clock at the last sample
+        QString language;             // Code, or "auto"
+        QString prompt;               // Text carried over from the previous chunks
+    };
+
+    explicit RemoteInference(QObject *parent = nullptr);
+    ~RemoteInference();
+
+    // Server URLs; a URL without a path gets /inference. Empty disables remote
+    // decoding. Chunks in flight to a removed endpoint are reported as failed.
+    void setEndpoints(const QStringList &urls);
+    void setTimeout(int ms) { m_timeoutMs = ms; }
+    void setTemperatureFallback(bool enabled) { m_temperatureFallback = enabled; }
+
+    bool isEnabled() const { return !m_endpoints.empty(); }
+    // Some endpoint isn't being skipped after a failure
+    bool hasAvailableEndpoint() const;
+    int pendingCount() const { return static_cast<int>(m_pending.size()); }
+
+    // With no endpoint available the chunk fails, reported after the chunks ahead of it
+    void submit(Chunk chunk);
+    // Forget everything in flight; nothing more is reported for it
+    void cancelAll();
+
+signals:
+    // Both are emitted in submission order
+    void chunkDecoded(const RemoteInference::Chunk &chunk, const QList<TranscriptionSegment> &segments);
+    void chunkFailed(const RemoteInference::Chunk &chunk, const QString &error);
+
+private:
+    struct Endpoint {
+        QUrl url;
+        int inFlight = 0;
+        double realTimeFactor = 0.0;  // Round trip per second of audio, averaged (0 = unknown)
+        int failures = 0;             // In a row
+        qint64 skipUntil = 0;         // Wall-clock ms
+    };
+
+    struct Pending {
+        enum State { Waiting, Done, Failed };
+        Chunk chunk;
+        State state = Waiting;
+        QList<TranscriptionSegment> segments;
+        QString error;
+        QNetworkReply *reply = nullptr;
+        int endpoint = -1;
+        int attempts = 0;
+        qint64 sentAt = 0;
+    };
+
+    int pickEndpoint(int exclude) const;
+    void send(Pending *pending, int endpoint);
+    void onReplyFinished(Pending *pending);
+    bool parseReply(const QByteArray &body, const Chunk &chunk, QList<TranscriptionSegment> &segments) const;
+    void deliverFinished();
+    static QByteArray encodeWav(const std::vector<float> &samples);
+
+    QNetworkAccessManager *m_network;
+    std::vector<Endpoint> m_endpoints;
+    std::deque<std::unique_ptr<Pending>> m_pending;   // Oldest first
+    int m_timeoutMs;
+    bool m_temperatureFallback;
+};
+
+#endif // REMOTEINFERENCE_H
@@ -0,0 +1,112 @@
+#include "runawayguard.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+RunawayGuard::RunawayGuard()
+    : m_enabled(true)
+    , m_audioSeconds(0.0)
+    , m_maxTokensPerSecond(12.0)
+    , m_minTokenBudget(24)
+    , m_maxNgram(8)
+    , m_maxRepeats(4)
+    , m_tripped(false)
+{
+}
+
+void RunawayGuard::reset(double audioSeconds)
+{
+    m_audioSeconds = std::max(0.0, audioSeconds);
+    QMutexLocker locker(&m_reasonMutex);
+    m_tripped.store(false, std::memory_order_relaxed);
+    m_reason.clear();
+}
+
+QString RunawayGuard::reason() const
+{
+    QMutexLocker locker(&m_reasonMutex);
+    return m_reason;
+}
+
+void RunawayGuard::setRepetitionLimits(int maxNgram, int maxRepeats)
+{
+    m_maxNgram = std::max(1, maxNgram);
+    m_maxRepeats = std::max(2, maxRepeats);
+}
+
+int RunawayGuard::tokenBudget() const
+{
+    return m_minTokenBudget + static_cast<int>(std::ceil(m_audioSeconds * m_maxTokensPerSecond));
+}
+
+bool RunawayGuard::check(const std::vector<int> &textTokens)
+{
+    if (!m_enabled) {
+        return false;
+    }
+    if (isTripped()) {
+        return true;
+    }
+    
+    // Far more text than the audio duration allows
+    const int budget = tokenBudget();
+    if (static_cast<int>(textTokens.size()) > budget) {
+        trip(QString("%1 tokens for %2 s of audio (budget %3)")
+             .arg(textTokens.size()).arg(m_audioSeconds, 0, 'f', 1).arg(budget));
+        return true;
+    }
+    
+    // The same phrase repeating back to back at the end of the output
+    int ngram = 0;
+    int repeats = 0;
+    if (findRepetition(textTokens, ngram, repeats)) {
+        trip(QString("%1-token phrase repeated %2 times").arg(ngram).arg(repeats));
+        return true;
+    }
+    
+    return false;
+}
+
+bool RunawayGuard::findRepetition(const std::vector<int> &tokens, int &ngram, int &repeats) const
+{
+    const int count = static_cast<int>(tokens.size());
+    
+    for (int n = 1; n <= m_maxNgram; ++n) {
+        // Single tokens legitimately repeat a few times ("no no no"), so demand more
+        const int required = n == 1 ? m_maxRepeats * 2 : m_maxRepeats;
+        if (count < n * required) {
+            break;
+        }
+        
+        // Count how many times the trailing n-gram repeats back to back
+        int found = 1;
+        int pos = count - 2 * n;
+        while (pos >= 0 && found < required) {
+            if (!std::equal(tokens.begin() + pos, tokens.begin() + pos + n, tokens.end() - n)) {
+                break;
+            }
+            ++found;
+            pos -= n;
+        }
+        
+        if (found >= required) {
+            ngram = n;
+            repeats = found;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void RunawayGuard::trip(const QString &reason)
+{
+    QMutexLocker locker(&m_reasonMutex);
+    if (m_tripped.load(std::memory_order_relaxed)) {
+        return;  // Another decoder got there first
+    }
+    m_reason = reason;
+    m_tripped.store(true, std::memory_order_release);
+    qDebug() << "Runaway decode guard tripped:" << reason;
+}
@@ -0,0 +1,55 @@
+#ifndef RUNAWAYGUARD_H
+#define RUNAWAYGUARD_H
+
+#include <QString>
+#include <QMutex>
+#include <vector>
+#include <atomic>
+
+// Watches the tokens whisper produces while decoding and trips when the output
+// looks like a runaway decode: a phrase repeating over and over, or far more
+// text than the audio could plausibly contain.
+class RunawayGuard
+{
+public:
+    RunawayGuard();
+    
+    // Arm the guard for a new decode of the given amount of audio
+    void reset(double audioSeconds);
+    
+    // Inspect one decoder's text tokens (special and timestamp tokens removed).
+    // Returns true once the guard has tripped.
+    bool check(const std::vector<int> &textTokens);
+    
+    bool isTripped() const { return m_tripped.load(std::memory_order_acquire); }
+    QString reason() const;
+    
+    // Most text tokens a decode of the armed audio length may produce
+    int tokenBudget() const;
+    
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+    
+    void setMaxTokensPerSecond(double rate) { m_maxTokensPerSecond = rate; }
+    void setRepetitionLimits(int maxNgram, int maxRepeats);
+
+private:
+    bool findRepetition(const std::vector<int> &tokens, int &ngram, int &repeats) const;
+    void trip(const QString &reason);
+    
+    bool m_enabled;
+    double m_audioSeconds;
+    double m_maxTokensPerSecond;  // Sustained speech is ~3-5 tokens/s
+    int m_minTokenBudget;         // Slack for very short segments
+    int m_maxNgram;               // Longest phrase (in tokens) checked for repetition
+    int m_maxRepeats;             // Consecutive repeats of a phrase that count as a loop
+    
+    // check() runs on every decoder thread of a beam search or best-of decode,
+    // and the abort callback polls the flag from ggml's worker threads. The
+    // first decoder to trip sets the reason.
+    std::atomic<bool> m_tripped;
+    mutable QMutex m_reasonMutex;
+    QString m_reason;
+};
+
+#endif // RUNAWAYGUARD_H
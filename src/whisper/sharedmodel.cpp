@@ -0,0 +1,38 @@
+#include "sharedmodel.h"
+#include <QHash>
+#include <QDebug>
+#include <mutex>
+
+extern "C" {
+#include "include/whisper.h"
+}
+
+SharedModel::Context SharedModel::acquire(const QString &modelPath, int deviceType, int deviceId)
+{
+    // Held across the load, so two users asking at once don't both read the file
+    static std::mutex mutex;
+    static QHash<QString, std::weak_ptr<whisper_context>> contexts;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const int device = deviceType == 1 ? deviceId : -1;
+    const QString key = modelPath + '\n' + QString::number(device);
+    if (Context context = contexts.value(key).lock()) {
+        return context;
+    }
+
+    whisper_context_params params = whisper_context_default_params();
+    params.use_gpu = deviceType == 1;
+    params.gpu_device = deviceType == 1 ? deviceId : 0;
+    params.flash_attn = true;
+
+    whisper_context *context = whisper_init_from_file_with_params_no_state(modelPath.toLocal8Bit().constData(), params);
+    if (!context) {
+        contexts.remove(key);
+        return Context();
+    }
+    qDebug() << "Loaded shared model" << modelPath << (deviceType == 1 ? QString("on GPU %1").arg(deviceId) : QString("on CPU"));
+
+    Context shared(context, [](whisper_context *ctx) { whisper_free(ctx); });
+    contexts.insert(key, shared);
+    return shared;
+}
@@ -0,0 +1,25 @@
+#ifndef SHAREDMODEL_H
+#define SHAREDMODEL_H
+
+#include <QString>
+#include <memory>
+
+struct whisper_context;
+
+// One resident copy of a model's weights for the whole process. The live
+// processor, the streaming server, offline and batch transcription all ask for
+// their model here; users of the same file on the same device get the same
+// context and decode with whisper states of their own (whisper_init_state),
+// which is safe from several threads at once. The weights are freed when the
+// last user lets go, after it has freed its states.
+class SharedModel
+{
+public:
+    using Context = std::shared_ptr<whisper_context>;
+
+    // Loaded without a default state; null if the file can't be loaded.
+    // deviceType: 0 = CPU, 1 = CUDA. Thread-safe.
+    static Context acquire(const QString &modelPath, int deviceType, int deviceId);
+};
+
+#endif // SHAREDMODEL_H
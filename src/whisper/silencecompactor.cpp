@@ -0,0 +1,94 @@
+#include "silencecompactor.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+constexpr size_t kFrameSamples = 320;  // 20 ms at 16 kHz
+}
+
+SilenceCompactor::SilenceCompactor()
+    : m_threshold(0.01f)
+    , m_maxSilence(1000)
+    , m_keptGap(300)
+    , m_removedSamples(0)
+{
+}
+
+bool SilenceCompactor::compact(const float *samples, size_t count)
+{
+    m_samples.clear();
+    m_spans.clear();
+    m_removedSamples = 0;
+
+    if (m_maxSilence <= 0 || count == 0) {
+        return false;
+    }
+
+    const size_t maxSilenceSamples = static_cast<size_t>(m_maxSilence) * 16;
+    const size_t keptHalf = static_cast<size_t>(std::min(m_keptGap, m_maxSilence)) * 16 / 2;
+
+    // Find the frames that are silent, then the runs of them that are too long.
+    // Silence at the very start and end is left alone: whisper needs a little lead-in
+    // and the tail is already trimmed by the VAD.
+    size_t keepFrom = 0;          // Start of the audio not yet copied
+    size_t silenceStart = 0;
+    bool inSilence = false;
+
+    auto closeSilence = [&](size_t silenceEnd) {
+        if (silenceStart == 0 || silenceEnd >= count) {
+            return;
+        }
+        if (silenceEnd - silenceStart <= maxSilenceSamples) {
+            return;
+        }
+
+        // Keep [keepFrom, silenceStart + keptHalf), drop up to silenceEnd - keptHalf
+        const size_t cutStart = silenceStart + keptHalf;
+        const size_t cutEnd = silenceEnd - keptHalf;
+        if (m_spans.empty()) {
+            m_spans.push_back({0, 0});
+        }
+        m_samples.insert(m_samples.end(), samples + keepFrom, samples + cutStart);
+        m_spans.push_back({m_samples.size(), cutEnd});
+        m_removedSamples += cutEnd - cutStart;
+        keepFrom = cutEnd;
+    };
+
+    for (size_t frame = 0; frame < count; frame += kFrameSamples) {
+        const size_t frameEnd = std::min(count, frame + kFrameSamples);
+        float sum = 0.0f;
+        for (size_t i = frame; i < frameEnd; ++i) {
+            sum += std::fabs(samples[i]);
+        }
+        const bool silent = sum / (frameEnd - frame) < m_threshold;
+
+        if (silent && !inSilence) {
+            inSilence = true;
+            silenceStart = frame;
+        } else if (!silent && inSilence) {
+            inSilence = false;
+            closeSilence(frame);
+        }
+    }
+
+    if (m_removedSamples == 0) {
+        m_spans.clear();
+        return false;
+    }
+
+    m_samples.insert(m_samples.end(), samples + keepFrom, samples + count);
+    return true;
+}
+
+qint64 SilenceCompactor::toOriginal(qint64 compactedMs) const
+{
+    if (m_spans.empty() || compactedMs <= 0) {
+        return compactedMs;
+    }
+
+    const size_t position = static_cast<size_t>(compactedMs) * 16;
+    auto span = std::upper_bound(m_spans.begin(), m_spans.end(), position,
+                                 [](size_t value, const Span &s) { return value < s.compactedStart; });
+    --span;  // The first span starts at 0, so there is always one at or before position
+    return static_cast<qint64>(span->originalStart + (position - span->compactedStart)) / 16;
+}
@@ -0,0 +1,54 @@
+#ifndef SILENCECOMPACTOR_H
+#define SILENCECOMPACTOR_H
+
+#include <QtGlobal>
+#include <cstddef>
+#include <vector>
+
+// Shortens long pauses inside an utterance before it is decoded, so whisper
+// doesn't spend encoder and decoder time on silence. Every pause longer than
+// the limit is cut down to a fixed gap (half kept on each side, so words at
+// either edge keep their tails); a time map translates positions in the
+// compacted audio back to the original recording.
+class SilenceCompactor
+{
+public:
+    SilenceCompactor();
+
+    // Mean absolute amplitude below which a 20 ms frame counts as silent
+    void setThreshold(float amplitude) { m_threshold = amplitude; }
+    // Pauses longer than this (ms) are shortened; 0 disables compaction
+    void setMaxSilence(int ms) { m_maxSilence = ms; }
+    int maxSilence() const { return m_maxSilence; }
+    // Length (ms) a shortened pause is cut down to
+    void setKeptGap(int ms) { m_keptGap = ms; }
+
+    // Compact 16 kHz mono samples. Returns true when anything was removed; the
+    // result is then available from samples()
+    bool compact(const float *samples, size_t count);
+
+    const std::vector<float> &samples() const { return m_samples; }
+
+    // Map an offset (ms) in the compacted audio to the original audio
+    qint64 toOriginal(qint64 compactedMs) const;
+
+    // Audio removed by the last compact() call
+    double removedSeconds() const { return m_removedSamples / 16000.0; }
+
+private:
+    // A stretch of kept audio: where it starts in the compacted and original buffers
+    struct Span {
+        size_t compactedStart;
+        size_t originalStart;
+    };
+
+    float m_threshold;
+    int m_maxSilence;
+    int m_keptGap;
+
+    std::vector<float> m_samples;
+    std::vector<Span> m_spans;
+    size_t m_removedSamples;
+};
+
+#endif // SILENCECOMPACTOR_H
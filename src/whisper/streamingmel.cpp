@@ -0,0 +1,301 @@
+#include "streamingmel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+
+namespace {
+// whisper's fixed frontend parameters
+constexpr int kFftSize = StreamingMel::kWindowLength;
+constexpr int kFftBins = StreamingMel::kFftBins;
+constexpr int kCenterPad = kFftSize / 2;   // Reflective padding at the start of the audio
+constexpr float kLogFloor = -10.0f;        // log10(1e-10)
+
+// 400 = 4 * 4 * 5 * 5, one FFT stage per factor
+constexpr int kRadices[] = {4, 4, 5, 5};
+static_assert(std::size(kRadices) % 2 == 0, "the spectrum has to end up in m_re / m_im");
+
+// Layout of a whisper.cpp (ggml) model file up to its filterbank
+constexpr uint32_t kModelMagic = 0x67676d6c;   // "ggml"
+constexpr int kHeaderFields = 11;              // Vocabulary, encoder and decoder sizes, mels, type
+}
+
+StreamingMel::StreamingMel()
+    : m_melCount(0)
+    , m_frameCount(0)
+    , m_maxValue(kLogFloor)
+{
+    m_window.resize(kFftSize);
+    for (int i = 0; i < kFftSize; ++i) {
+        m_window[i] = 0.5f * (1.0f - std::cos(2.0f * static_cast<float>(M_PI) * i / kFftSize));
+    }
+    
+    // Each stage splits its sub-transforms radix ways and twiddles the results,
+    // leaving the spectrum in natural order once the last one is done
+    int span = kFftSize;
+    int stride = 1;
+    for (int radix : kRadices) {
+        FftStage stage;
+        stage.radix = radix;
+        stage.span = span;
+        stage.stride = stride;
+        for (int q = 0; q < span / radix; ++q) {
+            for (int r = 0; r < radix; ++r) {
+                const double angle = -2.0 * M_PI * q * r / span;
+                stage.twiddleRe.push_back(static_cast<float>(std::cos(angle)));
+                stage.twiddleIm.push_back(static_cast<float>(std::sin(angle)));
+            }
+        }
+        m_fftStages.push_back(std::move(stage));
+        span /= radix;
+        stride *= radix;
+    }
+    
+    m_re.resize(kFftSize);
+    m_im.resize(kFftSize);
+    m_workRe.resize(kFftSize);
+    m_workIm.resize(kFftSize);
+    m_power.resize(kFftBins);
+    m_padded.resize(kFftSize);
+}
+
+void StreamingMel::setFilters(int melCount, const std::vector<float> &filters)
+{
+    m_melCount = melCount;
+    m_filters = filters;
+    m_filters.resize(static_cast<size_t>(melCount) * kFftBins, 0.0f);
+    
+    // The filters are triangles a few bins wide; only those bins are summed
+    m_filterStart.assign(melCount, 0);
+    m_filterEnd.assign(melCount, 0);
+    for (int m = 0; m < melCount; ++m) {
+        const float *filter = m_filters.data() + static_cast<size_t>(m) * kFftBins;
+        int first = 0;
+        while (first < kFftBins && filter[first] == 0.0f) {
+            first++;
+        }
+        int last = kFftBins;
+        while (last > first && filter[last - 1] == 0.0f) {
+            last--;
+        }
+        m_filterStart[m] = first;
+        m_filterEnd[m] = last;
+    }
+    reset();
+}
+
+bool StreamingMel::readFilters(const std::string &modelPath, int &melCount, std::vector<float> &filters)
+{
+    std::ifstream file(modelPath, std::ios::binary);
+    uint32_t magic = 0;
+    int32_t header[kHeaderFields];
+    int32_t melBands = 0;
+    int32_t fftBins = 0;
+    if (!file.read(reinterpret_cast<char*>(&magic), sizeof(magic)) || magic != kModelMagic ||
+        !file.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        !file.read(reinterpret_cast<char*>(&melBands), sizeof(melBands)) ||
+        !file.read(reinterpret_cast<char*>(&fftBins), sizeof(fftBins)) ||
+        melBands <= 0 || melBands > 512 || fftBins != kFftBins) {
+        return false;
+    }
+    
+    filters.resize(static_cast<size_t>(melBands) * kFftBins);
+    if (!file.read(reinterpret_cast<char*>(filters.data()), filters.size() * sizeof(float))) {
+        filters.clear();
+        return false;
+    }
+    melCount = melBands;
+    return true;
+}
+
+void StreamingMel::reset()
+{
+    m_frames.clear();
+    m_frameCount = 0;
+    m_maxValue = kLogFloor;
+}
+
+namespace {
+// The DFT of four and of five points, in place
+void butterfly(float (&re)[4], float (&im)[4])
+{
+    const float sumRe = re[0] + re[2], sumIm = im[0] + im[2];
+    const float diffRe = re[0] - re[2], diffIm = im[0] - im[2];
+    const float oddRe = re[1] + re[3], oddIm = im[1] + im[3];
+    const float turnRe = im[1] - im[3], turnIm = re[3] - re[1];  // -i (a1 - a3)
+    re[0] = sumRe + oddRe;   im[0] = sumIm + oddIm;
+    re[1] = diffRe + turnRe; im[1] = diffIm + turnIm;
+    re[2] = sumRe - oddRe;   im[2] = sumIm - oddIm;
+    re[3] = diffRe - turnRe; im[3] = diffIm - turnIm;
+}
+
+void butterfly(float (&re)[5], float (&im)[5])
+{
+    const float c1 = 0.309016994f, c2 = -0.809016994f;   // cos(2 pi / 5), cos(4 pi / 5)
+    const float s1 = 0.951056516f, s2 = 0.587785252f;    // sin(2 pi / 5), sin(4 pi / 5)
+    const float b1Re = re[1] + re[4], b1Im = im[1] + im[4];
+    const float b2Re = re[2] + re[3], b2Im = im[2] + im[3];
+    const float d1Re = re[1] - re[4], d1Im = im[1] - im[4];
+    const float d2Re = re[2] - re[3], d2Im = im[2] - im[3];
+    const float t1Re = re[0] + c1 * b1Re + c2 * b2Re, t1Im = im[0] + c1 * b1Im + c2 * b2Im;
+    const float t2Re = re[0] + c2 * b1Re + c1 * b2Re, t2Im = im[0] + c2 * b1Im + c1 * b2Im;
+    const float u1Re = s1 * d1Re + s2 * d2Re, u1Im = s1 * d1Im + s2 * d2Im;
+    const float u2Re = s2 * d1Re - s1 * d2Re, u2Im = s2 * d1Im - s1 * d2Im;
+    re[0] += b1Re + b2Re;    im[0] += b1Im + b2Im;
+    re[1] = t1Re + u1Im;     im[1] = t1Im - u1Re;   // t1 - i u1
+    re[4] = t1Re - u1Im;     im[4] = t1Im + u1Re;
+    re[2] = t2Re + u2Im;     im[2] = t2Im - u2Re;
+    re[3] = t2Re - u2Im;     im[3] = t2Im + u2Re;
+}
+
+// One stage: each group of Radix points, stride apart, goes through the
+// butterfly and is twiddled. The innermost loop walks consecutive points.
+template <int Radix>
+void fftStage(int groups, int stride, const float *twiddleRe, const float *twiddleIm,
+              const float *inRe, const float *inIm, float *outRe, float *outIm)
+{
+    for (int q = 0; q < groups; ++q) {
+        const float *wRe = twiddleRe + q * Radix;
+        const float *wIm = twiddleIm + q * Radix;
+        for (int t = 0; t < stride; ++t) {
+            float re[Radix];
+            float im[Radix];
+            for (int k = 0; k < Radix; ++k) {
+                re[k] = inRe[t + stride * (q + groups * k)];
+                im[k] = inIm[t + stride * (q + groups * k)];
+            }
+            butterfly(re, im);
+            for (int r = 0; r < Radix; ++r) {
+                const int out = t + stride * (Radix * q + r);
+                outRe[out] = re[r] * wRe[r] - im[r] * wIm[r];
+                outIm[out] = re[r] * wIm[r] + im[r] * wRe[r];
+            }
+        }
+    }
+}
+}
+
+void StreamingMel::fft()
+{
+    // Stockham autosort: every stage reads one pair of buffers and writes the
+    // other, so there is no bit reversal and the output is in natural order
+    float *inRe = m_re.data();
+    float *inIm = m_im.data();
+    float *outRe = m_workRe.data();
+    float *outIm = m_workIm.data();
+    for (const FftStage &stage : m_fftStages) {
+        const int groups = stage.span / stage.radix;
+        if (stage.radix == 4) {
+            fftStage<4>(groups, stage.stride, stage.twiddleRe.data(), stage.twiddleIm.data(),
+                        inRe, inIm, outRe, outIm);
+        } else {
+            fftStage<5>(groups, stage.stride, stage.twiddleRe.data(), stage.twiddleIm.data(),
+                        inRe, inIm, outRe, outIm);
+        }
+        std::swap(inRe, outRe);
+        std::swap(inIm, outIm);
+    }
+}
+
+void StreamingMel::computeFrame(const float *audio, size_t sampleCount, size_t frame)
+{
+    // The frame is centred on frame * hop; samples before the start are reflected,
+    // samples past the end are the zero padding whisper appends
+    const long start = static_cast<long>(frame * kHopLength) - kCenterPad;
+    for (int i = 0; i < kFftSize; ++i) {
+        long index = start + i;
+        float sample = 0.0f;
+        if (index < 0) {
+            index = -index;
+            sample = static_cast<size_t>(index) < sampleCount ? audio[index] : 0.0f;
+        } else if (static_cast<size_t>(index) < sampleCount) {
+            sample = audio[index];
+        }
+        m_padded[i] = sample;
+    }
+    
+    m_frames.resize((frame + 1) * m_melCount);
+    float *out = m_frames.data() + frame * m_melCount;
+    logMel(m_padded.data(), out);
+    for (int m = 0; m < m_melCount; ++m) {
+        m_maxValue = std::max(m_maxValue, out[m]);
+    }
+}
+
+void StreamingMel::logMel(const float *samples, float *out)
+{
+    for (int i = 0; i < kFftSize; ++i) {
+        m_re[i] = samples[i] * m_window[i];
+        m_im[i] = 0.0f;
+    }
+    
+    fft();
+    
+    for (int k = 0; k < kFftBins; ++k) {
+        m_power[k] = m_re[k] * m_re[k] + m_im[k] * m_im[k];
+    }
+    
+    // Summed in double, as whisper does
+    for (int m = 0; m < m_melCount; ++m) {
+        const float *filter = m_filters.data() + static_cast<size_t>(m) * kFftBins;
+        double sum = 0.0;
+        for (int k = m_filterStart[m]; k < m_filterEnd[m]; ++k) {
+            sum += m_power[k] * filter[k];
+        }
+        out[m] = static_cast<float>(std::log10(std::max(sum, 1e-10)));
+    }
+}
+
+void StreamingMel::update(const float *audio, size_t sampleCount)
+{
+    // A frame is final once the whole window lies inside the audio received so far
+    while (m_frameCount * kHopLength + kCenterPad <= sampleCount) {
+        computeFrame(audio, sampleCount, m_frameCount);
+        m_frameCount++;
+    }
+}
+
+void StreamingMel::begin(const float *audio, size_t sampleCount)
+{
+    while (m_frameCount * kHopLength < kCenterPad && m_frameCount * kHopLength + kCenterPad <= sampleCount) {
+        computeFrame(audio, sampleCount, m_frameCount);
+        m_frameCount++;
+    }
+}
+
+void StreamingMel::append(const float *frames, size_t frameCount)
+{
+    m_frames.insert(m_frames.end(), frames, frames + frameCount * m_melCount);
+    m_frameCount += frameCount;
+    for (size_t i = 0; i < frameCount * m_melCount; ++i) {
+        m_maxValue = std::max(m_maxValue, frames[i]);
+    }
+}
+
+std::vector<float> StreamingMel::finish(const float *audio, size_t sampleCount, int paddingFrames, int &frameCount)
+{
+    update(audio, sampleCount);
+    
+    // Frames reaching into the trailing zeros; after these everything is silence
+    while (m_frameCount * kHopLength < sampleCount + kCenterPad) {
+        computeFrame(audio, sampleCount, m_frameCount);
+        m_frameCount++;
+    }
+    
+    // Clamp to 8 (log10) below the peak and scale, then transpose to mel-major
+    const float floor = m_maxValue - 8.0f;
+    const float silence = (std::max(kLogFloor, floor) + 4.0f) / 4.0f;
+    frameCount = static_cast<int>(m_frameCount) + paddingFrames;
+    
+    std::vector<float> mel(static_cast<size_t>(frameCount) * m_melCount, silence);
+    for (size_t frame = 0; frame < m_frameCount; ++frame) {
+        const float *in = m_frames.data() + frame * m_melCount;
+        for (int m = 0; m < m_melCount; ++m) {
+            mel[static_cast<size_t>(m) * frameCount + frame] = (std::max(in[m], floor) + 4.0f) / 4.0f;
+        }
+    }
+    
+    reset();
+    return mel;
+}
@@ -0,0 +1,87 @@
+#ifndef STREAMINGMEL_H
+#define STREAMINGMEL_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Computes whisper's log-mel spectrogram of an utterance a frame at a time, so
+// most of it can be done while the utterance is still being recorded (see
+// MelStream) and only the encoder and decoder are left to run once speech
+// ends. The output matches whisper_pcm_to_mel (Hann window, 400-point
+// FFT, 160-sample hop, the model's own mel filterbank, log10 with the 8 dB
+// dynamic range clamp) and is handed to whisper through whisper_set_mel.
+class StreamingMel
+{
+public:
+    static constexpr int kHopLength = 160;    // Samples between frames
+    static constexpr int kWindowLength = 400; // Samples per frame, centred on its hop
+    static constexpr int kFftBins = kWindowLength / 2 + 1;
+    
+    StreamingMel();
+    
+    // The model's filterbank, [melCount][kFftBins]; melCount is 80, or 128
+    // for large-v3. Nothing can be computed until it is set.
+    void setFilters(int melCount, const std::vector<float> &filters);
+    int melCount() const { return m_melCount; }
+    
+    // Reads the filterbank whisper.cpp model files carry after their header.
+    // Returns false if the file isn't one.
+    static bool readFilters(const std::string &modelPath, int &melCount, std::vector<float> &filters);
+    
+    // Start a new utterance
+    void reset();
+    
+    // Compute every frame whose window is covered by the first sampleCount samples
+    // of audio. The audio must only ever grow between calls (same buffer, appended to).
+    void update(const float *audio, size_t sampleCount);
+    
+    // Compute only the frames whose window reaches before the start of the audio
+    // (reflected, as whisper pads it); the rest can come from append()
+    void begin(const float *audio, size_t sampleCount);
+    
+    // Take the next frames as computed elsewhere by logMel(), frame-major
+    void append(const float *frames, size_t frameCount);
+    
+    // Raw log10 mel energies (melCount of them) of kWindowLength samples,
+    // without padding or clamping
+    void logMel(const float *samples, float *out);
+    
+    // Finish the utterance: computes the frames overlapping its end, normalises,
+    // and returns the spectrogram mel-major (as whisper_set_mel expects) followed
+    // by paddingFrames frames of silence. frameCount receives the total length.
+    std::vector<float> finish(const float *audio, size_t sampleCount, int paddingFrames, int &frameCount);
+    
+    size_t framesComputed() const { return m_frameCount; }
+
+private:
+    struct FftStage {
+        int radix;
+        int span;                             // Points per sub-transform on entry
+        int stride;                           // Distance between its points
+        std::vector<float> twiddleRe, twiddleIm;  // [span / radix][radix]
+    };
+    
+    void computeFrame(const float *audio, size_t sampleCount, size_t frame);
+    void fft();
+    
+    int m_melCount;
+    std::vector<float> m_window;              // Periodic Hann window
+    std::vector<float> m_filters;             // [melCount][kFftBins]
+    std::vector<int> m_filterStart;           // Nonzero range of each filter
+    std::vector<int> m_filterEnd;
+    std::vector<FftStage> m_fftStages;
+    
+    std::vector<float> m_frames;              // Raw log10 energies, frame-major
+    size_t m_frameCount;
+    float m_maxValue;
+    
+    // Scratch buffers reused for every frame; the FFT works on split real and
+    // imaginary parts, back and forth between the two pairs
+    std::vector<float> m_re, m_im;
+    std::vector<float> m_workRe, m_workIm;
+    std::vector<float> m_power;
+    std::vector<float> m_padded;
+};
+
+#endif // STREAMINGMEL_H
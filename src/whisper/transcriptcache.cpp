@@ -0,0 +1,174 @@
+#include "transcriptcache.h"
+#include "whispermodels.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+#include <algorithm>
+
+TranscriptCache::TranscriptCache(const QString &directory, qint64 maxBytes)
+    : m_directory(directory)
+    , m_maxBytes(maxBytes)
+    , m_totalBytes(-1)
+{
+}
+
+QString TranscriptCache::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/transcripts";
+}
+
+QByteArray TranscriptCache::key(const float *samples, size_t count, const QString &modelIdentity,
+                                const QByteArray &params)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(QByteArrayView(reinterpret_cast<const char*>(samples), static_cast<qsizetype>(count * sizeof(float))));
+    hash.addData(modelIdentity.toUtf8());
+    hash.addData(params);
+    return hash.result().toHex();
+}
+
+QString TranscriptCache::modelIdentity(const QString &modelName, const QString &modelPath)
+{
+    // The manifest's digest when there is one; otherwise hashing gigabytes of
+    // weights per run would cost more than it saves, so size and date stand in
+    const ModelInfo info = WhisperModels::modelInfo(modelName);
+    if (!info.sha256.isEmpty()) {
+        return info.sha256;
+    }
+    const QFileInfo file(modelPath);
+    return QString("%1:%2:%3").arg(modelName).arg(file.size()).arg(file.lastModified().toMSecsSinceEpoch());
+}
+
+QString TranscriptCache::entryPath(const QByteArray &key) const
+{
+    // Fan out over subdirectories so no single directory gets huge
+    return QString("%1/%2/%3.json").arg(m_directory, QString::fromLatin1(key.left(2)), QString::fromLatin1(key));
+}
+
+bool TranscriptCache::lookup(const QByteArray &key, QList<TranscriptionSegment> &segments)
+{
+    QFile file(entryPath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    if (!doc.isObject()) {
+        file.remove();
+        return false;
+    }
+
+    segments.clear();
+    for (const QJsonValue &value : doc.object().value("segments").toArray()) {
+        const QJsonObject entry = value.toObject();
+        TranscriptionSegment segment;
+        segment.text = entry.value("text").toString();
+        segment.startTime = static_cast<qint64>(entry.value("t0").toDouble());
+        segment.endTime = static_cast<qint64>(entry.value("t1").toDouble());
+        segment.noSpeechProb = static_cast<float>(entry.value("noSpeech").toDouble());
+        for (const QJsonValue &wordValue : entry.value("words").toArray()) {
+            const QJsonObject wordEntry = wordValue.toObject();
+            TranscriptionWord word;
+            word.text = wordEntry.value("text").toString();
+            word.startTime = static_cast<qint64>(wordEntry.value("t0").toDouble());
+            word.endTime = static_cast<qint64>(wordEntry.value("t1").toDouble());
+            word.probability = static_cast<float>(wordEntry.value("p").toDouble());
+            segment.words.append(word);
+        }
+        segments.append(segment);
+    }
+
+    // The modification time is the LRU clock
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return true;
+}
+
+void TranscriptCache::store(const QByteArray &key, const QList<TranscriptionSegment> &segments)
+{
+    QJsonArray entries;
+    for (const TranscriptionSegment &segment : segments) {
+        QJsonObject entry;
+        entry["text"] = segment.text;
+        entry["t0"] = static_cast<double>(segment.startTime);
+        entry["t1"] = static_cast<double>(segment.endTime);
+        entry["noSpeech"] = segment.noSpeechProb;
+        if (!segment.words.isEmpty()) {
+            QJsonArray words;
+            for (const TranscriptionWord &word : segment.words) {
+                QJsonObject wordEntry;
+                wordEntry["text"] = word.text;
+                wordEntry["t0"] = static_cast<double>(word.startTime);
+                wordEntry["t1"] = static_cast<double>(word.endTime);
+                wordEntry["p"] = word.probability;
+                words.append(wordEntry);
+            }
+            entry["words"] = words;
+        }
+        entries.append(entry);
+    }
+    QJsonObject root;
+    root["segments"] = entries;
+    const QByteArray data = QJsonDocument(root).toJson(QJsonDocument::Compact);
+
+    const QString path = entryPath(key);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qDebug() << "Cannot write transcript cache entry" << path;
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_totalBytes >= 0) {
+        m_totalBytes += data.size();
+    }
+    if (m_totalBytes < 0 || m_totalBytes > m_maxBytes) {
+        evict();
+    }
+}
+
+void TranscriptCache::evict()
+{
+    // Measure what is there (other processes share the directory), then drop
+    // the least recently used entries down to 90% of the limit
+    struct Entry {
+        QString path;
+        qint64 size;
+        qint64 used;
+    };
+    std::vector<Entry> entries;
+    qint64 total = 0;
+    QDirIterator it(m_directory, {"*.json"}, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QFileInfo info(it.next());
+        entries.push_back({info.absoluteFilePath(), info.size(), info.lastModified().toMSecsSinceEpoch()});
+        total += info.size();
+    }
+
+    if (total > m_maxBytes) {
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.used < b.used; });
+        const qint64 target = m_maxBytes / 10 * 9;
+        int removed = 0;
+        for (const Entry &entry : entries) {
+            if (total <= target) {
+                break;
+            }
+            if (QFile::remove(entry.path)) {
+                total -= entry.size;
+                removed++;
+            }
+        }
+        qDebug() << "Transcript cache: evicted" << removed << "entries," << total / 1024 << "KB left";
+    }
+    m_totalBytes = total;
+}
@@ -0,0 +1,48 @@
+#ifndef TRANSCRIPTCACHE_H
+#define TRANSCRIPTCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <cstddef>
+#include "transcriptionsegment.h"
+
+// On-disk cache of decoded chunks, addressed by the hash of the audio together
+// with the model and the decoding parameters, so re-running a file (or a file
+// that shares chunks with an earlier one) skips inference for what is unchanged.
+// Segment times are stored relative to the chunk. Entries are files; reading one
+// refreshes its modification time, and the least recently used are deleted once
+// the cache grows past its size limit. Safe to use from several threads.
+class TranscriptCache
+{
+public:
+    TranscriptCache(const QString &directory, qint64 maxBytes);
+
+    static QString defaultDirectory();
+
+    // Hex key for a chunk. modelIdentity and params must change whenever the
+    // same audio would decode differently.
+    static QByteArray key(const float *samples, size_t count, const QString &modelIdentity,
+                          const QByteArray &params);
+
+    // Identity of a model file that changes when the file is replaced
+    static QString modelIdentity(const QString &modelName, const QString &modelPath);
+
+    bool lookup(const QByteArray &key, QList<TranscriptionSegment> &segments);
+    void store(const QByteArray &key, const QList<TranscriptionSegment> &segments);
+
+    QString directory() const { return m_directory; }
+    qint64 maxBytes() const { return m_maxBytes; }
+
+private:
+    QString entryPath(const QByteArray &key) const;
+    void evict();
+
+    QString m_directory;
+    qint64 m_maxBytes;
+    qint64 m_totalBytes;        // -1 until the directory has been measured
+    QMutex m_mutex;
+};
+
+#endif // TRANSCRIPTCACHE_H
@@ -0,0 +1,32 @@
+#ifndef TRANSCRIPTIONSEGMENT_H
+#define TRANSCRIPTIONSEGMENT_H
+
+#include <QString>
+#include <QList>
+#include <QMetaType>
+
+// One word of a segment, built from whisper's token timestamps
+struct TranscriptionWord {
+    QString text;
+    qint64 startTime = 0;    // Wall-clock ms since epoch
+    qint64 endTime = 0;
+    float probability = 0.0f; // Mean probability of the word's tokens
+};
+
+// One decoded whisper segment. All times are wall-clock milliseconds since epoch.
+struct TranscriptionSegment {
+    QString text;
+    qint64 timestamp = 0;   // When the segment was decoded
+    qint64 startTime = 0;   // Start of the segment's audio
+    qint64 endTime = 0;     // End of the segment's audio
+    QList<TranscriptionWord> words; // Empty unless word timestamps are enabled
+    quint64 utteranceId = 0; // Speech chunk the segment was decoded from (shared by its segments)
+    bool refined = false;    // Re-decoded by the background refinement model
+    float avgLogprob = 0.0f;   // Mean log-probability of the segment's text tokens
+    float noSpeechProb = 0.0f; // Probability that the segment's audio holds no speech
+    QString translation;     // English translation decoded from the same encoder pass (if enabled)
+};
+
+Q_DECLARE_METATYPE(TranscriptionSegment)
+
+#endif // TRANSCRIPTIONSEGMENT_H
@@ -0,0 +1,186 @@
+#include "wakeworddetector.h"
+#include "sharedmodel.h"
+#include <QRegularExpression>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <vector>
+#include <algorithm>
+
+extern "C" {
+#include "include/whisper.h"
+}
+
+WakeWordDetector::WakeWordDetector()
+    : m_state(nullptr)
+    , m_matchThreshold(0.75)
+    , m_threads(4)
+{
+}
+
+WakeWordDetector::~WakeWordDetector()
+{
+    release();
+}
+
+bool WakeWordDetector::loadModel(const QString &modelPath)
+{
+    if (m_state && modelPath == m_modelPath) {
+        return true;
+    }
+    release();
+
+    m_context = SharedModel::acquire(modelPath, 0, -1);
+    if (m_context) {
+        m_state = whisper_init_state(m_context.get());
+    }
+    if (!m_state) {
+        qDebug() << "Failed to load wake word model:" << modelPath;
+        release();
+        return false;
+    }
+    m_modelPath = modelPath;
+    qDebug() << "Wake word model loaded:" << modelPath;
+    return true;
+}
+
+void WakeWordDetector::release()
+{
+    if (m_state) {
+        whisper_free_state(m_state);
+        m_state = nullptr;
+    }
+    m_context.reset();
+    m_modelPath.clear();
+}
+
+void WakeWordDetector::setPhrase(const QString &phrase)
+{
+    m_phrase = phrase.trimmed();
+    m_phraseWords = normalizedWords(m_phrase);
+}
+
+bool WakeWordDetector::detect(const float *samples, size_t count, const QString &language,
+                              whisper_context *fallback, whisper_state *fallbackState)
+{
+    m_lastText.clear();
+    whisper_context *ctx = m_state ? m_context.get() : fallback;
+    whisper_state *state = m_state ? m_state : fallbackState;
+    if (!ctx || !state || m_phraseWords.isEmpty() || count == 0) {
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The phrase as prompt biases the decoder towards it; a single short segment,
+    // a small token budget and an encoder window sized to the audio keep the
+    // decode to a fraction of a normal one
+    const QByteArray prompt = m_phrase.toUtf8();
+    const QByteArray languageCode = whisper_is_multilingual(ctx) ? language.toLatin1() : QByteArray("en");
+    whisper_full_params wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    wparams.print_progress = false;
+    wparams.print_special = false;
+    wparams.print_realtime = false;
+    wparams.print_timestamps = false;
+    wparams.single_segment = true;
+    wparams.no_context = true;
+    wparams.no_timestamps = true;
+    wparams.n_threads = m_threads;
+    wparams.max_tokens = 8 + 2 * m_phraseWords.size();
+    wparams.temperature_inc = 0.0f;
+    wparams.initial_prompt = prompt.constData();
+    wparams.language = languageCode.constData();
+    wparams.audio_ctx = std::min(static_cast<int>(count * 50 / 16000) + 64, whisper_n_audio_ctx(ctx));
+
+    if (whisper_full_with_state(ctx, state, wparams, samples, static_cast<int>(count)) != 0) {
+        qDebug() << "Wake word decode failed";
+        return false;
+    }
+
+    QString text;
+    for (int i = 0; i < whisper_full_n_segments_from_state(state); ++i) {
+        text += QString::fromUtf8(whisper_full_get_segment_text_from_state(state, i));
+    }
+    m_lastText = text.trimmed();
+
+    const bool found = findPhrase(normalizedWords(m_lastText)) >= 0;
+    qDebug() << "Wake word check:" << m_lastText << (found ? "- matched" : "- no match")
+             << "in" << timer.elapsed() << "ms";
+    return found;
+}
+
+QString WakeWordDetector::stripPhrase(const QString &text) const
+{
+    // Match on normalized words, then drop that many words of the original text
+    const int after = findPhrase(normalizedWords(text));
+    if (after < 0) {
+        return text;
+    }
+
+    QStringList words = text.split(QRegularExpression("\\s+"), Qt::SkipEmptyParts);
+    words = words.mid(std::min<int>(after, words.size()));
+    QString rest = words.join(' ');
+    // "Hey computer, open mail" -> "Open mail"
+    rest.remove(QRegularExpression("^[\\p{P}\\s]+"));
+    if (!rest.isEmpty()) {
+        rest[0] = rest[0].toUpper();
+    }
+    return rest;
+}
+
+QStringList WakeWordDetector::normalizedWords(const QString &text)
+{
+    QStringList words;
+    for (const QString &word : text.toLower().split(QRegularExpression("\\s+"), Qt::SkipEmptyParts)) {
+        QString cleaned = word;
+        cleaned.remove(QRegularExpression("[^\\w']"));
+        // Keep empty entries so word positions match the original text
+        words.append(cleaned);
+    }
+    return words;
+}
+
+double WakeWordDetector::similarity(const QString &a, const QString &b)
+{
+    // 1 - normalized Levenshtein distance
+    const int n = a.size();
+    const int m = b.size();
+    if (n == 0 || m == 0) {
+        return n == m ? 1.0 : 0.0;
+    }
+
+    std::vector<int> previous(m + 1), current(m + 1);
+    for (int j = 0; j <= m; ++j) {
+        previous[j] = j;
+    }
+    for (int i = 1; i <= n; ++i) {
+        current[0] = i;
+        for (int j = 1; j <= m; ++j) {
+            const int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+        }
+        std::swap(previous, current);
+    }
+    return 1.0 - static_cast<double>(previous[m]) / std::max(n, m);
+}
+
+int WakeWordDetector::findPhrase(const QStringList &words) const
+{
+    // Slide over the transcript comparing runs of about the phrase's length, so
+    // "hey computer" also matches "hey, compute her" or "heycomputer"
+    const QString target = m_phraseWords.join(' ');
+    const int phraseLength = m_phraseWords.size();
+    for (int start = 0; start < words.size(); ++start) {
+        for (int length = std::max(1, phraseLength - 1); length <= phraseLength + 1; ++length) {
+            if (start + length > words.size()) {
+                break;
+            }
+            QStringList run = words.mid(start, length);
+            run.removeAll(QString());
+            if (similarity(run.join(' '), target) >= m_matchThreshold) {
+                return start + length;
+            }
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,61 @@
+#ifndef WAKEWORDDETECTOR_H
+#define WAKEWORDDETECTOR_H
+
+#include <QString>
+#include <QStringList>
+#include <cstddef>
+#include <memory>
+
+struct whisper_context;
+struct whisper_state;
+
+// Keyword spotting for the low-power listening mode: short bursts of speech are
+// decoded with a tiny model, biased towards the wake phrase, and the result is
+// fuzzy-matched against the phrase. Only after a match does the configured
+// model get to see any audio.
+class WakeWordDetector
+{
+public:
+    WakeWordDetector();
+    ~WakeWordDetector();
+
+    // Load the small model used for spotting (CPU only, it is cheap enough)
+    bool loadModel(const QString &modelPath);
+    void release();
+    bool isLoaded() const { return m_state != nullptr; }
+    QString modelPath() const { return m_modelPath; }
+
+    void setPhrase(const QString &phrase);
+    QString phrase() const { return m_phrase; }
+    
+    // CPU threads for the spotting decode, as many as the live decodes get
+    void setThreadCount(int threads) { m_threads = threads; }
+
+    // Decode 16 kHz samples and look for the phrase. Uses the spotting model, or
+    // the given context and state when none is loaded.
+    bool detect(const float *samples, size_t count, const QString &language,
+                whisper_context *fallback, whisper_state *fallbackState);
+
+    // Text decoded by the last detect() call
+    QString lastText() const { return m_lastText; }
+
+    // Remove the wake phrase (and anything before it) from a transcript
+    QString stripPhrase(const QString &text) const;
+
+private:
+    static QStringList normalizedWords(const QString &text);
+    static double similarity(const QString &a, const QString &b);
+    // Index of the first transcript word after the phrase, or -1 if it isn't there
+    int findPhrase(const QStringList &words) const;
+
+    std::shared_ptr<whisper_context> m_context;
+    whisper_state *m_state;
+    QString m_modelPath;
+    QString m_phrase;
+    QStringList m_phraseWords;
+    QString m_lastText;
+    double m_matchThreshold;   // Minimum similarity (0-1) to count as the phrase
+    int m_threads;
+};
+
+#endif // WAKEWORDDETECTOR_H
@@ -3,6 +3,12 @@
 #include <QDir>
 #include <QStandardPaths>
 #include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <algorithm>
 
 WhisperModels::WhisperModels(QObject *parent)
     : QObject(parent)
@@ -13,22 +19,104 @@ WhisperModels::~WhisperModels()
 {
 }
 
+QList<ModelInfo> WhisperModels::catalog()
+{
+    // Read once; the decoder threads ask for model details too
+    static const QList<ModelInfo> models = loadCatalog();
+    return models;
+}
+
+QString WhisperModels::userManifestPath()
+{
+    return QFileInfo(ConfigManager::instance().getConfigFilePath()).dir().filePath("models.json");
+}
+
+QList<ModelInfo> WhisperModels::loadCatalog()
+{
+    QList<ModelInfo> models;
+    readManifest(":/models.json", models);
+    if (QFile::exists(userManifestPath())) {
+        readManifest(userManifestPath(), models);
+    }
+    qDebug() << "Model catalog:" << models.size() << "models";
+    return models;
+}
+
+void WhisperModels::readManifest(const QString &path, QList<ModelInfo> &models)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Cannot open model manifest" << path << ":" << file.errorString();
+        return;
+    }
+    
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (doc.isNull()) {
+        qDebug() << "Invalid model manifest" << path << ":" << error.errorString();
+        return;
+    }
+    
+    for (const QJsonValue &value : doc.object().value("models").toArray()) {
+        const QJsonObject entry = value.toObject();
+        ModelInfo info;
+        info.name = entry.value("name").toString().trimmed();
+        if (info.name.isEmpty()) {
+            continue;
+        }
+        info.file = entry.value("file").toString(QString("ggml-%1.bin").arg(info.name));
+        info.url = entry.value("url").toString();
+        info.size = static_cast<qint64>(entry.value("sizeMB").toDouble() * 1024 * 1024);
+        info.sha256 = entry.value("sha256").toString().toLower();
+        info.memory = static_cast<size_t>(entry.value("memoryMB").toDouble(200) * 1024 * 1024);
+        info.speed = entry.value("speed").toString("medium");
+        info.description = entry.value("description").toString(info.name);
+        info.multilingual = entry.value("multilingual").toBool(!info.name.endsWith(".en"));
+        info.maxChunkSeconds = entry.value("maxChunkSeconds").toInt(0);
+        
+        // Later manifests replace entries of the same name
+        auto existing = std::find_if(models.begin(), models.end(),
+                                     [&info](const ModelInfo &m) { return m.name == info.name; });
+        if (existing != models.end()) {
+            *existing = info;
+        } else {
+            models.append(info);
+        }
+    }
+}
+
+ModelInfo WhisperModels::modelInfo(const QString &modelName)
+{
+    for (const ModelInfo &info : catalog()) {
+        if (info.name == modelName) {
+            return info;
+        }
+    }
+    
+    // A model file installed by hand under the usual name
+    ModelInfo info;
+    info.name = modelName;
+    info.file = modelName.startsWith("ggml-") ? modelName : QString("ggml-%1.bin").arg(modelName);
+    info.memory = static_cast<size_t>(200) * 1024 * 1024;
+    info.speed = "medium";
+    info.description = "Custom model";
+    info.multilingual = !modelName.endsWith(".en");
+    return info;
+}
+
 QStringList WhisperModels::availableModels()
 {
-    return QStringList{
-        "tiny.en", "tiny",
-        "base.en", "base",
-        "small.en", "small",
-        "medium.en", "medium",
-        "large-v1", "large-v2", "large-v3",
-        "turbo"
-    };
+    QStringList names;
+    for (const ModelInfo &info : catalog()) {
+        names.append(info.name);
+    }
+    return names;
 }
 
 QString WhisperModels::modelPath(const QString &modelName)
 {
-    // Use ConfigManager to get the model path
-    return ConfigManager::instance().getModelPath(modelName);
+    // Use ConfigManager to get the models directory, the manifest for the file name
+    return QDir(ConfigManager::instance().getModelsDirectory()).filePath(modelInfo(modelName).file);
 }
 
 bool WhisperModels::isModelDownloaded(const QString &modelName)
@@ -38,39 +126,11 @@ bool WhisperModels::isModelDownloaded(const QString &modelName)
 
 QString WhisperModels::modelDescription(const QString &modelName)
 {
-    if (modelName.contains("tiny")) {
-        return "Tiny: Fastest, least accurate (~39 MB)";
-    } else if (modelName.contains("base")) {
-        return "Base: Fast, good accuracy (~74 MB)";
-    } else if (modelName.contains("small")) {
-        return "Small: Balanced speed/accuracy (~244 MB)";
-    } else if (modelName.contains("medium")) {
-        return "Medium: Slower, better accuracy (~769 MB)";
-    } else if (modelName.contains("large")) {
-        return "Large: Slowest, best accuracy (~1550 MB)";
-    } else if (modelName.contains("turbo")) {
-        return "Turbo: Fast, high quality (~809 MB)";
-    }
-    return "Unknown model";
+    return modelInfo(modelName).description;
 }
 
 size_t WhisperModels::getModelMemoryRequirement(const QString &modelName)
 {
-    // Return memory requirements in bytes
-    // These are approximate values based on model sizes plus runtime overhead
-    // We add ~2x overhead for runtime memory usage
-    if (modelName.contains("tiny")) {
-        return static_cast<size_t>(100) * 1024 * 1024;  // ~100 MB
-    } else if (modelName.contains("base")) {
-        return static_cast<size_t>(200) * 1024 * 1024;  // ~200 MB
-    } else if (modelName.contains("small")) {
-        return static_cast<size_t>(600) * 1024 * 1024;  // ~600 MB
-    } else if (modelName.contains("medium")) {
-        return static_cast<size_t>(1800) * 1024 * 1024; // ~1.8 GB
-    } else if (modelName.contains("large")) {
-        return static_cast<size_t>(3500) * 1024 * 1024; // ~3.5 GB
-    } else if (modelName.contains("turbo")) {
-        return static_cast<size_t>(1900) * 1024 * 1024; // ~1.9 GB
-    }
-    return static_cast<size_t>(200) * 1024 * 1024; // Default ~200 MB
+    // Model size plus runtime overhead, in bytes
+    return modelInfo(modelName).memory;
 }
@@ -4,8 +4,33 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QList>
 #include <cstddef>
 
+// One entry of the model manifest
+struct ModelInfo {
+    QString name;
+    QString file;                 // File name in the models directory
+    QString url;                  // Empty for models installed by hand
+    qint64 size = 0;              // Download size in bytes
+    QString sha256;               // Hex digest, checked after download when set
+    size_t memory = 0;            // Runtime memory need in bytes
+    QString speed;                // "fastest", "fast", "medium" or "slow"
+    QString description;
+    bool multilingual = true;
+    int maxChunkSeconds = 0;      // Longest chunk the model transcribes well; 0 = no limit
+
+    bool isValid() const { return !name.isEmpty(); }
+};
+
+// The model catalog comes from the manifest built into the application
+// (resources/models.json) merged with an optional models.json next to the
+// config file, whose entries add models or override built-in ones by name:
+//
+//     { "models": [ { "name": "distil-medium.en", "url": "https://...",
+//                     "sizeMB": 789, "memoryMB": 1000, "speed": "medium",
+//                     "multilingual": false, "maxChunkSeconds": 25,
+//                     "sha256": "...", "description": "..." } ] }
 class WhisperModels : public QObject
 {
     Q_OBJECT
@@ -19,6 +44,15 @@ public:
     static bool isModelDownloaded(const QString &modelName);
     static QString modelDescription(const QString &modelName);
     static size_t getModelMemoryRequirement(const QString &modelName);
+    
+    // Manifest entry for a model; names missing from the manifest get defaults
+    static ModelInfo modelInfo(const QString &modelName);
+    static QList<ModelInfo> catalog();
+    static QString userManifestPath();
+
+private:
+    static QList<ModelInfo> loadCatalog();
+    static void readManifest(const QString &path, QList<ModelInfo> &models);
 };
 
 #endif // WHISPERMODELS_H
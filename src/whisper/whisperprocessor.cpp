@@ -1,12 +1,20 @@
 #include "whisperprocessor.h"
-#include "../ui/configwidget.h"
+#include "../config/audioconfiguration.h"
+#include "../config/configmanager.h"
+#include "whispermodels.h"
+#include "sharedmodel.h"
+#include "../ipc/inferenceworker.h"
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
 #include <QStandardPaths>
+#include <QThread>
 #include <vector>
 #include <cmath>
+#include <algorithm>
 
 // Include whisper.cpp header
 extern "C" {
@@ -18,8 +26,9 @@ WhisperProcessor::WhisperProcessor(QObject *parent)
     , m_modelLoaded(false)
     , m_computeDeviceType(0)  // Default to CPU
     , m_computeDeviceId(-1)
+    , m_threads(std::min(std::max(1, QThread::idealThreadCount()), 8))  // ggml gains little past 8
     , m_whisperContext(nullptr)
-    , m_contextParams(nullptr)
+    , m_whisperState(nullptr)
     , m_pickupThreshold(0.01f)  // Default VAD threshold
     , m_minSpeechDuration(5000)  // Default 5 seconds min
     , m_maxSpeechDuration(5000)  // Default 5 seconds max
@@ -27,16 +36,85 @@ WhisperProcessor::WhisperProcessor(QObject *parent)
     , m_isRecording(false)
     , m_lastSoundTime(0)
     , m_speechStartTime(0)
+    , m_pushToTalk(false)
+    , m_pushToTalkPreRoll(500)
+    , m_maxChunkDuration(0)
+    , m_wakeWordEnabled(false)
+    , m_awake(false)
+    , m_awakeUntil(0)
+    , m_wakeWindow(10000)
+    , m_stripWakePhrase(false)
+    , m_commandMode(false)
+    , m_commandNoSpeechThreshold(0.6f)
+    , m_abortGeneration(0)
+    , m_decodeGeneration(0)
+    , m_decodeDeadline(0)
+    , m_maxDecodeLag(0)          // Never drop segments by default
+    , m_decodeAudioStart(0)
+    , m_segmentsEmitted(0)
+    , m_decodingProfile(DecodingProfile::preset("balanced"))
+    , m_promptTokenLimit(64)
+    , m_promptResetSilence(10000)  // Forget the context after 10 s without speech
+    , m_lastCommitTime(0)
+    , m_language("en")
+    , m_languageThreshold(0.6f)
+    , m_lastLanguageUse(0)
+    , m_segmentProbabilitySum(0.0)
+    , m_segmentTokenCount(0)
+    , m_utteranceId(0)
+    , m_refinementEnabled(false)
+    , m_refineLogprobThreshold(-0.5f)
+    , m_refineNoSpeechThreshold(0.6f)   // whisper's own no-speech cut-off
+    , m_utteranceUncertain(false)
+    , m_audioDecodedSeconds(0.0)
+    , m_audioEscalatedSeconds(0.0)
+    , m_wordTimestamps(false)
+    , m_melStream(new MelStream)
+    , m_melThread(new QThread)
+    , m_melStreaming(false)
+    , m_capturePosition(0)
+    , m_compacted(false)
+    , m_reduceAudioContext(false)
+    , m_translateAlongside(false)
+    , m_tierAdaptive(false)
+    , m_remoteInference(new RemoteInference(this))
+    , m_localOnly(false)
+    , m_wakePhraseUtterance(0)
+    , m_inferenceWorker(new InferenceWorker(this))
+    , m_workerMode(false)
+    , m_streamStartTime(0)
+    , m_samplesReceived(0)
 {
+    connect(m_remoteInference, &RemoteInference::chunkDecoded, this, &WhisperProcessor::onRemoteChunkDecoded);
+    connect(m_remoteInference, &RemoteInference::chunkFailed, this, &WhisperProcessor::onRemoteChunkFailed);
+    connect(m_inferenceWorker, &InferenceWorker::transcriptionReady, this, &WhisperProcessor::transcriptionReady);
+    connect(m_inferenceWorker, &InferenceWorker::statusChanged, this, &WhisperProcessor::statusChanged);
+    connect(m_inferenceWorker, &InferenceWorker::modelNotFound, this, &WhisperProcessor::modelNotFound);
+    connect(m_inferenceWorker, &InferenceWorker::utteranceDecoded, this, &WhisperProcessor::utteranceDecoded);
+    connect(m_inferenceWorker, &InferenceWorker::commandRecognized, this, &WhisperProcessor::commandRecognized);
+    m_wakeWordDetector.setThreadCount(m_threads);
+    
+    m_melStream->moveToThread(m_melThread);
+    m_melThread->start();
 }
 
 WhisperProcessor::~WhisperProcessor()
 {
     releaseWhisperContext();
+    m_melThread->quit();
+    m_melThread->wait();
+    delete m_melStream;
+    delete m_melThread;
 }
 
 void WhisperProcessor::processAudio(const QByteArray &audioData)
 {
+    m_capturePosition += audioData.size() / sizeof(int16_t);
+    if (m_workerMode) {
+        m_inferenceWorker->writeAudio(audioData);
+        return;
+    }
+    
     if (!m_modelLoaded || !m_whisperContext) {
         qDebug() << "Model not loaded or context not initialized, skipping audio processing";
         return;
@@ -57,14 +135,57 @@ void WhisperProcessor::processAudio(const QByteArray &audioData)
     }
     avgAmplitude /= sampleCount;
     
-    // Add samples to buffer
+    // Add samples to buffer; the utterance being recorded goes to the mel stream too
     m_audioBuffer.insert(m_audioBuffer.end(), samples.begin(), samples.end());
+    if (m_melStreaming) {
+        QMetaObject::invokeMethod(m_melStream, [melStream = m_melStream, samples = std::move(samples)]() {
+            melStream->append(samples);
+        }, Qt::QueuedConnection);
+    }
     
     qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
     
+    // Advance the audio clock; (re)base it so the newest sample lines up with now
+    if (m_streamStartTime == 0) {
+        m_streamStartTime = currentTime - (sampleCount * 1000LL) / 16000;
+        m_samplesReceived = 0;
+    }
+    m_samplesReceived += sampleCount;
+    
+    // Push-to-talk: the span is decided by the key, not by the signal level
+    if (m_pushToTalk) {
+        if (m_isRecording && m_maxChunkDuration > 0 &&
+            m_audioBuffer.size() >= static_cast<size_t>(m_maxChunkDuration) * 16) {
+            // The model can't take the whole span in one piece; decode what
+            // we have and keep listening
+            qDebug() << "Push-to-talk span reached the model's chunk limit of" << m_maxChunkDuration << "ms";
+            processAccumulatedAudio();
+            // The samples since the last frame boundary are decoded again with
+            // the rest, so the span goes on from the stream's frame grid
+            const size_t carried = std::min(m_audioBuffer.size(),
+                                            static_cast<size_t>(m_capturePosition % StreamingMel::kHopLength));
+            m_audioBuffer.erase(m_audioBuffer.begin(), m_audioBuffer.end() - carried);
+            startStreamedMel();
+        } else if (!m_isRecording) {
+            const size_t preRoll = static_cast<size_t>(m_pushToTalkPreRoll) * 16;
+            if (m_audioBuffer.size() > preRoll) {
+                m_audioBuffer.erase(m_audioBuffer.begin(), m_audioBuffer.end() - preRoll);
+            }
+        }
+        return;
+    }
+    
     // Voice Activity Detection - use average amplitude for better detection
     bool hasSound = avgAmplitude > m_pickupThreshold;
     
+    // The listening window closes after a stretch without transcribed speech
+    if (m_wakeWordEnabled && m_awake && !m_isRecording && currentTime > m_awakeUntil) {
+        m_awake = false;
+        qDebug() << "Wake window closed";
+        emit statusChanged(QString("Waiting for wake word \"%1\"").arg(m_wakeWordDetector.phrase()));
+    }
+    const bool asleep = m_wakeWordEnabled && !m_awake;
+    
     // Debug output every second
     static qint64 lastDebugTime = 0;
     if (currentTime - lastDebugTime > 1000) {
@@ -87,6 +208,9 @@ void WhisperProcessor::processAudio(const QByteArray &audioData)
         if (!m_isRecording) {
             // Start recording
             m_isRecording = true;
+            if (!asleep) {
+                startStreamedMel();  // The spotting decode is too short to benefit
+            }
             m_speechStartTime = currentTime;
             qDebug() << "Speech detected, starting recording at threshold:" << m_pickupThreshold;
         }
@@ -100,10 +224,15 @@ void WhisperProcessor::processAudio(const QByteArray &audioData)
         bool shouldStop = false;
         QString stopReason;
         
-        // Process if we've reached max duration
-        if (speechDuration >= m_maxSpeechDuration) {
+        // Process if we've reached max duration; while waiting for the wake word
+        // only short bursts are needed
+        int maxDuration = asleep ? std::min(m_maxSpeechDuration, 3000) : m_maxSpeechDuration;
+        if (m_maxChunkDuration > 0) {
+            maxDuration = std::min(maxDuration, m_maxChunkDuration);
+        }
+        if (speechDuration >= maxDuration) {
             shouldStop = true;
-            stopReason = QString("max duration reached (%1ms)").arg(m_maxSpeechDuration);
+            stopReason = QString("max duration reached (%1ms)").arg(maxDuration);
         }
         // Or if we have silence after minimum duration
         else if (silenceDuration >= m_silenceDuration && speechDuration >= m_minSpeechDuration) {
@@ -118,10 +247,15 @@ void WhisperProcessor::processAudio(const QByteArray &audioData)
                      << "(" << (m_audioBuffer.size() / 16000.0) << "seconds)";
             
             // Process the accumulated audio
-            processAccumulatedAudio();
+            if (asleep) {
+                checkWakeWord();
+            } else {
+                processAccumulatedAudio();
+            }
             
             // Reset for next speech segment
             m_audioBuffer.clear();
+            stopStreamedMel();
             m_isRecording = false;
             m_speechStartTime = 0;
         }
@@ -133,12 +267,394 @@ void WhisperProcessor::processAudio(const QByteArray &audioData)
     }
 }
 
+void WhisperProcessor::requestAbort()
+{
+    m_abortGeneration.fetch_add(1);
+    // Any thread: the flag is atomic and the worker's abort is an eventfd write
+    if (m_workerMode.load()) {
+        m_inferenceWorker->requestAbort();
+    }
+}
+
+void WhisperProcessor::resetAudioClock()
+{
+    if (m_workerMode) {
+        m_inferenceWorker->resetAudioClock();
+        return;
+    }
+    
+    // Called when capture pauses/stops; the next chunk rebases the clock so the gap
+    // is not mistaken for inference falling behind
+    m_streamStartTime = 0;
+    m_samplesReceived = 0;
+}
+
+qint64 WhisperProcessor::audioClock() const
+{
+    if (m_streamStartTime == 0) {
+        return QDateTime::currentMSecsSinceEpoch();
+    }
+    return m_streamStartTime + (m_samplesReceived * 1000) / 16000;
+}
+
+const std::vector<float> &WhisperProcessor::decodeAudio() const
+{
+    return m_compacted ? m_silenceCompactor.samples() : m_audioBuffer;
+}
+
+qint64 WhisperProcessor::audioTime(qint64 offsetMs) const
+{
+    // Offsets into the decoded audio, mapped back to the recording when pauses were cut
+    return m_decodeAudioStart + (m_compacted ? m_silenceCompactor.toOriginal(offsetMs) : offsetMs);
+}
+
+bool WhisperProcessor::shouldAbort() const
+{
+    if (m_abortGeneration.load() != m_decodeGeneration || m_runawayGuard.isTripped()) {
+        return true;
+    }
+    return m_decodeDeadline > 0 && QDateTime::currentMSecsSinceEpoch() > m_decodeDeadline;
+}
+
+bool WhisperProcessor::abortCallback(void *userData)
+{
+    // Polled by ggml between graph nodes, possibly from its worker threads
+    return static_cast<const WhisperProcessor*>(userData)->shouldAbort();
+}
+
+bool WhisperProcessor::encoderBeginCallback(whisper_context *ctx, whisper_state *state, void *userData)
+{
+    Q_UNUSED(ctx)
+    Q_UNUSED(state)
+    // Returning false skips the encoder entirely (e.g. on temperature fallback retries)
+    return !static_cast<const WhisperProcessor*>(userData)->shouldAbort();
+}
+
+void WhisperProcessor::newSegmentCallback(whisper_context *ctx, whisper_state *state, int nNew, void *userData)
+{
+    WhisperProcessor *self = static_cast<WhisperProcessor*>(userData);
+    
+    // Stream the new segments out immediately rather than waiting for whisper_full to return
+    const int nSegments = whisper_full_n_segments_from_state(state);
+    for (int i = std::max(0, nSegments - nNew); i < nSegments; ++i) {
+        const char* text = whisper_full_get_segment_text_from_state(state, i);
+        if (!text) {
+            continue;
+        }
+        
+        QString segmentText = QString::fromUtf8(text).trimmed();
+        qDebug() << "Segment" << i << ":" << segmentText;
+        
+        // The burst that woke us up starts with the wake phrase
+        if (self->m_stripWakePhrase && !segmentText.isEmpty()) {
+            self->m_stripWakePhrase = false;
+            segmentText = self->m_wakeWordDetector.stripPhrase(segmentText);
+        }
+        
+        if (segmentText.isEmpty() || segmentText == "[BLANK_AUDIO]") {
+            continue;
+        }
+        
+        // Segment times are in units of 10 ms relative to the start of the buffer
+        TranscriptionSegment segment;
+        segment.text = segmentText;
+        segment.timestamp = QDateTime::currentMSecsSinceEpoch();
+        segment.startTime = self->audioTime(whisper_full_get_segment_t0_from_state(state, i) * 10);
+        segment.endTime = self->audioTime(whisper_full_get_segment_t1_from_state(state, i) * 10);
+        segment.utteranceId = self->m_utteranceId;
+        
+        // Confidence of the text tokens: the decode-wide average probability tells
+        // whether the (cached) language still fits, the per-segment log-probability
+        // decides whether the segment is worth a larger model
+        const whisper_token eot = whisper_token_eot(ctx);
+        const int nTokens = whisper_full_n_tokens_from_state(state, i);
+        double logprobSum = 0.0;
+        int textTokens = 0;
+        for (int j = 0; j < nTokens; ++j) {
+            const whisper_token_data data = whisper_full_get_token_data_from_state(state, i, j);
+            if (data.id < eot) {
+                self->m_segmentProbabilitySum += data.p;
+                self->m_segmentTokenCount++;
+                logprobSum += data.plog;
+                textTokens++;
+            }
+        }
+        segment.avgLogprob = textTokens > 0 ? static_cast<float>(logprobSum / textTokens) : 0.0f;
+        segment.noSpeechProb = whisper_full_get_segment_no_speech_prob_from_state(state, i);
+        
+        if (segment.avgLogprob < self->m_refineLogprobThreshold ||
+            segment.noSpeechProb > self->m_refineNoSpeechThreshold) {
+            self->m_utteranceUncertain = true;
+        }
+        
+        if (self->m_wordTimestamps) {
+            // Word times come back relative to the decoded audio; map them through
+            // the silence compaction to the recording
+            segment.words = collectWords(ctx, state, i, 0);
+            for (TranscriptionWord &word : segment.words) {
+                word.startTime = self->audioTime(word.startTime);
+                word.endTime = self->audioTime(word.endTime);
+            }
+        }
+        
+        self->m_segmentsEmitted++;
+        self->commitPromptTokens(state, i);
+        self->m_lastCommitTime = segment.endTime;
+        self->m_lastLanguageUse = segment.endTime;
+        emit self->transcriptionReady(segment);
+    }
+}
+
+QList<TranscriptionWord> WhisperProcessor::collectWords(whisper_context *ctx, whisper_state *state,
+                                                        int segment, qint64 audioStart)
+{
+    QList<TranscriptionWord> words;
+    
+    // Whisper's BPE tokens carry the leading space of the word they begin, so a
+    // token starting with a space (or the first token) opens a new word. Bytes are
+    // gathered before decoding because a token may hold only part of a UTF-8 character.
+    QByteArray wordBytes;
+    TranscriptionWord word;
+    float probabilitySum = 0.0f;
+    int tokenCount = 0;
+    
+    auto flushWord = [&]() {
+        QString text = QString::fromUtf8(wordBytes).trimmed();
+        if (!text.isEmpty() && tokenCount > 0) {
+            word.text = text;
+            word.probability = probabilitySum / tokenCount;
+            words.append(word);
+        }
+        wordBytes.clear();
+        probabilitySum = 0.0f;
+        tokenCount = 0;
+    };
+    
+    const whisper_token eot = whisper_token_eot(ctx);
+    const int nTokens = whisper_full_n_tokens_from_state(state, segment);
+    for (int j = 0; j < nTokens; ++j) {
+        const whisper_token_data data = whisper_full_get_token_data_from_state(state, segment, j);
+        if (data.id >= eot) {
+            continue; // Timestamp and control tokens
+        }
+        
+        const char *piece = whisper_full_get_token_text_from_state(ctx, state, segment, j);
+        if (!piece || !*piece) {
+            continue;
+        }
+        
+        // Token times are in units of 10 ms relative to the start of the buffer
+        const qint64 t0 = audioStart + data.t0 * 10;
+        const qint64 t1 = audioStart + data.t1 * 10;
+        
+        if (piece[0] == ' ' || tokenCount == 0) {
+            flushWord();
+            word.startTime = t0;
+        }
+        wordBytes.append(piece);
+        word.endTime = std::max(word.startTime, t1);
+        probabilitySum += data.p;
+        tokenCount++;
+    }
+    flushWord();
+    
+    return words;
+}
+
+void WhisperProcessor::logitsFilterCallback(whisper_context *ctx, whisper_state *state,
+                                            const whisper_token_data *tokens, int nTokens,
+                                            float *logits, void *userData)
+{
+    Q_UNUSED(state)
+    Q_UNUSED(logits)
+    WhisperProcessor *self = static_cast<WhisperProcessor*>(userData);
+    if (!self->m_runawayGuard.isEnabled()) {
+        return;
+    }
+    
+    // Called before every sampled token with the decoder's output so far; only the
+    // text tokens matter for loop detection (EOT and above are special/timestamps)
+    const whisper_token eot = whisper_token_eot(ctx);
+    std::vector<int> textTokens;
+    textTokens.reserve(nTokens);
+    for (int i = 0; i < nTokens; ++i) {
+        if (tokens[i].id < eot) {
+            textTokens.push_back(tokens[i].id);
+        }
+    }
+    
+    // Tripping makes the abort callback stop the decode at the next graph node
+    self->m_runawayGuard.check(textTokens);
+}
+
+void WhisperProcessor::commitPromptTokens(whisper_state *state, int segment)
+{
+    if (m_promptTokenLimit <= 0 || !m_whisperContext) {
+        return;
+    }
+    
+    // Keep only text tokens; special and timestamp tokens start at EOT
+    const whisper_token eot = whisper_token_eot(m_whisperContext);
+    const int nTokens = whisper_full_n_tokens_from_state(state, segment);
+    for (int i = 0; i < nTokens; ++i) {
+        whisper_token id = whisper_full_get_token_id_from_state(state, segment, i);
+        if (id < eot) {
+            m_promptTokens.push_back(id);
+        }
+    }
+    
+    while (static_cast<int>(m_promptTokens.size()) > m_promptTokenLimit) {
+        m_promptTokens.pop_front();
+    }
+}
+
+void WhisperProcessor::resetPromptContext(const QString &reason)
+{
+    if (!m_promptTokens.empty()) {
+        qDebug() << "Resetting prompt context:" << reason;
+    }
+    m_promptTokens.clear();
+    m_remotePrompt.clear();
+    m_lastCommitTime = 0;
+}
+
+QString WhisperProcessor::resolveLanguage()
+{
+    // English-only models can't do anything else
+    if (!whisper_is_multilingual(m_whisperContext)) {
+        return "en";
+    }
+    if (m_language != "auto") {
+        return m_language;
+    }
+    
+    // A long pause may mean a new speaker; check the language again
+    if (!m_detectedLanguage.isEmpty() && m_lastLanguageUse > 0 &&
+        m_decodeAudioStart - m_lastLanguageUse > m_promptResetSilence) {
+        invalidateDetectedLanguage("long silence");
+    }
+    
+    if (!m_detectedLanguage.isEmpty()) {
+        return m_detectedLanguage;
+    }
+    
+    // Language ID runs the encoder on the mel of this segment, so it is only done
+    // until a confident result has been cached for the session
+    const std::vector<float> &audio = decodeAudio();
+    if (whisper_pcm_to_mel_with_state(m_whisperContext, m_whisperState, audio.data(), audio.size(), m_threads) != 0) {
+        qDebug() << "Language detection failed: could not compute mel spectrogram";
+        return "en";
+    }
+    
+    std::vector<float> probabilities(whisper_lang_max_id() + 1, 0.0f);
+    int languageId = whisper_lang_auto_detect_with_state(m_whisperContext, m_whisperState, 0, m_threads, probabilities.data());
+    if (languageId < 0) {
+        qDebug() << "Language detection failed with error code:" << languageId;
+        return "en";
+    }
+    
+    QString language = QString::fromLatin1(whisper_lang_str(languageId));
+    float probability = probabilities[languageId];
+    qDebug() << "Detected language:" << language << "probability:" << probability;
+    
+    if (probability >= m_languageThreshold) {
+        m_detectedLanguage = language;
+        m_lastLanguageUse = 0;
+        emit statusChanged(QString("Detected language: %1 (%2%)")
+                           .arg(QString::fromLatin1(whisper_lang_str_full(languageId)))
+                           .arg(qRound(probability * 100)));
+    }
+    
+    return language;
+}
+
+void WhisperProcessor::invalidateDetectedLanguage(const QString &reason)
+{
+    if (!m_detectedLanguage.isEmpty()) {
+        qDebug() << "Re-detecting language:" << reason;
+    }
+    m_detectedLanguage.clear();
+    m_lastLanguageUse = 0;
+}
+
+void WhisperProcessor::checkWakeWord()
+{
+    const QString language = !m_detectedLanguage.isEmpty() ? m_detectedLanguage : m_language;
+    if (!m_wakeWordDetector.detect(m_audioBuffer.data(), m_audioBuffer.size(), language, m_whisperContext, m_whisperState)) {
+        return;
+    }
+    
+    m_awake = true;
+    m_awakeUntil = QDateTime::currentMSecsSinceEpoch() + m_wakeWindow;
+    qDebug() << "Wake word heard, listening for" << m_wakeWindow << "ms";
+    emit statusChanged(QString("Wake word heard - listening for %1 s").arg(m_wakeWindow / 1000));
+    
+    // "Hey computer, open the calendar" in one breath: the rest of the burst is
+    // already part of what should be transcribed
+    if (!m_wakeWordDetector.stripPhrase(m_wakeWordDetector.lastText()).isEmpty()) {
+        m_stripWakePhrase = true;
+        processAccumulatedAudio();
+        m_stripWakePhrase = false;
+    }
+}
+
+void WhisperProcessor::pushToTalkPressed()
+{
+    if (m_workerMode) {
+        m_inferenceWorker->pushToTalkPressed();
+        return;
+    }
+    
+    if (!m_pushToTalk || m_isRecording) {
+        return;
+    }
+    
+    // Capture is already running, so the pre-roll in the buffer becomes the
+    // start of the utterance and nothing is lost to device start-up
+    qDebug() << "Push-to-talk pressed -" << m_audioBuffer.size() / 16 << "ms of pre-roll";
+    m_isRecording = true;
+    m_speechStartTime = QDateTime::currentMSecsSinceEpoch();
+    startStreamedMel();
+    emit statusChanged("Push-to-talk: listening");
+}
+
+void WhisperProcessor::pushToTalkReleased()
+{
+    if (m_workerMode) {
+        m_inferenceWorker->pushToTalkReleased();
+        return;
+    }
+    
+    if (!m_pushToTalk || !m_isRecording) {
+        return;
+    }
+    
+    qDebug() << "Push-to-talk released -" << m_audioBuffer.size() / 16000.0 << "seconds to decode";
+    emit statusChanged("Push-to-talk: transcribing");
+    processAccumulatedAudio();
+    
+    m_audioBuffer.clear();
+    stopStreamedMel();
+    m_isRecording = false;
+    m_speechStartTime = 0;
+}
+
 void WhisperProcessor::finishRecording()
 {
+    if (m_workerMode) {
+        m_inferenceWorker->finishRecording();
+        return;
+    }
+    
     qDebug() << "finishRecording() called - Processing any remaining audio";
     
     // If we have audio in the buffer and we're currently recording, process it immediately
-    if (m_isRecording && !m_audioBuffer.empty()) {
+    if (m_wakeWordEnabled && !m_awake) {
+        // Nothing has been addressed to us
+        m_audioBuffer.clear();
+        m_isRecording = false;
+        m_speechStartTime = 0;
+    } else if (m_isRecording && !m_audioBuffer.empty()) {
         qDebug() << "Processing remaining audio buffer on stop - Buffer size:" << m_audioBuffer.size() 
                  << "samples (" << (m_audioBuffer.size() / 16000.0) << "seconds)";
         
@@ -149,6 +665,9 @@ void WhisperProcessor::finishRecording()
         m_audioBuffer.clear();
         m_isRecording = false;
         m_speechStartTime = 0;
+    } else if (m_pushToTalk) {
+        // Only pre-roll; the key was never pressed
+        m_audioBuffer.clear();
     } else if (!m_audioBuffer.empty()) {
         qDebug() << "Processing remaining audio buffer (not actively recording) - Buffer size:" << m_audioBuffer.size() 
                  << "samples (" << (m_audioBuffer.size() / 16000.0) << "seconds)";
@@ -159,74 +678,646 @@ void WhisperProcessor::finishRecording()
     } else {
         qDebug() << "No audio to process on stop";
     }
+    stopStreamedMel();
+    
+    resetAudioClock();
+    resetPromptContext("recording stopped");
+    invalidateDetectedLanguage("recording stopped");
 }
 
-void WhisperProcessor::processAccumulatedAudio()
+void WhisperProcessor::processAccumulatedAudio(qint64 audioEnd)
 {
     if (m_audioBuffer.empty() || !m_whisperContext) {
         qDebug() << "Cannot process: buffer empty or no context";
+        stopStreamedMel();
+        return;
+    }
+    
+    if (m_commandMode) {
+        decodeCommand();
         return;
     }
     
     qDebug() << "Processing accumulated audio - Buffer size:" << m_audioBuffer.size() 
              << "samples (" << (m_audioBuffer.size() / 16000.0) << "seconds)";
     
-    // Process with whisper
-    whisper_full_params wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    // Capture the abort generation so only requests made from now on cancel this decode
+    m_decodeGeneration = m_abortGeneration.load();
+    
+    // The last buffered sample was captured at the current audio clock position;
+    // give up on the segment once it falls too far behind real time
+    qint64 segmentEndTime = audioEnd > 0 ? audioEnd : audioClock();
+    m_decodeDeadline = m_maxDecodeLag > 0 ? segmentEndTime + m_maxDecodeLag : 0;
+    m_decodeAudioStart = segmentEndTime - (static_cast<qint64>(m_audioBuffer.size()) * 1000) / 16000;
+    m_segmentsEmitted = 0;
+    
+    qint64 lag = QDateTime::currentMSecsSinceEpoch() - segmentEndTime;
+    if (m_decodeDeadline > 0 && lag > m_maxDecodeLag) {
+        qDebug() << "Dropping segment without decoding -" << lag << "ms behind real time";
+        emit statusChanged(QString("Dropped segment: %1 s behind real time").arg(lag / 1000.0, 0, 'f', 1));
+        adaptQuality(m_audioBuffer.size() / 16000.0, -1, lag);
+        return;
+    }
+    
+    // While earlier chunks are still out, a chunk no server can take goes through
+    // the same queue; it fails straight away but is only handed back for local
+    // decoding after their results, so the transcript stays in utterance order
+    if (!m_localOnly && (m_remoteInference->hasAvailableEndpoint() || m_remoteInference->pendingCount() > 0)) {
+        submitRemote(segmentEndTime);
+        return;
+    }
+    
+    // Shorten long internal pauses; whisper then decodes the compacted copy and
+    // its timestamps are mapped back through audioTime()
+    m_compacted = m_silenceCompactor.compact(m_audioBuffer.data(), m_audioBuffer.size());
+    if (m_compacted) {
+        qDebug() << "Compacted silence:" << m_silenceCompactor.removedSeconds() << "of"
+                 << m_audioBuffer.size() / 16000.0 << "seconds removed";
+    }
+    const std::vector<float> &audio = decodeAudio();
+    
+    m_utteranceId++;
+    m_utteranceUncertain = m_refineLogprobThreshold >= 0.0f;  // 0 escalates every chunk
+    
+    // Process with whisper using the configured decoding profile
+    whisper_full_params wparams = whisper_full_default_params(
+        static_cast<whisper_sampling_strategy>(m_decodingProfile.whisperStrategy()));
+    m_decodingProfile.applyTo(wparams);
     wparams.print_progress = false;
     wparams.print_special = false;
     wparams.print_realtime = false;
     wparams.print_timestamps = false;
     wparams.single_segment = false;
+    // whisper's own carry-over can't be bounded or reset, so it stays off and the
+    // previous text is passed explicitly through prompt_tokens instead
     wparams.no_context = true;
-    wparams.language = "en";
-    wparams.n_threads = 4;
+    wparams.n_threads = m_threads;
+    wparams.token_timestamps = m_wordTimestamps;
     wparams.suppress_blank = true;
     
+    // The encoder normally always processes a 30 s window; a shorter one saves
+    // most of its time on short chunks (at some cost in accuracy)
+    if (m_reduceAudioContext && audio.size() < 16000 * 30) {
+        const int frames = static_cast<int>(audio.size() * 50 / 16000) + 64;  // 50 encoder frames per second
+        wparams.audio_ctx = std::min(frames, whisper_n_audio_ctx(m_whisperContext));
+    }
+    
+    // Allow the decode to be interrupted (stop, model change, shutdown, deadline)
+    wparams.abort_callback = &WhisperProcessor::abortCallback;
+    wparams.abort_callback_user_data = this;
+    wparams.encoder_begin_callback = &WhisperProcessor::encoderBeginCallback;
+    wparams.encoder_begin_callback_user_data = this;
+    
+    // Pick the language, running detection only when nothing is cached yet
+    const QString language = resolveLanguage();
+    const QByteArray languageCode = language.toLatin1();
+    wparams.language = languageCode.constData();
+    m_segmentProbabilitySum = 0.0;
+    m_segmentTokenCount = 0;
+    
+    // Drop the carried-over context after a long pause or a change of language
+    if (m_lastCommitTime > 0 && m_decodeAudioStart - m_lastCommitTime > m_promptResetSilence) {
+        resetPromptContext("long silence");
+    } else if (language != m_promptLanguage) {
+        resetPromptContext("language changed");
+    }
+    m_promptLanguage = language;
+    
+    std::vector<whisper_token> promptTokens(m_promptTokens.begin(), m_promptTokens.end());
+    if (!promptTokens.empty()) {
+        wparams.prompt_tokens = promptTokens.data();
+        wparams.prompt_n_tokens = static_cast<int>(promptTokens.size());
+    }
+    
+    // Emit each segment as soon as it has been decoded
+    wparams.new_segment_callback = &WhisperProcessor::newSegmentCallback;
+    wparams.new_segment_callback_user_data = this;
+    
+    // Watch the tokens as they are produced to catch repetition loops early
+    const double audioSeconds = m_audioBuffer.size() / 16000.0;
+    const double decodeSeconds = audio.size() / 16000.0;
+    m_runawayGuard.reset(decodeSeconds);
+    wparams.logits_filter_callback = &WhisperProcessor::logitsFilterCallback;
+    wparams.logits_filter_callback_user_data = this;
+    
+    // Transcript plus English translation: one encoder pass, two decoder passes.
+    // Pointless for English speech, which falls through to the normal path.
+    const bool sharedEncoder = m_translateAlongside && language != "en";
+    
     qDebug() << "Starting whisper processing...";
-    int result = whisper_full(m_whisperContext, wparams, m_audioBuffer.data(), m_audioBuffer.size());
+    QElapsedTimer decodeTimer;
+    decodeTimer.start();
+    int result = 0;
+    if (sharedEncoder) {
+        result = decodeWithSharedEncoder(language, promptTokens, decodeSeconds);
+    } else if (!m_wordTimestamps && loadStreamedMel()) {
+        // Mel already in the context; limit the decode to the audio itself, the
+        // rest of the spectrogram is the silence padding of the last window.
+        // (Token timestamps need the raw samples, so they take the path below.)
+        wparams.duration_ms = static_cast<int>(m_audioBuffer.size() / 16);
+        result = whisper_full_with_state(m_whisperContext, m_whisperState, wparams, nullptr, 0);
+    } else {
+        result = whisper_full_with_state(m_whisperContext, m_whisperState, wparams, audio.data(), audio.size());
+    }
     
-    if (result == 0) {
-        // Get the transcription
-        int n_segments = whisper_full_n_segments(m_whisperContext);
-        qDebug() << "Whisper processing complete - Found" << n_segments << "segments";
+    // A runaway decode is retried once with sampling instead of greedy search, no
+    // temperature fallback and a hard token cap, so the worst case stays bounded
+    if (!sharedEncoder && result != 0 && m_runawayGuard.isTripped() && m_segmentsEmitted == 0 &&
+        m_abortGeneration.load() == m_decodeGeneration) {
+        qDebug() << "Runaway decode (" << m_runawayGuard.reason() << ") - retrying with constrained parameters";
         
-        QString transcription;
+        const int tokenBudget = m_runawayGuard.tokenBudget();
+        m_runawayGuard.reset(decodeSeconds);
+        wparams.temperature = 0.4f;
+        wparams.temperature_inc = 0.0f;
+        wparams.max_tokens = tokenBudget;
         
-        for (int i = 0; i < n_segments; ++i) {
-            const char* text = whisper_full_get_segment_text(m_whisperContext, i);
-            if (text) {
-                QString segment = QString::fromUtf8(text).trimmed();
-                qDebug() << "Segment" << i << ":" << segment;
-                
-                if (!segment.isEmpty() && segment != "[BLANK_AUDIO]") {
-                    if (!transcription.isEmpty()) {
-                        transcription += " ";
-                    }
-                    transcription += segment;
-                }
-            }
+        result = whisper_full_with_state(m_whisperContext, m_whisperState, wparams, audio.data(), audio.size());
+    }
+    
+    if (result != 0 && m_runawayGuard.isTripped()) {
+        qDebug() << "Dropping runaway decode:" << m_runawayGuard.reason();
+        // Loops tend to feed on themselves through the prompt
+        resetPromptContext("runaway decode");
+        emit statusChanged(QString("Dropped runaway transcription (%1)").arg(m_runawayGuard.reason()));
+    } else if (result != 0 && shouldAbort()) {
+        if (m_abortGeneration.load() != m_decodeGeneration) {
+            qDebug() << "Whisper processing aborted on request";
+        } else {
+            qDebug() << "Whisper processing aborted - segment fell more than"
+                     << m_maxDecodeLag << "ms behind real time";
+            emit statusChanged(QString("Dropped segment: decoding fell %1 s behind real time")
+                               .arg(m_maxDecodeLag / 1000.0, 0, 'f', 1));
         }
+    } else if (result == 0) {
+        int n_segments = sharedEncoder ? m_segmentsEmitted : whisper_full_n_segments_from_state(m_whisperState);
+        qDebug() << "Whisper processing complete - Found" << n_segments << "segments,"
+                 << m_segmentsEmitted << "emitted";
         
-        if (!transcription.isEmpty()) {
-            qint64 timestamp = QDateTime::currentMSecsSinceEpoch();
-            emit transcriptionReady(transcription, timestamp);
-            qDebug() << "Final transcription:" << transcription;
-        } else {
+        // Speech keeps the wake window open
+        if (m_wakeWordEnabled && m_segmentsEmitted > 0) {
+            m_awakeUntil = QDateTime::currentMSecsSinceEpoch() + m_wakeWindow;
+        }
+        
+        if (m_segmentsEmitted == 0) {
             qDebug() << "No valid transcription found in segments";
+        } else if (m_refinementEnabled) {
+            // Only chunks the live model was unsure about go to the larger model
+            m_audioDecodedSeconds += audioSeconds;
+            if (m_utteranceUncertain) {
+                m_audioEscalatedSeconds += audioSeconds;
+                emit utteranceDecoded(m_utteranceId, m_decodeAudioStart, language,
+                                      QList<float>(m_audioBuffer.begin(), m_audioBuffer.end()));
+            }
+            qDebug() << "Escalated" << m_audioEscalatedSeconds << "of" << m_audioDecodedSeconds
+                     << "seconds of audio to the refinement model";
+        }
+        
+        // Low confidence with a cached language suggests the speaker switched languages
+        if (m_segmentTokenCount > 0 && !m_detectedLanguage.isEmpty()) {
+            double averageProbability = m_segmentProbabilitySum / m_segmentTokenCount;
+            if (averageProbability < 0.5) {
+                invalidateDetectedLanguage(QString("average token probability %1").arg(averageProbability, 0, 'f', 2));
+            }
         }
     } else {
         qDebug() << "Whisper processing failed with error code:" << result;
     }
+    
+    // Requested aborts say nothing about load; everything else feeds the controller
+    if (m_abortGeneration.load() == m_decodeGeneration) {
+        adaptQuality(audioSeconds, decodeTimer.elapsed(), lag);
+    }
+}
+
+void WhisperProcessor::submitRemote(qint64 audioEnd)
+{
+    // Sent without silence compaction, so the server's timestamps need no mapping.
+    // The language is whatever is known without running detection here; "auto"
+    // leaves it to the server.
+    RemoteInference::Chunk chunk;
+    chunk.utteranceId = ++m_utteranceId;
+    chunk.samples = m_audioBuffer;
+    chunk.audioEnd = audioEnd;
+    chunk.audioStart = m_decodeAudioStart;
+    chunk.language = !m_detectedLanguage.isEmpty() ? m_detectedLanguage : m_language;
+    if (m_lastCommitTime > 0 && m_decodeAudioStart - m_lastCommitTime > m_promptResetSilence) {
+        resetPromptContext("long silence");
+    }
+    chunk.prompt = m_remotePrompt;
+    if (m_stripWakePhrase) {
+        m_wakePhraseUtterance = chunk.utteranceId;
+    }
+    
+    qDebug() << "Sending chunk" << chunk.utteranceId << "(" << m_audioBuffer.size() / 16000.0
+             << "seconds) for remote inference," << m_remoteInference->pendingCount() << "already in flight";
+    m_remoteInference->submit(std::move(chunk));
+}
+
+void WhisperProcessor::onRemoteChunkDecoded(const RemoteInference::Chunk &chunk,
+                                            const QList<TranscriptionSegment> &segments)
+{
+    bool uncertain = m_refineLogprobThreshold >= 0.0f;  // 0 escalates every chunk
+    bool stripWakePhrase = chunk.utteranceId == m_wakePhraseUtterance;
+    int emitted = 0;
+    for (TranscriptionSegment segment : segments) {
+        if (stripWakePhrase) {
+            stripWakePhrase = false;
+            segment.text = m_wakeWordDetector.stripPhrase(segment.text);
+            if (segment.text.isEmpty()) {
+                continue;
+            }
+        }
+        if (segment.avgLogprob < m_refineLogprobThreshold || segment.noSpeechProb > m_refineNoSpeechThreshold) {
+            uncertain = true;
+        }
+        
+        // Keep roughly as much text as the local decoder carries in tokens
+        if (m_promptTokenLimit > 0) {
+            m_remotePrompt = (m_remotePrompt + ' ' + segment.text).trimmed().right(m_promptTokenLimit * 4);
+        }
+        m_lastCommitTime = segment.endTime;
+        m_lastLanguageUse = segment.endTime;
+        emitted++;
+        emit transcriptionReady(segment);
+    }
+    
+    if (m_wakeWordEnabled && emitted > 0) {
+        m_awakeUntil = QDateTime::currentMSecsSinceEpoch() + m_wakeWindow;
+    }
+    if (m_refinementEnabled && emitted > 0 && uncertain) {
+        emit utteranceDecoded(chunk.utteranceId, chunk.audioStart, chunk.language,
+                              QList<float>(chunk.samples.begin(), chunk.samples.end()));
+    }
+}
+
+void WhisperProcessor::onRemoteChunkFailed(const RemoteInference::Chunk &chunk, const QString &error)
+{
+    if (!m_whisperContext) {
+        emit statusChanged(QString("Remote transcription failed (%1) and no local model is loaded").arg(error));
+        return;
+    }
+    qDebug() << "Decoding chunk" << chunk.utteranceId << "locally - remote inference failed:" << error;
+    if (m_remoteInference->isEnabled()) {
+        emit statusChanged(QString("Remote transcription failed (%1); decoding locally").arg(error));
+    }
+    
+    // Run the normal path on the failed chunk. The utterance being recorded is
+    // set aside meanwhile; its streamed mel doesn't match the failed chunk.
+    std::vector<float> recording;
+    recording.swap(m_audioBuffer);
+    m_audioBuffer = chunk.samples;
+    const bool melStreaming = m_melStreaming;
+    m_melStreaming = false;
+    const quint64 utteranceId = m_utteranceId;
+    m_utteranceId = chunk.utteranceId - 1;  // processAccumulatedAudio() takes the next id
+    m_localOnly = true;
+    m_stripWakePhrase = chunk.utteranceId == m_wakePhraseUtterance;
+    
+    processAccumulatedAudio(chunk.audioEnd);
+    
+    m_stripWakePhrase = false;
+    m_localOnly = false;
+    m_utteranceId = utteranceId;
+    m_melStreaming = melStreaming;
+    m_audioBuffer.swap(recording);
+}
+
+void WhisperProcessor::decodeCommand()
+{
+    QElapsedTimer timer;
+    timer.start();
+    
+    m_decodeGeneration = m_abortGeneration.load();
+    m_decodeDeadline = 0;
+    m_runawayGuard.reset(m_audioBuffer.size() / 16000.0);
+    
+    // The grammar only admits the configured phrases, so a handful of tokens and
+    // an encoder window the length of the chunk are all the decode needs
+    const QString language = resolveLanguage();
+    const QByteArray languageCode = language.toLatin1();
+    const QByteArray prompt = m_commandGrammar.prompt().toUtf8();
+    whisper_full_params wparams = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    wparams.print_progress = false;
+    wparams.print_special = false;
+    wparams.print_realtime = false;
+    wparams.print_timestamps = false;
+    wparams.single_segment = true;
+    wparams.no_context = true;
+    wparams.no_timestamps = true;
+    wparams.n_threads = m_threads;
+    wparams.temperature_inc = 0.0f;
+    wparams.max_tokens = m_commandGrammar.tokenBudget();
+    wparams.language = languageCode.constData();
+    wparams.initial_prompt = prompt.constData();
+    wparams.grammar_rules = m_commandGrammar.rules();
+    wparams.n_grammar_rules = m_commandGrammar.ruleCount();
+    wparams.i_start_rule = 0;
+    wparams.grammar_penalty = 100.0f;
+    wparams.abort_callback = &WhisperProcessor::abortCallback;
+    wparams.abort_callback_user_data = this;
+    if (m_audioBuffer.size() < 16000 * 30) {
+        wparams.audio_ctx = std::min(static_cast<int>(m_audioBuffer.size() * 50 / 16000) + 64,
+                                     whisper_n_audio_ctx(m_whisperContext));
+    }
+    
+    if (whisper_full_with_state(m_whisperContext, m_whisperState, wparams, m_audioBuffer.data(), m_audioBuffer.size()) != 0) {
+        qDebug() << "Command decode failed or was aborted";
+        return;
+    }
+    
+    QString text;
+    float noSpeechProb = 0.0f;
+    for (int i = 0; i < whisper_full_n_segments_from_state(m_whisperState); ++i) {
+        text += QString::fromUtf8(whisper_full_get_segment_text_from_state(m_whisperState, i));
+        noSpeechProb = std::max(noSpeechProb, whisper_full_get_segment_no_speech_prob_from_state(m_whisperState, i));
+    }
+    text = text.trimmed();
+    
+    // The grammar forces some phrase out of any noise; the no-speech probability
+    // is the guard against acting on it
+    const VoiceCommand *command = m_commandGrammar.match(text);
+    qDebug() << "Command decode:" << text << "no-speech" << noSpeechProb << "in" << timer.elapsed() << "ms";
+    if (!command || noSpeechProb > m_commandNoSpeechThreshold) {
+        emit statusChanged(QString("No command recognized (%1 ms)").arg(timer.elapsed()));
+        return;
+    }
+    
+    emit statusChanged(QString("Command: %1 (%2 ms)").arg(command->phrase).arg(timer.elapsed()));
+    emit commandRecognized(command->phrase, command->action);
+}
+
+void WhisperProcessor::adaptQuality(double audioSeconds, qint64 decodeMs, qint64 backlogMs)
+{
+    if (!m_qualityController.update(audioSeconds, decodeMs, backlogMs)) {
+        return;
+    }
+    
+    const QualityTier &tier = m_qualityController.tier();
+    m_decodingProfile = DecodingProfile::preset(tier.profile);
+    emit statusChanged(QString("Quality: %1 (%2) - %3")
+                       .arg(tier.model, tier.profile, m_qualityController.reason()));
+    
+    if (tier.model != m_currentModel) {
+        loadModel(tier.model);
+        m_qualityController.settle();
+    }
+}
+
+int WhisperProcessor::decodeWithSharedEncoder(const QString &language,
+                                              const std::vector<whisper_token> &promptTokens,
+                                              double audioSeconds)
+{
+    const int nThreads = m_threads;
+    QElapsedTimer timer;
+    timer.start();
+    
+    const int languageId = whisper_lang_id(language.toLatin1().constData());
+    if (languageId < 0) {
+        qDebug() << "Unknown language for shared-encoder decode:" << language;
+        return -1;
+    }
+    
+    // Mel + encoder once; the cross-attention keys/values stay in the context and
+    // both decoder passes below attend to them
+    const std::vector<float> &audio = decodeAudio();
+    if (!loadStreamedMel() &&
+        whisper_pcm_to_mel_with_state(m_whisperContext, m_whisperState, audio.data(), audio.size(), nThreads) != 0) {
+        return -2;
+    }
+    if (shouldAbort()) {
+        return -3;
+    }
+    if (whisper_encode_with_state(m_whisperContext, m_whisperState, 0, nThreads) != 0) {
+        return -4;
+    }
+    const qint64 encodeMs = timer.restart();
+    
+    const whisper_token sot = whisper_token_sot(m_whisperContext);
+    const whisper_token languageToken = whisper_token_lang(m_whisperContext, languageId);
+    const whisper_token noTimestamps = whisper_token_not(m_whisperContext);
+    
+    // Transcribe pass, with the carried-over text as prompt
+    std::vector<whisper_token> prefix;
+    if (!promptTokens.empty()) {
+        prefix.push_back(whisper_token_prev(m_whisperContext));
+        prefix.insert(prefix.end(), promptTokens.begin(), promptTokens.end());
+    }
+    prefix.insert(prefix.end(), {sot, languageToken, whisper_token_transcribe(m_whisperContext), noTimestamps});
+    
+    std::vector<whisper_token> transcript;
+    std::vector<float> transcriptLogprobs;
+    if (!greedyDecode(prefix, transcript, transcriptLogprobs)) {
+        return -5;
+    }
+    const qint64 transcribeMs = timer.restart();
+    
+    // Translate pass; no prompt, since the previous text is in the source language
+    m_runawayGuard.reset(audioSeconds);
+    std::vector<whisper_token> translation;
+    std::vector<float> translationLogprobs;
+    if (!greedyDecode({sot, languageToken, whisper_token_translate(m_whisperContext), noTimestamps},
+                      translation, translationLogprobs)) {
+        return -5;
+    }
+    qDebug() << "Shared-encoder decode: encode" << encodeMs << "ms, transcribe" << transcribeMs
+             << "ms, translate" << timer.elapsed() << "ms";
+    
+    auto tokensToText = [this](const std::vector<whisper_token> &tokens) {
+        QByteArray bytes;
+        for (whisper_token token : tokens) {
+            bytes.append(whisper_token_to_str(m_whisperContext, token));
+        }
+        return QString::fromUtf8(bytes).trimmed();
+    };
+    
+    QString text = tokensToText(transcript);
+    if (text.isEmpty() || text == "[BLANK_AUDIO]") {
+        return 0;
+    }
+    
+    // Without timestamp tokens the whole chunk is one segment
+    TranscriptionSegment segment;
+    segment.text = text;
+    segment.translation = tokensToText(translation);
+    segment.timestamp = QDateTime::currentMSecsSinceEpoch();
+    segment.startTime = m_decodeAudioStart;
+    segment.endTime = audioTime(static_cast<qint64>(audioSeconds * 1000));
+    segment.utteranceId = m_utteranceId;
+    
+    double logprobSum = 0.0;
+    for (float logprob : transcriptLogprobs) {
+        logprobSum += logprob;
+        m_segmentProbabilitySum += std::exp(logprob);
+        m_segmentTokenCount++;
+    }
+    segment.avgLogprob = transcriptLogprobs.empty() ? 0.0f
+                                                    : static_cast<float>(logprobSum / transcriptLogprobs.size());
+    if (segment.avgLogprob < m_refineLogprobThreshold) {
+        m_utteranceUncertain = true;
+    }
+    
+    if (m_promptTokenLimit > 0) {
+        m_promptTokens.insert(m_promptTokens.end(), transcript.begin(), transcript.end());
+        while (static_cast<int>(m_promptTokens.size()) > m_promptTokenLimit) {
+            m_promptTokens.pop_front();
+        }
+    }
+    
+    m_segmentsEmitted++;
+    m_lastCommitTime = segment.endTime;
+    m_lastLanguageUse = segment.endTime;
+    emit transcriptionReady(segment);
+    return 0;
+}
+
+void WhisperProcessor::startStreamedMel()
+{
+    if (m_streamingMel.melCount() == 0) {
+        return;
+    }
+    
+    // The stream's frames are centred every hop from the start of the capture;
+    // start the utterance on that grid (dropping under 10 ms of pre-roll)
+    const size_t offset = (m_capturePosition - m_audioBuffer.size()) % StreamingMel::kHopLength;
+    if (offset > 0) {
+        const size_t skipped = std::min(m_audioBuffer.size(), StreamingMel::kHopLength - offset);
+        m_audioBuffer.erase(m_audioBuffer.begin(), m_audioBuffer.begin() + skipped);
+    }
+    
+    // From here on processAudio() hands the stream each block as it arrives
+    m_melStreaming = true;
+    const quint64 start = m_capturePosition - m_audioBuffer.size();
+    QMetaObject::invokeMethod(m_melStream, [melStream = m_melStream, start, samples = m_audioBuffer]() mutable {
+        melStream->begin(start, std::move(samples));
+    }, Qt::QueuedConnection);
+}
+
+void WhisperProcessor::stopStreamedMel()
+{
+    if (m_melStreaming) {
+        m_melStreaming = false;
+        QMetaObject::invokeMethod(m_melStream, &MelStream::end, Qt::QueuedConnection);
+    }
+}
+
+bool WhisperProcessor::loadStreamedMel()
+{
+    // The streamed spectrogram covers the recording, not the compacted copy
+    if (!m_melStreaming || m_compacted) {
+        return false;
+    }
+    
+    // The stream has the frames inside the utterance, unless it is still behind.
+    // Left to compute here: the first two, whose windows are reflected at the
+    // start, any the stream hasn't reached, and the last few, which reach into
+    // one encoder window (30 s) of silence padding like whisper_pcm_to_mel adds
+    QElapsedTimer timer;
+    timer.start();
+    const float *audio = m_audioBuffer.data();
+    const size_t sampleCount = m_audioBuffer.size();
+    m_streamingMel.reset();
+    m_streamingMel.begin(audio, sampleCount);
+    std::vector<float> streamed;
+    const size_t copied = m_melStream->copyFrames(m_capturePosition - sampleCount, audio, sampleCount,
+                                                  m_streamingMel.framesComputed(), streamed);
+    stopStreamedMel();
+    m_streamingMel.append(streamed.data(), copied);
+    
+    int frameCount = 0;
+    std::vector<float> mel = m_streamingMel.finish(audio, sampleCount, 3000, frameCount);
+    if (whisper_set_mel_with_state(m_whisperContext, m_whisperState, mel.data(), frameCount, m_streamingMel.melCount()) != 0) {
+        qDebug() << "whisper_set_mel failed, falling back to computing the spectrogram from samples";
+        return false;
+    }
+    qDebug() << "Streamed mel ready:" << frameCount << "frames," << copied << "from the stream, finished in"
+             << timer.elapsed() << "ms";
+    return true;
+}
+
+bool WhisperProcessor::greedyDecode(const std::vector<whisper_token> &prefix,
+                                    std::vector<whisper_token> &tokens, std::vector<float> &logprobs)
+{
+    const int nThreads = m_threads;
+    const int nVocab = whisper_n_vocab(m_whisperContext);
+    const whisper_token eot = whisper_token_eot(m_whisperContext);
+    
+    // Stay inside the decoder's context window and the guard's token budget
+    int maxTokens = std::min(whisper_n_text_ctx(m_whisperContext) - static_cast<int>(prefix.size()) - 1,
+                             m_runawayGuard.tokenBudget());
+    if (m_decodingProfile.maxTokensPerSegment > 0) {
+        maxTokens = std::min(maxTokens, m_decodingProfile.maxTokensPerSegment);
+    }
+    
+    tokens.clear();
+    logprobs.clear();
+    if (whisper_decode_with_state(m_whisperContext, m_whisperState, prefix.data(), static_cast<int>(prefix.size()), 0, nThreads) != 0) {
+        return false;
+    }
+    
+    int nPast = static_cast<int>(prefix.size());
+    int nLast = nPast;
+    while (static_cast<int>(tokens.size()) < maxTokens) {
+        if (shouldAbort()) {
+            return false;
+        }
+        
+        // Logits of the last decoded position; only text tokens and EOT may be
+        // chosen (timestamps and other control tokens sit above EOT)
+        const float *logits = whisper_get_logits_from_state(m_whisperState) + static_cast<size_t>(nLast - 1) * nVocab;
+        whisper_token best = eot;
+        for (whisper_token id = 0; id < eot; ++id) {
+            if (logits[id] > logits[best]) {
+                best = id;
+            }
+        }
+        
+        // Log-softmax of the chosen (maximum) logit over the allowed tokens
+        double sum = 0.0;
+        for (whisper_token id = 0; id <= eot; ++id) {
+            sum += std::exp(logits[id] - logits[best]);
+        }
+        
+        if (best == eot) {
+            break;
+        }
+        tokens.push_back(best);
+        logprobs.push_back(static_cast<float>(-std::log(sum)));
+        
+        if (m_runawayGuard.isEnabled() && m_runawayGuard.check(tokens)) {
+            return false;
+        }
+        
+        if (whisper_decode_with_state(m_whisperContext, m_whisperState, &best, 1, nPast, nThreads) != 0) {
+            return false;
+        }
+        nPast++;
+        nLast = 1;
+    }
+    
+    return true;
 }
 
 void WhisperProcessor::loadModel(const QString &modelName)
 {
+    if (m_workerMode) {
+        // The worker's process and socket belong to this object's thread
+        if (QThread::currentThread() != thread()) {
+            QMetaObject::invokeMethod(this, [this, modelName]() { loadModel(modelName); }, Qt::QueuedConnection);
+        } else {
+            m_inferenceWorker->loadModel(modelName);
+        }
+        return;
+    }
+    
     m_currentModel = modelName;
+    m_maxChunkDuration = WhisperModels::modelInfo(modelName).maxChunkSeconds * 1000;
     emit statusChanged(QString("Loading model: %1").arg(modelName));
     
-    // Release any existing context
+    // Release any existing context; cached prompt tokens belong to the old vocabulary
     releaseWhisperContext();
+    resetPromptContext("model changed");
+    invalidateDetectedLanguage("model changed");
     
     // Get model path
     QString modelPath = getModelPath(modelName);
@@ -237,49 +1328,192 @@ void WhisperProcessor::loadModel(const QString &modelName)
         return;
     }
     
-    // Initialize whisper context with the model
-    initializeWhisperContext();
-    
-    // Load the model with the configured parameters
-    m_whisperContext = whisper_init_from_file_with_params(
-        modelPath.toLocal8Bit().constData(), 
-        *m_contextParams
-    );
-    
-    if (m_whisperContext) {
+    // The weights are shared with the other decoders using this model; the
+    // state (KV cache, mel, results) is this processor's own
+    m_sharedContext = SharedModel::acquire(modelPath, m_computeDeviceType, m_computeDeviceId);
+    if (m_sharedContext) {
+        m_whisperState = whisper_init_state(m_sharedContext.get());
+    }
+    if (m_whisperState) {
+        m_whisperContext = m_sharedContext.get();
         m_modelLoaded = true;
+        // The streamed spectrogram has to use the very filters the model was
+        // trained with; without them it is computed when the utterance ends
+        int melCount = 0;
+        std::vector<float> filters;
+        if (!StreamingMel::readFilters(QFile::encodeName(modelPath).toStdString(), melCount, filters) ||
+            melCount != whisper_model_n_mels(m_whisperContext)) {
+            qDebug() << "No mel filterbank found in" << modelPath << "- not streaming the spectrogram";
+            melCount = 0;
+            filters.clear();
+        }
+        m_streamingMel.setFilters(melCount, filters);
+        m_melStream->setFilters(melCount, filters);
+        m_melStreaming = false;
         emit statusChanged(QString("Model loaded: %1 (Device: %2)")
             .arg(modelName)
             .arg(m_computeDeviceType == 0 ? "CPU" : QString("GPU %1").arg(m_computeDeviceId)));
     } else {
-        m_modelLoaded = false;
+        releaseWhisperContext();
         emit statusChanged(QString("Failed to load model: %1").arg(modelName));
     }
 }
 
 void WhisperProcessor::updateConfiguration(const AudioConfiguration &config)
 {
+    if ((config.inferenceProcess || m_workerMode) && QThread::currentThread() != thread()) {
+        // The worker's process and socket belong to this object's thread
+        QMetaObject::invokeMethod(this, [this, config]() { updateConfiguration(config); }, Qt::QueuedConnection);
+        return;
+    }
+    if (config.inferenceProcess && m_inferenceWorker->start(config)) {
+        if (!m_workerMode) {
+            // The worker loads its own copy of the model. Chunks still out on
+            // servers are decoded here first, while the local model is loaded.
+            qDebug() << "Decoding in an inference worker process";
+            m_remoteInference->setEndpoints(QStringList());
+            m_wakeWordDetector.release();
+            releaseWhisperContext();
+            m_currentModel.clear();
+            m_audioBuffer.clear();
+            m_isRecording = false;
+            m_workerMode = true;
+        }
+        return;
+    }
+    if (m_workerMode) {
+        // Back in process; the model below is loaded again since none is current
+        m_workerMode = false;
+        m_inferenceWorker->stop();
+        resetAudioClock();
+    }
+    
+    m_remoteInference->setEndpoints(config.remoteEndpoints);
+    m_remoteInference->setTimeout(static_cast<int>(config.remoteTimeout * 1000));
+    m_remoteInference->setTemperatureFallback(config.temperatureFallback);
+    
     // Check if compute device changed
     if (config.computeDeviceType != m_computeDeviceType || 
         config.computeDeviceId != m_computeDeviceId) {
         setComputeDevice(config.computeDeviceType, config.computeDeviceId);
     }
     
-    // Apply configuration settings
-    if (config.model != m_currentModel) {
-        loadModel(config.model);
-    }
-    
     // Update VAD settings
     // Convert UI threshold (50-500) to amplitude threshold (0.001-0.05)
     m_pickupThreshold = config.pickupThreshold / 10000.0f;  // 120 -> 0.012
     m_minSpeechDuration = config.minSpeechDuration * 1000; // Convert to ms
     m_maxSpeechDuration = config.maxSpeechDuration * 1000; // Convert to ms
+    m_maxDecodeLag = static_cast<int>(config.maxDecodeLag * 1000); // Convert to ms, 0 disables
+    m_runawayGuard.setEnabled(config.runawayGuardEnabled);
+    m_decodingProfile = DecodingProfile::fromConfiguration(config);
+    
+    // Adaptive quality starts from the tier matching the configured model and
+    // profile; tiers whose model hasn't been downloaded are left out. Choosing
+    // the tiers again resets the adaptation, so other settings leave them be.
+    QString model = config.model;
+    if (config.model != m_tierModel || config.decodingProfile != m_tierProfile ||
+        config.qualityTiers != m_tierList || config.adaptiveQuality != m_tierAdaptive) {
+        m_tierModel = config.model;
+        m_tierProfile = config.decodingProfile;
+        m_tierList = config.qualityTiers;
+        m_tierAdaptive = config.adaptiveQuality;
+        QList<QualityTier> tiers;
+        for (const QualityTier &tier : QualityController::parseTiers(config.qualityTiers, config.model)) {
+            if (QFile::exists(getModelPath(tier.model))) {
+                tiers.append(tier);
+            } else {
+                qDebug() << "Skipping quality tier" << tier.toString() << "- model not downloaded";
+            }
+        }
+        m_qualityController.setTiers(tiers);
+        m_qualityController.setEnabled(config.adaptiveQuality);
+        if (m_qualityController.isEnabled()) {
+            m_qualityController.selectTier(config.model, m_decodingProfile.name);
+        }
+    }
+    if (m_qualityController.isEnabled()) {
+        model = m_qualityController.tier().model;
+        m_decodingProfile = DecodingProfile::preset(m_qualityController.tier().profile);
+    }
+    
+    // Apply configuration settings
+    if (model != m_currentModel) {
+        loadModel(model);
+    }
+    m_wordTimestamps = config.wordTimestamps;
+    m_refinementEnabled = !config.refineModel.isEmpty() && config.refineModel != config.model;
+    m_refineLogprobThreshold = static_cast<float>(config.refineLogprobThreshold);
+    m_translateAlongside = config.translateAlongside;
+    m_silenceCompactor.setThreshold(m_pickupThreshold);
+    m_silenceCompactor.setMaxSilence(static_cast<int>(config.compactSilence * 1000));  // 0 disables
+    m_reduceAudioContext = config.reduceAudioContext;
+    m_pushToTalk = config.pushToTalk;
+    m_pushToTalkPreRoll = static_cast<int>(config.pushToTalkPreRoll * 1000);
+    
+    // Command mode; a missing command list is created from a template to edit
+    m_commandMode = config.commandMode;
+    m_commandNoSpeechThreshold = static_cast<float>(config.commandNoSpeechThreshold);
+    if (m_commandMode) {
+        QString commandFile = config.commandFile;
+        if (commandFile.isEmpty()) {
+            commandFile = QFileInfo(ConfigManager::instance().getConfigFilePath()).dir().filePath("commands.txt");
+        }
+        if (!QFile::exists(commandFile)) {
+            CommandGrammar::writeTemplate(commandFile);
+        }
+        if (m_commandGrammar.load(commandFile)) {
+            emit statusChanged(QString("Command mode: %1 commands from %2")
+                               .arg(m_commandGrammar.commands().size()).arg(commandFile));
+        } else {
+            emit statusChanged(QString("Command mode off: %1").arg(m_commandGrammar.errorString()));
+            m_commandMode = false;
+        }
+    }
+    
+    // Wake word gating (push-to-talk already decides when to listen). An open
+    // listening window survives changes to anything but the wake settings
+    const bool wakeWordEnabled = config.wakeWordEnabled && !config.wakePhrase.trimmed().isEmpty() && !m_pushToTalk;
+    const bool wakeChanged = wakeWordEnabled != m_wakeWordEnabled
+                             || config.wakePhrase.trimmed() != m_wakeWordDetector.phrase()
+                             || config.wakeModel != m_wakeModel;
+    m_wakeWordEnabled = wakeWordEnabled;
+    m_wakeWindow = static_cast<int>(config.wakeWindow * 1000);
+    if (wakeChanged) {
+        m_wakeWordDetector.setPhrase(config.wakePhrase);
+        m_wakeModel = config.wakeModel;
+        m_awake = false;
+        m_awakeUntil = 0;
+        if (m_wakeWordEnabled) {
+            // A separate context only pays off when the spotting model is smaller
+            const QString wakeModelPath = getModelPath(config.wakeModel);
+            if (config.wakeModel != m_currentModel && QFile::exists(wakeModelPath)) {
+                m_wakeWordDetector.loadModel(wakeModelPath);
+            } else {
+                qDebug() << "Spotting the wake word with the transcription model";
+                m_wakeWordDetector.release();
+            }
+            emit statusChanged(QString("Waiting for wake word \"%1\"").arg(m_wakeWordDetector.phrase()));
+        } else {
+            m_wakeWordDetector.release();
+        }
+    }
+    if (config.language != m_language || config.languageThreshold != m_languageThreshold) {
+        invalidateDetectedLanguage("language settings changed");
+    }
+    m_language = config.language.isEmpty() ? QString("auto") : config.language;
+    m_languageThreshold = static_cast<float>(config.languageThreshold);
+    m_promptTokenLimit = config.promptTokens;
+    m_promptResetSilence = static_cast<int>(config.promptResetSilence * 1000);
+    if (m_promptTokenLimit <= 0) {
+        resetPromptContext("carry-over disabled");
+    }
     
     qDebug() << "Updated VAD settings - UI Threshold:" << config.pickupThreshold
              << "-> Amplitude threshold:" << m_pickupThreshold
              << "Min duration:" << m_minSpeechDuration << "ms"
-             << "Max duration:" << m_maxSpeechDuration << "ms";
+             << "Max duration:" << m_maxSpeechDuration << "ms"
+             << "Max decode lag:" << m_maxDecodeLag << "ms"
+             << "Decoding profile:" << m_decodingProfile.name;
 }
 
 void WhisperProcessor::setComputeDevice(int deviceType, int deviceId)
@@ -295,49 +1529,30 @@ void WhisperProcessor::setComputeDevice(int deviceType, int deviceId)
     }
 }
 
-void WhisperProcessor::initializeWhisperContext()
-{
-    // Clean up any existing context params
-    if (m_contextParams) {
-        whisper_free_context_params(m_contextParams);
-        m_contextParams = nullptr;
-    }
-    
-    // Create new context params
-    m_contextParams = whisper_context_default_params_by_ref();
-    if (m_contextParams) {
-        // Set device parameters
-        if (m_computeDeviceType == 1) {  // CUDA
-            m_contextParams->use_gpu = true;
-            m_contextParams->gpu_device = m_computeDeviceId;
-            qDebug() << "Initializing Whisper with CUDA device:" << m_computeDeviceId;
-        } else {
-            m_contextParams->use_gpu = false;
-            qDebug() << "Initializing Whisper with CPU";
-        }
-        
-        // Enable flash attention for better performance
-        m_contextParams->flash_attn = true;
-    }
-}
-
 void WhisperProcessor::releaseWhisperContext()
 {
-    if (m_whisperContext) {
-        whisper_free(m_whisperContext);
-        m_whisperContext = nullptr;
-    }
-    
-    if (m_contextParams) {
-        whisper_free_context_params(m_contextParams);
-        m_contextParams = nullptr;
+    // The state first: it belongs to the context, which may go with our reference
+    if (m_whisperState) {
+        whisper_free_state(m_whisperState);
+        m_whisperState = nullptr;
     }
+    m_whisperContext = nullptr;
+    m_sharedContext.reset();
+    m_streamingMel.setFilters(0, {});
+    m_melStream->setFilters(0, {});
+    m_melStreaming = false;
     
     m_modelLoaded = false;
 }
 
 QString WhisperProcessor::getModelPath(const QString &modelName)
 {
+    // The models directory, where downloads go
+    const QString configuredPath = WhisperModels::modelPath(modelName);
+    if (QFile::exists(configuredPath)) {
+        return configuredPath;
+    }
+    
     // Check common model locations
     QStringList searchPaths;
     
@@ -356,7 +1571,7 @@ QString WhisperProcessor::getModelPath(const QString &modelName)
     searchPaths << QDir::currentPath() + "/build/models";
     
     // Check each path for the model file
-    QString modelFileName = QString("ggml-%1.bin").arg(modelName);
+    QString modelFileName = WhisperModels::modelInfo(modelName).file;
     for (const QString &path : searchPaths) {
         QString fullPath = path + "/" + modelFileName;
         if (QFile::exists(fullPath)) {
@@ -4,12 +4,29 @@
 #include <QObject>
 #include <QByteArray>
 #include <QString>
+#include <QStringList>
 #include <memory>
 #include <vector>
+#include <atomic>
+#include <deque>
+#include "transcriptionsegment.h"
+#include "runawayguard.h"
+#include "decodingprofile.h"
+#include "streamingmel.h"
+#include "melstream.h"
+#include "qualitycontroller.h"
+#include "silencecompactor.h"
+#include "wakeworddetector.h"
+#include "commandgrammar.h"
+#include "remoteinference.h"
+
+class InferenceWorker;
+class QThread;
 
 struct AudioConfiguration;
 struct whisper_context;
-struct whisper_context_params;
+struct whisper_state;
+struct whisper_token_data;
 
 class WhisperProcessor : public QObject
 {
@@ -18,6 +35,15 @@ class WhisperProcessor : public QObject
 public:
     explicit WhisperProcessor(QObject *parent = nullptr);
     ~WhisperProcessor();
+    
+    // Cancel the decode currently in flight (if any). Thread-safe, so it can be
+    // called directly from the GUI thread while this object's thread is busy.
+    void requestAbort();
+    
+    // Helpers shared with the background refinement decoder
+    static QString getModelPath(const QString &modelName);
+    static QList<TranscriptionWord> collectWords(whisper_context *ctx, whisper_state *state,
+                                                 int segment, qint64 audioStart);
 
 public slots:
     void processAudio(const QByteArray &audioData);
@@ -25,26 +51,67 @@ public slots:
     void updateConfiguration(const AudioConfiguration &config);
     void setComputeDevice(int deviceType, int deviceId);
     void finishRecording();
+    void resetAudioClock();
+    // Push-to-talk span boundaries (ignored unless push-to-talk is configured)
+    void pushToTalkPressed();
+    void pushToTalkReleased();
 
 signals:
-    void transcriptionReady(const QString &text, qint64 timestamp);
+    // Emitted once per decoded segment, while whisper is still working on the rest
+    void transcriptionReady(const TranscriptionSegment &segment);
     void statusChanged(const QString &status);
     void modelNotFound(const QString &modelName);
+    // A chunk produced text; its audio can be re-decoded with a larger model
+    void utteranceDecoded(quint64 utteranceId, qint64 audioStart, const QString &language,
+                          const QList<float> &samples);
+    // Command mode recognized one of the configured phrases
+    void commandRecognized(const QString &phrase, const QString &action);
+
+private slots:
+    void onRemoteChunkDecoded(const RemoteInference::Chunk &chunk, const QList<TranscriptionSegment> &segments);
+    void onRemoteChunkFailed(const RemoteInference::Chunk &chunk, const QString &error);
 
 private:
-    void initializeWhisperContext();
     void releaseWhisperContext();
-    QString getModelPath(const QString &modelName);
-    void processAccumulatedAudio();
+    // audioEnd is the audio clock at the buffer's last sample (0 = now)
+    void processAccumulatedAudio(qint64 audioEnd = 0);
+    void submitRemote(qint64 audioEnd);
+    void checkWakeWord();
+    void decodeCommand();
+    bool shouldAbort() const;
+    void commitPromptTokens(whisper_state *state, int segment);
+    void resetPromptContext(const QString &reason);
+    QString resolveLanguage();
+    int decodeWithSharedEncoder(const QString &language, const std::vector<int> &promptTokens,
+                                double audioSeconds);
+    bool loadStreamedMel();
+    void startStreamedMel();
+    void stopStreamedMel();
+    bool greedyDecode(const std::vector<int> &prefix, std::vector<int> &tokens, std::vector<float> &logprobs);
+    void invalidateDetectedLanguage(const QString &reason);
+    void adaptQuality(double audioSeconds, qint64 decodeMs, qint64 backlogMs);
+    qint64 audioClock() const;
+    const std::vector<float> &decodeAudio() const;
+    qint64 audioTime(qint64 offsetMs) const;
+    
+    // whisper.cpp callbacks (user data is the WhisperProcessor instance)
+    static bool abortCallback(void *userData);
+    static bool encoderBeginCallback(whisper_context *ctx, whisper_state *state, void *userData);
+    static void newSegmentCallback(whisper_context *ctx, whisper_state *state, int nNew, void *userData);
+    static void logitsFilterCallback(whisper_context *ctx, whisper_state *state,
+                                     const whisper_token_data *tokens, int nTokens,
+                                     float *logits, void *userData);
     
     QString m_currentModel;
     bool m_modelLoaded;
     int m_computeDeviceType;  // 0 = CPU, 1 = CUDA
     int m_computeDeviceId;    // -1 for CPU, 0+ for GPU index
+    int m_threads;            // CPU threads for every decode: one per core, up to 8
     
-    // Whisper.cpp context
+    // Whisper.cpp context, shared with other decoders of the same model, and our own state
+    std::shared_ptr<whisper_context> m_sharedContext;
     whisper_context* m_whisperContext;
-    whisper_context_params* m_contextParams;
+    whisper_state* m_whisperState;
     
     // Audio buffering and VAD
     std::vector<float> m_audioBuffer;
@@ -55,6 +122,111 @@ private:
     bool m_isRecording;
     qint64 m_lastSoundTime;
     qint64 m_speechStartTime;
+    
+    // Push-to-talk: the key marks the utterance and the VAD is bypassed. While
+    // the key is up, m_audioBuffer holds only the last m_pushToTalkPreRoll ms.
+    bool m_pushToTalk;
+    int m_pushToTalkPreRoll;
+    
+    // Longest chunk the current model handles (from the manifest; distilled
+    // models lose accuracy past it), 0 = limited only by m_maxSpeechDuration
+    int m_maxChunkDuration;
+    
+    // Wake word gating: while asleep, speech bursts only go to the small spotting
+    // model; the wake phrase opens a window in which the full model transcribes
+    WakeWordDetector m_wakeWordDetector;
+    bool m_wakeWordEnabled;
+    bool m_awake;
+    qint64 m_awakeUntil;                 // Wall-clock ms at which the window closes
+    int m_wakeWindow;                    // ms the window stays open after the last speech
+    QString m_wakeModel;                 // Spotting model the detector was set up with
+    bool m_stripWakePhrase;              // Remove the phrase from the next decoded segment
+    
+    // Command mode: chunks are decoded against the command grammar instead of as free text
+    CommandGrammar m_commandGrammar;
+    bool m_commandMode;
+    float m_commandNoSpeechThreshold;    // Phrases heard as this likely to be noise aren't run
+    
+    // Decode cancellation
+    std::atomic<int> m_abortGeneration;  // Bumped by requestAbort()
+    int m_decodeGeneration;              // Generation captured when the current decode started
+    qint64 m_decodeDeadline;             // Wall-clock ms after which the decode is dropped (0 = none)
+    int m_maxDecodeLag;                  // Max ms a segment may fall behind real time (0 = unlimited)
+    qint64 m_decodeAudioStart;           // Wall-clock ms of the first sample being decoded
+    int m_segmentsEmitted;               // Segments streamed out by the current decode
+    
+    // Decoding strategy (greedy/beam, fallback thresholds, token caps)
+    DecodingProfile m_decodingProfile;
+    
+    // Prompt carry-over: the last committed text tokens are fed back as the prompt
+    std::deque<int> m_promptTokens;
+    int m_promptTokenLimit;              // Max tokens kept (0 disables carry-over)
+    int m_promptResetSilence;            // ms of silence after which the context is dropped
+    qint64 m_lastCommitTime;             // Wall-clock ms at which the last committed segment ended
+    QString m_promptLanguage;            // Language the cached tokens were decoded in
+    
+    // Language selection; "auto" detects once per session and caches the result
+    QString m_language;                  // Configured language code or "auto"
+    float m_languageThreshold;           // Detection probability needed to cache a language
+    QString m_detectedLanguage;          // Cached detection result (empty = detect next segment)
+    qint64 m_lastLanguageUse;            // Wall-clock ms of the last segment decoded with it
+    double m_segmentProbabilitySum;      // Token probabilities of the current decode,
+    int m_segmentTokenCount;             // used to notice when the cached language stops fitting
+    
+    // Every decoded chunk gets an id so refined text can replace its live segments
+    quint64 m_utteranceId;
+    bool m_refinementEnabled;            // Hand decoded chunks to the refinement model
+    float m_refineLogprobThreshold;      // Only chunks with a segment below this are escalated (0 = all)
+    float m_refineNoSpeechThreshold;     // ...or with a segment this likely to be non-speech
+    bool m_utteranceUncertain;           // Current chunk has a segment that needs escalation
+    double m_audioDecodedSeconds;        // Escalation statistics for the session
+    double m_audioEscalatedSeconds;
+    
+    // Per-word timing from whisper's token timestamps (costs an extra pass per segment)
+    bool m_wordTimestamps;
+    
+    // Log-mel frames computed on m_melThread while the utterance is still being
+    // recorded (and only then); the stream has most of them, m_streamingMel
+    // adds the ones at either end
+    MelStream *m_melStream;
+    QThread *m_melThread;
+    StreamingMel m_streamingMel;
+    bool m_melStreaming;                 // m_audioBuffer starts on the grid and feeds the stream
+    quint64 m_capturePosition;           // Samples received since the processor was created
+    
+    // Long pauses inside an utterance are shortened before decoding
+    SilenceCompactor m_silenceCompactor;
+    bool m_compacted;                    // The current decode runs on m_silenceCompactor.samples()
+    bool m_reduceAudioContext;           // Shrink the encoder window to the (compacted) audio length
+    
+    // Decode a translation alongside the transcript from the same encoder output
+    bool m_translateAlongside;
+    
+    // Steps between model/profile tiers as the machine gets busier or idler
+    QualityController m_qualityController;
+    QString m_tierModel;                 // Settings the tiers were last chosen from
+    QString m_tierProfile;
+    QStringList m_tierList;
+    bool m_tierAdaptive;
+    
+    // Aborts decodes that loop or hallucinate far more text than the audio holds
+    RunawayGuard m_runawayGuard;
+    
+    // Chunks can be sent to whisper.cpp servers instead; the local model then
+    // only decodes the ones they fail on (and wake words and commands)
+    RemoteInference *m_remoteInference;
+    bool m_localOnly;                    // Decoding a chunk a server failed on
+    QString m_remotePrompt;              // Recent text sent along as the prompt
+    quint64 m_wakePhraseUtterance;       // Sent chunk that starts with the wake phrase
+    
+    // Live decoding can run in a child process instead; this object then only
+    // forwards audio and commands to it and relays what it reports
+    InferenceWorker *m_inferenceWorker;
+    std::atomic<bool> m_workerMode;      // Atomic: requestAbort() reads it from other threads
+    
+    // Audio clock used to measure how far behind real time we are
+    qint64 m_streamStartTime;            // Wall-clock ms of the first sample (0 = rebase on next chunk)
+    qint64 m_samplesReceived;
 };
 
 #endif // WHISPERPROCESSOR_H
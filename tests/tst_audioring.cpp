@@ -0,0 +1,121 @@
+#include <QtTest>
+#include <numeric>
+#include <vector>
+#include <unistd.h>
+#include "ipc/audioring.h"
+
+class TestAudioRing : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readsWhatWasWritten();
+    void wrapsAround();
+    void dropsNewestWhenFull();
+    void sharesMappingWithConsumer();
+
+private:
+    static std::vector<qint16> ramp(qint16 first, size_t count);
+    // Everything unread, across the wrap, handed back as it is read
+    static std::vector<qint16> drain(AudioRing &ring);
+};
+
+std::vector<qint16> TestAudioRing::ramp(qint16 first, size_t count)
+{
+    std::vector<qint16> samples(count);
+    std::iota(samples.begin(), samples.end(), first);
+    return samples;
+}
+
+std::vector<qint16> TestAudioRing::drain(AudioRing &ring)
+{
+    std::vector<qint16> read;
+    size_t count = 0;
+    const qint16 *samples = ring.peek(&count);
+    while (count > 0) {
+        read.insert(read.end(), samples, samples + count);
+        ring.consume(count);
+        samples = ring.peek(&count);
+    }
+    return read;
+}
+
+void TestAudioRing::readsWhatWasWritten()
+{
+    AudioRing ring;
+    QVERIFY(ring.create(16));
+    QVERIFY(ring.isValid());
+    QVERIFY(ring.fd() >= 0);
+
+    const std::vector<qint16> samples = ramp(1, 10);
+    QCOMPARE(ring.write(samples.data(), samples.size()), size_t(10));
+    QCOMPARE(ring.available(), size_t(10));
+    QCOMPARE(drain(ring), samples);
+    QCOMPARE(ring.available(), size_t(0));
+    QCOMPARE(ring.droppedSamples(), quint64(0));
+}
+
+void TestAudioRing::wrapsAround()
+{
+    AudioRing ring;
+    QVERIFY(ring.create(16));
+
+    // Move the positions near the end of the buffer
+    const std::vector<qint16> first = ramp(1, 12);
+    ring.write(first.data(), first.size());
+    drain(ring);
+
+    // 10 samples from position 12: 4 at the end, 6 from the start
+    const std::vector<qint16> second = ramp(100, 10);
+    QCOMPARE(ring.write(second.data(), second.size()), size_t(10));
+    size_t count = 0;
+    const qint16 *samples = ring.peek(&count);
+    QCOMPARE(count, size_t(4));   // Only the contiguous run up to the end
+    QCOMPARE(samples[0], qint16(100));
+    QCOMPARE(drain(ring), second);
+    QCOMPARE(ring.droppedSamples(), quint64(0));
+}
+
+void TestAudioRing::dropsNewestWhenFull()
+{
+    AudioRing ring;
+    QVERIFY(ring.create(16));
+
+    // A stalled consumer keeps the oldest audio; what doesn't fit is counted
+    const std::vector<qint16> samples = ramp(1, 20);
+    QCOMPARE(ring.write(samples.data(), samples.size()), size_t(16));
+    QCOMPARE(ring.droppedSamples(), quint64(4));
+    QCOMPARE(ring.available(), size_t(16));
+
+    const std::vector<qint16> more = ramp(500, 3);
+    QCOMPARE(ring.write(more.data(), more.size()), size_t(0));
+    QCOMPARE(ring.droppedSamples(), quint64(7));
+
+    // What was kept is intact, and freed space takes new audio again
+    QCOMPARE(drain(ring), ramp(1, 16));
+    QCOMPARE(ring.write(more.data(), more.size()), size_t(3));
+    QCOMPARE(drain(ring), more);
+    QCOMPARE(ring.droppedSamples(), quint64(7));
+
+    ring.write(samples.data(), 5);
+    ring.reset();
+    QCOMPARE(ring.available(), size_t(0));
+}
+
+void TestAudioRing::sharesMappingWithConsumer()
+{
+    AudioRing producer;
+    QVERIFY(producer.create(16));
+
+    // As the worker does with the inherited descriptor
+    AudioRing consumer;
+    QVERIFY(consumer.attach(dup(producer.fd())));
+
+    const std::vector<qint16> samples = ramp(7, 12);
+    producer.write(samples.data(), samples.size());
+    QCOMPARE(drain(consumer), samples);
+    QCOMPARE(producer.available(), size_t(0));   // Consumed through the other mapping
+}
+
+QTEST_GUILESS_MAIN(TestAudioRing)
+#include "tst_audioring.moc"
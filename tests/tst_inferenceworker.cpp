@@ -0,0 +1,99 @@
+#include <QtTest>
+#include <csignal>
+#include <sys/types.h>
+#include "ipc/inferenceworker.h"
+#include "ipc/workerprocess.h"
+#include "config/audioconfiguration.h"
+
+// InferenceWorker starts the running executable as its worker, so this test
+// binary serves --inference-worker the way the app's main() does
+class TestInferenceWorker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void replaysConfigurationAfterKill();
+
+private:
+    bool hasStatus(const QString &text) const;
+
+    InferenceWorker *m_worker = nullptr;
+    QStringList m_status;
+    QStringList m_modelsNotFound;
+};
+
+void TestInferenceWorker::init()
+{
+    m_worker = new InferenceWorker(this);
+    m_status.clear();
+    m_modelsNotFound.clear();
+    connect(m_worker, &InferenceWorker::statusChanged, this, [this](const QString &status) {
+        m_status.append(status);
+    });
+    connect(m_worker, &InferenceWorker::modelNotFound, this, [this](const QString &model) {
+        m_modelsNotFound.append(model);
+    });
+}
+
+void TestInferenceWorker::cleanup()
+{
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+bool TestInferenceWorker::hasStatus(const QString &text) const
+{
+    for (const QString &status : m_status) {
+        if (status.contains(text)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TestInferenceWorker::replaysConfigurationAfterKill()
+{
+    // A model that doesn't exist: each worker answers the configuration by
+    // reporting it missing, which shows the configuration arrived
+    AudioConfiguration config = AudioConfiguration::defaults();
+    config.model = "qwhisper-test-no-such-model";
+    config.inferenceProcess = true;
+    QVERIFY(m_worker->start(config));
+    QTRY_COMPARE_WITH_TIMEOUT(m_modelsNotFound.size(), 1, 10000);
+    QCOMPARE(m_modelsNotFound.first(), config.model);
+    const qint64 firstPid = m_worker->processId();
+    QVERIFY(firstPid > 0);
+
+    QVERIFY(::kill(static_cast<pid_t>(firstPid), SIGKILL) == 0);
+    QTRY_VERIFY_WITH_TIMEOUT(!m_worker->isRunning(), 5000);
+    QVERIFY(hasStatus("crashed, restarting"));
+
+    // Audio captured during the backoff waits in the ring for the next worker
+    m_worker->writeAudio(QByteArray(16000 * 2, 0));
+
+    QTRY_COMPARE_WITH_TIMEOUT(m_modelsNotFound.size(), 2, 10000);
+    QCOMPARE(m_modelsNotFound.last(), config.model);
+    QVERIFY(m_worker->isRunning());
+    QVERIFY(m_worker->processId() != firstPid);
+    QVERIFY(hasStatus("restarted, catching up on 1.0 s of audio"));
+    QVERIFY(!hasStatus("dropped"));
+
+    m_worker->stop();
+    QVERIFY(!m_worker->isRunning());
+    QCOMPARE(m_worker->processId(), qint64(0));
+}
+
+int main(int argc, char *argv[])
+{
+    if (WorkerProcess::isRequested(argc, argv)) {
+        return WorkerProcess::run(argc, argv);
+    }
+    QCoreApplication app(argc, argv);
+    TestInferenceWorker test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_inferenceworker.moc"
@@ -0,0 +1,304 @@
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHash>
+#include <QTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include "whisper/remoteinference.h"
+
+// Stand-in for the whisper.cpp server example: answers POST /inference with a
+// verbose_json body, an HTTP error, or nothing at all, after a set delay
+class FakeInferenceServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Behavior { Reply, Fail, Hang };
+
+    explicit FakeInferenceServer(const QString &text, QObject *parent = nullptr)
+        : QObject(parent), m_text(text), m_behavior(Reply), m_delayMs(0), m_requests(0)
+    {
+        connect(&m_server, &QTcpServer::newConnection, this, &FakeInferenceServer::onNewConnection);
+    }
+
+    bool listen() { return m_server.listen(QHostAddress::LocalHost, 0); }
+    QString url() const { return QString("http://127.0.0.1:%1").arg(m_server.serverPort()); }
+    void setBehavior(Behavior behavior) { m_behavior = behavior; }
+    void setDelay(int ms) { m_delayMs = ms; }
+    int requestCount() const { return m_requests; }
+    QByteArray lastPath() const { return m_lastPath; }
+
+private slots:
+    void onNewConnection()
+    {
+        while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        }
+    }
+
+private:
+    void onReadyRead(QTcpSocket *socket)
+    {
+        QByteArray &buffer = m_buffers[socket];
+        buffer += socket->readAll();
+
+        // Several requests may arrive on one connection
+        for (;;) {
+            const int headerEnd = buffer.indexOf("\r\n\r\n");
+            if (headerEnd < 0) {
+                return;
+            }
+            const QByteArray header = buffer.left(headerEnd);
+            static const QRegularExpression lengthPattern("content-length:\\s*(\\d+)",
+                                                          QRegularExpression::CaseInsensitiveOption);
+            const QRegularExpressionMatch match = lengthPattern.match(QString::fromLatin1(header));
+            const int length = match.hasMatch() ? match.captured(1).toInt() : 0;
+            if (buffer.size() < headerEnd + 4 + length) {
+                return;
+            }
+            m_lastPath = header.split(' ').value(1);
+            buffer.remove(0, headerEnd + 4 + length);
+            m_requests++;
+            respond(socket);
+        }
+    }
+
+    void respond(QTcpSocket *socket)
+    {
+        if (m_behavior == Hang) {
+            return;
+        }
+
+        QByteArray status = "200 OK";
+        QByteArray body;
+        if (m_behavior == Fail) {
+            status = "500 Internal Server Error";
+            body = "{\"error\":\"failed\"}";
+        } else {
+            QJsonObject segment;
+            segment["text"] = " " + m_text;
+            segment["start"] = 0.0;
+            segment["end"] = 0.5;
+            segment["avg_logprob"] = -0.2;
+            segment["no_speech_prob"] = 0.01;
+            QJsonObject reply;
+            reply["text"] = " " + m_text;
+            reply["segments"] = QJsonArray{segment};
+            body = QJsonDocument(reply).toJson(QJsonDocument::Compact);
+        }
+        const QByteArray response = "HTTP/1.1 " + status + "\r\nContent-Type: application/json\r\n"
+                                  + "Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body;
+        QTimer::singleShot(m_delayMs, socket, [socket, response]() { socket->write(response); });
+    }
+
+    QTcpServer m_server;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    QString m_text;
+    Behavior m_behavior;
+    int m_delayMs;
+    int m_requests;
+    QByteArray m_lastPath;
+};
+
+class TestRemoteInference : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void decodesOnServer();
+    void balancesByMeasuredSpeed();
+    void retriesAfterTimeout();
+    void fallsBackWhenEveryEndpointFails();
+    void reportsInSubmissionOrder();
+    void failsOverRemovedEndpoint();
+
+private:
+    static RemoteInference::Chunk makeChunk(quint64 id, double seconds);
+    FakeInferenceServer *addServer(const QString &text);
+
+    RemoteInference *m_remote = nullptr;
+    QList<FakeInferenceServer*> m_servers;
+    QList<QPair<quint64, QList<TranscriptionSegment>>> m_decoded;
+    QList<QPair<quint64, QString>> m_failed;
+    QList<quint64> m_order;   // Both kinds of result, as reported
+};
+
+RemoteInference::Chunk TestRemoteInference::makeChunk(quint64 id, double seconds)
+{
+    RemoteInference::Chunk chunk;
+    chunk.utteranceId = id;
+    chunk.samples.assign(static_cast<size_t>(seconds * 16000), 0.0f);
+    chunk.audioStart = 1000000;
+    chunk.audioEnd = chunk.audioStart + static_cast<qint64>(seconds * 1000);
+    chunk.language = "en";
+    return chunk;
+}
+
+FakeInferenceServer *TestRemoteInference::addServer(const QString &text)
+{
+    auto *server = new FakeInferenceServer(text, this);
+    if (!server->listen()) {
+        qFatal("Cannot listen on localhost");
+    }
+    m_servers.append(server);
+    return server;
+}
+
+void TestRemoteInference::init()
+{
+    m_remote = new RemoteInference(this);
+    m_decoded.clear();
+    m_failed.clear();
+    m_order.clear();
+    connect(m_remote, &RemoteInference::chunkDecoded, this,
+            [this](const RemoteInference::Chunk &chunk, const QList<TranscriptionSegment> &segments) {
+        m_decoded.append(qMakePair(chunk.utteranceId, segments));
+        m_order.append(chunk.utteranceId);
+    });
+    connect(m_remote, &RemoteInference::chunkFailed, this,
+            [this](const RemoteInference::Chunk &chunk, const QString &error) {
+        QCOMPARE(chunk.samples.size(), size_t(16000));  // Intact, for the local model
+        m_failed.append(qMakePair(chunk.utteranceId, error));
+        m_order.append(chunk.utteranceId);
+    });
+}
+
+void TestRemoteInference::cleanup()
+{
+    delete m_remote;
+    m_remote = nullptr;
+    qDeleteAll(m_servers);
+    m_servers.clear();
+}
+
+void TestRemoteInference::decodesOnServer()
+{
+    FakeInferenceServer *server = addServer("hello");
+    m_remote->setEndpoints({server->url()});
+    QVERIFY(m_remote->isEnabled());
+
+    m_remote->submit(makeChunk(1, 1.0));
+    QTRY_COMPARE(m_decoded.size(), 1);
+    QCOMPARE(server->lastPath(), QByteArray("/inference"));
+
+    // Segment times are relative to the upload and come back on the chunk's clock
+    const TranscriptionSegment segment = m_decoded.first().second.value(0);
+    QCOMPARE(segment.text, QString("hello"));
+    QCOMPARE(segment.startTime, qint64(1000000));
+    QCOMPARE(segment.endTime, qint64(1000500));
+    QCOMPARE(segment.utteranceId, quint64(1));
+    QCOMPARE(m_remote->pendingCount(), 0);
+}
+
+void TestRemoteInference::balancesByMeasuredSpeed()
+{
+    FakeInferenceServer *slow = addServer("slow");
+    FakeInferenceServer *fast = addServer("fast");
+    slow->setDelay(800);
+    m_remote->setEndpoints({slow->url(), fast->url()});
+
+    // Unmeasured endpoints look equally fast, so the first two chunks are spread out
+    m_remote->submit(makeChunk(1, 1.0));
+    m_remote->submit(makeChunk(2, 1.0));
+    QTRY_COMPARE_WITH_TIMEOUT(m_decoded.size(), 2, 5000);
+    QCOMPARE(slow->requestCount(), 1);
+    QCOMPARE(fast->requestCount(), 1);
+
+    // Once measured, the fast endpoint takes a queue several chunks deep
+    // before the slow one is worth waiting for
+    for (quint64 id = 3; id <= 6; ++id) {
+        m_remote->submit(makeChunk(id, 1.0));
+    }
+    QTRY_COMPARE_WITH_TIMEOUT(m_decoded.size(), 6, 5000);
+    QCOMPARE(slow->requestCount(), 1);
+    QCOMPARE(fast->requestCount(), 5);
+}
+
+void TestRemoteInference::retriesAfterTimeout()
+{
+    FakeInferenceServer *hung = addServer("hung");
+    FakeInferenceServer *healthy = addServer("healthy");
+    hung->setBehavior(FakeInferenceServer::Hang);
+    m_remote->setEndpoints({hung->url(), healthy->url()});
+    m_remote->setTimeout(200);   // Plus the chunk's second of audio
+
+    m_remote->submit(makeChunk(1, 1.0));
+    QTRY_COMPARE_WITH_TIMEOUT(m_decoded.size(), 1, 5000);
+    QCOMPARE(hung->requestCount(), 1);
+    QCOMPARE(healthy->requestCount(), 1);
+    QCOMPARE(m_decoded.first().second.value(0).text, QString("healthy"));
+    QVERIFY(m_failed.isEmpty());
+
+    // The hung endpoint is skipped for a while
+    m_remote->submit(makeChunk(2, 1.0));
+    QTRY_COMPARE_WITH_TIMEOUT(m_decoded.size(), 2, 5000);
+    QCOMPARE(hung->requestCount(), 1);
+}
+
+void TestRemoteInference::fallsBackWhenEveryEndpointFails()
+{
+    FakeInferenceServer *first = addServer("first");
+    FakeInferenceServer *second = addServer("second");
+    first->setBehavior(FakeInferenceServer::Fail);
+    second->setBehavior(FakeInferenceServer::Fail);
+    m_remote->setEndpoints({first->url(), second->url()});
+
+    // Tried once on each endpoint, then handed back for local decoding
+    m_remote->submit(makeChunk(1, 1.0));
+    QTRY_COMPARE_WITH_TIMEOUT(m_failed.size(), 1, 5000);
+    QCOMPARE(first->requestCount(), 1);
+    QCOMPARE(second->requestCount(), 1);
+    QVERIFY(m_decoded.isEmpty());
+    QVERIFY(!m_remote->hasAvailableEndpoint());
+
+    // With both skipped, the next chunk fails without a request
+    m_remote->submit(makeChunk(2, 1.0));
+    QCOMPARE(m_failed.size(), 2);
+    QCOMPARE(first->requestCount() + second->requestCount(), 2);
+}
+
+void TestRemoteInference::reportsInSubmissionOrder()
+{
+    FakeInferenceServer *slow = addServer("slow");
+    FakeInferenceServer *fast = addServer("fast");
+    slow->setDelay(500);
+    m_remote->setEndpoints({slow->url(), fast->url()});
+
+    m_remote->submit(makeChunk(1, 1.0));   // Goes to the slow endpoint
+    m_remote->submit(makeChunk(2, 1.0));   // Finishes first on the fast one
+    QTRY_COMPARE_WITH_TIMEOUT(m_order.size(), 2, 5000);
+    QCOMPARE(m_order, QList<quint64>({1, 2}));
+    QCOMPARE(m_decoded.at(0).second.value(0).text, QString("slow"));
+}
+
+void TestRemoteInference::failsOverRemovedEndpoint()
+{
+    FakeInferenceServer *removed = addServer("removed");
+    FakeInferenceServer *kept = addServer("kept");
+    removed->setBehavior(FakeInferenceServer::Hang);
+    kept->setDelay(300);
+    m_remote->setEndpoints({removed->url(), kept->url()});
+
+    m_remote->submit(makeChunk(1, 1.0));   // To the endpoint about to be removed
+    m_remote->submit(makeChunk(2, 1.0));   // To the one that stays
+    QTRY_COMPARE_WITH_TIMEOUT(removed->requestCount() + kept->requestCount(), 2, 5000);
+
+    // The removed endpoint's chunk is reported for local decoding at once; the
+    // request to the remaining endpoint carries on
+    m_remote->setEndpoints({kept->url()});
+    QCOMPARE(m_failed.size(), 1);
+    QCOMPARE(m_failed.first().first, quint64(1));
+    QVERIFY(m_failed.first().second.contains("removed"));
+    QTRY_COMPARE_WITH_TIMEOUT(m_decoded.size(), 1, 5000);
+    QCOMPARE(m_order, QList<quint64>({1, 2}));
+}
+
+QTEST_GUILESS_MAIN(TestRemoteInference)
+#include "tst_remoteinference.moc"
@@ -0,0 +1,171 @@
+#include <QtTest>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+#include "whisper/streamingmel.h"
+#include "whisper/whisperprocessor.h"
+
+extern "C" {
+#include "include/whisper.h"
+}
+
+// StreamingMel has to reproduce whisper's own spectrogram, or the encoder
+// sees different input for streamed utterances than for everything else
+class TestStreamingMel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void spectrumMatchesDft();
+    void streamedFramesMatchWholeUtterance();
+    void matchesWhisperSpectrogram();
+
+private:
+    static std::vector<float> testAudio(size_t sampleCount);
+    static std::vector<float> binFilters(int melCount);
+};
+
+std::vector<float> TestStreamingMel::testAudio(size_t sampleCount)
+{
+    // A voiced-sounding tone with a wobbling pitch and a little noise
+    std::vector<float> audio(sampleCount);
+    quint32 noise = 12345;
+    double phase = 0.0;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        phase += 2.0 * M_PI * (140.0 + 30.0 * std::sin(i / 4000.0)) / 16000.0;
+        double sample = 0.0;
+        for (int harmonic = 1; harmonic <= 12; ++harmonic) {
+            sample += std::sin(harmonic * phase) / harmonic;
+        }
+        noise = noise * 1664525u + 1013904223u;
+        audio[i] = static_cast<float>(0.2 * sample * (0.6 + 0.4 * std::sin(i / 1500.0)) +
+                                      0.01 * (static_cast<double>(noise) / 4294967296.0 - 0.5));
+    }
+    return audio;
+}
+
+std::vector<float> TestStreamingMel::binFilters(int melCount)
+{
+    // Band m is FFT bin 2m on its own, so the output is the power spectrum
+    std::vector<float> filters(static_cast<size_t>(melCount) * StreamingMel::kFftBins, 0.0f);
+    for (int m = 0; m < melCount; ++m) {
+        filters[static_cast<size_t>(m) * StreamingMel::kFftBins + 2 * m] = 1.0f;
+    }
+    return filters;
+}
+
+void TestStreamingMel::spectrumMatchesDft()
+{
+    StreamingMel mel;
+    mel.setFilters(80, binFilters(80));
+    const std::vector<float> audio = testAudio(StreamingMel::kWindowLength);
+    std::vector<float> out(80);
+    mel.logMel(audio.data(), out.data());
+
+    const int n = StreamingMel::kWindowLength;
+    for (int m = 0; m < 80; ++m) {
+        std::complex<double> sum = 0.0;
+        for (int i = 0; i < n; ++i) {
+            const double window = 0.5 * (1.0 - std::cos(2.0 * M_PI * i / n));
+            sum += audio[i] * window * std::polar(1.0, -2.0 * M_PI * i * (2 * m) / n);
+        }
+        const double expected = std::log10(std::max(std::norm(sum), 1e-10));
+        QVERIFY2(std::abs(out[m] - expected) < 1e-3,
+                 qPrintable(QString("bin %1: %2 instead of %3").arg(2 * m).arg(out[m]).arg(expected)));
+    }
+}
+
+void TestStreamingMel::streamedFramesMatchWholeUtterance()
+{
+    // What WhisperProcessor assembles from MelStream's frames...
+    const size_t sampleCount = 16000 * 3 + 77;
+    const std::vector<float> audio = testAudio(sampleCount);
+    StreamingMel streamed;
+    streamed.setFilters(80, binFilters(80));
+    streamed.begin(audio.data(), sampleCount);
+    StreamingMel frameSource;
+    frameSource.setFilters(80, binFilters(80));
+    std::vector<float> frames;
+    size_t frame = streamed.framesComputed();
+    while (frame * StreamingMel::kHopLength + StreamingMel::kWindowLength / 2 <= sampleCount) {
+        frames.resize(frames.size() + 80);
+        frameSource.logMel(audio.data() + frame * StreamingMel::kHopLength - StreamingMel::kWindowLength / 2,
+                           frames.data() + frames.size() - 80);
+        frame++;
+    }
+    streamed.append(frames.data(), frames.size() / 80);
+    int streamedCount = 0;
+    const std::vector<float> fromStream = streamed.finish(audio.data(), sampleCount, 3000, streamedCount);
+
+    // ...is the spectrogram computed in one go
+    StreamingMel whole;
+    whole.setFilters(80, binFilters(80));
+    int wholeCount = 0;
+    const std::vector<float> inOneGo = whole.finish(audio.data(), sampleCount, 3000, wholeCount);
+    QCOMPARE(streamedCount, wholeCount);
+    QVERIFY(fromStream == inOneGo);
+}
+
+void TestStreamingMel::matchesWhisperSpectrogram()
+{
+    // Needs a real model for its filterbank and encoder
+    QString modelPath = qEnvironmentVariable("QWHISPER_TEST_MODEL");
+    if (modelPath.isEmpty()) {
+        modelPath = WhisperProcessor::getModelPath("tiny.en");
+    }
+    if (modelPath.isEmpty() || !QFile::exists(modelPath)) {
+        QSKIP("No model found; set QWHISPER_TEST_MODEL to a whisper.cpp model file");
+    }
+
+    int melCount = 0;
+    std::vector<float> filters;
+    QVERIFY(StreamingMel::readFilters(QFile::encodeName(modelPath).toStdString(), melCount, filters));
+
+    whisper_context_params params = whisper_context_default_params();
+    params.use_gpu = false;
+    whisper_context *context = whisper_init_from_file_with_params_no_state(
+        QFile::encodeName(modelPath).constData(), params);
+    QVERIFY(context);
+    QCOMPARE(melCount, whisper_model_n_mels(context));
+    whisper_state *reference = whisper_init_state(context);
+    whisper_state *streamed = whisper_init_state(context);
+    QVERIFY(reference && streamed);
+
+    const size_t sampleCount = 16000 * 5 / 2 + 33;
+    const std::vector<float> audio = testAudio(sampleCount);
+    QCOMPARE(whisper_pcm_to_mel_with_state(context, reference, audio.data(), static_cast<int>(sampleCount), 1), 0);
+
+    StreamingMel mel;
+    mel.setFilters(melCount, filters);
+    for (size_t received = 1600; received < sampleCount; received += 1600) {
+        mel.update(audio.data(), received);
+    }
+    int frameCount = 0;
+    std::vector<float> spectrogram = mel.finish(audio.data(), sampleCount, 3000, frameCount);
+    QCOMPARE(whisper_set_mel_with_state(context, streamed, spectrogram.data(), frameCount, melCount), 0);
+
+    // The spectrogram isn't exposed, so compare what the model makes of it:
+    // the first token's logits after encoding either one
+    const whisper_token prompt[] = {whisper_token_sot(context)};
+    std::vector<float> logits[2];
+    whisper_state *states[2] = {reference, streamed};
+    for (int i = 0; i < 2; ++i) {
+        QCOMPARE(whisper_encode_with_state(context, states[i], 0, 2), 0);
+        QCOMPARE(whisper_decode_with_state(context, states[i], prompt, 1, 0, 2), 0);
+        const float *out = whisper_get_logits_from_state(states[i]);
+        logits[i].assign(out, out + whisper_n_vocab(context));
+    }
+    float largest = 0.0f;
+    for (size_t i = 0; i < logits[0].size(); ++i) {
+        largest = std::max(largest, std::abs(logits[0][i] - logits[1][i]));
+    }
+    QVERIFY2(largest < 1e-2f, qPrintable(QString("logits differ by up to %1").arg(largest)));
+
+    whisper_free_state(streamed);
+    whisper_free_state(reference);
+    whisper_free(context);
+}
+
+QTEST_GUILESS_MAIN(TestStreamingMel)
+#include "tst_streamingmel.moc"
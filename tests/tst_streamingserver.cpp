@@ -0,0 +1,358 @@
+#include <QtTest>
+#include <QTcpSocket>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "server/streamingserver.h"
+#include "server/decodescheduler.h"
+#include "config/audioconfiguration.h"
+
+namespace {
+constexpr int kSampleRate = 16000;
+
+// A tone is speech as far as the server's energy VAD is concerned
+QByteArray tone(double seconds)
+{
+    const int count = static_cast<int>(seconds * kSampleRate);
+    QByteArray pcm(count * 2, 0);
+    for (int i = 0; i < count; ++i) {
+        const double sample = 0.3 * std::sin(2.0 * M_PI * 440.0 * i / kSampleRate);
+        qToLittleEndian<qint16>(static_cast<qint16>(sample * 32767.0), pcm.data() + i * 2);
+    }
+    return pcm;
+}
+
+QByteArray silence(double seconds)
+{
+    return QByteArray(static_cast<int>(seconds * kSampleRate) * 2, 0);
+}
+}
+
+// Speaks the server's two streaming protocols and collects the events
+class StreamClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Protocol { WebSocket, ChunkedPost };
+
+    explicit StreamClient(Protocol protocol, QObject *parent = nullptr)
+        : QObject(parent), m_protocol(protocol), m_headerDone(false), m_closed(false)
+    {
+        connect(&m_socket, &QTcpSocket::readyRead, this, &StreamClient::onReadyRead);
+    }
+
+    bool open(quint16 port)
+    {
+        m_socket.connectToHost(QHostAddress::LocalHost, port);
+        if (!m_socket.waitForConnected(5000)) {
+            return false;
+        }
+        if (m_protocol == WebSocket) {
+            m_socket.write("GET /stream HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\n"
+                           "Connection: Upgrade\r\nSec-WebSocket-Version: 13\r\n"
+                           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n\r\n");
+        } else {
+            m_socket.write("POST /transcribe HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                           "Content-Type: application/octet-stream\r\nTransfer-Encoding: chunked\r\n\r\n");
+        }
+        return true;
+    }
+
+    void sendAudio(const QByteArray &pcm)
+    {
+        if (m_protocol == WebSocket) {
+            sendFrame(0x2, pcm);
+        } else {
+            m_socket.write(QByteArray::number(pcm.size(), 16) + "\r\n" + pcm + "\r\n");
+        }
+    }
+
+    void end()
+    {
+        if (m_protocol == WebSocket) {
+            sendFrame(0x1, "{\"type\":\"end\"}");
+        } else {
+            m_socket.write("0\r\n\r\n");
+        }
+    }
+
+    QList<QJsonObject> events(const QString &type) const
+    {
+        QList<QJsonObject> matching;
+        for (const QJsonObject &event : m_events) {
+            if (event.value("type").toString() == type) {
+                matching.append(event);
+            }
+        }
+        return matching;
+    }
+
+    QByteArray header() const { return m_header; }
+    qint64 unsent() const { return m_socket.bytesToWrite(); }
+    bool isClosed() const { return m_closed; }
+
+private slots:
+    void onReadyRead()
+    {
+        m_input += m_socket.readAll();
+        if (!m_headerDone) {
+            const int headerEnd = m_input.indexOf("\r\n\r\n");
+            if (headerEnd < 0) {
+                return;
+            }
+            m_header = m_input.left(headerEnd);
+            m_input.remove(0, headerEnd + 4);
+            m_headerDone = true;
+        }
+        if (m_protocol == WebSocket) {
+            readFrames();
+        } else {
+            readChunks();
+        }
+    }
+
+private:
+    void readFrames()
+    {
+        // Server frames are unmasked and our events never fragmented
+        while (m_input.size() >= 2) {
+            const quint8 opcode = static_cast<quint8>(m_input[0]) & 0x0F;
+            qint64 length = static_cast<quint8>(m_input[1]) & 0x7F;
+            int offset = 2;
+            if (length == 126) {
+                if (m_input.size() < 4) {
+                    return;
+                }
+                length = qFromBigEndian<quint16>(m_input.constData() + 2);
+                offset = 4;
+            }
+            if (m_input.size() < offset + length) {
+                return;
+            }
+            const QByteArray payload = m_input.mid(offset, length);
+            m_input.remove(0, offset + length);
+            if (opcode == 0x1) {
+                m_events.append(QJsonDocument::fromJson(payload).object());
+            } else if (opcode == 0x8) {
+                m_closed = true;
+            }
+        }
+    }
+
+    void readChunks()
+    {
+        // One event per line, one line per chunk
+        for (;;) {
+            const int lineEnd = m_input.indexOf("\r\n");
+            if (lineEnd < 0) {
+                return;
+            }
+            const int size = m_input.left(lineEnd).toInt(nullptr, 16);
+            if (size == 0) {
+                m_closed = true;
+                return;
+            }
+            if (m_input.size() < lineEnd + 2 + size + 2) {
+                return;
+            }
+            m_events.append(QJsonDocument::fromJson(m_input.mid(lineEnd + 2, size)).object());
+            m_input.remove(0, lineEnd + 2 + size + 2);
+        }
+    }
+
+    void sendFrame(quint8 opcode, const QByteArray &payload)
+    {
+        QByteArray frame;
+        frame.append(static_cast<char>(0x80 | opcode));
+        if (payload.size() < 126) {
+            frame.append(static_cast<char>(0x80 | payload.size()));
+        } else if (payload.size() <= 0xFFFF) {
+            frame.append(static_cast<char>(0x80 | 126));
+            QByteArray length(2, 0);
+            qToBigEndian<quint16>(static_cast<quint16>(payload.size()), length.data());
+            frame += length;
+        } else {
+            frame.append(static_cast<char>(0x80 | 127));
+            QByteArray length(8, 0);
+            qToBigEndian<quint64>(static_cast<quint64>(payload.size()), length.data());
+            frame += length;
+        }
+        const QByteArray mask("\x12\x34\x56\x78", 4);
+        QByteArray masked = payload;
+        for (qsizetype i = 0; i < masked.size(); ++i) {
+            masked[i] = masked[i] ^ mask[i % 4];
+        }
+        m_socket.write(frame + mask + masked);
+    }
+
+    QTcpSocket m_socket;
+    Protocol m_protocol;
+    QByteArray m_input;
+    QByteArray m_header;
+    bool m_headerDone;
+    bool m_closed;
+    QList<QJsonObject> m_events;
+};
+
+class TestStreamingServer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void streamsOverWebSocket();
+    void streamsOverChunkedPost();
+    void pausesReadingWhileBacklogged();
+    void closesStalledRequests();
+
+private:
+    void speakOneUtterance(StreamClient &client);
+
+    StreamingServer *m_server = nullptr;
+    std::atomic<bool> m_decoderBlocked{false};
+};
+
+void TestStreamingServer::init()
+{
+    AudioConfiguration config = AudioConfiguration::defaults();
+    config.streamServerDecoders = 1;
+    m_server = new StreamingServer(this);
+    m_server->updateConfiguration(config);
+
+    // Stands in for whisper: names the kind of decode and spans the audio given
+    m_decoderBlocked = false;
+    m_server->scheduler()->setDecodeFunction([this](const std::vector<float> &samples, bool final) {
+        while (m_decoderBlocked.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        TranscriptionSegment segment;
+        segment.text = final ? "final" : "interim";
+        segment.startTime = 0;
+        segment.endTime = static_cast<qint64>(samples.size()) * 1000 / kSampleRate;
+        return QList<TranscriptionSegment>{segment};
+    });
+    QVERIFY(m_server->listen(0));
+    QVERIFY(m_server->port() != 0);
+}
+
+void TestStreamingServer::cleanup()
+{
+    m_decoderBlocked = false;   // Shutdown waits for the decode in flight
+    delete m_server;
+    m_server = nullptr;
+}
+
+void TestStreamingServer::speakOneUtterance(StreamClient &client)
+{
+    QTRY_COMPARE(client.events("ready").size(), 1);
+
+    // Past a second of speech the server decodes the utterance so far
+    client.sendAudio(tone(1.5));
+    QTRY_COMPARE(client.events("interim").size(), 1);
+    const QJsonObject interim = client.events("interim").first();
+    QCOMPARE(interim.value("text").toString(), QString("interim"));
+    QCOMPARE(interim.value("utterance").toInt(), 1);
+    QCOMPARE(interim.value("end").toInt(), 1500);
+
+    // A 0.6 s pause ends it: 2 s of speech and the pause go to the final decode
+    client.sendAudio(tone(0.5) + silence(1.0));
+    QTRY_COMPARE(client.events("final").size(), 1);
+    const QJsonObject result = client.events("final").first();
+    QCOMPARE(result.value("text").toString(), QString("final"));
+    QCOMPARE(result.value("utterance").toInt(), 1);
+    QCOMPARE(result.value("start").toInt(), 0);
+    QCOMPARE(result.value("end").toInt(), 2600);
+    QCOMPARE(result.value("segments").toArray().size(), 1);
+
+    client.end();
+    QTRY_COMPARE(client.events("done").size(), 1);
+    QTRY_VERIFY(client.isClosed());
+    QCOMPARE(client.events("final").size(), 1);
+    QVERIFY(client.events("error").isEmpty());
+}
+
+void TestStreamingServer::streamsOverWebSocket()
+{
+    StreamClient client(StreamClient::WebSocket);
+    QVERIFY(client.open(m_server->port()));
+    QTRY_VERIFY(client.header().startsWith("HTTP/1.1 101"));
+    // RFC 6455's example key and its accept value
+    QVERIFY(client.header().contains("s3pPLMBiTxaQ9kYGzzhZRbK+xOo="));
+
+    speakOneUtterance(client);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    QCOMPARE(client.events("ready").first().value("priority").toString(), QString("live"));
+}
+
+void TestStreamingServer::streamsOverChunkedPost()
+{
+    StreamClient client(StreamClient::ChunkedPost);
+    QVERIFY(client.open(m_server->port()));
+    QTRY_VERIFY(client.header().startsWith("HTTP/1.1 200"));
+    QVERIFY(client.header().contains("Transfer-Encoding: chunked"));
+
+    speakOneUtterance(client);
+    if (QTest::currentTestFailed()) {
+        return;
+    }
+    QCOMPARE(client.events("ready").first().value("priority").toString(), QString("batch"));
+}
+
+void TestStreamingServer::pausesReadingWhileBacklogged()
+{
+    StreamClient client(StreamClient::WebSocket);
+    QVERIFY(client.open(m_server->port()));
+    QTRY_COMPARE(client.events("ready").size(), 1);
+
+    // About 11 minutes of utterances, more than the kernel's socket buffers
+    // hold, sent while the decoder is stuck
+    m_decoderBlocked = true;
+    const int utterances = 400;
+    const QByteArray utterance = tone(1.0) + silence(0.7);
+    for (int i = 0; i < utterances; ++i) {
+        client.sendAudio(utterance);
+    }
+
+    // Past 30 s of undecoded finals the server stops reading, so the audio
+    // backs up on the client's side
+    QTest::qWait(1000);
+    QVERIFY(client.unsent() > 0);
+    QVERIFY(client.events("final").isEmpty());
+
+    // Once decoding catches up, reading resumes and nothing was lost
+    m_decoderBlocked = false;
+    QTRY_COMPARE_WITH_TIMEOUT(client.events("final").size(), utterances, 60000);
+    QCOMPARE(client.unsent(), qint64(0));
+    const QList<QJsonObject> finals = client.events("final");
+    for (int i = 0; i < finals.size(); ++i) {
+        QCOMPARE(finals[i].value("utterance").toInt(), i + 1);
+    }
+
+    client.end();
+    QTRY_COMPARE(client.events("done").size(), 1);
+}
+
+void TestStreamingServer::closesStalledRequests()
+{
+    // Half a request header, then nothing
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress::LocalHost, m_server->port());
+    QVERIFY(socket.waitForConnected(5000));
+    socket.write("GET /stream HTTP/1.1\r\nHost: 127.0.0.1\r\n");
+    QVERIFY(socket.waitForBytesWritten(5000));
+
+    QTRY_COMPARE_WITH_TIMEOUT(socket.state(), QAbstractSocket::UnconnectedState, 20000);
+}
+
+QTEST_GUILESS_MAIN(TestStreamingServer)
+#include "tst_streamingserver.moc"